@@ -29,6 +29,9 @@
 #ifndef CLIENT_LINUX_CRASH_GENERATION_CLIENT_INFO_H_
 #define CLIENT_LINUX_CRASH_GENERATION_CLIENT_INFO_H_
 
+#include <stdint.h>
+#include <sys/types.h>
+
 namespace google_breakpad {
 
 class CrashGenerationServer;
@@ -37,14 +40,30 @@ class ClientInfo {
  public:
   ClientInfo(pid_t pid, CrashGenerationServer* crash_server)
     : crash_server_(crash_server),
-      pid_(pid) {}
+      pid_(pid),
+      queue_time_us_(0),
+      write_time_us_(0) {}
+
+  ClientInfo(pid_t pid, CrashGenerationServer* crash_server,
+             int64_t queue_time_us, int64_t write_time_us)
+    : crash_server_(crash_server),
+      pid_(pid),
+      queue_time_us_(queue_time_us),
+      write_time_us_(write_time_us) {}
 
   CrashGenerationServer* crash_server() const { return crash_server_; }
   pid_t pid() const { return pid_; }
 
+  // How long the client's dump request waited to be handled, and how long
+  // its minidump took to write, in microseconds.
+  int64_t queue_time_us() const { return queue_time_us_; }
+  int64_t write_time_us() const { return write_time_us_; }
+
  private:
   CrashGenerationServer* crash_server_;
   pid_t pid_;
+  int64_t queue_time_us_;
+  int64_t write_time_us_;
 };
 
 }
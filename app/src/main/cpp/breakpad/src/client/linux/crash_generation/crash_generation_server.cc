@@ -40,8 +40,10 @@
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <vector>
 
 #include "client/linux/crash_generation/crash_generation_server.h"
@@ -54,8 +56,25 @@
 
 static const char kCommandQuit = 'x';
 
+static int64_t MonotonicTimeUs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
 namespace google_breakpad {
 
+struct CrashGenerationServer::DumpRequest {
+  pid_t crashing_pid;
+  // Closing this tells the client that its dump has been written.
+  int signal_fd;
+  string minidump_filename;
+  // When the request was received, from MonotonicTimeUs().
+  int64_t received_us;
+  char crash_context[sizeof(ExceptionHandler::CrashContext)];
+};
+
 CrashGenerationServer::CrashGenerationServer(
   const int listen_fd,
   OnClientDumpRequestCallback dump_callback,
@@ -70,18 +89,35 @@ CrashGenerationServer::CrashGenerationServer(
     exit_callback_(exit_callback),
     exit_context_(exit_context),
     generate_dumps_(generate_dumps),
-    started_(false)
+    started_(false),
+    max_workers_(0),
+    max_queued_(0),
+    stopping_workers_(false)
 {
   if (dump_path)
     dump_dir_ = *dump_path;
   else
     dump_dir_ = "/tmp";
+
+  pthread_mutex_init(&queue_lock_, NULL);
+  pthread_cond_init(&queue_cond_, NULL);
 }
 
 CrashGenerationServer::~CrashGenerationServer()
 {
   if (started_)
     Stop();
+
+  pthread_cond_destroy(&queue_cond_);
+  pthread_mutex_destroy(&queue_lock_);
+}
+
+void
+CrashGenerationServer::SetWorkerPool(int max_workers, size_t max_queued)
+{
+  assert(!started_);
+  max_workers_ = max_workers;
+  max_queued_ = max_queued;
 }
 
 bool
@@ -105,9 +141,22 @@ CrashGenerationServer::Start()
   control_pipe_in_ = control_pipe[0];
   control_pipe_out_ = control_pipe[1];
 
+  stopping_workers_ = false;
+  for (int i = 0; i < max_workers_; ++i) {
+    pthread_t worker;
+    if (pthread_create(&worker, NULL,
+                       WorkerMain, reinterpret_cast<void*>(this))) {
+      StopWorkers();
+      return false;
+    }
+    workers_.push_back(worker);
+  }
+
   if (pthread_create(&thread_, NULL,
-                     ThreadMain, reinterpret_cast<void*>(this)))
+                     ThreadMain, reinterpret_cast<void*>(this))) {
+    StopWorkers();
     return false;
+  }
 
   started_ = true;
   return true;
@@ -126,12 +175,30 @@ CrashGenerationServer::Stop()
   void* dummy;
   pthread_join(thread_, &dummy);
 
+  // No more requests can be queued now.
+  StopWorkers();
+
   close(control_pipe_in_);
   close(control_pipe_out_);
 
   started_ = false;
 }
 
+void
+CrashGenerationServer::StopWorkers()
+{
+  pthread_mutex_lock(&queue_lock_);
+  stopping_workers_ = true;
+  pthread_cond_broadcast(&queue_cond_);
+  pthread_mutex_unlock(&queue_lock_);
+
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    void* dummy;
+    pthread_join(workers_[i], &dummy);
+  }
+  workers_.clear();
+}
+
 //static
 bool
 CrashGenerationServer::CreateReportChannel(int* server_fd, int* client_fd)
@@ -263,28 +330,67 @@ CrashGenerationServer::ClientEvent(short revents)
     return true;
   }
 
-  string minidump_filename;
-  if (!MakeMinidumpFilename(minidump_filename))
-    return true;
-
-  if (!google_breakpad::WriteMinidump(minidump_filename.c_str(),
-                                      crashing_pid, crash_context,
-                                      kCrashContextSize)) {
+  DumpRequest* request = new DumpRequest;
+  request->crashing_pid = crashing_pid;
+  request->signal_fd = signal_fd;
+  request->received_us = MonotonicTimeUs();
+  memcpy(request->crash_context, crash_context, kCrashContextSize);
+  if (!MakeMinidumpFilename(request->minidump_filename)) {
     close(signal_fd);
+    delete request;
     return true;
   }
 
-  if (dump_callback_) {
-    ClientInfo info(crashing_pid, this);
+  if (max_workers_ > 0)
+    QueueDump(request);
+  else
+    WriteDump(request);
 
-    dump_callback_(dump_context_, &info, &minidump_filename);
+  return true;
+}
+
+void
+CrashGenerationServer::WriteDump(DumpRequest* request)
+{
+  const int64_t start_us = MonotonicTimeUs();
+  const bool written =
+      google_breakpad::WriteMinidump(request->minidump_filename.c_str(),
+                                     request->crashing_pid,
+                                     request->crash_context,
+                                     sizeof(request->crash_context));
+  const int64_t end_us = MonotonicTimeUs();
+
+  if (written && dump_callback_) {
+    ClientInfo info(request->crashing_pid, this,
+                    start_us - request->received_us, end_us - start_us);
+
+    dump_callback_(dump_context_, &info, &request->minidump_filename);
   }
 
   // Send the done signal to the process: it can exit now.
   // (Closing this will make the child's sys_read unblock and return 0.)
-  close(signal_fd);
+  close(request->signal_fd);
+  delete request;
+}
 
-  return true;
+void
+CrashGenerationServer::QueueDump(DumpRequest* request)
+{
+  pthread_mutex_lock(&queue_lock_);
+  // Idle workers take requests as soon as they're queued, so only the
+  // requests beyond those count against |max_queued_|.
+  const size_t idle_workers = workers_.size() - dumping_pids_.size();
+  if (queue_.size() >= idle_workers + max_queued_) {
+    pthread_mutex_unlock(&queue_lock_);
+    // Release the client rather than keep it waiting for longer than its
+    // dump would be useful.
+    close(request->signal_fd);
+    delete request;
+    return;
+  }
+  queue_.push_back(request);
+  pthread_cond_broadcast(&queue_cond_);
+  pthread_mutex_unlock(&queue_lock_);
 }
 
 bool
@@ -325,6 +431,48 @@ CrashGenerationServer::MakeMinidumpFilename(string& outFilename)
   return true;
 }
 
+// The following methods/functions execute on the worker threads
+
+void
+CrashGenerationServer::RunWorker()
+{
+  pthread_mutex_lock(&queue_lock_);
+  while (true) {
+    // Take the oldest request for a process that isn't being dumped already:
+    // a process can only be ptraced by one worker at a time.
+    DumpRequest* request = NULL;
+    for (std::deque<DumpRequest*>::iterator it = queue_.begin();
+         it != queue_.end(); ++it) {
+      if (std::find(dumping_pids_.begin(), dumping_pids_.end(),
+                    (*it)->crashing_pid) == dumping_pids_.end()) {
+        request = *it;
+        queue_.erase(it);
+        break;
+      }
+    }
+
+    if (!request) {
+      if (stopping_workers_ && queue_.empty())
+        break;
+      pthread_cond_wait(&queue_cond_, &queue_lock_);
+      continue;
+    }
+
+    const pid_t crashing_pid = request->crashing_pid;
+    dumping_pids_.push_back(crashing_pid);
+    pthread_mutex_unlock(&queue_lock_);
+
+    WriteDump(request);
+
+    pthread_mutex_lock(&queue_lock_);
+    dumping_pids_.erase(std::find(dumping_pids_.begin(), dumping_pids_.end(),
+                                  crashing_pid));
+    // Another request from the same process may be waiting for this one.
+    pthread_cond_broadcast(&queue_cond_);
+  }
+  pthread_mutex_unlock(&queue_lock_);
+}
+
 // static
 void*
 CrashGenerationServer::ThreadMain(void* arg)
@@ -333,4 +481,12 @@ CrashGenerationServer::ThreadMain(void* arg)
   return NULL;
 }
 
+// static
+void*
+CrashGenerationServer::WorkerMain(void* arg)
+{
+  reinterpret_cast<CrashGenerationServer*>(arg)->RunWorker();
+  return NULL;
+}
+
 }  // namespace google_breakpad
@@ -30,8 +30,11 @@
 #define CLIENT_LINUX_CRASH_GENERATION_CRASH_GENERATION_SERVER_H_
 
 #include <pthread.h>
+#include <sys/types.h>
 
+#include <deque>
 #include <string>
+#include <vector>
 
 #include "common/using_std_string.h"
 
@@ -74,6 +77,16 @@ public:
 
   ~CrashGenerationServer();
 
+  // Have dumps written by a pool of up to |max_workers| threads, so that
+  // dumps of different crashing processes are written in parallel rather
+  // than one after another on the server thread. Once every worker is busy,
+  // requests wait for one in a queue of up to |max_queued|; requests beyond
+  // that are turned away and their clients released without a dump. The dump request callback
+  // is called on the worker thread, and its ClientInfo reports how long the
+  // request waited and how long the dump took to write.
+  // Must be called before Start(). By default there are no workers.
+  void SetWorkerPool(int max_workers, size_t max_queued);
+
   // Perform initialization steps needed to start listening to clients.
   //
   // Return true if initialization is successful; false otherwise.
@@ -89,6 +102,9 @@ public:
   static bool CreateReportChannel(int* server_fd, int* client_fd);
 
 private:
+  // A client's dump request, as received on the server thread.
+  struct DumpRequest;
+
   // Run the server's event loop
   void Run();
 
@@ -103,9 +119,26 @@ private:
   // Return a unique filename at which a minidump can be written
   bool MakeMinidumpFilename(string& outFilename);
 
+  // Write the minidump for |request|, tell the client it's done and
+  // delete |request|.
+  void WriteDump(DumpRequest* request);
+
+  // Hand |request| over to the worker pool, or turn it away if every
+  // worker is busy and the queue is full.
+  void QueueDump(DumpRequest* request);
+
+  // Stop the worker pool once the queued requests have been written.
+  void StopWorkers();
+
+  // Run a worker's loop, writing queued dumps until StopWorkers()
+  void RunWorker();
+
   // Trampoline to |Run()|
   static void* ThreadMain(void* arg);
 
+  // Trampoline to |RunWorker()|
+  static void* WorkerMain(void* arg);
+
   int server_fd_;
 
   OnClientDumpRequestCallback dump_callback_;
@@ -124,6 +157,19 @@ private:
   int control_pipe_in_;
   int control_pipe_out_;
 
+  // The worker pool; see SetWorkerPool(). |queue_lock_| guards the members
+  // after it.
+  int max_workers_;
+  size_t max_queued_;
+  std::vector<pthread_t> workers_;
+  pthread_mutex_t queue_lock_;
+  pthread_cond_t queue_cond_;
+  std::deque<DumpRequest*> queue_;
+  // The processes that workers are dumping, which can't be dumped by
+  // another worker at the same time.
+  std::vector<pid_t> dumping_pids_;
+  bool stopping_workers_;
+
   // disable these
   CrashGenerationServer(const CrashGenerationServer&);
   CrashGenerationServer& operator=(const CrashGenerationServer&);
@@ -0,0 +1,295 @@
+// Copyright 2024 Google LLC
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google LLC nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>  // Must come first
+#endif
+
+#include <pthread.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include <map>
+#include <string>
+
+#include "breakpad_googletest_includes.h"
+#include "client/linux/crash_generation/client_info.h"
+#include "client/linux/crash_generation/crash_generation_client.h"
+#include "client/linux/crash_generation/crash_generation_server.h"
+#include "client/linux/handler/exception_handler.h"
+#include "common/scoped_ptr.h"
+#include "common/tests/auto_tempdir.h"
+#include "common/using_std_string.h"
+
+using namespace google_breakpad;
+
+namespace {
+
+// How long a test waits for the server before giving up.
+const int kTimeoutMs = 10000;
+
+// A dump request callback that records each dump, and that can hold the
+// worker writing a dump until it's released.
+class DumpRecorder {
+ public:
+  struct Dump {
+    string path;
+    off_t size;
+    pthread_t thread;
+    int64_t queue_time_us;
+    int64_t write_time_us;
+  };
+
+  DumpRecorder() : blocked_(false), waiting_(0) {
+    pthread_mutex_init(&lock_, NULL);
+    pthread_cond_init(&cond_, NULL);
+  }
+
+  ~DumpRecorder() {
+    pthread_cond_destroy(&cond_);
+    pthread_mutex_destroy(&lock_);
+  }
+
+  static void OnDump(void* context, const ClientInfo* info,
+                     const string* path) {
+    reinterpret_cast<DumpRecorder*>(context)->Record(info, *path);
+  }
+
+  // Hold the workers in the callback until Unblock() is called.
+  void Block() {
+    pthread_mutex_lock(&lock_);
+    blocked_ = true;
+    pthread_mutex_unlock(&lock_);
+  }
+
+  void Unblock() {
+    pthread_mutex_lock(&lock_);
+    blocked_ = false;
+    pthread_cond_broadcast(&cond_);
+    pthread_mutex_unlock(&lock_);
+  }
+
+  // Wait until |count| dumps have been written, including any being held
+  // in the callback. Returns false on timeout.
+  bool WaitForDumps(size_t count) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += kTimeoutMs / 1000;
+    pthread_mutex_lock(&lock_);
+    int error = 0;
+    while (dumps_.size() + waiting_ < count && error == 0)
+      error = pthread_cond_timedwait(&cond_, &lock_, &deadline);
+    const bool done = dumps_.size() + waiting_ >= count;
+    pthread_mutex_unlock(&lock_);
+    return done;
+  }
+
+  std::map<pid_t, Dump> dumps() {
+    pthread_mutex_lock(&lock_);
+    std::map<pid_t, Dump> dumps = dumps_;
+    pthread_mutex_unlock(&lock_);
+    return dumps;
+  }
+
+ private:
+  void Record(const ClientInfo* info, const string& path) {
+    Dump dump;
+    dump.path = path;
+    struct stat st;
+    dump.size = stat(path.c_str(), &st) == 0 ? st.st_size : 0;
+    dump.thread = pthread_self();
+    dump.queue_time_us = info->queue_time_us();
+    dump.write_time_us = info->write_time_us();
+
+    pthread_mutex_lock(&lock_);
+    ++waiting_;
+    pthread_cond_broadcast(&cond_);
+    while (blocked_)
+      pthread_cond_wait(&cond_, &lock_);
+    --waiting_;
+    dumps_[info->pid()] = dump;
+    pthread_cond_broadcast(&cond_);
+    pthread_mutex_unlock(&lock_);
+  }
+
+  pthread_mutex_t lock_;
+  pthread_cond_t cond_;
+  bool blocked_;
+  size_t waiting_;
+  std::map<pid_t, Dump> dumps_;
+};
+
+class CrashGenerationServerTest : public ::testing::Test {
+ protected:
+  void SetUp() {
+    ASSERT_TRUE(CrashGenerationServer::CreateReportChannel(&server_fd_,
+                                                           &client_fd_));
+    dump_dir_ = temp_dir_.path();
+    server_.reset(new CrashGenerationServer(server_fd_, DumpRecorder::OnDump,
+                                            &recorder_, NULL, NULL, true,
+                                            &dump_dir_));
+  }
+
+  void TearDown() {
+    server_.reset();
+    close(server_fd_);
+    close(client_fd_);
+  }
+
+  // Fork a client that requests a dump and exits once the server has
+  // released it.
+  pid_t RequestDump() {
+    const pid_t child = fork();
+    if (child == 0) {
+      CrashGenerationClient* client =
+          CrashGenerationClient::TryCreate(client_fd_);
+      ExceptionHandler::CrashContext context;
+      memset(&context, 0, sizeof(context));
+      getcontext(&context.context);
+      context.tid = syscall(__NR_gettid);
+      _exit(client && client->RequestDump(&context, sizeof(context)) ? 0 : 1);
+    }
+    return child;
+  }
+
+  // Wait for |child| to exit, which it only does once the server has
+  // released it. The server may be ptracing a child until its dump has been
+  // written, so this must not be called on a child that might be queued.
+  // Returns false on timeout.
+  static bool WaitForExit(pid_t child) {
+    for (int i = 0; i < kTimeoutMs / 10; ++i) {
+      int status;
+      if (waitpid(child, &status, WNOHANG) == child)
+        return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+      usleep(10000);
+    }
+    return false;
+  }
+
+  AutoTempDir temp_dir_;
+  string dump_dir_;
+  int server_fd_;
+  int client_fd_;
+  DumpRecorder recorder_;
+  scoped_ptr<CrashGenerationServer> server_;
+};
+
+}  // namespace
+
+TEST_F(CrashGenerationServerTest, WorkersWriteConcurrentRequests) {
+  const int kClients = 4;
+  server_->SetWorkerPool(2, kClients);
+  ASSERT_TRUE(server_->Start());
+
+  pid_t children[kClients];
+  for (int i = 0; i < kClients; ++i)
+    children[i] = RequestDump();
+  ASSERT_TRUE(recorder_.WaitForDumps(kClients));
+  for (int i = 0; i < kClients; ++i)
+    ASSERT_TRUE(WaitForExit(children[i]));
+  server_->Stop();
+
+  std::map<pid_t, DumpRecorder::Dump> dumps = recorder_.dumps();
+  ASSERT_EQ(static_cast<size_t>(kClients), dumps.size());
+  for (int i = 0; i < kClients; ++i) {
+    ASSERT_TRUE(dumps.count(children[i]));
+    const DumpRecorder::Dump& dump = dumps[children[i]];
+    EXPECT_GT(dump.size, 0);
+    EXPECT_FALSE(pthread_equal(dump.thread, pthread_self()));
+    EXPECT_GE(dump.queue_time_us, 0);
+    EXPECT_GT(dump.write_time_us, 0);
+  }
+}
+
+TEST_F(CrashGenerationServerTest, IdleWorkersNeedNoQueue) {
+  server_->SetWorkerPool(2, 0);
+  ASSERT_TRUE(server_->Start());
+
+  const pid_t child = RequestDump();
+  ASSERT_TRUE(recorder_.WaitForDumps(1));
+  ASSERT_TRUE(WaitForExit(child));
+  server_->Stop();
+
+  EXPECT_EQ(1U, recorder_.dumps().count(child));
+}
+
+TEST_F(CrashGenerationServerTest, FullQueueTurnsRequestsAway) {
+  server_->SetWorkerPool(1, 1);
+  ASSERT_TRUE(server_->Start());
+
+  // Keep the only worker busy with the first request...
+  recorder_.Block();
+  const pid_t busy = RequestDump();
+  ASSERT_TRUE(recorder_.WaitForDumps(1));
+
+  // ...so that the second waits in the queue. Give the server time to
+  // receive it, so that it waits measurably.
+  const pid_t queued = RequestDump();
+  usleep(100000);
+
+  // The queue is full, so the third is released without a dump.
+  const pid_t rejected = RequestDump();
+  EXPECT_TRUE(WaitForExit(rejected));
+
+  recorder_.Unblock();
+  ASSERT_TRUE(recorder_.WaitForDumps(2));
+  ASSERT_TRUE(WaitForExit(busy));
+  ASSERT_TRUE(WaitForExit(queued));
+  server_->Stop();
+
+  std::map<pid_t, DumpRecorder::Dump> dumps = recorder_.dumps();
+  EXPECT_EQ(2U, dumps.size());
+  ASSERT_TRUE(dumps.count(busy));
+  ASSERT_TRUE(dumps.count(queued));
+  EXPECT_FALSE(dumps.count(rejected));
+  EXPECT_GT(dumps[queued].queue_time_us, dumps[busy].queue_time_us);
+}
+
+TEST_F(CrashGenerationServerTest, StopWritesQueuedRequests) {
+  server_->SetWorkerPool(1, 2);
+  ASSERT_TRUE(server_->Start());
+
+  recorder_.Block();
+  const pid_t busy = RequestDump();
+  ASSERT_TRUE(recorder_.WaitForDumps(1));
+  const pid_t queued[2] = { RequestDump(), RequestDump() };
+  usleep(100000);
+
+  // Stopping the server waits for the queued requests to be written.
+  recorder_.Unblock();
+  server_->Stop();
+  EXPECT_EQ(3U, recorder_.dumps().size());
+  EXPECT_TRUE(WaitForExit(busy));
+  EXPECT_TRUE(WaitForExit(queued[0]));
+  EXPECT_TRUE(WaitForExit(queued[1]));
+}
@@ -51,6 +51,17 @@ uintptr_t UContextReader::GetInstructionPointer(const ucontext_t* uc) {
   return uc->uc_mcontext.gregs[REG_EIP];
 }
 
+size_t UContextReader::GetGeneralRegisters(const ucontext_t* uc,
+                                           uintptr_t* regs) {
+  static const int kRegs[] = {
+    REG_EAX, REG_EBX, REG_ECX, REG_EDX, REG_ESI, REG_EDI, REG_EBP
+  };
+  const size_t count = sizeof(kRegs) / sizeof(kRegs[0]);
+  for (size_t i = 0; i < count; ++i)
+    regs[i] = uc->uc_mcontext.gregs[kRegs[i]];
+  return count;
+}
+
 void UContextReader::FillCPUContext(RawContextCPU* out, const ucontext_t* uc,
                                     const fpstate_t* fp) {
   const greg_t* regs = uc->uc_mcontext.gregs;
@@ -99,6 +110,18 @@ uintptr_t UContextReader::GetInstructionPointer(const ucontext_t* uc) {
   return uc->uc_mcontext.gregs[REG_RIP];
 }
 
+size_t UContextReader::GetGeneralRegisters(const ucontext_t* uc,
+                                           uintptr_t* regs) {
+  static const int kRegs[] = {
+    REG_RAX, REG_RBX, REG_RCX, REG_RDX, REG_RSI, REG_RDI, REG_RBP,
+    REG_R8, REG_R9, REG_R10, REG_R11, REG_R12, REG_R13, REG_R14, REG_R15
+  };
+  const size_t count = sizeof(kRegs) / sizeof(kRegs[0]);
+  for (size_t i = 0; i < count; ++i)
+    regs[i] = uc->uc_mcontext.gregs[kRegs[i]];
+  return count;
+}
+
 void UContextReader::FillCPUContext(RawContextCPU* out, const ucontext_t* uc,
                                     const fpstate_t* fpregs) {
   const greg_t* regs = uc->uc_mcontext.gregs;
@@ -156,6 +179,25 @@ uintptr_t UContextReader::GetInstructionPointer(const ucontext_t* uc) {
   return uc->uc_mcontext.arm_pc;
 }
 
+size_t UContextReader::GetGeneralRegisters(const ucontext_t* uc,
+                                           uintptr_t* regs) {
+  regs[0] = uc->uc_mcontext.arm_r0;
+  regs[1] = uc->uc_mcontext.arm_r1;
+  regs[2] = uc->uc_mcontext.arm_r2;
+  regs[3] = uc->uc_mcontext.arm_r3;
+  regs[4] = uc->uc_mcontext.arm_r4;
+  regs[5] = uc->uc_mcontext.arm_r5;
+  regs[6] = uc->uc_mcontext.arm_r6;
+  regs[7] = uc->uc_mcontext.arm_r7;
+  regs[8] = uc->uc_mcontext.arm_r8;
+  regs[9] = uc->uc_mcontext.arm_r9;
+  regs[10] = uc->uc_mcontext.arm_r10;
+  regs[11] = uc->uc_mcontext.arm_fp;
+  regs[12] = uc->uc_mcontext.arm_ip;
+  regs[13] = uc->uc_mcontext.arm_lr;
+  return 14;
+}
+
 void UContextReader::FillCPUContext(RawContextCPU* out, const ucontext_t* uc) {
   out->context_flags = MD_CONTEXT_ARM_FULL;
 
@@ -195,6 +237,13 @@ uintptr_t UContextReader::GetInstructionPointer(const ucontext_t* uc) {
   return uc->uc_mcontext.pc;
 }
 
+size_t UContextReader::GetGeneralRegisters(const ucontext_t* uc,
+                                           uintptr_t* regs) {
+  for (int i = 0; i < MD_CONTEXT_ARM64_REG_SP; ++i)
+    regs[i] = uc->uc_mcontext.regs[i];
+  return MD_CONTEXT_ARM64_REG_SP;
+}
+
 void UContextReader::FillCPUContext(RawContextCPU* out, const ucontext_t* uc,
                                     const struct fpsimd_context* fpregs) {
   out->context_flags = MD_CONTEXT_ARM64_FULL_OLD;
@@ -221,6 +270,16 @@ uintptr_t UContextReader::GetInstructionPointer(const ucontext_t* uc) {
   return uc->uc_mcontext.pc;
 }
 
+size_t UContextReader::GetGeneralRegisters(const ucontext_t* uc,
+                                           uintptr_t* regs) {
+  size_t count = 0;
+  for (int i = 0; i < MD_CONTEXT_MIPS_GPR_COUNT; ++i) {
+    if (i != MD_CONTEXT_MIPS_REG_SP)
+      regs[count++] = uc->uc_mcontext.gregs[i];
+  }
+  return count;
+}
+
 void UContextReader::FillCPUContext(RawContextCPU* out, const ucontext_t* uc) {
 #if _MIPS_SIM == _ABI64
   out->context_flags = MD_CONTEXT_MIPS64_FULL;
@@ -268,6 +327,16 @@ uintptr_t UContextReader::GetInstructionPointer(const ucontext_t* uc) {
   return uc->uc_mcontext.__gregs[MD_CONTEXT_RISCV_REG_PC];
 }
 
+size_t UContextReader::GetGeneralRegisters(const ucontext_t* uc,
+                                           uintptr_t* regs) {
+  size_t count = 0;
+  for (int i = 1; i < 32; ++i) {
+    if (i != MD_CONTEXT_RISCV_REG_SP)
+      regs[count++] = uc->uc_mcontext.__gregs[i];
+  }
+  return count;
+}
+
 void UContextReader::FillCPUContext(RawContextCPU* out, const ucontext_t* uc) {
 # if __riscv__xlen == 32
   out->context_flags = MD_CONTEXT_RISCV_FULL;
@@ -45,6 +45,13 @@ struct UContextReader {
 
   static uintptr_t GetInstructionPointer(const ucontext_t* uc);
 
+  // The largest number of registers that GetGeneralRegisters() returns.
+  static const size_t kMaxGeneralRegisters = 32;
+
+  // Stores the general-purpose registers, other than the stack pointer and
+  // the instruction pointer, in |regs| and returns how many were stored.
+  static size_t GetGeneralRegisters(const ucontext_t* uc, uintptr_t* regs);
+
   // Juggle a arch-specific ucontext_t into a minidump format
   //   out: the minidump structure
   //   info: the collection of register structures.
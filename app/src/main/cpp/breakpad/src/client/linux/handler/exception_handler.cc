@@ -216,6 +216,37 @@ pthread_mutex_t g_handler_stack_mutex_ = PTHREAD_MUTEX_INITIALIZER;
 ExceptionHandler::CrashContext g_crash_context_;
 
 FirstChanceHandler g_first_chance_handler_ = nullptr;
+
+// Makes |arena|, unless it is NULL, the current PageArena while in scope, and
+// frees whatever was taken from it meanwhile when going out of scope.
+class ScopedPageArena {
+ public:
+  explicit ScopedPageArena(PageArena* arena)
+      : arena_(arena),
+        previous_(PageArena::current()),
+        in_use_(arena ? arena->in_use() : 0) {
+    if (arena_)
+      PageArena::set_current(arena_);
+  }
+  ~ScopedPageArena() {
+    if (arena_)
+      arena_->Rewind(in_use_);
+    PageArena::set_current(previous_);
+  }
+
+ private:
+  PageArena* const arena_;
+  PageArena* const previous_;
+  const size_t in_use_;
+};
+
+// Closes |*fd| if it is open, and marks it closed.
+void CloseFd(int* fd) {
+  if (*fd != -1) {
+    sys_close(*fd);
+    *fd = -1;
+  }
+}
 }  // namespace
 
 // Runs before crashing: normal context.
@@ -242,6 +273,14 @@ ExceptionHandler::ExceptionHandler(const MinidumpDescriptor& descriptor,
     logger::initializeCrashLogWriter();
 #endif
 
+  // Reserve the memory to write dumps with now, as it may not be available
+  // when handling a crash.
+  if (!IsOutOfProcess() && minidump_descriptor_.crash_arena_size()) {
+    crash_arena_.reset(new PageArena(minidump_descriptor_.crash_arena_size()));
+    if (!crash_arena_->valid())
+      crash_arena_.reset();
+  }
+
   pthread_mutex_lock(&g_handler_stack_mutex_);
 
   // Pre-fault the crash context struct. This is to avoid failing due to OOM
@@ -428,6 +467,9 @@ int ExceptionHandler::ThreadEntry(void* arg) {
   // Close the write end of the pipe. This allows us to fail if the parent dies
   // while waiting for the continue signal.
   sys_close(thread_arg->handler->fdes[1]);
+  // Likewise for the ends of the snapshot pipes that aren't ours.
+  CloseFd(&thread_arg->handler->snapshot_request_fdes_[0]);
+  CloseFd(&thread_arg->handler->snapshot_reply_fdes_[1]);
 
   // Block here until the crashing process unblocks us when
   // we're allowed to use ptrace
@@ -438,6 +480,36 @@ int ExceptionHandler::ThreadEntry(void* arg) {
                                      thread_arg->context_size) == false;
 }
 
+struct SnapshotArgument {
+  ExceptionHandler* handler;
+  pid_t dumper;  // the cloned process writing the dump
+};
+
+// This is the entry function for the snapshot process, a copy of the crashing
+// process cloned without CLONE_VM while its other threads are suspended. We
+// are in a compromised context here: see the top of the file.
+// static
+int ExceptionHandler::SnapshotEntry(void* arg) {
+  const SnapshotArgument* snapshot_arg =
+      reinterpret_cast<SnapshotArgument*>(arg);
+  const ExceptionHandler* handler = snapshot_arg->handler;
+
+  // Let the cloned process ptrace us, and only then tell it who we are.
+  sys_prctl(PR_SET_PTRACER, snapshot_arg->dumper, 0, 0, 0);
+  const pid_t snapshot = sys_getpid();
+  HANDLE_EINTR(sys_write(handler->snapshot_reply_fdes_[1], &snapshot,
+                         sizeof(snapshot)));
+  sys_close(handler->snapshot_reply_fdes_[1]);
+
+  // Leave our memory alone until the cloned process is done with it, which
+  // it tells us by exiting and so closing the write end of this pipe.
+  char message;
+  while (HANDLE_EINTR(sys_read(handler->snapshot_request_fdes_[0], &message,
+                               sizeof(message))) > 0) {
+  }
+  return 0;
+}
+
 // This function runs in a compromised context: see the top of the file.
 // Runs on the crashing thread.
 bool ExceptionHandler::HandleSignal(int /*sig*/, siginfo_t* info, void* uc) {
@@ -499,6 +571,11 @@ bool ExceptionHandler::GenerateDump(CrashContext* context) {
   if (IsOutOfProcess())
     return crash_generation_client_->RequestDump(context, sizeof(*context));
 
+  // Everything the dump needs, starting with the child's stack, comes from
+  // the crash arena if there is one. The child inherits it as the current
+  // arena, and what it took is freed once it has exited.
+  ScopedPageArena scoped_arena(crash_arena_.get());
+
   // Allocating too much stack isn't a problem, and better to err on the side
   // of caution than smash it into random locations.
   static const unsigned kChildStackSize = 16000;
@@ -510,6 +587,30 @@ bool ExceptionHandler::GenerateDump(CrashContext* context) {
   stack += kChildStackSize;
   my_memset(stack - 16, 0, 16);
 
+  // To dump from a snapshot, the snapshot process needs a stack of its own,
+  // and two more pipes (see |snapshot_request_fdes_|). Without them the dump
+  // is written with the process suspended throughout. That is always the
+  // case for crashes: the crashed process's other threads mustn't run on
+  // while it's dumped.
+  static const unsigned kSnapshotStackSize = 4096;
+  uint8_t* snapshot_stack = NULL;
+  if (minidump_descriptor_.dump_from_snapshot() &&
+      !minidump_descriptor_.IsMicrodumpOnConsole() &&
+      context->siginfo.si_signo ==
+          static_cast<int>(MD_EXCEPTION_CODE_LIN_DUMP_REQUESTED)) {
+    snapshot_stack =
+        reinterpret_cast<uint8_t*>(allocator.Alloc(kSnapshotStackSize));
+  }
+  if (snapshot_stack && sys_pipe(snapshot_request_fdes_) != -1) {
+    if (sys_pipe(snapshot_reply_fdes_) == -1) {
+      CloseFd(&snapshot_request_fdes_[0]);
+      CloseFd(&snapshot_request_fdes_[1]);
+    } else {
+      snapshot_stack += kSnapshotStackSize;
+      my_memset(snapshot_stack - 16, 0, 16);
+    }
+  }
+
   ThreadArgument thread_arg;
   thread_arg.handler = this;
   thread_arg.minidump_descriptor = &minidump_descriptor_;
@@ -541,6 +642,10 @@ bool ExceptionHandler::GenerateDump(CrashContext* context) {
   if (child == -1) {
     sys_close(fdes[0]);
     sys_close(fdes[1]);
+    CloseFd(&snapshot_request_fdes_[0]);
+    CloseFd(&snapshot_request_fdes_[1]);
+    CloseFd(&snapshot_reply_fdes_[0]);
+    CloseFd(&snapshot_reply_fdes_[1]);
     return false;
   }
 
@@ -549,8 +654,23 @@ bool ExceptionHandler::GenerateDump(CrashContext* context) {
   // Allow the child to ptrace us
   sys_prctl(PR_SET_PTRACER, child, 0, 0, 0);
   SendContinueSignalToChild();
+
+  pid_t snapshot = -1;
+  if (snapshot_request_fdes_[0] != -1) {
+    // Only the child may ask for a snapshot, so that the snapshot sees the
+    // request pipe close when the child exits.
+    CloseFd(&snapshot_request_fdes_[1]);
+    CloseFd(&snapshot_reply_fdes_[0]);
+    snapshot = TakeSnapshot(child, snapshot_stack);
+    CloseFd(&snapshot_request_fdes_[0]);
+    CloseFd(&snapshot_reply_fdes_[1]);
+  }
+
   int status = 0;
   const int r = HANDLE_EINTR(sys_waitpid(child, &status, __WALL));
+  // The snapshot exits along with the child.
+  if (snapshot != -1)
+    HANDLE_EINTR(sys_waitpid(snapshot, NULL, __WALL));
 
   sys_close(fdes[1]);
 
@@ -596,6 +716,50 @@ void ExceptionHandler::WaitForContinueSignal() {
   }
 }
 
+// This function runs in a compromised context: see the top of the file.
+// Runs on the crashing thread, while the cloned process has the other threads
+// suspended. Returns the pid of the snapshot, or -1.
+pid_t ExceptionHandler::TakeSnapshot(pid_t child, uint8_t* stack) {
+  // Nothing is read if the child exits without asking for a snapshot.
+  char request;
+  if (HANDLE_EINTR(sys_read(snapshot_request_fdes_[0], &request,
+                            sizeof(request))) != sizeof(request)) {
+    return -1;
+  }
+
+  SnapshotArgument snapshot_arg;
+  snapshot_arg.handler = this;
+  snapshot_arg.dumper = child;
+  const pid_t snapshot = sys_clone(SnapshotEntry, stack, CLONE_UNTRACED,
+                                   &snapshot_arg, NULL, NULL, NULL);
+  if (snapshot == -1) {
+    // Let the child go ahead without one.
+    HANDLE_EINTR(sys_write(snapshot_reply_fdes_[1], &snapshot,
+                           sizeof(snapshot)));
+  }
+  return snapshot;
+}
+
+// This function runs in a compromised context: see the top of the file.
+// Runs on the cloned process, with the crashing process's other threads
+// suspended. Used as a LinuxPtraceDumper::SnapshotCallback.
+// static
+pid_t ExceptionHandler::RequestSnapshot(void* handler) {
+  const ExceptionHandler* const self =
+      reinterpret_cast<ExceptionHandler*>(handler);
+  static const char kRequestSnapshotMessage = 's';
+  pid_t snapshot;
+  if (HANDLE_EINTR(sys_write(self->snapshot_request_fdes_[1],
+                             &kRequestSnapshotMessage,
+                             sizeof(kRequestSnapshotMessage))) !=
+          sizeof(kRequestSnapshotMessage) ||
+      HANDLE_EINTR(sys_read(self->snapshot_reply_fdes_[0], &snapshot,
+                            sizeof(snapshot))) != sizeof(snapshot)) {
+    return -1;
+  }
+  return snapshot;
+}
+
 // This function runs in a compromised context: see the top of the file.
 // Runs on the cloned process.
 bool ExceptionHandler::DoDump(pid_t crashing_process, const void* context,
@@ -605,6 +769,9 @@ bool ExceptionHandler::DoDump(pid_t crashing_process, const void* context,
   const uintptr_t principal_mapping_address =
       minidump_descriptor_.address_within_principal_mapping();
   const bool sanitize_stacks = minidump_descriptor_.sanitize_stacks();
+  // The snapshot pipes are only open if a snapshot was asked for.
+  const LinuxPtraceDumper::SnapshotCallback snapshot_callback =
+      snapshot_request_fdes_[1] != -1 ? RequestSnapshot : NULL;
   if (minidump_descriptor_.IsMicrodumpOnConsole()) {
     return google_breakpad::WriteMicrodump(
         crashing_process,
@@ -626,7 +793,10 @@ bool ExceptionHandler::DoDump(pid_t crashing_process, const void* context,
                                           app_memory_list_,
                                           may_skip_dump,
                                           principal_mapping_address,
-                                          sanitize_stacks);
+                                          sanitize_stacks,
+                                          minidump_descriptor_.compress(),
+                                          snapshot_callback,
+                                          this);
   }
   return google_breakpad::WriteMinidump(minidump_descriptor_.path(),
                                         minidump_descriptor_.size_limit(),
@@ -637,7 +807,10 @@ bool ExceptionHandler::DoDump(pid_t crashing_process, const void* context,
                                         app_memory_list_,
                                         may_skip_dump,
                                         principal_mapping_address,
-                                        sanitize_stacks);
+                                        sanitize_stacks,
+                                        minidump_descriptor_.compress(),
+                                        snapshot_callback,
+                                        this);
 }
 
 // static
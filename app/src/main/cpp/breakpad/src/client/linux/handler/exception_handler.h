@@ -39,6 +39,7 @@
 #include "client/linux/crash_generation/crash_generation_client.h"
 #include "client/linux/handler/minidump_descriptor.h"
 #include "client/linux/minidump_writer/minidump_writer.h"
+#include "common/memory_allocator.h"
 #include "common/scoped_ptr.h"
 #include "common/using_std_string.h"
 #include "google_breakpad/common/minidump_format.h"
@@ -226,6 +227,13 @@ class ExceptionHandler {
   // Unregister a block of memory that was registered with RegisterAppMemory.
   void UnregisterAppMemory(void* ptr);
 
+  // Returns the memory reserved for writing dumps, as requested with
+  // MinidumpDescriptor::set_crash_arena_size(), or NULL if none was. Its
+  // high_water() and overflow_bytes() tell how much the dumps written so far
+  // needed. Each minidump records them too, in its Breakpad info stream, so
+  // that the size can be chosen from real crashes.
+  const PageArena* crash_arena() const { return crash_arena_.get(); }
+
   // Force signal handling for the specified signal.
   bool SimulateSignalDelivery(int sig);
 
@@ -242,9 +250,12 @@ class ExceptionHandler {
   bool GenerateDump(CrashContext* context);
   void SendContinueSignalToChild();
   void WaitForContinueSignal();
+  pid_t TakeSnapshot(pid_t child, uint8_t* stack);
 
   static void SignalHandler(int sig, siginfo_t* info, void* uc);
   static int ThreadEntry(void* arg);
+  static int SnapshotEntry(void* arg);
+  static pid_t RequestSnapshot(void* handler);
   bool DoDump(pid_t crashing_process, const void* context,
               size_t context_size);
 
@@ -256,6 +267,10 @@ class ExceptionHandler {
 
   MinidumpDescriptor minidump_descriptor_;
 
+  // Memory reserved when the handler is created, from which dumps are
+  // written. See MinidumpDescriptor::set_crash_arena_size().
+  scoped_ptr<PageArena> crash_arena_;
+
   // Must be volatile. The compiler is unaware of the code which runs in
   // the signal handler which reads this variable. Without volatile the
   // compiler is free to optimise away writes to this variable which it
@@ -269,6 +284,13 @@ class ExceptionHandler {
   // ptrace. This is used to store the file descriptors for the pipe
   int fdes[2] = {-1, -1};
 
+  // When dumping from a snapshot, the cloned process asks the crashing
+  // thread for one over the first pipe, and the snapshot replies with its
+  // pid over the second. The snapshot then lives until the first pipe is
+  // closed by the cloned process exiting.
+  int snapshot_request_fdes_[2] = {-1, -1};
+  int snapshot_reply_fdes_[2] = {-1, -1};
+
   // Callers can add extra info about mappings for cases where the
   // dumper code cannot extract enough information from /proc/<pid>/maps.
   MappingList mapping_list_;
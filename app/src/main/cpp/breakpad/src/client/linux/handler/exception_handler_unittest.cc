@@ -1108,6 +1108,78 @@ TEST(ExceptionHandlerTest, ExternalDumper) {
   unlink(templ.c_str());
 }
 
+TEST(ExceptionHandlerTest, CrashDumpNotFromSnapshot) {
+  AutoTempDir temp_dir;
+  int fds[2];
+  ASSERT_NE(pipe(fds), -1);
+
+  const pid_t child = fork();
+  if (child == 0) {
+    close(fds[0]);
+    MinidumpDescriptor descriptor(temp_dir.path());
+    descriptor.set_dump_from_snapshot(true);
+    ExceptionHandler handler(descriptor, NULL, DoneCallback,
+                             reinterpret_cast<void*>(fds[1]), true, -1);
+    DoNullPointerDereference();
+  }
+  close(fds[1]);
+  ASSERT_NO_FATAL_FAILURE(WaitForProcessToTerminate(child, SIGSEGV));
+
+  string minidump_path;
+  ASSERT_NO_FATAL_FAILURE(ReadMinidumpPathFromPipe(fds[0], &minidump_path));
+
+  // The crashed process stayed suspended while its dump was written, so no
+  // pause was recorded and older readers can still read the Breakpad info.
+  Minidump minidump(minidump_path);
+  ASSERT_TRUE(minidump.Read());
+  MinidumpBreakpadInfo* breakpad_info = minidump.GetBreakpadInfo();
+  ASSERT_TRUE(breakpad_info);
+  uint32_t pause_duration_us;
+  EXPECT_FALSE(breakpad_info->GetPauseDuration(&pause_duration_us));
+  uint32_t stream_length;
+  ASSERT_TRUE(minidump.SeekToStreamType(MD_BREAKPAD_INFO_STREAM,
+                                        &stream_length));
+  EXPECT_EQ(sizeof(MDRawBreakpadInfo), stream_length);
+  unlink(minidump_path.c_str());
+}
+
+TEST(ExceptionHandlerTest, CrashDumpRecordsCrashArenaUsage) {
+  AutoTempDir temp_dir;
+  int fds[2];
+  ASSERT_NE(pipe(fds), -1);
+
+  const pid_t child = fork();
+  if (child == 0) {
+    close(fds[0]);
+    MinidumpDescriptor descriptor(temp_dir.path());
+    // Too small for the dump, so that some of it has to be mapped.
+    descriptor.set_crash_arena_size(64 * 1024);
+    ExceptionHandler handler(descriptor, NULL, DoneCallback,
+                             reinterpret_cast<void*>(fds[1]), true, -1);
+    DoNullPointerDereference();
+  }
+  close(fds[1]);
+  ASSERT_NO_FATAL_FAILURE(WaitForProcessToTerminate(child, SIGSEGV));
+
+  string minidump_path;
+  ASSERT_NO_FATAL_FAILURE(ReadMinidumpPathFromPipe(fds[0], &minidump_path));
+
+  // The arena's usage can only be read from the dump once the process that
+  // owned it is gone.
+  Minidump minidump(minidump_path);
+  ASSERT_TRUE(minidump.Read());
+  MinidumpBreakpadInfo* breakpad_info = minidump.GetBreakpadInfo();
+  ASSERT_TRUE(breakpad_info);
+  uint32_t high_water;
+  uint32_t overflow_bytes;
+  ASSERT_TRUE(breakpad_info->GetCrashArenaUsage(&high_water,
+                                                &overflow_bytes));
+  EXPECT_GT(high_water, 0U);
+  EXPECT_LE(high_water, 64U * 1024);
+  EXPECT_GT(overflow_bytes, 0U);
+  unlink(minidump_path.c_str());
+}
+
 #endif  // !ADDRESS_SANITIZER
 
 TEST(ExceptionHandlerTest, WriteMinidumpExceptionStream) {
@@ -1129,6 +1201,96 @@ TEST(ExceptionHandlerTest, WriteMinidumpExceptionStream) {
             raw->exception_record.exception_code);
 }
 
+TEST(ExceptionHandlerTest, WriteMinidumpWithCrashArena) {
+  AutoTempDir temp_dir;
+  MinidumpDescriptor descriptor(temp_dir.path());
+  descriptor.set_crash_arena_size(16 * 1024 * 1024);
+  ExceptionHandler handler(descriptor, NULL, NULL, NULL, false, -1);
+  const PageArena* arena = handler.crash_arena();
+  ASSERT_TRUE(arena);
+  EXPECT_EQ(0U, arena->high_water());
+  ASSERT_TRUE(handler.WriteMinidump());
+
+  // The dump, written by a cloned process, took its memory from the arena.
+  const size_t high_water = arena->high_water();
+  EXPECT_GT(high_water, 0U);
+  EXPECT_EQ(0U, arena->overflow_bytes());
+  EXPECT_EQ(0U, arena->in_use());
+  EXPECT_EQ(NULL, PageArena::current());
+
+  // The next dump reuses the same memory.
+  ASSERT_TRUE(handler.WriteMinidump());
+  EXPECT_EQ(high_water, arena->high_water());
+
+  Minidump minidump(handler.minidump_descriptor().path());
+  ASSERT_TRUE(minidump.Read());
+  ASSERT_TRUE(minidump.GetThreadList());
+
+  // The dump records how much of the arena it used.
+  MinidumpBreakpadInfo* breakpad_info = minidump.GetBreakpadInfo();
+  ASSERT_TRUE(breakpad_info);
+  uint32_t dump_high_water;
+  uint32_t dump_overflow_bytes;
+  ASSERT_TRUE(breakpad_info->GetCrashArenaUsage(&dump_high_water,
+                                                &dump_overflow_bytes));
+  EXPECT_GT(dump_high_water, 0U);
+  EXPECT_LE(dump_high_water, high_water);
+  EXPECT_EQ(0U, dump_overflow_bytes);
+}
+
+static void* ReadFromPipeFunction(void* fd_ptr) {
+  char c;
+  HANDLE_EINTR(read(*reinterpret_cast<int*>(fd_ptr), &c, 1));
+  return NULL;
+}
+
+TEST(ExceptionHandlerTest, WriteMinidumpFromSnapshot) {
+  AutoTempDir temp_dir;
+  MinidumpDescriptor descriptor(temp_dir.path());
+  descriptor.set_dump_from_snapshot(true);
+  ExceptionHandler handler(descriptor, NULL, NULL, NULL, false, -1);
+
+  // A thread to be suspended while this one takes the snapshot.
+  int fds[2];
+  ASSERT_NE(-1, pipe(fds));
+  pthread_t thread;
+  ASSERT_EQ(0, pthread_create(&thread, NULL, ReadFromPipeFunction, &fds[0]));
+  ASSERT_TRUE(handler.WriteMinidump());
+  ASSERT_EQ(1, HANDLE_EINTR(write(fds[1], "x", 1)));
+  ASSERT_EQ(0, pthread_join(thread, NULL));
+  close(fds[0]);
+  close(fds[1]);
+
+  // Both the cloned process and the snapshot have been reaped.
+  errno = 0;
+  EXPECT_EQ(-1, waitpid(-1, NULL, WNOHANG | __WALL));
+  EXPECT_EQ(ECHILD, errno);
+
+  Minidump minidump(handler.minidump_descriptor().path());
+  ASSERT_TRUE(minidump.Read());
+  MinidumpThreadList* thread_list = minidump.GetThreadList();
+  ASSERT_TRUE(thread_list);
+  ASSERT_GE(thread_list->thread_count(), 2U);
+  for (unsigned i = 0; i < thread_list->thread_count(); ++i) {
+    MinidumpThread* dumped_thread = thread_list->GetThreadAtIndex(i);
+    ASSERT_TRUE(dumped_thread->GetContext());
+    MinidumpMemoryRegion* stack = dumped_thread->GetMemory();
+    ASSERT_TRUE(stack);
+    EXPECT_GT(stack->GetSize(), 0U);
+  }
+
+  MinidumpBreakpadInfo* breakpad_info = minidump.GetBreakpadInfo();
+  ASSERT_TRUE(breakpad_info);
+  uint32_t thread_id;
+  ASSERT_TRUE(breakpad_info->GetRequestingThreadID(&thread_id));
+  EXPECT_EQ(static_cast<uint32_t>(sys_gettid()), thread_id);
+  uint32_t pause_duration_us;
+  EXPECT_TRUE(breakpad_info->GetPauseDuration(&pause_duration_us));
+
+  // The pipes are set up afresh for every dump.
+  ASSERT_TRUE(handler.WriteMinidump());
+}
+
 TEST(ExceptionHandlerTest, GenerateMultipleDumpsWithFD) {
   AutoTempDir temp_dir;
   string path;
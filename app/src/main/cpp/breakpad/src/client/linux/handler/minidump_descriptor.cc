@@ -53,6 +53,9 @@ MinidumpDescriptor::MinidumpDescriptor(const MinidumpDescriptor& descriptor)
       skip_dump_if_principal_mapping_not_referenced_(
           descriptor.skip_dump_if_principal_mapping_not_referenced_),
       sanitize_stacks_(descriptor.sanitize_stacks_),
+      compress_(descriptor.compress_),
+      crash_arena_size_(descriptor.crash_arena_size_),
+      dump_from_snapshot_(descriptor.dump_from_snapshot_),
       microdump_extra_info_(descriptor.microdump_extra_info_) {
   // The copy constructor is not allowed to be called on a MinidumpDescriptor
   // with a valid path_, as getting its c_path_ would require the heap which
@@ -79,6 +82,9 @@ MinidumpDescriptor& MinidumpDescriptor::operator=(
   skip_dump_if_principal_mapping_not_referenced_ =
       descriptor.skip_dump_if_principal_mapping_not_referenced_;
   sanitize_stacks_ = descriptor.sanitize_stacks_;
+  compress_ = descriptor.compress_;
+  crash_arena_size_ = descriptor.crash_arena_size_;
+  dump_from_snapshot_ = descriptor.dump_from_snapshot_;
   microdump_extra_info_ = descriptor.microdump_extra_info_;
   return *this;
 }
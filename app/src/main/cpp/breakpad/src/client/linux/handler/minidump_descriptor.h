@@ -55,7 +55,11 @@ class MinidumpDescriptor {
         fd_(-1),
         size_limit_(-1),
         address_within_principal_mapping_(0),
-        skip_dump_if_principal_mapping_not_referenced_(false) {}
+        skip_dump_if_principal_mapping_not_referenced_(false),
+        sanitize_stacks_(false),
+        compress_(false),
+        crash_arena_size_(0),
+        dump_from_snapshot_(false) {}
 
   explicit MinidumpDescriptor(const string& directory)
       : mode_(kWriteMinidumpToFile),
@@ -65,7 +69,10 @@ class MinidumpDescriptor {
         size_limit_(-1),
         address_within_principal_mapping_(0),
         skip_dump_if_principal_mapping_not_referenced_(false),
-        sanitize_stacks_(false) {
+        sanitize_stacks_(false),
+        compress_(false),
+        crash_arena_size_(0),
+        dump_from_snapshot_(false) {
     assert(!directory.empty());
   }
 
@@ -76,7 +83,10 @@ class MinidumpDescriptor {
         size_limit_(-1),
         address_within_principal_mapping_(0),
         skip_dump_if_principal_mapping_not_referenced_(false),
-        sanitize_stacks_(false) {
+        sanitize_stacks_(false),
+        compress_(false),
+        crash_arena_size_(0),
+        dump_from_snapshot_(false) {
     assert(fd != -1);
   }
 
@@ -86,7 +96,10 @@ class MinidumpDescriptor {
         size_limit_(-1),
         address_within_principal_mapping_(0),
         skip_dump_if_principal_mapping_not_referenced_(false),
-        sanitize_stacks_(false) {}
+        sanitize_stacks_(false),
+        compress_(false),
+        crash_arena_size_(0),
+        dump_from_snapshot_(false) {}
 
   explicit MinidumpDescriptor(const MinidumpDescriptor& descriptor);
   MinidumpDescriptor& operator=(const MinidumpDescriptor& descriptor);
@@ -134,6 +147,17 @@ class MinidumpDescriptor {
     sanitize_stacks_ = sanitize_stacks;
   }
 
+  bool compress() const { return compress_; }
+  void set_compress(bool compress) { compress_ = compress; }
+
+  size_t crash_arena_size() const { return crash_arena_size_; }
+  void set_crash_arena_size(size_t size) { crash_arena_size_ = size; }
+
+  bool dump_from_snapshot() const { return dump_from_snapshot_; }
+  void set_dump_from_snapshot(bool dump_from_snapshot) {
+    dump_from_snapshot_ = dump_from_snapshot;
+  }
+
   MicrodumpExtraInfo* microdump_extra_info() {
     assert(IsMicrodumpOnConsole());
     return &microdump_extra_info_;
@@ -182,6 +206,25 @@ class MinidumpDescriptor {
   // register values, but elides strings and other program data.
   bool sanitize_stacks_;
 
+  // If set, the minidump is written as a compressed container (see
+  // common/minidump_compression.h) rather than as a plain minidump
+  // (minidump only).
+  bool compress_;
+
+  // If non-zero, the ExceptionHandler reserves this many bytes when it is
+  // created, and writes dumps with memory taken from them rather than
+  // mapped at crash time. See ExceptionHandler::crash_arena().
+  size_t crash_arena_size_;
+
+  // If set, a dump requested with ExceptionHandler::WriteMinidump()
+  // suspends the process only while a copy-on-write snapshot of it is taken,
+  // and the minidump is then written from the snapshot. This keeps dumps of
+  // live processes from stalling them for long. The Breakpad info stream
+  // records how long the process was paused. Crash dumps are unaffected:
+  // the crashed process stays suspended until its dump is written
+  // (minidump only).
+  bool dump_from_snapshot_;
+
   // The extra microdump data (e.g. product name/version, build
   // fingerprint, gpu fingerprint) that should be appended to the dump
   // (microdump only). Microdumps don't have the ability of appending
@@ -86,6 +86,7 @@ bool LinuxCoreDumper::BuildProcPath(char* path, pid_t pid,
 bool LinuxCoreDumper::CopyFromProcess(void* dest, pid_t child,
                                       const void* src, size_t length) {
   ElfCoreDump::Addr virtual_address = reinterpret_cast<ElfCoreDump::Addr>(src);
+  copy_stats_.bytes += length;
   // TODO(benchan): Investigate whether the data to be copied could span
   // across multiple segments in the core dump file. ElfCoreDump::CopyData
   // and this method do not handle that case yet.
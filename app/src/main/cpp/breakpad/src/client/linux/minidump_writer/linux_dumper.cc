@@ -297,6 +297,7 @@ LinuxDumper::LinuxDumper(pid_t pid, const char* root_prefix)
   // The passed-in size to the constructor (above) is only a hint.
   // Must call .resize() to do actual initialization of the elements.
   auxv_.resize(AT_MAX + 1);
+  my_memset(&copy_stats_, 0, sizeof(copy_stats_));
 }
 
 LinuxDumper::~LinuxDumper() {
@@ -306,6 +307,17 @@ bool LinuxDumper::Init() {
   return ReadAuxv() && EnumerateThreads() && EnumerateMappings();
 }
 
+bool LinuxDumper::CopyRangesFromProcess(pid_t child,
+                                        const RemoteMemoryRange* ranges,
+                                        size_t count) {
+  bool success = true;
+  for (size_t i = 0; i < count; ++i) {
+    success &= CopyFromProcess(ranges[i].dest, child, ranges[i].src,
+                               ranges[i].length);
+  }
+  return success;
+}
+
 bool LinuxDumper::LateInit() {
 #if defined(__ANDROID__)
   LatePostprocessMappings();
@@ -51,6 +51,7 @@
 
 #include "client/linux/dump_writer_common/mapping_info.h"
 #include "client/linux/dump_writer_common/thread_info.h"
+#include "client/linux/minidump_writer/remote_memory_reader.h"
 #include "common/linux/file_id.h"
 #include "common/memory_allocator.h"
 #include "google_breakpad/common/minidump_format.h"
@@ -160,6 +161,26 @@ class LinuxDumper {
   virtual bool CopyFromProcess(void* dest, pid_t child, const void* src,
                                size_t length) = 0;
 
+  // Copy each of the |count| |ranges| from a given process |child|. This
+  // lets implementations batch many ranges, such as all thread stacks,
+  // into few operations. The default implementation calls
+  // CopyFromProcess() for every range. Returns true if all copies
+  // succeeded.
+  virtual bool CopyRangesFromProcess(pid_t child,
+                                     const RemoteMemoryRange* ranges,
+                                     size_t count);
+
+  // Returns counters describing the memory copied out of the process so
+  // far by CopyFromProcess() and CopyRangesFromProcess().
+  virtual const RemoteMemoryReadStats& copy_stats() const {
+    return copy_stats_;
+  }
+
+  // Returns how long, in microseconds, ThreadsSuspend() kept the process's
+  // threads suspended before they were resumed for the rest of the dump to
+  // be written from a snapshot, or -1 if no snapshot was taken.
+  virtual int64_t pause_duration_us() const { return -1; }
+
   // Builds a proc path for a certain pid for a node (/proc/<pid>/<node>).
   // |path| is a character array of at least NAME_MAX bytes to return the
   // result.|node| is the final node without any slashes. Returns true on
@@ -265,6 +286,10 @@ class LinuxDumper {
   // Info from /proc/<pid>/auxv
   wasteful_vector<elf_aux_val_t> auxv_;
 
+  // Counters for the memory copied out of the process, for dumpers that do
+  // not track them elsewhere.
+  RemoteMemoryReadStats copy_stats_;
+
 #if defined(__ANDROID__)
  private:
   // Android M and later support packed ELF relocations in shared libraries.
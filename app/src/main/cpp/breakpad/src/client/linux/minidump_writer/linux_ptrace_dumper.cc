@@ -52,6 +52,7 @@
 #include <sys/ptrace.h>
 #include <sys/uio.h>
 #include <sys/wait.h>
+#include <time.h>
 
 #if defined(__i386)
 #include <cpuid.h>
@@ -118,11 +119,27 @@ static bool ResumeThread(pid_t pid) {
   return sys_ptrace(PTRACE_DETACH, pid, NULL, NULL) >= 0;
 }
 
+// Returns the CLOCK_MONOTONIC time in microseconds.
+static int64_t MonotonicTimeUs() {
+  struct kernel_timespec ts;
+  if (sys_clock_gettime(CLOCK_MONOTONIC, &ts) != 0)
+    return 0;
+  return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
 namespace google_breakpad {
 
 LinuxPtraceDumper::LinuxPtraceDumper(pid_t pid)
     : LinuxDumper(pid),
-      threads_suspended_(false) {
+      threads_suspended_(false),
+      memory_reader_(pid, &allocator_),
+      snapshot_callback_(NULL),
+      snapshot_context_(NULL),
+      snapshot_thread_(-1),
+      snapshot_pid_(-1),
+      snapshot_thread_infos_(NULL),
+      suspend_time_us_(0),
+      pause_duration_us_(-1) {
 }
 
 bool LinuxPtraceDumper::BuildProcPath(char* path, pid_t pid,
@@ -149,21 +166,19 @@ bool LinuxPtraceDumper::BuildProcPath(char* path, pid_t pid,
 
 bool LinuxPtraceDumper::CopyFromProcess(void* dest, pid_t child,
                                         const void* src, size_t length) {
-  unsigned long tmp = 55;
-  size_t done = 0;
-  static const size_t word_size = sizeof(tmp);
-  uint8_t* const local = (uint8_t*) dest;
-  uint8_t* const remote = (uint8_t*) src;
-
-  while (done < length) {
-    const size_t l = (length - done > word_size) ? word_size : (length - done);
-    if (sys_ptrace(PTRACE_PEEKDATA, child, remote + done, &tmp) == -1) {
-      tmp = 0;
-    }
-    my_memcpy(local + done, &tmp, l);
-    done += l;
-  }
-  return true;
+  // The threads of |child| may have been resumed since the snapshot was
+  // taken, but the snapshot itself is still attached to.
+  if (snapshot_pid_ != -1)
+    child = snapshot_pid_;
+  return memory_reader_.Read(child, dest, src, length);
+}
+
+bool LinuxPtraceDumper::CopyRangesFromProcess(pid_t child,
+                                              const RemoteMemoryRange* ranges,
+                                              size_t count) {
+  if (snapshot_pid_ != -1)
+    child = snapshot_pid_;
+  return memory_reader_.ReadRanges(child, ranges, count);
 }
 
 // This read VFP registers via either PTRACE_GETREGSET or PTRACE_GETREGS
@@ -270,17 +285,27 @@ bool LinuxPtraceDumper::ReadRegisters(ThreadInfo* info, pid_t tid) {
 #endif
 }
 
-// Read thread info from /proc/$pid/status.
-// Fill out the |tgid|, |ppid| and |pid| members of |info|. If unavailable,
-// these members are set to -1. Returns true iff all three members are
-// available.
 bool LinuxPtraceDumper::GetThreadInfoByIndex(size_t index, ThreadInfo* info) {
   if (index >= threads_.size())
     return false;
 
-  pid_t tid = threads_[index];
-
   assert(info != NULL);
+  // Once there is a snapshot the threads are no longer suspended, so their
+  // registers are what was read before they were resumed.
+  if (snapshot_thread_infos_) {
+    if (!snapshot_thread_infos_[index])
+      return false;
+    my_memcpy(info, snapshot_thread_infos_[index], sizeof(*info));
+    return true;
+  }
+  return ReadThreadInfo(threads_[index], info);
+}
+
+// Read thread info from /proc/$pid/status.
+// Fill out the |tgid|, |ppid| and |pid| members of |info|. If unavailable,
+// these members are set to -1. Returns true iff all three members are
+// available.
+bool LinuxPtraceDumper::ReadThreadInfo(pid_t tid, ThreadInfo* info) {
   char status_path[NAME_MAX];
   if (!BuildProcPath(status_path, tid, "status"))
     return false;
@@ -393,7 +418,11 @@ bool LinuxPtraceDumper::IsPostMortem() const {
 bool LinuxPtraceDumper::ThreadsSuspend() {
   if (threads_suspended_)
     return true;
+  suspend_time_us_ = MonotonicTimeUs();
   for (size_t i = 0; i < threads_.size(); ++i) {
+    // The thread taking the snapshot has to keep running to do so.
+    if (snapshot_callback_ && threads_[i] == snapshot_thread_)
+      continue;
     if (!SuspendThread(threads_[i])) {
       // If the thread either disappeared before we could attach to it, or if
       // it was part of the seccomp sandbox's trusted code, it is OK to
@@ -407,16 +436,58 @@ bool LinuxPtraceDumper::ThreadsSuspend() {
     }
   }
   threads_suspended_ = true;
-  return threads_.size() > 0;
+  if (threads_.size() == 0)
+    return false;
+  if (snapshot_callback_)
+    TakeSnapshot();
+  return true;
 }
 
 bool LinuxPtraceDumper::ThreadsResume() {
   if (!threads_suspended_)
     return false;
+  // With a snapshot, the threads were resumed as soon as it was taken.
+  const bool good = snapshot_pid_ != -1 ? ResumeThread(snapshot_pid_)
+                                        : ResumeThreads();
+  threads_suspended_ = false;
+  return good;
+}
+
+void LinuxPtraceDumper::TakeSnapshot() {
+  const pid_t snapshot = snapshot_callback_(snapshot_context_);
+  if (snapshot <= 0 || !SuspendThread(snapshot))
+    return;
+
+  ThreadInfo** infos = reinterpret_cast<ThreadInfo**>(
+      allocator_.Alloc(threads_.size() * sizeof(ThreadInfo*)));
+  if (!infos) {
+    ResumeThread(snapshot);
+    return;
+  }
+  for (size_t i = 0; i < threads_.size(); ++i) {
+    infos[i] = NULL;
+    if (threads_[i] == snapshot_thread_)
+      continue;
+    ThreadInfo* info =
+        reinterpret_cast<ThreadInfo*>(allocator_.Alloc(sizeof(ThreadInfo)));
+    if (info && ReadThreadInfo(threads_[i], info))
+      infos[i] = info;
+  }
+
+  snapshot_thread_infos_ = infos;
+  snapshot_pid_ = snapshot;
+  memory_reader_.set_pid(snapshot);
+  ResumeThreads();
+  pause_duration_us_ = MonotonicTimeUs() - suspend_time_us_;
+}
+
+bool LinuxPtraceDumper::ResumeThreads() {
   bool good = true;
-  for (size_t i = 0; i < threads_.size(); ++i)
+  for (size_t i = 0; i < threads_.size(); ++i) {
+    if (snapshot_callback_ && threads_[i] == snapshot_thread_)
+      continue;
     good &= ResumeThread(threads_[i]);
-  threads_suspended_ = false;
+  }
   return good;
 }
 
@@ -40,10 +40,37 @@ namespace google_breakpad {
 
 class LinuxPtraceDumper : public LinuxDumper {
  public:
+  // Takes a snapshot of the dumped process for ThreadsSuspend(). Returns the
+  // pid of the snapshot, or -1 if none could be taken.
+  typedef pid_t (*SnapshotCallback)(void* context);
+
   // Constructs a dumper for extracting information of a given process
   // with a process ID of |pid|.
   explicit LinuxPtraceDumper(pid_t pid);
 
+  // Makes ThreadsSuspend() read the process's memory from a copy-on-write
+  // snapshot, so that its threads need only be kept suspended until their
+  // registers have been read rather than until the dump is written.
+  // Once every other thread is suspended, |callback| is called with
+  // |context| to have |snapshot_thread|, which is left running, clone the
+  // process without CLONE_VM. The clone must let this process ptrace it,
+  // and must leave its memory alone until the dumper is done with it.
+  // Since the registers of |snapshot_thread| are never read, it should be
+  // the crash thread, with the crash context supplying them. Shared
+  // mappings are not copied by the clone, so they are read as they are
+  // when the dump gets to them. If no snapshot can be taken, the dump goes
+  // ahead with the threads suspended as usual.
+  void set_snapshot_callback(SnapshotCallback callback, void* context,
+                             pid_t snapshot_thread) {
+    snapshot_callback_ = callback;
+    snapshot_context_ = context;
+    snapshot_thread_ = snapshot_thread;
+  }
+
+  // Returns the pid of the snapshot memory is read from, or -1 if memory is
+  // read from the process itself.
+  pid_t snapshot_pid() const { return snapshot_pid_; }
+
   // Implements LinuxDumper::BuildProcPath().
   // Builds a proc path for a certain pid for a node (/proc/<pid>/<node>).
   // |path| is a character array of at least NAME_MAX bytes to return the
@@ -53,11 +80,34 @@ class LinuxPtraceDumper : public LinuxDumper {
 
   // Implements LinuxDumper::CopyFromProcess().
   // Copies content of |length| bytes from a given process |child|,
-  // starting from |src|, into |dest|. This method uses ptrace to extract
-  // the content from the target process. Always returns true.
+  // starting from |src|, into |dest|. This method uses process_vm_readv,
+  // /proc/<pid>/mem or ptrace to extract the content from the target
+  // process, see RemoteMemoryReader. Always returns true.
   virtual bool CopyFromProcess(void* dest, pid_t child, const void* src,
                                size_t length);
 
+  // Implements LinuxDumper::CopyRangesFromProcess().
+  // Copies all |ranges| using as few process_vm_readv calls as possible,
+  // falling back to /proc/<pid>/mem and ptrace for memory those cannot
+  // read. Always returns true.
+  virtual bool CopyRangesFromProcess(pid_t child,
+                                     const RemoteMemoryRange* ranges,
+                                     size_t count);
+
+  // Implements LinuxDumper::copy_stats().
+  virtual const RemoteMemoryReadStats& copy_stats() const {
+    return memory_reader_.stats();
+  }
+
+  // Restricts the mechanisms used to read the process memory to
+  // |methods|, a mask of RemoteMemoryReader::Method values.
+  void set_memory_read_methods(int methods) {
+    memory_reader_.set_methods(methods);
+  }
+
+  // Implements LinuxDumper::pause_duration_us().
+  virtual int64_t pause_duration_us() const { return pause_duration_us_; }
+
   // Implements LinuxDumper::GetThreadInfoByIndex().
   // Reads information about the |index|-th thread of |threads_|.
   // Returns true on success. One must have called |ThreadsSuspend| first.
@@ -69,7 +119,9 @@ class LinuxPtraceDumper : public LinuxDumper {
   virtual bool IsPostMortem() const;
 
   // Implements LinuxDumper::ThreadsSuspend().
-  // Suspends all threads in the given process. Returns true on success.
+  // Suspends all threads in the given process, and then, if there is a
+  // snapshot callback, takes a snapshot and resumes them. Returns true on
+  // success.
   virtual bool ThreadsSuspend();
 
   // Implements LinuxDumper::ThreadsResume().
@@ -85,6 +137,37 @@ class LinuxPtraceDumper : public LinuxDumper {
   // Set to true if all threads of the crashed process are suspended.
   bool threads_suspended_;
 
+  // Reads memory out of the crashed process, or out of its snapshot.
+  RemoteMemoryReader memory_reader_;
+
+  // See set_snapshot_callback().
+  SnapshotCallback snapshot_callback_;
+  void* snapshot_context_;
+  pid_t snapshot_thread_;
+
+  // The snapshot, attached to with ptrace, or -1.
+  pid_t snapshot_pid_;
+
+  // The information about each of |threads_| read before they were resumed,
+  // with NULL for any that could not be read, once there is a snapshot.
+  ThreadInfo** snapshot_thread_infos_;
+
+  // CLOCK_MONOTONIC time at which ThreadsSuspend() started, and how long
+  // the threads were then kept suspended if a snapshot was taken, or -1.
+  int64_t suspend_time_us_;
+  int64_t pause_duration_us_;
+
+  // Has |snapshot_callback_| take a snapshot and, once it is attached to,
+  // reads the information about every suspended thread and resumes them.
+  void TakeSnapshot();
+
+  // Resumes all suspended threads and records how long they were
+  // suspended for.
+  bool ResumeThreads();
+
+  // Reads information about the suspended thread |tid|.
+  bool ReadThreadInfo(pid_t tid, ThreadInfo* info);
+
   // Read the tracee's registers on kernel with PTRACE_GETREGSET support.
   // Returns false if PTRACE_GETREGSET is not defined.
   // Returns true on success.
@@ -312,6 +312,106 @@ TEST_F(LinuxPtraceDumperMappingsTest, MergedMappings) {
   EXPECT_EQ(1, mapping_count);
 }
 
+class LinuxPtraceDumperCopyTest : public LinuxPtraceDumperChildTest {
+ protected:
+  virtual void SetUp();
+  virtual void TearDown();
+
+  // Copies the whole test region out of the parent process using only
+  // |methods|, and returns the copy.
+  string CopyRegion(int methods, RemoteMemoryReadStats* stats);
+
+  // Returns the byte stored at |offset| in the test region.
+  static uint8_t PatternAt(size_t offset) {
+    return static_cast<uint8_t>(offset * 7 + 3);
+  }
+
+  size_t page_size_;
+  size_t region_size_;
+  uint8_t* region_;
+};
+
+void LinuxPtraceDumperCopyTest::SetUp() {
+  // Three pages of known data, the middle one of which is not readable, so
+  // that process_vm_readv has to hand over to the other mechanisms.
+  page_size_ = sysconf(_SC_PAGESIZE);
+  region_size_ = 3 * page_size_;
+  region_ = reinterpret_cast<uint8_t*>(
+      mmap(NULL, region_size_, PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+  ASSERT_NE(MAP_FAILED, region_);
+  for (size_t i = 0; i < region_size_; ++i)
+    region_[i] = PatternAt(i);
+  ASSERT_EQ(0, mprotect(region_ + page_size_, page_size_, PROT_NONE));
+
+  LinuxPtraceDumperChildTest::SetUp();
+}
+
+void LinuxPtraceDumperCopyTest::TearDown() {
+  munmap(region_, region_size_);
+}
+
+string LinuxPtraceDumperCopyTest::CopyRegion(int methods,
+                                             RemoteMemoryReadStats* stats) {
+  LinuxPtraceDumper dumper(getppid());
+  EXPECT_TRUE(dumper.Init());
+  EXPECT_TRUE(dumper.ThreadsSuspend());
+  dumper.set_memory_read_methods(methods);
+
+  // Copy the region as two ranges with an odd split, to exercise batching
+  // and unaligned partial reads.
+  string copy(region_size_, '\0');
+  const size_t split = page_size_ / 2 + 3;
+  RemoteMemoryRange ranges[2] = {
+    { &copy[0], region_, split },
+    { &copy[split], region_ + split, region_size_ - split },
+  };
+  EXPECT_TRUE(dumper.CopyRangesFromProcess(getppid(), ranges, 2));
+  *stats = dumper.copy_stats();
+  EXPECT_TRUE(dumper.ThreadsResume());
+  return copy;
+}
+
+TEST_F(LinuxPtraceDumperCopyTest, CopyWithAllMethods) {
+  RemoteMemoryReadStats stats;
+  string copy = CopyRegion(RemoteMemoryReader::kAllMethods, &stats);
+  for (size_t i = 0; i < region_size_; ++i)
+    ASSERT_EQ(PatternAt(i), static_cast<uint8_t>(copy[i])) << i;
+  EXPECT_EQ(region_size_, stats.bytes);
+  EXPECT_EQ(0U, stats.peek_calls);
+  EXPECT_LT(stats.syscalls, 8U);
+}
+
+TEST_F(LinuxPtraceDumperCopyTest, CopyWithProcMem) {
+  RemoteMemoryReadStats stats;
+  string copy = CopyRegion(RemoteMemoryReader::kProcMem |
+                           RemoteMemoryReader::kPtracePeek, &stats);
+  for (size_t i = 0; i < region_size_; ++i)
+    ASSERT_EQ(PatternAt(i), static_cast<uint8_t>(copy[i])) << i;
+  EXPECT_EQ(0U, stats.vm_readv_calls);
+  EXPECT_EQ(0U, stats.peek_calls);
+  EXPECT_EQ(2U, stats.proc_mem_calls);
+}
+
+TEST_F(LinuxPtraceDumperCopyTest, CopyWithPtracePeek) {
+  RemoteMemoryReadStats stats;
+  string copy = CopyRegion(RemoteMemoryReader::kPtracePeek, &stats);
+  for (size_t i = 0; i < region_size_; ++i)
+    ASSERT_EQ(PatternAt(i), static_cast<uint8_t>(copy[i])) << i;
+  EXPECT_EQ(stats.syscalls, stats.peek_calls);
+  EXPECT_GE(stats.peek_calls, region_size_ / sizeof(long));
+}
+
+TEST_F(LinuxPtraceDumperCopyTest, UnreadablePageIsZeroed) {
+  RemoteMemoryReadStats stats;
+  string copy = CopyRegion(RemoteMemoryReader::kProcessVmReadv, &stats);
+  for (size_t i = 0; i < region_size_; ++i) {
+    const bool readable = i < page_size_ || i >= 2 * page_size_;
+    ASSERT_EQ(readable ? PatternAt(i) : 0, static_cast<uint8_t>(copy[i]))
+        << i;
+  }
+}
+
 TEST_F(LinuxPtraceDumperChildTest, BuildProcPath) {
   const pid_t pid = getppid();
   LinuxPtraceDumper dumper(pid);
@@ -80,6 +80,7 @@
 #include "client/minidump_file_writer.h"
 #include "common/linux/file_id.h"
 #include "common/linux/linux_libc_support.h"
+#include "common/memory_allocator.h"
 #include "common/minidump_type_helper.h"
 #include "google_breakpad/common/minidump_format.h"
 #include "third_party/lss/linux_syscall_support.h"
@@ -100,10 +101,12 @@ using google_breakpad::MappingInfo;
 using google_breakpad::MappingList;
 using google_breakpad::MinidumpFileWriter;
 using google_breakpad::PageAllocator;
+using google_breakpad::PageArena;
 using google_breakpad::PEFile;
 using google_breakpad::PEFileFormat;
 using google_breakpad::ProcCpuInfoReader;
 using google_breakpad::RawContextCPU;
+using google_breakpad::RemoteMemoryRange;
 using google_breakpad::RSDS_DEBUG_FORMAT;
 using google_breakpad::ThreadInfo;
 using google_breakpad::TypedMDRVA;
@@ -119,18 +122,23 @@ class MinidumpWriter {
   // The following kLimit* constants are for when minidump_size_limit_ is set
   // and the minidump size might exceed it.
   //
-  // Estimate for how big each thread's stack will be (in bytes).
-  static const unsigned kLimitAverageThreadStackLength = 8 * 1024;
-  // Number of threads whose stack size we don't want to limit.  These base
-  // threads will simply be the first N threads returned by the dumper (although
-  // the crashing thread will never be limited).  Threads beyond this count are
-  // the extra threads.
-  static const unsigned kLimitBaseThreadCount = 20;
-  // Maximum stack size to dump for any extra thread (in bytes).
+  // Stack size to dump for every other thread (in bytes) before any of them
+  // gets more than this.
   static const unsigned kLimitMaxExtraThreadStackLen = 2 * 1024;
-  // Make sure this number of additional bytes can fit in the minidump
-  // (exclude the stack data).
-  static const unsigned kLimitMinidumpFudgeFactor = 64 * 1024;
+  // Most padding that can follow anything written to the minidump, which is
+  // kept 8-byte aligned.
+  static const unsigned kLimitAlignmentPadding = 7;
+  // What each memory region adds to the minidump besides its data: a memory
+  // list entry and the padding after the data.
+  static const unsigned kLimitMemoryRegionOverhead =
+      sizeof(MDMemoryDescriptor) + kLimitAlignmentPadding;
+
+  // Bytes of memory to dump around each crash context register that points
+  // into a mapping.
+  static const unsigned kRegisterMemorySize = 256;
+
+  // Bytes of memory to dump around the crashing instruction pointer.
+  static const size_t kIPMemorySize = 256;
 
   MinidumpWriter(const char* minidump_path,
                  int minidump_fd,
@@ -150,6 +158,8 @@ class MinidumpWriter {
         dumper_(dumper),
         minidump_size_limit_(-1),
         memory_blocks_(dumper_->allocator()),
+        register_memory_(dumper_->allocator()),
+        app_memory_included_(NULL),
         mapping_list_(mappings),
         app_memory_list_(appmem),
         skip_stacks_if_mapping_unreferenced_(
@@ -227,13 +237,13 @@ class MinidumpWriter {
   bool Dump() {
     // A minidump file contains a number of tagged streams. This is the number
     // of stream which we write.
-    unsigned kNumWriters = 13;
+    unsigned kNumWriters = 14;
 
     TypedMDRVA<MDRawDirectory> dir(&minidump_writer_);
     {
-      // Ensure the header gets flushed, as that happens in the destructor.
-      // If a crash occurs somewhere below, at least the header will be
-      // intact.
+      // Ensure the header gets flushed, as that happens in the destructor
+      // and the Flush() below. If a crash occurs somewhere below, at least
+      // the header will be intact.
       TypedMDRVA<MDRawHeader> header(&minidump_writer_);
       if (!header.Allocate())
         return false;
@@ -249,17 +259,35 @@ class MinidumpWriter {
       header.get()->stream_count = kNumWriters;
       header.get()->stream_directory_rva = dir.position();
     }
+    if (!minidump_writer_.Flush())
+      return false;
 
     unsigned dir_index = 0;
     MDRawDirectory dirent;
 
+    // With a size limit, the streams that don't depend on how much memory is
+    // dumped go first, so that the memory can be fitted to the limit around
+    // what they actually take up. Otherwise the thread list goes first, so
+    // that it survives a failure to write the rest.
+    const bool size_limited = minidump_size_limit_ >= 0;
+    if (size_limited) {
+      if (!WriteMappings(&dirent))
+        return false;
+      dir.CopyIndex(dir_index++, &dirent);
+
+      if (!WriteSystemStreams(&dir, &dir_index))
+        return false;
+    }
+
     if (!WriteThreadListStream(&dirent))
       return false;
     dir.CopyIndex(dir_index++, &dirent);
 
-    if (!WriteMappings(&dirent))
-      return false;
-    dir.CopyIndex(dir_index++, &dirent);
+    if (!size_limited) {
+      if (!WriteMappings(&dirent))
+        return false;
+      dir.CopyIndex(dir_index++, &dirent);
+    }
 
     if (!WriteAppMemory())
       return false;
@@ -272,83 +300,132 @@ class MinidumpWriter {
       return false;
     dir.CopyIndex(dir_index++, &dirent);
 
-    if (!WriteSystemInfoStream(&dirent))
+    if (!size_limited && !WriteSystemStreams(&dir, &dir_index))
+      return false;
+
+    if (!minidump_writer_.Flush())
+      return false;
+
+    dumper_->ThreadsResume();
+
+    // This goes last, once the threads have been resumed, so that it can
+    // record how long they were suspended for.
+    if (!WriteBreakpadInfoStream(&dirent))
       return false;
     dir.CopyIndex(dir_index++, &dirent);
 
+    // If you add more directory entries, don't forget to update kNumWriters,
+    // above.
+
+    return minidump_writer_.Flush();
+  }
+
+  // Writes the system information stream and the streams copied from /proc
+  // and the dynamic linker, adding them to |dir| from |*dir_index| on.
+  bool WriteSystemStreams(TypedMDRVA<MDRawDirectory>* dir,
+                          unsigned* dir_index) {
+    MDRawDirectory dirent;
+
+    if (!WriteSystemInfoStream(&dirent))
+      return false;
+    dir->CopyIndex((*dir_index)++, &dirent);
+
     dirent.stream_type = MD_LINUX_CPU_INFO;
     if (!WriteFile(&dirent.location, "/proc/cpuinfo"))
       NullifyDirectoryEntry(&dirent);
-    dir.CopyIndex(dir_index++, &dirent);
+    dir->CopyIndex((*dir_index)++, &dirent);
 
     dirent.stream_type = MD_LINUX_PROC_STATUS;
     if (!WriteProcFile(&dirent.location, GetCrashThread(), "status"))
       NullifyDirectoryEntry(&dirent);
-    dir.CopyIndex(dir_index++, &dirent);
+    dir->CopyIndex((*dir_index)++, &dirent);
 
     dirent.stream_type = MD_LINUX_LSB_RELEASE;
     if (!WriteFile(&dirent.location, "/etc/lsb-release"))
       NullifyDirectoryEntry(&dirent);
-    dir.CopyIndex(dir_index++, &dirent);
+    dir->CopyIndex((*dir_index)++, &dirent);
 
     dirent.stream_type = MD_LINUX_CMD_LINE;
     if (!WriteProcFile(&dirent.location, GetCrashThread(), "cmdline"))
       NullifyDirectoryEntry(&dirent);
-    dir.CopyIndex(dir_index++, &dirent);
+    dir->CopyIndex((*dir_index)++, &dirent);
 
     dirent.stream_type = MD_LINUX_ENVIRON;
     if (!WriteProcFile(&dirent.location, GetCrashThread(), "environ"))
       NullifyDirectoryEntry(&dirent);
-    dir.CopyIndex(dir_index++, &dirent);
+    dir->CopyIndex((*dir_index)++, &dirent);
 
     dirent.stream_type = MD_LINUX_AUXV;
     if (!WriteProcFile(&dirent.location, GetCrashThread(), "auxv"))
       NullifyDirectoryEntry(&dirent);
-    dir.CopyIndex(dir_index++, &dirent);
+    dir->CopyIndex((*dir_index)++, &dirent);
 
     dirent.stream_type = MD_LINUX_MAPS;
     if (!WriteProcFile(&dirent.location, GetCrashThread(), "maps"))
       NullifyDirectoryEntry(&dirent);
-    dir.CopyIndex(dir_index++, &dirent);
+    dir->CopyIndex((*dir_index)++, &dirent);
 
     dirent.stream_type = MD_LINUX_DSO_DEBUG;
     if (!WriteDSODebugStream(&dirent))
       NullifyDirectoryEntry(&dirent);
-    dir.CopyIndex(dir_index++, &dirent);
+    dir->CopyIndex((*dir_index)++, &dirent);
 
-    // If you add more directory entries, don't forget to update kNumWriters,
-    // above.
-
-    dumper_->ThreadsResume();
     return true;
   }
 
-  bool FillThreadStack(MDRawThread* thread, uintptr_t stack_pointer,
-                       uintptr_t pc, int max_stack_len, uint8_t** stack_copy) {
-    *stack_copy = NULL;
+  // The part of a thread's stack that will be written to the dump, and a
+  // local copy of its contents.
+  struct ThreadStack {
+    const void* stack;
+    size_t stack_len;
+    uint8_t* copy;  // NULL if no stack mapping was found.
+  };
+
+  // Works out which part of the stack containing |stack_pointer| should be
+  // dumped, truncated to |max_stack_len| bytes unless it is negative, and
+  // allocates a buffer for it. The buffer is not filled in; that is left to
+  // the caller so that the memory of many stacks can be copied in one go.
+  void PrepareThreadStack(uintptr_t stack_pointer, int max_stack_len,
+                          ThreadStack* thread_stack) {
+    thread_stack->copy = NULL;
     const void* stack;
     size_t stack_len;
+    if (!dumper_->GetStackInfo(&stack, &stack_len, stack_pointer))
+      return;
+
+    if (max_stack_len >= 0 &&
+        stack_len > static_cast<unsigned int>(max_stack_len)) {
+      // Skip empty chunks of length max_stack_len, without running past the
+      // end of the stack.
+      uintptr_t int_stack = reinterpret_cast<uintptr_t>(stack);
+      const uintptr_t stack_end = int_stack + stack_len;
+      if (max_stack_len > 0) {
+        while (int_stack + max_stack_len < stack_pointer) {
+          int_stack += max_stack_len;
+        }
+        int_stack = std::min(int_stack, stack_end - max_stack_len);
+      }
+      stack_len = max_stack_len;
+      stack = reinterpret_cast<const void*>(int_stack);
+    }
+    thread_stack->stack = stack;
+    thread_stack->stack_len = stack_len;
+    thread_stack->copy = reinterpret_cast<uint8_t*>(Alloc(stack_len));
+  }
+
+  bool FillThreadStack(MDRawThread* thread, uintptr_t stack_pointer,
+                       uintptr_t pc, const ThreadStack& thread_stack,
+                       uint8_t** stack_copy) {
+    *stack_copy = NULL;
 
     thread->stack.start_of_memory_range = stack_pointer;
     thread->stack.memory.data_size = 0;
     thread->stack.memory.rva = minidump_writer_.position();
 
-    if (dumper_->GetStackInfo(&stack, &stack_len, stack_pointer)) {
-      if (max_stack_len >= 0 &&
-          stack_len > static_cast<unsigned int>(max_stack_len)) {
-        stack_len = max_stack_len;
-        // Skip empty chunks of length max_stack_len.
-        uintptr_t int_stack = reinterpret_cast<uintptr_t>(stack);
-        if (max_stack_len > 0) {
-          while (int_stack + max_stack_len < stack_pointer) {
-            int_stack += max_stack_len;
-          }
-        }
-        stack = reinterpret_cast<const void*>(int_stack);
-      }
-      *stack_copy = reinterpret_cast<uint8_t*>(Alloc(stack_len));
-      dumper_->CopyFromProcess(*stack_copy, thread->thread_id, stack,
-                               stack_len);
+    if (thread_stack.copy) {
+      const void* stack = thread_stack.stack;
+      const size_t stack_len = thread_stack.stack_len;
+      *stack_copy = thread_stack.copy;
 
       uintptr_t stack_pointer_offset =
           stack_pointer - reinterpret_cast<uintptr_t>(stack);
@@ -395,19 +472,57 @@ class MinidumpWriter {
 
     *list.get() = num_threads;
 
-    // If there's a minidump size limit, check if it might be exceeded.  Since
-    // most of the space is filled with stack data, just check against that.
-    // If this expects to exceed the limit, set extra_thread_stack_len such
-    // that any thread beyond the first kLimitBaseThreadCount threads will
-    // have only kLimitMaxExtraThreadStackLen bytes dumped.
-    int extra_thread_stack_len = -1;  // default to no maximum
-    if (minidump_size_limit_ >= 0) {
-      const unsigned estimated_total_stack_size = num_threads *
-          kLimitAverageThreadStackLength;
-      const off_t estimated_minidump_size = minidump_writer_.position() +
-          estimated_total_stack_size + kLimitMinidumpFudgeFactor;
-      if (estimated_minidump_size > minidump_size_limit_)
-        extra_thread_stack_len = kLimitMaxExtraThreadStackLen;
+    // Collect the registers of every thread and locate its stack before
+    // writing anything, so that all of the stacks can be copied out of the
+    // process in one batch rather than one read per thread.
+    ThreadInfo* thread_infos = NULL;
+    ThreadStack* thread_stacks = NULL;
+    RemoteMemoryRange* stack_ranges = NULL;
+    uintptr_t* stack_pointers = NULL;
+    int* max_stack_lens = NULL;
+    size_t num_stack_ranges = 0;
+    if (num_threads) {
+      thread_infos = reinterpret_cast<ThreadInfo*>(
+          Alloc(num_threads * sizeof(ThreadInfo)));
+      thread_stacks = reinterpret_cast<ThreadStack*>(
+          Alloc(num_threads * sizeof(ThreadStack)));
+      stack_ranges = reinterpret_cast<RemoteMemoryRange*>(
+          Alloc(num_threads * sizeof(RemoteMemoryRange)));
+      stack_pointers = reinterpret_cast<uintptr_t*>(
+          Alloc(num_threads * sizeof(uintptr_t)));
+      max_stack_lens = reinterpret_cast<int*>(
+          Alloc(num_threads * sizeof(int)));
+    }
+    for (unsigned i = 0; i < num_threads; ++i) {
+      if (UseCrashContextForThread(dumper_->threads()[i])) {
+        stack_pointers[i] = UContextReader::GetStackPointer(ucontext_);
+      } else {
+        if (!dumper_->GetThreadInfoByIndex(i, &thread_infos[i]))
+          return false;
+        stack_pointers[i] = thread_infos[i].stack_pointer;
+      }
+      max_stack_lens[i] = -1;  // default to no maximum for this thread
+    }
+
+    // If there's a minidump size limit, decide how much of each stack, and
+    // of the other memory, fits within it.
+    if (minidump_size_limit_ >= 0)
+      ChooseMemory(num_threads, stack_pointers, max_stack_lens);
+
+    for (unsigned i = 0; i < num_threads; ++i) {
+      PrepareThreadStack(stack_pointers[i], max_stack_lens[i],
+                         &thread_stacks[i]);
+      if (thread_stacks[i].copy) {
+        RemoteMemoryRange& range = stack_ranges[num_stack_ranges++];
+        range.dest = thread_stacks[i].copy;
+        range.src = thread_stacks[i].stack;
+        range.length = thread_stacks[i].stack_len;
+      }
+    }
+    // Any suspended thread can be used to access the process memory.
+    if (num_stack_ranges) {
+      dumper_->CopyRangesFromProcess(dumper_->threads()[0], stack_ranges,
+                                     num_stack_ranges);
     }
 
     for (unsigned i = 0; i < num_threads; ++i) {
@@ -415,48 +530,17 @@ class MinidumpWriter {
       my_memset(&thread, 0, sizeof(thread));
       thread.thread_id = dumper_->threads()[i];
 
-      // We have a different source of information for the crashing thread. If
-      // we used the actual state of the thread we would find it running in the
-      // signal handler with the alternative stack, which would be deeply
-      // unhelpful.
-      if (static_cast<pid_t>(thread.thread_id) == GetCrashThread() &&
-          ucontext_ &&
-          !dumper_->IsPostMortem()) {
+      if (UseCrashContextForThread(thread.thread_id)) {
         uint8_t* stack_copy;
         const uintptr_t stack_ptr = UContextReader::GetStackPointer(ucontext_);
         if (!FillThreadStack(&thread, stack_ptr,
                              UContextReader::GetInstructionPointer(ucontext_),
-                             -1, &stack_copy))
+                             thread_stacks[i], &stack_copy))
           return false;
 
         // Copy 256 bytes around crashing instruction pointer to minidump.
-        const size_t kIPMemorySize = 256;
-        uint64_t ip = UContextReader::GetInstructionPointer(ucontext_);
-        // Bound it to the upper and lower bounds of the memory map
-        // it's contained within. If it's not in mapped memory,
-        // don't bother trying to write it.
-        bool ip_is_mapped = false;
         MDMemoryDescriptor ip_memory_d;
-        for (unsigned j = 0; j < dumper_->mappings().size(); ++j) {
-          const MappingInfo& mapping = *dumper_->mappings()[j];
-          if (ip >= mapping.start_addr &&
-              ip < mapping.start_addr + mapping.size) {
-            ip_is_mapped = true;
-            // Try to get 128 bytes before and after the IP, but
-            // settle for whatever's available.
-            ip_memory_d.start_of_memory_range =
-              std::max(mapping.start_addr,
-                       uintptr_t(ip - (kIPMemorySize / 2)));
-            uintptr_t end_of_range =
-              std::min(uintptr_t(ip + (kIPMemorySize / 2)),
-                       uintptr_t(mapping.start_addr + mapping.size));
-            ip_memory_d.memory.data_size =
-              end_of_range - ip_memory_d.start_of_memory_range;
-            break;
-          }
-        }
-
-        if (ip_is_mapped) {
+        if (GetIPMemoryRange(&ip_memory_d)) {
           UntypedMDRVA ip_memory(&minidump_writer_);
           if (!ip_memory.Allocate(ip_memory_d.memory.data_size))
             return false;
@@ -472,6 +556,9 @@ class MinidumpWriter {
           memory_blocks_.push_back(ip_memory_d);
         }
 
+        if (!WriteRegisterMemory())
+          return false;
+
         TypedMDRVA<RawContextCPU> cpu(&minidump_writer_);
         if (!cpu.Allocate())
           return false;
@@ -484,16 +571,11 @@ class MinidumpWriter {
         thread.thread_context = cpu.location();
         crashing_thread_context_ = cpu.location();
       } else {
-        ThreadInfo info;
-        if (!dumper_->GetThreadInfoByIndex(i, &info))
-          return false;
+        const ThreadInfo& info = thread_infos[i];
 
         uint8_t* stack_copy;
-        int max_stack_len = -1;  // default to no maximum for this thread
-        if (minidump_size_limit_ >= 0 && i >= kLimitBaseThreadCount)
-          max_stack_len = extra_thread_stack_len;
         if (!FillThreadStack(&thread, info.stack_pointer,
-                             info.GetInstructionPointer(), max_stack_len,
+                             info.GetInstructionPointer(), thread_stacks[i],
                              &stack_copy))
           return false;
 
@@ -520,23 +602,318 @@ class MinidumpWriter {
     return true;
   }
 
-  // Write application-provided memory regions.
-  bool WriteAppMemory() {
+  // Works out the memory around the crashing instruction pointer to dump,
+  // bounded by the mapping it is in. Returns false if it isn't mapped.
+  bool GetIPMemoryRange(MDMemoryDescriptor* ip_memory_d) {
+    const uintptr_t ip = UContextReader::GetInstructionPointer(ucontext_);
+    const MappingInfo* mapping =
+        dumper_->FindMapping(reinterpret_cast<const void*>(ip));
+    if (!mapping)
+      return false;
+    // Try to get 128 bytes before and after the IP, but settle for
+    // whatever's available.
+    ip_memory_d->start_of_memory_range =
+        ip - mapping->start_addr > kIPMemorySize / 2 ?
+        ip - kIPMemorySize / 2 : mapping->start_addr;
+    const uintptr_t end_of_range =
+        std::min(uintptr_t(ip + (kIPMemorySize / 2)),
+                 uintptr_t(mapping->start_addr + mapping->size));
+    ip_memory_d->memory.data_size =
+        end_of_range - ip_memory_d->start_of_memory_range;
+    return true;
+  }
+
+  // Takes up to |wanted| bytes from |budget|, charging for the rest of a
+  // memory region too if anything is taken, and returns how many bytes were
+  // taken.
+  static size_t TakeFromBudget(size_t wanted, size_t* budget) {
+    if (!wanted || *budget <= kLimitMemoryRegionOverhead)
+      return 0;
+    const size_t taken =
+        std::min(wanted, *budget - kLimitMemoryRegionOverhead);
+    *budget -= taken + kLimitMemoryRegionOverhead;
+    return taken;
+  }
+
+  // Shrinks [|*start|, |*end|), which contains |address|, so that it doesn't
+  // overlap [|other_start|, |other_end|). Returns false if |address| is
+  // itself in the other range, so that it is already covered.
+  static bool ExcludeRange(uintptr_t address, uintptr_t other_start,
+                           uintptr_t other_end, uintptr_t* start,
+                           uintptr_t* end) {
+    if (address >= other_start && address < other_end)
+      return false;
+    if (other_end <= address && other_end > *start)
+      *start = other_end;
+    if (other_start > address && other_start < *end)
+      *end = other_start;
+    return true;
+  }
+
+  // Works out the memory to dump around crash context registers that point
+  // into mappings, and stores it in |register_memory_|. Memory that would
+  // be dumped anyway, as part of a stack in [|stacks|[i], |stacks|[i] +
+  // |stack_lens|[i]), around the IP (|ip_memory_d| if not NULL), or as an
+  // application-provided region, is left out.
+  void ChooseRegisterMemory(unsigned num_threads, const void* const* stacks,
+                            const size_t* stack_lens,
+                            const MDMemoryDescriptor* ip_memory_d) {
+    uintptr_t regs[UContextReader::kMaxGeneralRegisters];
+    const size_t num_regs = UContextReader::GetGeneralRegisters(ucontext_,
+                                                                regs);
+    for (size_t r = 0; r < num_regs; ++r) {
+      const uintptr_t address = regs[r];
+      const MappingInfo* mapping =
+          dumper_->FindMapping(reinterpret_cast<const void*>(address));
+      if (!mapping)
+        continue;
+      uintptr_t start = address - mapping->start_addr >
+          kRegisterMemorySize / 2 ?
+          address - kRegisterMemorySize / 2 : mapping->start_addr;
+      uintptr_t end = std::min(
+          uintptr_t(address + kRegisterMemorySize / 2),
+          uintptr_t(mapping->start_addr + mapping->size));
+
+      bool covered = false;
+      for (unsigned i = 0; i < num_threads && !covered; ++i) {
+        const uintptr_t stack = reinterpret_cast<uintptr_t>(stacks[i]);
+        covered = stacks[i] &&
+            !ExcludeRange(address, stack, stack + stack_lens[i],
+                          &start, &end);
+      }
+      if (ip_memory_d && !covered) {
+        covered = !ExcludeRange(address, ip_memory_d->start_of_memory_range,
+                                ip_memory_d->start_of_memory_range +
+                                    ip_memory_d->memory.data_size,
+                                &start, &end);
+      }
+      for (AppMemoryList::const_iterator iter = app_memory_list_.begin();
+           iter != app_memory_list_.end() && !covered;
+           ++iter) {
+        const uintptr_t ptr = reinterpret_cast<uintptr_t>(iter->ptr);
+        covered = !ExcludeRange(address, ptr, ptr + iter->length,
+                                &start, &end);
+      }
+      for (size_t j = 0; j < register_memory_.size() && !covered; ++j) {
+        const MDMemoryDescriptor& other = register_memory_[j];
+        covered = !ExcludeRange(address, other.start_of_memory_range,
+                                other.start_of_memory_range +
+                                    other.memory.data_size,
+                                &start, &end);
+      }
+      if (covered)
+        continue;
+
+      MDMemoryDescriptor desc;
+      my_memset(&desc, 0, sizeof(desc));
+      desc.start_of_memory_range = start;
+      desc.memory.data_size = end - start;
+      register_memory_.push_back(desc);
+    }
+  }
+
+  // Works out which memory to dump around crash context registers (see
+  // ChooseRegisterMemory()), how much of each thread's stack, and which
+  // other memory to dump so that the minidump fits within
+  // |minidump_size_limit_|. Everything but the memory has either been
+  // written already or has a known size, so if all of the memory fits,
+  // nothing is left out. Otherwise the space left is shared out greedily,
+  // the most useful memory first:
+  //   1. the crashing thread's stack and the memory around its IP,
+  //   2. the memory around crash context registers,
+  //   3. the application-provided regions, each in full or not at all,
+  //   4. up to kLimitMaxExtraThreadStackLen bytes of every other stack,
+  //   5. the rest of the other stacks, in thread order.
+  // The stack lengths chosen are stored in |max_stack_lens|.
+  void ChooseMemory(unsigned num_threads, const uintptr_t* stack_pointers,
+                    int* max_stack_lens) {
+    const bool have_crash_context =
+        UseCrashContextForThread(GetCrashThread());
+
+    const void** stacks = NULL;
+    size_t* stack_lens = NULL;
+    if (num_threads) {
+      stacks = reinterpret_cast<const void**>(
+          Alloc(num_threads * sizeof(void*)));
+      stack_lens = reinterpret_cast<size_t*>(
+          Alloc(num_threads * sizeof(size_t)));
+    }
+
+    // Add up all of the memory that would be dumped if it all fit.
+    size_t total_size = 0;
+    int crash_index = -1;
+    for (unsigned i = 0; i < num_threads; ++i) {
+      if (!dumper_->GetStackInfo(&stacks[i], &stack_lens[i],
+                                 stack_pointers[i])) {
+        stacks[i] = NULL;
+        stack_lens[i] = 0;
+      }
+      total_size += stack_lens[i] + kLimitMemoryRegionOverhead;
+      if (dumper_->threads()[i] == GetCrashThread())
+        crash_index = i;
+    }
+    MDMemoryDescriptor ip_memory_d;
+    my_memset(&ip_memory_d, 0, sizeof(ip_memory_d));
+    const bool have_ip_memory =
+        have_crash_context && GetIPMemoryRange(&ip_memory_d);
+    if (have_ip_memory)
+      total_size += ip_memory_d.memory.data_size + kLimitMemoryRegionOverhead;
+    // The memory around registers can hold anything the stacks can, so it's
+    // left out whenever they would be sanitized or skipped.
+    if (have_crash_context && !sanitize_stacks_ &&
+        (!skip_stacks_if_mapping_unreferenced_ ||
+         CrashingThreadReferencesPrincipalMapping())) {
+      ChooseRegisterMemory(num_threads, stacks, stack_lens,
+                           have_ip_memory ? &ip_memory_d : NULL);
+    }
+    for (size_t i = 0; i < register_memory_.size(); ++i) {
+      total_size += register_memory_[i].memory.data_size +
+          kLimitMemoryRegionOverhead;
+    }
     for (AppMemoryList::const_iterator iter = app_memory_list_.begin();
          iter != app_memory_list_.end();
          ++iter) {
-      uint8_t* data_copy =
-        reinterpret_cast<uint8_t*>(dumper_->allocator()->Alloc(iter->length));
-      dumper_->CopyFromProcess(data_copy, GetCrashThread(), iter->ptr,
-                               iter->length);
+      total_size += iter->length + kLimitMemoryRegionOverhead;
+    }
+
+    // What's still to be written besides the memory: the thread contexts,
+    // the memory list's count, and the exception and Breakpad info streams.
+    const off_t fixed_size = minidump_writer_.position() +
+        num_threads * (sizeof(RawContextCPU) + kLimitAlignmentPadding) +
+        sizeof(uint32_t) + sizeof(MDRawExceptionStream) +
+        sizeof(MDRawBreakpadInfo2) + 3 * kLimitAlignmentPadding;
+    if (fixed_size + static_cast<off_t>(total_size) <= minidump_size_limit_)
+      return;
+    size_t budget = minidump_size_limit_ > fixed_size ?
+        minidump_size_limit_ - fixed_size : 0;
+
+    // 1. The crashing thread. The memory around the IP is always written, so
+    // it is charged for first.
+    if (have_ip_memory)
+      TakeFromBudget(ip_memory_d.memory.data_size, &budget);
+    if (crash_index >= 0) {
+      max_stack_lens[crash_index] =
+          TakeFromBudget(stack_lens[crash_index], &budget);
+    }
+
+    // 2. The memory around registers, keeping whichever of it fits.
+    size_t num_register_regions = 0;
+    for (size_t i = 0; i < register_memory_.size(); ++i) {
+      const size_t size = register_memory_[i].memory.data_size;
+      if (size + kLimitMemoryRegionOverhead > budget)
+        continue;
+      TakeFromBudget(size, &budget);
+      register_memory_[num_register_regions++] = register_memory_[i];
+    }
+    register_memory_.resize(num_register_regions);
+
+    // 3. The application-provided regions, which are only useful whole.
+    if (!app_memory_list_.empty()) {
+      app_memory_included_ = reinterpret_cast<bool*>(
+          Alloc(app_memory_list_.size() * sizeof(bool)));
+      size_t i = 0;
+      for (AppMemoryList::const_iterator iter = app_memory_list_.begin();
+           iter != app_memory_list_.end();
+           ++iter, ++i) {
+        app_memory_included_[i] =
+            iter->length + kLimitMemoryRegionOverhead <= budget;
+        if (app_memory_included_[i])
+          TakeFromBudget(iter->length, &budget);
+      }
+    }
+
+    // 4. The top of every other thread's stack.
+    for (unsigned i = 0; i < num_threads; ++i) {
+      if (static_cast<int>(i) == crash_index)
+        continue;
+      max_stack_lens[i] = TakeFromBudget(
+          std::min(stack_lens[i], size_t(kLimitMaxExtraThreadStackLen)),
+          &budget);
+    }
 
+    // 5. The rest of the other stacks, while there is room. The rest of
+    // their memory regions was paid for in step 4.
+    for (unsigned i = 0; i < num_threads && budget; ++i) {
+      if (static_cast<int>(i) == crash_index || !max_stack_lens[i])
+        continue;
+      const size_t extra =
+          std::min(stack_lens[i] - max_stack_lens[i], budget);
+      max_stack_lens[i] += extra;
+      budget -= extra;
+    }
+  }
+
+  // Writes the memory around crash context registers that was chosen by
+  // ChooseMemory().
+  bool WriteRegisterMemory() {
+    const size_t num_regions = register_memory_.size();
+    if (!num_regions)
+      return true;
+
+    RemoteMemoryRange* ranges = reinterpret_cast<RemoteMemoryRange*>(
+        Alloc(num_regions * sizeof(RemoteMemoryRange)));
+    for (size_t i = 0; i < num_regions; ++i) {
+      ranges[i].dest = Alloc(register_memory_[i].memory.data_size);
+      ranges[i].src = reinterpret_cast<const void*>(
+          register_memory_[i].start_of_memory_range);
+      ranges[i].length = register_memory_[i].memory.data_size;
+    }
+    dumper_->CopyRangesFromProcess(GetCrashThread(), ranges, num_regions);
+
+    for (size_t i = 0; i < num_regions; ++i) {
+      UntypedMDRVA memory(&minidump_writer_);
+      if (!memory.Allocate(ranges[i].length))
+        return false;
+      memory.Copy(ranges[i].dest, ranges[i].length);
+      MDMemoryDescriptor desc = register_memory_[i];
+      desc.memory = memory.location();
+      memory_blocks_.push_back(desc);
+    }
+    return true;
+  }
+
+  // We have a different source of information for the crashing thread. If
+  // we used the actual state of the thread we would find it running in the
+  // signal handler with the alternative stack, which would be deeply
+  // unhelpful.
+  bool UseCrashContextForThread(pid_t thread_id) const {
+    return thread_id == GetCrashThread() &&
+           ucontext_ &&
+           !dumper_->IsPostMortem();
+  }
+
+  // Write application-provided memory regions.
+  bool WriteAppMemory() {
+    // Copy all of the regions out of the process in one batch first. Regions
+    // left out to fit the size limit are not read at all.
+    RemoteMemoryRange* ranges = NULL;
+    size_t num_ranges = 0;
+    if (!app_memory_list_.empty()) {
+      ranges = reinterpret_cast<RemoteMemoryRange*>(
+          Alloc(app_memory_list_.size() * sizeof(RemoteMemoryRange)));
+      size_t i = 0;
+      for (AppMemoryList::const_iterator iter = app_memory_list_.begin();
+           iter != app_memory_list_.end();
+           ++iter, ++i) {
+        if (app_memory_included_ && !app_memory_included_[i])
+          continue;
+        RemoteMemoryRange& range = ranges[num_ranges++];
+        range.dest = dumper_->allocator()->Alloc(iter->length);
+        range.src = iter->ptr;
+        range.length = iter->length;
+      }
+      if (num_ranges)
+        dumper_->CopyRangesFromProcess(GetCrashThread(), ranges, num_ranges);
+    }
+
+    for (size_t i = 0; i < num_ranges; ++i) {
       UntypedMDRVA memory(&minidump_writer_);
-      if (!memory.Allocate(iter->length)) {
+      if (!memory.Allocate(ranges[i].length)) {
         return false;
       }
-      memory.Copy(data_copy, iter->length);
+      memory.Copy(ranges[i].dest, ranges[i].length);
       MDMemoryDescriptor desc;
-      desc.start_of_memory_range = reinterpret_cast<uintptr_t>(iter->ptr);
+      desc.start_of_memory_range = reinterpret_cast<uintptr_t>(ranges[i].src);
       desc.memory = memory.location();
       memory_blocks_.push_back(desc);
     }
@@ -780,6 +1157,49 @@ class MinidumpWriter {
     return true;
   }
 
+  static uint32_t SaturateToUint32(uint64_t value) {
+    return value > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(value);
+  }
+
+  bool WriteBreakpadInfoStream(MDRawDirectory* dirent) {
+    MDRawBreakpadInfo2 info;
+    my_memset(&info, 0, sizeof(info));
+    // The dump is written from another process, so there's no dump thread.
+    if (GetCrashThread()) {
+      info.validity |= MD_BREAKPAD_INFO_VALID_REQUESTING_THREAD_ID;
+      info.requesting_thread_id = GetCrashThread();
+    }
+    // Older readers only accept the short form, so keep to it unless the
+    // dump was written from a snapshot and there is a pause duration to
+    // record, or it was written from a crash arena.
+    size_t size = sizeof(MDRawBreakpadInfo);
+    const int64_t pause_duration_us = dumper_->pause_duration_us();
+    if (pause_duration_us >= 0) {
+      info.validity |= MD_BREAKPAD_INFO_VALID_PAUSE_DURATION;
+      info.pause_duration_us = SaturateToUint32(pause_duration_us);
+      size = sizeof(info);
+    }
+    // Recording the crash arena's usage in the dump keeps it from being lost
+    // with the crashed process. This stream is written last, so the arena
+    // has been used about as much as it will be.
+    const PageArena* arena = PageArena::current();
+    if (arena) {
+      info.validity |= MD_BREAKPAD_INFO_VALID_CRASH_ARENA;
+      info.crash_arena_high_water = SaturateToUint32(arena->high_water());
+      info.crash_arena_overflow_bytes =
+          SaturateToUint32(arena->overflow_bytes());
+      size = sizeof(info);
+    }
+
+    UntypedMDRVA stream(&minidump_writer_);
+    if (!stream.Allocate(size) || !stream.Copy(&info, size))
+      return false;
+
+    dirent->stream_type = MD_BREAKPAD_INFO_STREAM;
+    dirent->location = stream.location();
+    return true;
+  }
+
   bool WriteSystemInfoStream(MDRawDirectory* dirent) {
     TypedMDRVA<MDRawSystemInfo> si(&minidump_writer_);
     if (!si.Allocate())
@@ -938,6 +1358,10 @@ class MinidumpWriter {
 
   void set_minidump_size_limit(off_t limit) { minidump_size_limit_ = limit; }
 
+  // Writes the minidump as a compressed container. Must be called before
+  // Init().
+  void set_compress(bool compress) { minidump_writer_.set_compress(compress); }
+
  private:
   void* Alloc(unsigned bytes) {
     return dumper_->allocator()->Alloc(bytes);
@@ -1451,6 +1875,12 @@ class MinidumpWriter {
   // written while writing the thread list stream, but saved here
   // so a memory list stream can be written afterwards.
   wasteful_vector<MDMemoryDescriptor> memory_blocks_;
+  // The memory around crash context registers to dump. Only the address
+  // range of each descriptor is filled in.
+  wasteful_vector<MDMemoryDescriptor> register_memory_;
+  // Whether each of the |app_memory_list_| regions is to be dumped, or NULL
+  // if all of them are.
+  bool* app_memory_included_;
   // Additional information about some mappings provided by the caller.
   const MappingList& mapping_list_;
   // Additional memory regions to be included in the dump,
@@ -1475,7 +1905,10 @@ bool WriteMinidumpImpl(const char* minidump_path,
                        const AppMemoryList& appmem,
                        bool skip_stacks_if_mapping_unreferenced,
                        uintptr_t principal_mapping_address,
-                       bool sanitize_stacks) {
+                       bool sanitize_stacks,
+                       bool compress,
+                       LinuxPtraceDumper::SnapshotCallback snapshot_callback,
+                       void* snapshot_context) {
   LinuxPtraceDumper dumper(crashing_process);
   const ExceptionHandler::CrashContext* context = NULL;
   if (blob) {
@@ -1484,12 +1917,19 @@ bool WriteMinidumpImpl(const char* minidump_path,
     context = reinterpret_cast<const ExceptionHandler::CrashContext*>(blob);
     dumper.SetCrashInfoFromSigInfo(context->siginfo);
     dumper.set_crash_thread(context->tid);
+    // The crashing thread's registers come from |context|, so it is the one
+    // that can be left running to take the snapshot.
+    if (snapshot_callback) {
+      dumper.set_snapshot_callback(snapshot_callback, snapshot_context,
+                                   context->tid);
+    }
   }
   MinidumpWriter writer(minidump_path, minidump_fd, context, mappings,
                         appmem, skip_stacks_if_mapping_unreferenced,
                         principal_mapping_address, sanitize_stacks, &dumper);
   // Set desired limit for file size of minidump (-1 means no limit).
   writer.set_minidump_size_limit(minidump_size_limit);
+  writer.set_compress(compress);
   if (!writer.Init())
     return false;
   return writer.Dump();
@@ -1509,7 +1949,7 @@ bool WriteMinidump(const char* minidump_path, pid_t crashing_process,
                            MappingList(), AppMemoryList(),
                            skip_stacks_if_mapping_unreferenced,
                            principal_mapping_address,
-                           sanitize_stacks);
+                           sanitize_stacks, false, NULL, NULL);
 }
 
 bool WriteMinidump(int minidump_fd, pid_t crashing_process,
@@ -1522,7 +1962,7 @@ bool WriteMinidump(int minidump_fd, pid_t crashing_process,
                            MappingList(), AppMemoryList(),
                            skip_stacks_if_mapping_unreferenced,
                            principal_mapping_address,
-                           sanitize_stacks);
+                           sanitize_stacks, false, NULL, NULL);
 }
 
 bool WriteMinidump(const char* minidump_path, pid_t process,
@@ -1552,7 +1992,7 @@ bool WriteMinidump(const char* minidump_path, pid_t crashing_process,
                            mappings, appmem,
                            skip_stacks_if_mapping_unreferenced,
                            principal_mapping_address,
-                           sanitize_stacks);
+                           sanitize_stacks, false, NULL, NULL);
 }
 
 bool WriteMinidump(int minidump_fd, pid_t crashing_process,
@@ -1567,7 +2007,7 @@ bool WriteMinidump(int minidump_fd, pid_t crashing_process,
                            mappings, appmem,
                            skip_stacks_if_mapping_unreferenced,
                            principal_mapping_address,
-                           sanitize_stacks);
+                           sanitize_stacks, false, NULL, NULL);
 }
 
 bool WriteMinidump(const char* minidump_path, off_t minidump_size_limit,
@@ -1577,13 +2017,17 @@ bool WriteMinidump(const char* minidump_path, off_t minidump_size_limit,
                    const AppMemoryList& appmem,
                    bool skip_stacks_if_mapping_unreferenced,
                    uintptr_t principal_mapping_address,
-                   bool sanitize_stacks) {
+                   bool sanitize_stacks,
+                   bool compress,
+                   LinuxPtraceDumper::SnapshotCallback snapshot_callback,
+                   void* snapshot_context) {
   return WriteMinidumpImpl(minidump_path, -1, minidump_size_limit,
                            crashing_process, blob, blob_size,
                            mappings, appmem,
                            skip_stacks_if_mapping_unreferenced,
                            principal_mapping_address,
-                           sanitize_stacks);
+                           sanitize_stacks, compress, snapshot_callback,
+                           snapshot_context);
 }
 
 bool WriteMinidump(int minidump_fd, off_t minidump_size_limit,
@@ -1593,13 +2037,17 @@ bool WriteMinidump(int minidump_fd, off_t minidump_size_limit,
                    const AppMemoryList& appmem,
                    bool skip_stacks_if_mapping_unreferenced,
                    uintptr_t principal_mapping_address,
-                   bool sanitize_stacks) {
+                   bool sanitize_stacks,
+                   bool compress,
+                   LinuxPtraceDumper::SnapshotCallback snapshot_callback,
+                   void* snapshot_context) {
   return WriteMinidumpImpl(NULL, minidump_fd, minidump_size_limit,
                            crashing_process, blob, blob_size,
                            mappings, appmem,
                            skip_stacks_if_mapping_unreferenced,
                            principal_mapping_address,
-                           sanitize_stacks);
+                           sanitize_stacks, compress, snapshot_callback,
+                           snapshot_context);
 }
 
 bool WriteMinidump(const char* filename,
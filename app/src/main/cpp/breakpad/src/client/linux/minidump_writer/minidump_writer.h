@@ -39,6 +39,7 @@
 #include <utility>
 
 #include "client/linux/minidump_writer/linux_dumper.h"
+#include "client/linux/minidump_writer/linux_ptrace_dumper.h"
 #include "google_breakpad/common/minidump_format.h"
 
 namespace google_breakpad {
@@ -114,7 +115,18 @@ bool WriteMinidump(int minidump_fd, pid_t crashing_process,
                    uintptr_t principal_mapping_address = 0,
                    bool sanitize_stacks = false);
 
-// These overloads also allow passing a file size limit for the minidump.
+// These overloads also allow passing a file size limit for the minidump, and
+// writing it as a compressed container (see common/minidump_compression.h),
+// which the processor's Minidump class reads like a plain minidump.
+// With a size limit, the memory around crash context registers that point
+// into mappings is dumped too, unless the stacks are sanitized or skipped.
+// When the memory that would be dumped doesn't fit in the size limit, the
+// crashing thread's stack comes first, then the memory around the crash
+// context registers and |appdata|, and the other stacks share what's left.
+// Given a |snapshot_callback|, the crashing thread named in |blob| is left
+// running and the minidump is written from a snapshot of the process, so
+// that its other threads are only suspended while the snapshot is taken;
+// see LinuxPtraceDumper::set_snapshot_callback().
 bool WriteMinidump(const char* minidump_path, off_t minidump_size_limit,
                    pid_t crashing_process,
                    const void* blob, size_t blob_size,
@@ -122,7 +134,11 @@ bool WriteMinidump(const char* minidump_path, off_t minidump_size_limit,
                    const AppMemoryList& appdata,
                    bool skip_stacks_if_mapping_unreferenced = false,
                    uintptr_t principal_mapping_address = 0,
-                   bool sanitize_stacks = false);
+                   bool sanitize_stacks = false,
+                   bool compress = false,
+                   LinuxPtraceDumper::SnapshotCallback snapshot_callback =
+                       NULL,
+                   void* snapshot_context = NULL);
 bool WriteMinidump(int minidump_fd, off_t minidump_size_limit,
                    pid_t crashing_process,
                    const void* blob, size_t blob_size,
@@ -130,7 +146,11 @@ bool WriteMinidump(int minidump_fd, off_t minidump_size_limit,
                    const AppMemoryList& appdata,
                    bool skip_stacks_if_mapping_unreferenced = false,
                    uintptr_t principal_mapping_address = 0,
-                   bool sanitize_stacks = false);
+                   bool sanitize_stacks = false,
+                   bool compress = false,
+                   LinuxPtraceDumper::SnapshotCallback snapshot_callback =
+                       NULL,
+                   void* snapshot_context = NULL);
 
 bool WriteMinidump(const char* filename,
                    const MappingList& mappings,
@@ -32,6 +32,7 @@
 
 #include <fcntl.h>
 #include <poll.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/syscall.h>
 #include <sys/types.h>
@@ -681,6 +682,85 @@ TEST(MinidumpWriterTest, AdditionalMemory) {
   IGNORE_EINTR(waitpid(child, nullptr, 0));
 }
 
+// Test that a compressed minidump is smaller than the plain one and reads
+// back the same.
+TEST(MinidumpWriterTest, Compressed) {
+  int fds[2];
+  ASSERT_NE(-1, pipe(fds));
+
+  const uint32_t kMemorySize = sysconf(_SC_PAGESIZE);
+  uint8_t* memory = new uint8_t[kMemorySize];
+  const uintptr_t kMemoryAddress = reinterpret_cast<uintptr_t>(memory);
+  for (uint32_t i = 0; i < kMemorySize; ++i) {
+    memory[i] = i % 255;
+  }
+
+  const pid_t child = fork();
+  if (child == 0) {
+    close(fds[1]);
+    char b;
+    HANDLE_EINTR(read(fds[0], &b, sizeof(b)));
+    close(fds[0]);
+    syscall(__NR_exit_group);
+  }
+  close(fds[0]);
+
+  ExceptionHandler::CrashContext context;
+  ASSERT_EQ(0, getcontext(&context.context));
+  context.tid = child;
+
+  AutoTempDir temp_dir;
+  const string plain_path = temp_dir.path() + kMDWriterUnitTestFileName;
+  const string compressed_path = plain_path + "-compressed";
+
+  MappingList mappings;
+  AppMemoryList memory_list;
+  AppMemory app_memory;
+  app_memory.ptr = memory;
+  app_memory.length = kMemorySize;
+  memory_list.push_back(app_memory);
+  ASSERT_TRUE(WriteMinidump(plain_path.c_str(), -1, child, &context,
+                            sizeof(context), mappings, memory_list));
+  ASSERT_TRUE(WriteMinidump(compressed_path.c_str(), -1, child, &context,
+                            sizeof(context), mappings, memory_list,
+                            false, 0, false, true));
+
+  struct stat plain_st, compressed_st;
+  ASSERT_EQ(0, stat(plain_path.c_str(), &plain_st));
+  ASSERT_EQ(0, stat(compressed_path.c_str(), &compressed_st));
+  EXPECT_LT(compressed_st.st_size, plain_st.st_size);
+
+  Minidump plain(plain_path);
+  Minidump minidump(compressed_path);
+  ASSERT_TRUE(plain.Read());
+  ASSERT_TRUE(minidump.Read());
+  EXPECT_EQ(plain.GetDirectoryEntryCount(), minidump.GetDirectoryEntryCount());
+
+  MinidumpThreadList* plain_threads = plain.GetThreadList();
+  MinidumpThreadList* threads = minidump.GetThreadList();
+  ASSERT_TRUE(plain_threads);
+  ASSERT_TRUE(threads);
+  EXPECT_EQ(plain_threads->thread_count(), threads->thread_count());
+
+  MinidumpModuleList* plain_modules = plain.GetModuleList();
+  MinidumpModuleList* modules = minidump.GetModuleList();
+  ASSERT_TRUE(plain_modules);
+  ASSERT_TRUE(modules);
+  EXPECT_EQ(plain_modules->module_count(), modules->module_count());
+
+  MinidumpMemoryList* dump_memory_list = minidump.GetMemoryList();
+  ASSERT_TRUE(dump_memory_list);
+  const MinidumpMemoryRegion* region =
+    dump_memory_list->GetMemoryRegionForAddress(kMemoryAddress);
+  ASSERT_TRUE(region);
+  EXPECT_EQ(kMemorySize, region->GetSize());
+  EXPECT_EQ(0, memcmp(region->GetMemory(), memory, kMemorySize));
+
+  delete[] memory;
+  close(fds[1]);
+  IGNORE_EINTR(waitpid(child, nullptr, 0));
+}
+
 // Test that an invalid thread stack pointer still results in a minidump.
 TEST(MinidumpWriterTest, InvalidStackPointer) {
   int fds[2];
@@ -874,11 +954,7 @@ TEST(MinidumpWriterTest, MinidumpSizeLimit) {
   // Third, write a minidump with a size limit small enough to be triggered.
   {
     // Set size limit to some arbitrary amount, such that the limiting code
-    // will kick in.  The equation used to set this value was determined by
-    // simply reversing the size-limit logic a little bit in order to pick a
-    // size we know will trigger it.  The definition of
-    // kLimitAverageThreadStackLength here was copied from class
-    // MinidumpWriter in minidump_writer.cc.
+    // will kick in: an average of 8KB per thread for everything.
     static const unsigned kLimitAverageThreadStackLength = 8 * 1024;
     off_t minidump_size_limit = kNumberOfThreadsInHelperProgram *
         kLimitAverageThreadStackLength;
@@ -917,13 +993,12 @@ TEST(MinidumpWriterTest, MinidumpSizeLimit) {
       total_limit_stack_size += memory->GetSize();
     }
 
-    // Make sure stack size shrunk by at least 1KB per extra thread.  The
-    // definition of kLimitBaseThreadCount here was copied from class
-    // MinidumpWriter in minidump_writer.cc.
+    // Make sure stack size shrunk by at least 1KB for each thread beyond
+    // the first kLimitBaseThreadCount.
     // Note: The 1KB is arbitrary, and assumes that the thread stacks are big
     // enough to shrink by that much.  For example, if each thread stack was
-    // originally only 2KB, the current size-limit logic wouldn't actually
-    // shrink them because that's the size to which it tries to shrink.  If
+    // originally only 2KB, the size-limit logic wouldn't actually shrink
+    // them because every thread is given that much before any gets more.  If
     // you fail this part of the test due to something like that, the test
     // logic should probably be improved to account for your situation.
     const unsigned kLimitBaseThreadCount = 20;
@@ -939,4 +1014,241 @@ TEST(MinidumpWriterTest, MinidumpSizeLimit) {
   IGNORE_EINTR(waitpid(child_pid, nullptr, 0));
 }
 
+// Test that when the memory doesn't all fit in the size limit, the memory
+// around crash context registers and the application-provided regions that
+// fit are kept, and the rest is left out.
+TEST(MinidumpWriterTest, SizeLimitKeepsMostUsefulMemory) {
+  int fds[2];
+  ASSERT_NE(-1, pipe(fds));
+
+  // Heap memory for a register to point at, and two regions for the
+  // application to register: one small, and one too big for the limit.
+  const size_t kPointedSize = 1024;
+  const size_t kSmallSize = 1024;
+  const size_t kLargeSize = 256 * 1024;
+  uint8_t* pointed = new uint8_t[kPointedSize];
+  uint8_t* small = new uint8_t[kSmallSize];
+  uint8_t* large = new uint8_t[kLargeSize];
+  for (size_t i = 0; i < kPointedSize; ++i)
+    pointed[i] = i % 251;
+  memset(small, 0x5a, kSmallSize);
+  memset(large, 0xa5, kLargeSize);
+  const uintptr_t kPointedAddress =
+      reinterpret_cast<uintptr_t>(pointed) + kPointedSize / 2;
+
+  const pid_t child = fork();
+  if (child == 0) {
+    close(fds[1]);
+    char b;
+    HANDLE_EINTR(read(fds[0], &b, sizeof(b)));
+    close(fds[0]);
+    syscall(__NR_exit_group);
+  }
+  close(fds[0]);
+
+  // As above, the context comes from the parent, which the child is a
+  // forked copy of. Make a register that isn't the stack pointer point
+  // into the heap memory.
+  ExceptionHandler::CrashContext context;
+  ASSERT_EQ(0, getcontext(&context.context));
+  context.tid = child;
+#if defined(__i386)
+  context.context.uc_mcontext.gregs[REG_EBX] = kPointedAddress;
+#elif defined(__x86_64)
+  context.context.uc_mcontext.gregs[REG_RBX] = kPointedAddress;
+#elif defined(__ARM_EABI__)
+  context.context.uc_mcontext.arm_r4 = kPointedAddress;
+#elif defined(__aarch64__)
+  context.context.uc_mcontext.regs[19] = kPointedAddress;
+#elif defined(__mips__)
+  context.context.uc_mcontext.gregs[16] = kPointedAddress;
+#elif defined(__riscv)
+  context.context.uc_mcontext.__gregs[9] = kPointedAddress;
+#else
+# error "This code has not been ported to your platform yet."
+#endif
+
+  AutoTempDir temp_dir;
+
+  // Find out how big the dump is without any of the extra memory.
+  off_t normal_file_size;
+  {
+    string normal_dump = temp_dir.path() + "/minidump-writer-unittest.dmp";
+    ASSERT_TRUE(WriteMinidump(normal_dump.c_str(), -1, child,
+                              &context, sizeof(context),
+                              MappingList(), AppMemoryList()));
+    struct stat st;
+    ASSERT_EQ(0, stat(normal_dump.c_str(), &st));
+    normal_file_size = st.st_size;
+
+    // The memory around the register is only dumped with a limit.
+    Minidump minidump(normal_dump);
+    ASSERT_TRUE(minidump.Read());
+    MinidumpMemoryList* dump_memory_list = minidump.GetMemoryList();
+    ASSERT_TRUE(dump_memory_list);
+    EXPECT_FALSE(dump_memory_list->GetMemoryRegionForAddress(kPointedAddress));
+  }
+
+  AppMemoryList memory_list;
+  AppMemory app_memory;
+  app_memory.ptr = small;
+  app_memory.length = kSmallSize;
+  memory_list.push_back(app_memory);
+  app_memory.ptr = large;
+  app_memory.length = kLargeSize;
+  memory_list.push_back(app_memory);
+
+  // Leave room for a little more memory, but nowhere near enough for the
+  // large region.
+  const off_t minidump_size_limit = normal_file_size + 16 * 1024;
+  string limit_dump = temp_dir.path() + "/minidump-writer-unittest-limit.dmp";
+  ASSERT_TRUE(WriteMinidump(limit_dump.c_str(), minidump_size_limit, child,
+                            &context, sizeof(context),
+                            MappingList(), memory_list));
+  struct stat st;
+  ASSERT_EQ(0, stat(limit_dump.c_str(), &st));
+  EXPECT_LE(st.st_size, minidump_size_limit);
+
+  Minidump minidump(limit_dump);
+  ASSERT_TRUE(minidump.Read());
+  MinidumpMemoryList* dump_memory_list = minidump.GetMemoryList();
+  ASSERT_TRUE(dump_memory_list);
+
+  // The memory around the register is there.
+  MinidumpMemoryRegion* region =
+      dump_memory_list->GetMemoryRegionForAddress(kPointedAddress);
+  ASSERT_TRUE(region);
+  EXPECT_LE(region->GetBase(), kPointedAddress - 64);
+  EXPECT_GE(region->GetBase() + region->GetSize(), kPointedAddress + 64);
+  const uintptr_t pointed_offset =
+      region->GetBase() - reinterpret_cast<uintptr_t>(pointed);
+  EXPECT_EQ(0, memcmp(region->GetMemory(), pointed + pointed_offset,
+                      region->GetSize()));
+
+  // So is the small region, in full, but not the large one.
+  region = dump_memory_list->GetMemoryRegionForAddress(
+      reinterpret_cast<uintptr_t>(small));
+  ASSERT_TRUE(region);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(small), region->GetBase());
+  EXPECT_EQ(kSmallSize, region->GetSize());
+  EXPECT_EQ(0, memcmp(region->GetMemory(), small, kSmallSize));
+  EXPECT_FALSE(dump_memory_list->GetMemoryRegionForAddress(
+      reinterpret_cast<uintptr_t>(large)));
+
+  // With sanitized stacks, the memory around the register is left out too.
+  string sanitized_dump =
+      temp_dir.path() + "/minidump-writer-unittest-sanitized.dmp";
+  ASSERT_TRUE(WriteMinidump(sanitized_dump.c_str(), minidump_size_limit,
+                            child, &context, sizeof(context),
+                            MappingList(), memory_list, false, 0, true));
+  Minidump sanitized_minidump(sanitized_dump);
+  ASSERT_TRUE(sanitized_minidump.Read());
+  dump_memory_list = sanitized_minidump.GetMemoryList();
+  ASSERT_TRUE(dump_memory_list);
+  EXPECT_FALSE(dump_memory_list->GetMemoryRegionForAddress(kPointedAddress));
+  EXPECT_TRUE(dump_memory_list->GetMemoryRegionForAddress(
+      reinterpret_cast<uintptr_t>(small)));
+
+  delete[] pointed;
+  delete[] small;
+  delete[] large;
+  close(fds[1]);
+  IGNORE_EINTR(waitpid(child, nullptr, 0));
+}
+
+// Test that the size limit holds for a process whose other streams are big,
+// here its /proc/self/maps.
+TEST(MinidumpWriterTest, SizeLimitWithLargeMaps) {
+  const size_t kRegionSize = 256 * 1024;
+  uint8_t* region = new uint8_t[kRegionSize];
+  memset(region, 0x5a, kRegionSize);
+
+  int ready_fds[2];
+  int exit_fds[2];
+  ASSERT_NE(-1, pipe(ready_fds));
+  ASSERT_NE(-1, pipe(exit_fds));
+  const pid_t child = fork();
+  if (child == 0) {
+    close(ready_fds[0]);
+    close(exit_fds[1]);
+    // Alternate the protection of thousands of pages, so that each is a
+    // mapping of its own.
+    const size_t kNumPages = 8192;
+    const size_t page_size = getpagesize();
+    char* pages = reinterpret_cast<char*>(
+        mmap(NULL, kNumPages * page_size, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (pages != MAP_FAILED) {
+      for (size_t i = 0; i < kNumPages; i += 2)
+        mprotect(pages + i * page_size, page_size, PROT_READ);
+    }
+    char b = 0;
+    HANDLE_EINTR(write(ready_fds[1], &b, sizeof(b)));
+    HANDLE_EINTR(read(exit_fds[0], &b, sizeof(b)));
+    syscall(__NR_exit_group);
+  }
+  close(ready_fds[1]);
+  close(exit_fds[0]);
+  char b;
+  ASSERT_EQ(1, HANDLE_EINTR(read(ready_fds[0], &b, sizeof(b))));
+  close(ready_fds[0]);
+
+  AutoTempDir temp_dir;
+
+  // Find out how big the dump is without the region.
+  off_t normal_file_size;
+  {
+    string normal_dump = temp_dir.path() + "/minidump-writer-unittest.dmp";
+    ASSERT_TRUE(WriteMinidump(normal_dump.c_str(), -1, child, NULL, 0,
+                              MappingList(), AppMemoryList()));
+    struct stat st;
+    ASSERT_EQ(0, stat(normal_dump.c_str(), &st));
+    normal_file_size = st.st_size;
+
+    Minidump minidump(normal_dump);
+    ASSERT_TRUE(minidump.Read());
+    uint32_t maps_size = 0;
+    for (unsigned i = 0; i < minidump.GetDirectoryEntryCount(); ++i) {
+      const MDRawDirectory* dirent = minidump.GetDirectoryEntryAtIndex(i);
+      if (dirent->stream_type == MD_LINUX_MAPS)
+        maps_size = dirent->location.data_size;
+    }
+    ASSERT_GT(maps_size, kRegionSize);
+  }
+
+  // Leave room for far less than the region, which is then left out.
+  AppMemoryList memory_list;
+  AppMemory app_memory;
+  app_memory.ptr = region;
+  app_memory.length = kRegionSize;
+  memory_list.push_back(app_memory);
+  const off_t minidump_size_limit = normal_file_size + 16 * 1024;
+  string limit_dump = temp_dir.path() + "/minidump-writer-unittest-limit.dmp";
+  ASSERT_TRUE(WriteMinidump(limit_dump.c_str(), minidump_size_limit, child,
+                            NULL, 0, MappingList(), memory_list));
+  struct stat st;
+  ASSERT_EQ(0, stat(limit_dump.c_str(), &st));
+  EXPECT_LE(st.st_size, minidump_size_limit);
+
+  Minidump minidump(limit_dump);
+  ASSERT_TRUE(minidump.Read());
+  MinidumpMemoryList* dump_memory_list = minidump.GetMemoryList();
+  ASSERT_TRUE(dump_memory_list);
+  EXPECT_FALSE(dump_memory_list->GetMemoryRegionForAddress(
+      reinterpret_cast<uintptr_t>(region)));
+
+  // Even a limit just below the normal size is kept to, by giving up some
+  // stack.
+  const off_t tight_limit = normal_file_size - 1024;
+  string tight_dump = temp_dir.path() + "/minidump-writer-unittest-tight.dmp";
+  ASSERT_TRUE(WriteMinidump(tight_dump.c_str(), tight_limit, child,
+                            NULL, 0, MappingList(), AppMemoryList()));
+  ASSERT_EQ(0, stat(tight_dump.c_str(), &st));
+  EXPECT_LE(st.st_size, tight_limit);
+
+  delete[] region;
+  close(exit_fds[1]);
+  IGNORE_EINTR(waitpid(child, nullptr, 0));
+}
+
 }  // namespace
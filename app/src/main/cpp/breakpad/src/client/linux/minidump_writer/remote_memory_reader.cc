@@ -0,0 +1,266 @@
+// Copyright 2024 Google LLC
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google LLC nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// remote_memory_reader.cc: Implement google_breakpad::RemoteMemoryReader.
+// See remote_memory_reader.h for details.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>  // Must come first
+#endif
+
+#include "client/linux/minidump_writer/remote_memory_reader.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/ptrace.h>
+#include <unistd.h>
+
+#include "common/linux/linux_libc_support.h"
+#include "third_party/lss/linux_syscall_support.h"
+
+namespace {
+
+// Maximum number of ranges passed to a single process_vm_readv call. The
+// kernel accepts up to UIO_MAXIOV (1024); a smaller batch keeps the scratch
+// vectors within a couple of pages while still covering a few hundred
+// thread stacks per call.
+const size_t kMaxIovecs = 256;
+
+}  // namespace
+
+namespace google_breakpad {
+
+RemoteMemoryReader::RemoteMemoryReader(pid_t pid, PageAllocator* allocator)
+    : pid_(pid),
+      allocator_(allocator),
+      page_size_(getpagesize()),
+      methods_(kAllMethods),
+      proc_mem_fd_(-1),
+      vm_readv_worked_(false),
+      vm_readv_unavailable_(false),
+      local_iov_(NULL),
+      remote_iov_(NULL),
+      iov_capacity_(0) {
+  ResetStats();
+}
+
+RemoteMemoryReader::~RemoteMemoryReader() {
+  if (proc_mem_fd_ >= 0)
+    sys_close(proc_mem_fd_);
+}
+
+void RemoteMemoryReader::set_pid(pid_t pid) {
+  if (proc_mem_fd_ >= 0)
+    sys_close(proc_mem_fd_);
+  pid_ = pid;
+  proc_mem_fd_ = -1;
+  vm_readv_worked_ = false;
+  vm_readv_unavailable_ = false;
+}
+
+void RemoteMemoryReader::ResetStats() {
+  my_memset(&stats_, 0, sizeof(stats_));
+}
+
+bool RemoteMemoryReader::Read(pid_t tid, void* dest, const void* src,
+                              size_t length) {
+  RemoteMemoryRange range = { dest, src, length };
+  return ReadRanges(tid, &range, 1);
+}
+
+bool RemoteMemoryReader::ReadRanges(pid_t tid,
+                                    const RemoteMemoryRange* ranges,
+                                    size_t count) {
+  for (size_t i = 0; i < count; ++i)
+    stats_.bytes += ranges[i].length;
+
+#if defined(__NR_process_vm_readv)
+  if ((methods_ & kProcessVmReadv) && !local_iov_) {
+    local_iov_ = reinterpret_cast<struct kernel_iovec*>(
+        allocator_->Alloc(kMaxIovecs * sizeof(struct kernel_iovec)));
+    remote_iov_ = reinterpret_cast<struct kernel_iovec*>(
+        allocator_->Alloc(kMaxIovecs * sizeof(struct kernel_iovec)));
+    if (local_iov_ && remote_iov_)
+      iov_capacity_ = kMaxIovecs;
+  }
+
+  size_t next = 0;
+  while (next < count && (methods_ & kProcessVmReadv) &&
+         !vm_readv_unavailable_ && iov_capacity_) {
+    size_t batch = count - next;
+    if (batch > iov_capacity_)
+      batch = iov_capacity_;
+    for (size_t i = 0; i < batch; ++i) {
+      const RemoteMemoryRange& range = ranges[next + i];
+      local_iov_[i].iov_base = range.dest;
+      local_iov_[i].iov_len = range.length;
+      remote_iov_[i].iov_base = const_cast<void*>(range.src);
+      remote_iov_[i].iov_len = range.length;
+    }
+
+    ++stats_.syscalls;
+    ++stats_.vm_readv_calls;
+    const ssize_t copied = sys_process_vm_readv(pid_, local_iov_, batch,
+                                                remote_iov_, batch, 0);
+    if (copied < 0) {
+      // Nothing could be read from the first range; let the slower
+      // mechanisms deal with it and carry on batching after it.
+      const RemoteMemoryRange& range = ranges[next];
+      ReadSlow(tid, static_cast<uint8_t*>(range.dest),
+               reinterpret_cast<uintptr_t>(range.src), range.length);
+      ++next;
+      continue;
+    }
+    if (copied > 0)
+      vm_readv_worked_ = true;
+
+    // process_vm_readv stops at the first remote page it cannot read, so
+    // every range before that point is complete, the range containing it is
+    // partially filled, and none of the following ranges were touched.
+    size_t remaining = static_cast<size_t>(copied);
+    size_t i = 0;
+    for (; i < batch; ++i) {
+      const RemoteMemoryRange& range = ranges[next + i];
+      if (remaining < range.length) {
+        ReadSlow(tid, static_cast<uint8_t*>(range.dest) + remaining,
+                 reinterpret_cast<uintptr_t>(range.src) + remaining,
+                 range.length - remaining);
+        ++i;
+        break;
+      }
+      remaining -= range.length;
+    }
+    next += i;
+  }
+#else
+  const size_t next = 0;
+#endif  // __NR_process_vm_readv
+
+  for (size_t i = next; i < count; ++i) {
+    ReadSlow(tid, static_cast<uint8_t*>(ranges[i].dest),
+             reinterpret_cast<uintptr_t>(ranges[i].src), ranges[i].length);
+  }
+  return true;
+}
+
+void RemoteMemoryReader::ReadSlow(pid_t tid, uint8_t* dest, uintptr_t src,
+                                  size_t length) {
+  // The caller has just failed to read |src| with process_vm_readv, so only
+  // retry it once past the next unreadable page.
+  bool try_vm_readv = false;
+  while (length) {
+    ssize_t r = -1;
+#if defined(__NR_process_vm_readv)
+    if (try_vm_readv && (methods_ & kProcessVmReadv) &&
+        !vm_readv_unavailable_) {
+      struct kernel_iovec local = { dest, length };
+      struct kernel_iovec remote = { reinterpret_cast<void*>(src), length };
+      ++stats_.syscalls;
+      ++stats_.vm_readv_calls;
+      r = sys_process_vm_readv(pid_, &local, 1, &remote, 1, 0);
+      if (r > 0)
+        vm_readv_worked_ = true;
+    }
+#endif  // __NR_process_vm_readv
+    if (r <= 0 && (methods_ & kProcMem) && OpenProcMem()) {
+      ++stats_.syscalls;
+      ++stats_.proc_mem_calls;
+      r = sys_pread64(proc_mem_fd_, dest, length, static_cast<loff_t>(src));
+      // /proc/<pid>/mem could read memory that process_vm_readv has never
+      // managed to, so the latter is unsupported by this kernel or
+      // disallowed by a seccomp policy or LSM. Neither will change for the
+      // rest of the dump.
+      if (r > 0 && !try_vm_readv && !vm_readv_worked_)
+        vm_readv_unavailable_ = true;
+    }
+    if (r > 0) {
+      dest += r;
+      src += r;
+      length -= r;
+      continue;
+    }
+
+    // The page at |src| cannot be read in bulk. Peek at it one word at a
+    // time so that any readable words are still recovered, then resume bulk
+    // reads from the next page.
+    size_t chunk = page_size_ - (src % page_size_);
+    if (chunk > length)
+      chunk = length;
+    PeekWords(tid, dest, src, chunk);
+    dest += chunk;
+    src += chunk;
+    length -= chunk;
+    try_vm_readv = true;
+  }
+}
+
+void RemoteMemoryReader::PeekWords(pid_t tid, uint8_t* dest, uintptr_t src,
+                                   size_t length) {
+  if (!(methods_ & kPtracePeek)) {
+    my_memset(dest, 0, length);
+    return;
+  }
+
+  unsigned long tmp = 55;
+  size_t done = 0;
+  static const size_t word_size = sizeof(tmp);
+  uint8_t* const remote = reinterpret_cast<uint8_t*>(src);
+
+  while (done < length) {
+    const size_t l = (length - done > word_size) ? word_size : (length - done);
+    ++stats_.syscalls;
+    ++stats_.peek_calls;
+    if (sys_ptrace(PTRACE_PEEKDATA, tid, remote + done, &tmp) == -1) {
+      tmp = 0;
+    }
+    my_memcpy(dest + done, &tmp, l);
+    done += l;
+  }
+}
+
+bool RemoteMemoryReader::OpenProcMem() {
+  if (proc_mem_fd_ >= 0)
+    return true;
+  if (proc_mem_fd_ == -2 || pid_ <= 0)
+    return false;
+
+  char path[NAME_MAX];
+  const unsigned pid_len = my_uint_len(pid_);
+  my_memcpy(path, "/proc/", 6);
+  my_uitos(path + 6, pid_, pid_len);
+  my_memcpy(path + 6 + pid_len, "/mem", 5);
+
+  proc_mem_fd_ = sys_open(path, O_RDONLY, 0);
+  if (proc_mem_fd_ < 0) {
+    proc_mem_fd_ = -2;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace google_breakpad
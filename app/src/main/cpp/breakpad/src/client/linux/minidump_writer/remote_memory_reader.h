@@ -0,0 +1,151 @@
+// Copyright 2024 Google LLC
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google LLC nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// remote_memory_reader.h: Define the google_breakpad::RemoteMemoryReader
+// class, which copies memory out of another (stopped) process.
+//
+// Three mechanisms are tried, fastest first:
+//   1. process_vm_readv(2), which copies any number of ranges in a single
+//      scatter/gather system call.
+//   2. pread(2) on /proc/<pid>/mem, one system call per contiguous range.
+//      Unlike process_vm_readv, this can read pages the target mapped
+//      without PROT_READ.
+//   3. PTRACE_PEEKDATA, one system call per machine word.
+// A range that a faster mechanism cannot fully read has its remainder
+// retried with the next one, and words that cannot be read at all are
+// zero-filled, matching the historical PTRACE_PEEKDATA behaviour.
+//
+// This code runs in the compromised context of the crash handler, so it
+// follows the rules in minidump_writer.h: no libc calls that may allocate,
+// and all memory comes from a PageAllocator.
+
+#ifndef CLIENT_LINUX_MINIDUMP_WRITER_REMOTE_MEMORY_READER_H_
+#define CLIENT_LINUX_MINIDUMP_WRITER_REMOTE_MEMORY_READER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "common/memory_allocator.h"
+#include "third_party/lss/linux_syscall_support.h"
+
+namespace google_breakpad {
+
+// A request to copy |length| bytes starting at |src| in the remote process
+// into the local buffer |dest|.
+struct RemoteMemoryRange {
+  void* dest;
+  const void* src;
+  size_t length;
+};
+
+// Counters describing the cost of the remote reads made for one dump.
+struct RemoteMemoryReadStats {
+  uint64_t bytes;           // Bytes requested by callers.
+  uint64_t syscalls;        // Total system calls issued to read memory.
+  uint64_t vm_readv_calls;  // process_vm_readv calls.
+  uint64_t proc_mem_calls;  // pread calls on /proc/<pid>/mem.
+  uint64_t peek_calls;      // PTRACE_PEEKDATA calls.
+};
+
+class RemoteMemoryReader {
+ public:
+  // Bit flags naming the mechanisms the reader may use.
+  enum Method {
+    kProcessVmReadv = 1 << 0,
+    kProcMem = 1 << 1,
+    kPtracePeek = 1 << 2,
+    kAllMethods = kProcessVmReadv | kProcMem | kPtracePeek
+  };
+
+  // Constructs a reader for the process |pid|. Scratch space for the
+  // scatter/gather vectors is carved from |allocator|.
+  RemoteMemoryReader(pid_t pid, PageAllocator* allocator);
+  ~RemoteMemoryReader();
+
+  // Restricts the reader to the mechanisms in |methods|, a mask of Method
+  // values. PTRACE_PEEKDATA is always used as the last resort when it is in
+  // the mask; if it is not, unreadable bytes are zero-filled directly.
+  void set_methods(int methods) { methods_ = methods; }
+  int methods() const { return methods_; }
+
+  // Makes the reader read from the process |pid| instead, such as a
+  // snapshot of the original one.
+  void set_pid(pid_t pid);
+
+  // Copies a single range. |tid| must be a thread of the target process
+  // that the caller has ptrace-attached to; it is only used for
+  // PTRACE_PEEKDATA. Always returns true, unreadable bytes are zeroed.
+  bool Read(pid_t tid, void* dest, const void* src, size_t length);
+
+  // Copies |count| ranges, batching as many of them as possible into each
+  // process_vm_readv call. Always returns true, unreadable bytes are zeroed.
+  bool ReadRanges(pid_t tid, const RemoteMemoryRange* ranges, size_t count);
+
+  const RemoteMemoryReadStats& stats() const { return stats_; }
+  void ResetStats();
+
+ private:
+  // Copies [src, src + length) after process_vm_readv failed to read |src|,
+  // one page at a time with PTRACE_PEEKDATA where bulk reads fail.
+  void ReadSlow(pid_t tid, uint8_t* dest, uintptr_t src, size_t length);
+
+  // Copies [src, src + length) one word at a time using PTRACE_PEEKDATA,
+  // or zero-fills it if that mechanism is disabled.
+  void PeekWords(pid_t tid, uint8_t* dest, uintptr_t src, size_t length);
+
+  // Lazily opens /proc/<pid>/mem. Returns false if it cannot be used.
+  bool OpenProcMem();
+
+  pid_t pid_;
+  PageAllocator* allocator_;
+  const size_t page_size_;
+  int methods_;
+
+  // File descriptor of /proc/<pid>/mem, -1 if not yet opened, or -2 if
+  // opening failed.
+  int proc_mem_fd_;
+
+  // Set once process_vm_readv has read anything from this process.
+  bool vm_readv_worked_;
+
+  // Set once /proc/<pid>/mem has read memory that process_vm_readv could not
+  // before it ever worked, which will not change for this process.
+  bool vm_readv_unavailable_;
+
+  // Scratch iovec arrays for process_vm_readv, |iov_capacity_| entries each.
+  struct kernel_iovec* local_iov_;
+  struct kernel_iovec* remote_iov_;
+  size_t iov_capacity_;
+
+  RemoteMemoryReadStats stats_;
+};
+
+}  // namespace google_breakpad
+
+#endif  // CLIENT_LINUX_MINIDUMP_WRITER_REMOTE_MEMORY_READER_H_
@@ -34,6 +34,7 @@
 #include <config.h>  // Must come first
 #endif
 
+#include <errno.h>
 #include <fcntl.h>
 #include <limits.h>
 #include <stdio.h>
@@ -44,12 +45,27 @@
 #include "common/linux/linux_libc_support.h"
 #include "common/string_conversion.h"
 #if defined(__linux__) && __linux__
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
 #include "third_party/lss/linux_syscall_support.h"
 #endif
 
-#if defined(__ANDROID__)
-#include <errno.h>
+namespace {
 
+// Size of the buffer Copy() stages data in. Writing a thread's context and
+// the small streams around it takes a few kilobytes, while stacks and memory
+// regions larger than this go out together with the staged bytes in front
+// of them.
+const size_t kStagingSize = 64 * 1024;
+
+// Records of less data than this are stored in a compressed minidump
+// without trying to compress them.
+const size_t kMinCompressedRecord = 64;
+
+}  // namespace
+
+#if defined(__ANDROID__)
 namespace {
 
 bool g_need_ftruncate_workaround = false;
@@ -96,12 +112,51 @@ MinidumpFileWriter::MinidumpFileWriter()
     : file_(-1),
       close_file_when_destroyed_(true),
       position_(0),
-      size_(0) {
+      size_(0),
+      staging_(NULL),
+      staging_start_(0),
+      staged_begin_(0),
+      staged_end_(0),
+      writev_unavailable_(false),
+      compress_(false),
+      compressing_(false),
+      compress_buffer_(NULL),
+      compress_table_(NULL),
+      container_size_(0),
+      stats_() {
 }
 
 MinidumpFileWriter::~MinidumpFileWriter() {
-  if (close_file_when_destroyed_)
+  if (close_file_when_destroyed_) {
     Close();
+  } else if (file_ != -1) {
+    Flush();
+    // The caller keeps the descriptor, so the minidump is not trimmed to
+    // |position_| as Close() does; extend it over all the allocated space
+    // instead.
+    if (compressing_)
+      AppendFinalRecord(size_);
+    const off_t file_size = compressing_ ? container_size_ : size_;
+    // pwrite() leaves the file offset alone; move it past the minidump, as
+    // writing it out sequentially would have.
+    ++stats_.syscalls;
+#if defined(__linux__) && __linux__
+    sys_lseek(file_, file_size, SEEK_SET);
+#else
+    lseek(file_, file_size, SEEK_SET);
+#endif
+#if defined(__ANDROID__)
+    if (NeedsFTruncateWorkAround())
+      return;
+#endif
+    if (file_size) {
+      ++stats_.syscalls;
+      ++stats_.truncate_calls;
+      if (ftruncate(file_, file_size)) {
+        // There is no caller left to report the failure to.
+      }
+    }
+  }
 }
 
 bool MinidumpFileWriter::Open(const char* path) {
@@ -111,14 +166,18 @@ bool MinidumpFileWriter::Open(const char* path) {
 #else
   file_ = open(path, O_WRONLY | O_CREAT | O_EXCL, 0600);
 #endif
+  if (file_ == -1)
+    return false;
 
-  return file_ != -1;
+  StartStaging();
+  return true;
 }
 
 void MinidumpFileWriter::SetFile(const int file) {
   assert(file_ == -1);
   file_ = file;
   close_file_when_destroyed_ = false;
+  StartStaging();
 #if defined(__ANDROID__)
   CheckNeedsFTruncateWorkAround(file);
 #endif
@@ -128,15 +187,26 @@ bool MinidumpFileWriter::Close() {
   bool result = true;
 
   if (file_ != -1) {
+    if (!Flush())
+      return false;
+    if (compressing_ && !AppendFinalRecord(position_))
+      return false;
+    const off_t file_size = compressing_ ? container_size_ : position_;
 #if defined(__ANDROID__)
-    if (!NeedsFTruncateWorkAround() && ftruncate(file_, position_)) {
-       return false;
+    if (!NeedsFTruncateWorkAround()) {
+      ++stats_.syscalls;
+      ++stats_.truncate_calls;
+      if (ftruncate(file_, file_size))
+        return false;
     }
 #else
-    if (ftruncate(file_, position_)) {
+    ++stats_.syscalls;
+    ++stats_.truncate_calls;
+    if (ftruncate(file_, file_size)) {
        return false;
     }
 #endif
+    ++stats_.syscalls;
 #if defined(__linux__) && __linux__
     result = (sys_close(file_) == 0);
 #else
@@ -148,6 +218,23 @@ bool MinidumpFileWriter::Close() {
   return result;
 }
 
+bool MinidumpFileWriter::Flush() {
+  if (staged_begin_ == staged_end_)
+    return true;
+
+  const size_t length = staged_end_ - staged_begin_;
+  bool result = WriteAt(static_cast<MDRVA>(staging_start_ + staged_begin_),
+                        staging_ + staged_begin_, length);
+
+  // The window has to move past what was just written, as the bytes it
+  // holds beyond the staged range are only known to match the file while
+  // the file has not been written there.
+  memset(staging_ + staged_begin_, 0, length);
+  staging_start_ += static_cast<MDRVA>(staged_end_);
+  staged_begin_ = staged_end_ = 0;
+  return result;
+}
+
 bool MinidumpFileWriter::CopyStringToMDString(const wchar_t* str,
                                               unsigned int length,
                                               TypedMDRVA<MDString>* mdstring) {
@@ -297,11 +384,9 @@ MDRVA MinidumpFileWriter::Allocate(size_t size) {
     if (growth < minimal_growth)
       growth = minimal_growth;
 
-    size_t new_size = size_ + growth;
-    if (ftruncate(file_, new_size) != 0)
-      return kInvalidMDRVA;
-
-    size_ = new_size;
+    // The file itself is only sized when the writer is closed or
+    // destroyed, rather than with an ftruncate per allocation.
+    size_ += growth;
   }
 
   MDRVA current_position = position_;
@@ -319,21 +404,190 @@ bool MinidumpFileWriter::Copy(MDRVA position, const void* src, ssize_t size) {
   if (static_cast<size_t>(size + position) > size_)
     return false;
 
-  // Seek and write the data
-#if defined(__linux__) && __linux__
-  if (sys_lseek(file_, position, SEEK_SET) == static_cast<off_t>(position)) {
-    if (sys_write(file_, src, size) == size) {
-      return true;
+  stats_.bytes += size;
+  if (!staging_)
+    return WriteAt(position, src, size);
+
+  const size_t end = position + size;
+  if (end <= staging_start_) {
+    // Patching data that has already been written out, such as a directory
+    // entry filled in after its stream.
+    return WriteAt(position, src, size);
+  }
+
+  if (end <= staging_start_ + kStagingSize) {
+    const uint8_t* data = static_cast<const uint8_t*>(src);
+    size_t start = position;
+    if (start < staging_start_) {
+      // The head of the object went out with an earlier window.
+      const size_t head = staging_start_ - start;
+      if (!WriteAt(position, data, head))
+        return false;
+      data += head;
+      start = staging_start_;
     }
+    Stage(start - staging_start_, data, end - start);
+    return true;
   }
+
+  // The data runs past the window. Write it out together with the staged
+  // bytes if it follows on from them, and start a new window after it.
+  bool result;
+  if (staged_begin_ != staged_end_ &&
+      staging_start_ + staged_end_ == position) {
+    result = WriteStagedAndData(src, size);
+  } else {
+    result = Flush() && WriteAt(position, src, size);
+  }
+  staging_start_ = static_cast<MDRVA>(end);
+  return result;
+}
+
+void MinidumpFileWriter::StartStaging() {
+  if (!staging_) {
+    staging_ = reinterpret_cast<uint8_t*>(allocator_.Alloc(kStagingSize));
+  } else {
+    memset(staging_, 0, kStagingSize);
+  }
+  staging_start_ = 0;
+  staged_begin_ = staged_end_ = 0;
+  memset(&stats_, 0, sizeof(stats_));
+
+  compressing_ = false;
+  if (!compress_)
+    return;
+  if (!compress_buffer_) {
+    compress_buffer_ = reinterpret_cast<uint8_t*>(allocator_.Alloc(
+        sizeof(CompressedMinidumpRecord) +
+        CompressBlockBound(kCompressedMinidumpMaxBlock)));
+    compress_table_ = reinterpret_cast<uint16_t*>(
+        allocator_.Alloc(kCompressBlockTableSize * sizeof(uint16_t)));
+  }
+  if (compress_buffer_ && compress_table_) {
+    const CompressedMinidumpHeader header = { kCompressedMinidumpSignature,
+                                              kCompressedMinidumpVersion };
+    compressing_ = WriteFileAt(0, &header, sizeof(header));
+    container_size_ = sizeof(header);
+  }
+}
+
+void MinidumpFileWriter::Stage(size_t offset, const void* src, size_t size) {
+  memcpy(staging_ + offset, src, size);
+  if (staged_begin_ == staged_end_) {
+    staged_begin_ = offset;
+    staged_end_ = offset + size;
+    return;
+  }
+  if (offset < staged_begin_)
+    staged_begin_ = offset;
+  if (offset + size > staged_end_)
+    staged_end_ = offset + size;
+}
+
+bool MinidumpFileWriter::WriteAt(MDRVA position, const void* src,
+                                 size_t size) {
+  if (compressing_)
+    return AppendRecords(position, src, size);
+  return WriteFileAt(position, src, size);
+}
+
+bool MinidumpFileWriter::WriteFileAt(off_t offset, const void* src,
+                                     size_t size) {
+  ++stats_.syscalls;
+  ++stats_.write_calls;
+  stats_.file_bytes += size;
+#if defined(__linux__) && __linux__
+  return sys_pwrite64(file_, src, size, offset) ==
+      static_cast<ssize_t>(size);
 #else
-  if (lseek(file_, position, SEEK_SET) == static_cast<off_t>(position)) {
-    if (write(file_, src, size) == size) {
-      return true;
+  return pwrite(file_, src, size, offset) == static_cast<ssize_t>(size);
+#endif
+}
+
+bool MinidumpFileWriter::AppendRecords(MDRVA position, const void* src,
+                                       size_t size) {
+  const uint8_t* data = static_cast<const uint8_t*>(src);
+  uint8_t* const payload = compress_buffer_ + sizeof(CompressedMinidumpRecord);
+  while (size) {
+    CompressedMinidumpRecord record;
+    record.rva = position;
+    record.data_size = static_cast<uint32_t>(
+        size < kCompressedMinidumpMaxBlock ? size
+                                           : kCompressedMinidumpMaxBlock);
+    record.payload_size = record.data_size;
+    record.encoding = kCompressedMinidumpStored;
+    // Patches of a few bytes, like directory entries, are not worth
+    // compressing.
+    if (record.data_size >= kMinCompressedRecord) {
+      const size_t compressed =
+          CompressBlock(data, record.data_size, payload, compress_table_);
+      if (compressed < record.data_size) {
+        record.payload_size = static_cast<uint32_t>(compressed);
+        record.encoding = kCompressedMinidumpLZ4;
+      }
+    }
+    if (record.encoding == kCompressedMinidumpStored)
+      memcpy(payload, data, record.data_size);
+    memcpy(compress_buffer_, &record, sizeof(record));
+
+    const size_t length = sizeof(record) + record.payload_size;
+    if (!WriteFileAt(container_size_, compress_buffer_, length))
+      return false;
+    container_size_ += length;
+    position += record.data_size;
+    data += record.data_size;
+    size -= record.data_size;
+  }
+  return true;
+}
+
+bool MinidumpFileWriter::AppendFinalRecord(size_t size) {
+  const CompressedMinidumpRecord record = {
+    static_cast<uint32_t>(size), 0, 0, kCompressedMinidumpStored
+  };
+  if (!WriteFileAt(container_size_, &record, sizeof(record)))
+    return false;
+  container_size_ += sizeof(record);
+  return true;
+}
+
+bool MinidumpFileWriter::WriteStagedAndData(const void* src, size_t size) {
+  const MDRVA position = static_cast<MDRVA>(staging_start_ + staged_begin_);
+  const size_t length = staged_end_ - staged_begin_;
+  bool result = false;
+#if defined(__linux__) && __linux__
+  if (!writev_unavailable_ && !compressing_) {
+    struct iovec iov[2];
+    iov[0].iov_base = staging_ + staged_begin_;
+    iov[0].iov_len = length;
+    iov[1].iov_base = const_cast<void*>(src);
+    iov[1].iov_len = size;
+
+    // LSS has no pwritev. The offset is passed as two longs, and as an MDRVA
+    // is 32 bits wide, the high one is always zero.
+    ++stats_.syscalls;
+    ++stats_.writev_calls;
+    const long written = syscall(__NR_pwritev, file_, iov, 2,
+                                 static_cast<unsigned long>(position), 0UL);
+    if (written >= 0) {
+      stats_.file_bytes += written;
+      result = written == static_cast<long>(length + size);
+    } else if (errno == ENOSYS || errno == EPERM) {
+      // Not supported by this kernel, or disallowed by a seccomp policy.
+      writev_unavailable_ = true;
     }
   }
+  if (writev_unavailable_ || compressing_) {
 #endif
-  return false;
+    result = WriteAt(position, staging_ + staged_begin_, length) &&
+             WriteAt(static_cast<MDRVA>(position + length), src, size);
+#if defined(__linux__) && __linux__
+  }
+#endif
+
+  memset(staging_ + staged_begin_, 0, length);
+  staged_begin_ = staged_end_ = 0;
+  return result;
 }
 
 bool UntypedMDRVA::Allocate(size_t size) {
@@ -33,8 +33,12 @@
 #ifndef CLIENT_MINIDUMP_FILE_WRITER_H__
 #define CLIENT_MINIDUMP_FILE_WRITER_H__
 
+#include <stdint.h>
+
 #include <string>
 
+#include "common/memory_allocator.h"
+#include "common/minidump_compression.h"
 #include "google_breakpad/common/minidump_format.h"
 
 namespace google_breakpad {
@@ -42,6 +46,16 @@ namespace google_breakpad {
 class UntypedMDRVA;
 template<typename MDType> class TypedMDRVA;
 
+// Counters describing the file system calls made while writing a minidump.
+struct MinidumpFileWriterStats {
+  uint64_t bytes;           // Bytes passed to Copy().
+  uint64_t file_bytes;      // Bytes written to the file.
+  uint64_t syscalls;        // Total system calls issued on the file.
+  uint64_t write_calls;     // pwrite calls.
+  uint64_t writev_calls;    // pwritev calls.
+  uint64_t truncate_calls;  // ftruncate calls.
+};
+
 // The user of this class can Open() a file and add minidump streams, data, and
 // strings using the definitions in minidump_format.h.  Since this class is
 // expected to be used in a situation where the current process may be
@@ -63,6 +77,19 @@ template<typename MDType> class TypedMDRVA;
 // header->get()->signature = MD_HEADER_SIGNATURE;
 //  :
 // writer.Close();
+//
+// Copies are staged in a buffer taken from a PageAllocator and written out
+// in as few system calls as possible: contiguous data is coalesced, and data
+// too large for the buffer is written together with the staged bytes that
+// precede it using a single pwritev. Data landing before the staged window,
+// such as a directory filled in after its streams, is written straight to
+// the file. The file is laid out exactly as if every Copy() had been written
+// immediately, but its contents are only complete after Flush(), Close() or
+// the destruction of the writer.
+//
+// With set_compress(true), the file is instead the compressed minidump
+// container described in common/minidump_compression.h: every write that
+// would have gone to the file is compressed and appended to it as a record.
 
 class MinidumpFileWriter {
 public:
@@ -82,7 +109,7 @@ public:
   // Can be used as an alternative to Open() when a file descriptor is
   // available.
   // Note that |fd| is not closed when the instance of MinidumpFileWriter is
-  // destroyed.
+  // destroyed; it is left positioned at the end of the minidump.
   void SetFile(const int file);
 
   // Close the current file (that was either created when Open was called, or
@@ -90,6 +117,20 @@ public:
   // Return true on success, or false on failure.
   bool Close();
 
+  // Write the minidump as a compressed container rather than as a plain
+  // minidump file. Must be called before Open() or SetFile(). If the
+  // buffers compression needs can't be allocated, the minidump is written
+  // uncompressed; is_compressed() tells which happened.
+  void set_compress(bool compress) { compress_ = compress; }
+
+  // Return true if the file is being written as a compressed container.
+  bool is_compressed() const { return compressing_; }
+
+  // Write out the data staged by Copy(). Close() does this, and so does the
+  // destructor when the file was specified with SetFile().
+  // Return true on success, or false on failure.
+  bool Flush();
+
   // Copy the contents of |str| to a MDString and write it to the file.
   // |str| is expected to be either UTF-16 or UTF-32 depending on the size
   // of wchar_t.
@@ -115,6 +156,9 @@ public:
   // Return the current position for writing to the minidump
   inline MDRVA position() const { return position_; }
 
+  // Counters for the system calls made on the file since it was opened.
+  const MinidumpFileWriterStats& stats() const { return stats_; }
+
  private:
   friend class UntypedMDRVA;
 
@@ -123,6 +167,31 @@ public:
   // unable to allocate the bytes.
   MDRVA Allocate(size_t size);
 
+  // Prepares the staging buffer for a newly opened file.
+  void StartStaging();
+
+  // Copies |size| bytes from |src| into the staging buffer at |offset| bytes
+  // from the start of the staged window.
+  void Stage(size_t offset, const void* src, size_t size);
+
+  // Writes |size| bytes from |src| to |position| in the minidump.
+  bool WriteAt(MDRVA position, const void* src, size_t size);
+
+  // Writes |size| bytes from |src| to |offset| in the file itself.
+  bool WriteFileAt(off_t offset, const void* src, size_t size);
+
+  // Appends records carrying |size| bytes from |src| for |position| in the
+  // minidump to the compressed container.
+  bool AppendRecords(MDRVA position, const void* src, size_t size);
+
+  // Appends the final record of the compressed container, giving |size| as
+  // the size of the minidump.
+  bool AppendFinalRecord(size_t size);
+
+  // Writes the staged bytes followed by |size| bytes from |src|, which must
+  // start where the staged bytes end, to the file.
+  bool WriteStagedAndData(const void* src, size_t size);
+
   // The file descriptor for the output file.
   int file_;
 
@@ -135,6 +204,43 @@ public:
   // Current allocated size
   size_t size_;
 
+  // Provides the staging buffer without touching the heap.
+  PageAllocator allocator_;
+
+  // Buffer of kStagingSize bytes mirroring the file from |staging_start_|,
+  // or NULL if it could not be allocated, in which case every Copy() is
+  // written straight to the file. Nothing at or beyond |staging_start_| has
+  // been written to the file, and the buffer is zero outside the staged
+  // range.
+  uint8_t* staging_;
+
+  // File position of the first byte of |staging_|.
+  MDRVA staging_start_;
+
+  // Range of |staging_| holding data not yet written, relative to
+  // |staging_start_|. Empty when both are equal.
+  size_t staged_begin_;
+  size_t staged_end_;
+
+  // Whether pwritev is known not to work, so that staged bytes and the data
+  // following them must be written separately.
+  bool writev_unavailable_;
+
+  // Whether set_compress(true) was called, and whether the file is being
+  // written compressed.
+  bool compress_;
+  bool compressing_;
+
+  // Scratch space for compressing a record: a CompressedMinidumpRecord
+  // followed by room for its payload, and the table CompressBlock() needs.
+  uint8_t* compress_buffer_;
+  uint16_t* compress_table_;
+
+  // Size of the compressed container written so far.
+  off_t container_size_;
+
+  MinidumpFileWriterStats stats_;
+
   // Copy |length| characters from |str| to |mdstring|.  These are distinct
   // because the underlying MDString is a UTF-16 based string.  The wchar_t
   // variant may need to create a MDString that has more characters than the
@@ -0,0 +1,344 @@
+// Copyright 2024 Google LLC
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google LLC nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// minidump_file_writer_benchmark.cc: Measures the cost of writing a
+// minidump through MinidumpFileWriter.
+//
+// Each run writes a synthetic minidump laid out the way the Linux
+// minidump writer lays out a crash: a header and stream directory, a
+// thread list whose stacks and contexts are written thread by thread with
+// each thread's entry patched in afterwards, a module list with a name and
+// a CodeView record per module, a memory list and a few /proc files.  The
+// time per dump is reported along with the system calls the writer made on
+// the file and the bytes written to it, taken from MinidumpFileWriter::stats().
+// With -c the dumps are written compressed.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>  // Must come first
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "client/minidump_file_writer-inl.h"
+#include "common/path_helper.h"
+#include "google_breakpad/common/minidump_format.h"
+
+namespace {
+
+using google_breakpad::MinidumpFileWriter;
+using google_breakpad::MinidumpFileWriterStats;
+using google_breakpad::TypedMDRVA;
+using google_breakpad::UntypedMDRVA;
+using std::string;
+using std::vector;
+
+struct Options {
+  int repeat_count;
+  int thread_count;
+  int module_count;
+  size_t stack_size;
+  bool compress;
+  string directory;
+};
+
+// Contents of one of the /proc files copied into Linux minidumps.
+const size_t kProcFileSize = 4096;
+
+// Number of /proc files written per dump.
+const int kProcFileCount = 5;
+
+// Writes one synthetic minidump to |path|, taking stack and file contents
+// from |data|. Returns false if the writer reported a failure.
+bool WriteDump(const Options& options, const char* path,
+               const vector<uint8_t>& data, MinidumpFileWriterStats* stats) {
+  MinidumpFileWriter writer;
+  writer.set_compress(options.compress);
+  if (!writer.Open(path))
+    return false;
+
+  const int stream_count = 3 + kProcFileCount;
+  TypedMDRVA<MDRawDirectory> dir(&writer);
+  {
+    TypedMDRVA<MDRawHeader> header(&writer);
+    if (!header.Allocate() || !dir.AllocateArray(stream_count))
+      return false;
+    header.get()->signature = MD_HEADER_SIGNATURE;
+    header.get()->version = MD_HEADER_VERSION;
+    header.get()->stream_count = stream_count;
+    header.get()->stream_directory_rva = dir.position();
+  }
+  if (!writer.Flush())
+    return false;
+
+  int dir_index = 0;
+  MDRawDirectory dirent;
+  vector<MDMemoryDescriptor> stacks;
+
+  // The thread list, each thread's entry patched in once its stack and
+  // context have been written.
+  {
+    TypedMDRVA<uint32_t> list(&writer);
+    if (!list.AllocateObjectAndArray(options.thread_count,
+                                     sizeof(MDRawThread)))
+      return false;
+    *list.get() = options.thread_count;
+    for (int i = 0; i < options.thread_count; ++i) {
+      MDRawThread thread;
+      memset(&thread, 0, sizeof(thread));
+      thread.thread_id = 1000 + i;
+      if (!writer.WriteMemory(&data[i % 64], options.stack_size,
+                              &thread.stack))
+        return false;
+      stacks.push_back(thread.stack);
+
+      TypedMDRVA<MDRawContextAMD64> context(&writer);
+      if (!context.Allocate())
+        return false;
+      memset(context.get(), 0, sizeof(MDRawContextAMD64));
+      context.get()->context_flags = MD_CONTEXT_AMD64_FULL;
+      context.get()->rsp = thread.stack.start_of_memory_range;
+      thread.thread_context = context.location();
+      if (!list.CopyIndexAfterObject(i, &thread, sizeof(thread)))
+        return false;
+    }
+    dirent.stream_type = MD_THREAD_LIST_STREAM;
+    dirent.location = list.location();
+    dir.CopyIndex(dir_index++, &dirent);
+  }
+
+  // The module list, with a name and CodeView record per module.
+  {
+    TypedMDRVA<uint32_t> list(&writer);
+    if (!list.AllocateObjectAndArray(options.module_count, MD_MODULE_SIZE))
+      return false;
+    *list.get() = options.module_count;
+    for (int i = 0; i < options.module_count; ++i) {
+      MDRawModule module;
+      memset(&module, 0, sizeof(module));
+      module.base_of_image = 0x7f0000000000ULL + i * 0x100000ULL;
+      module.size_of_image = 0x80000;
+
+      char name[64];
+      snprintf(name, sizeof(name), "/system/lib64/libsynthetic%d.so", i);
+      MDLocationDescriptor name_location;
+      if (!writer.WriteString(name, 0, &name_location))
+        return false;
+      module.module_name_rva = name_location.rva;
+
+      UntypedMDRVA cv(&writer);
+      const size_t cv_size = sizeof(MDCVInfoELF) + 20;
+      if (!cv.Allocate(cv_size) || !cv.Copy(&data[i % 64], cv_size))
+        return false;
+      module.cv_record = cv.location();
+      if (!list.CopyIndexAfterObject(i, &module, MD_MODULE_SIZE))
+        return false;
+    }
+    dirent.stream_type = MD_MODULE_LIST_STREAM;
+    dirent.location = list.location();
+    dir.CopyIndex(dir_index++, &dirent);
+  }
+
+  // The memory list, repeating the stacks.
+  {
+    TypedMDRVA<uint32_t> list(&writer);
+    if (!list.AllocateObjectAndArray(stacks.size(),
+                                     sizeof(MDMemoryDescriptor)))
+      return false;
+    *list.get() = static_cast<uint32_t>(stacks.size());
+    for (size_t i = 0; i < stacks.size(); ++i) {
+      if (!list.CopyIndexAfterObject(i, &stacks[i],
+                                     sizeof(MDMemoryDescriptor)))
+        return false;
+    }
+    dirent.stream_type = MD_MEMORY_LIST_STREAM;
+    dirent.location = list.location();
+    dir.CopyIndex(dir_index++, &dirent);
+  }
+
+  for (int i = 0; i < kProcFileCount; ++i) {
+    UntypedMDRVA file(&writer);
+    if (!file.Allocate(kProcFileSize) || !file.Copy(&data[i], kProcFileSize))
+      return false;
+    dirent.stream_type = MD_LINUX_CPU_INFO + i;
+    dirent.location = file.location();
+    dir.CopyIndex(dir_index++, &dirent);
+  }
+
+  if (!writer.Close())
+    return false;
+  *stats = writer.stats();
+  return true;
+}
+
+void Usage(int argc, const char* argv[], bool error) {
+  fprintf(error ? stderr : stdout,
+          "Usage: %s [options]\n"
+          "\n"
+          "Writes synthetic minidumps with MinidumpFileWriter and reports\n"
+          "the time and the system calls on the file per dump.\n"
+          "\n"
+          "Options:\n"
+          "\n"
+          "  -r <n>      Dumps to write (default: 20)\n"
+          "  -t <n>      Threads per dump (default: 50)\n"
+          "  -m <n>      Modules per dump (default: 200)\n"
+          "  -s <n>      Bytes of stack per thread (default: 16384)\n"
+          "  -c          Write compressed minidumps\n"
+          "  -d <dir>    Directory to write the dumps to (default: /tmp)\n",
+          google_breakpad::BaseName(argv[0]).c_str());
+}
+
+// Parses the argument of option |option| as a count of at least 1.
+int ParseCount(const char* argv0, char option, const char* value) {
+  int count = atoi(value);
+  if (count < 1) {
+    fprintf(stderr, "%s: Invalid count for -%c: %s\n", argv0, option, value);
+    exit(1);
+  }
+  return count;
+}
+
+void SetupOptions(int argc, const char* argv[], Options* options) {
+  int ch;
+
+  options->repeat_count = 20;
+  options->thread_count = 50;
+  options->module_count = 200;
+  options->stack_size = 16384;
+  options->compress = false;
+  options->directory = "/tmp";
+
+  while ((ch = getopt(argc, (char * const*)argv, "cd:hm:r:s:t:")) != -1) {
+    switch (ch) {
+      case 'h':
+        Usage(argc, argv, false);
+        exit(0);
+        break;
+
+      case 'c':
+        options->compress = true;
+        break;
+
+      case 'd':
+        options->directory = optarg;
+        break;
+
+      case 'm':
+        options->module_count = ParseCount(argv[0], ch, optarg);
+        break;
+
+      case 'r':
+        options->repeat_count = ParseCount(argv[0], ch, optarg);
+        break;
+
+      case 's':
+        options->stack_size = ParseCount(argv[0], ch, optarg);
+        break;
+
+      case 't':
+        options->thread_count = ParseCount(argv[0], ch, optarg);
+        break;
+
+      case '?':
+        Usage(argc, argv, true);
+        exit(1);
+        break;
+    }
+  }
+
+  if (optind != argc) {
+    Usage(argc, argv, true);
+    exit(1);
+  }
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+  Options options;
+  SetupOptions(argc, argv, &options);
+
+  // Words like those found on a stack: zeros, small integers, pointers into
+  // a few mappings and the odd random value, so that compressing the dump
+  // does about as well as it would on a real one.
+  std::mt19937_64 engine(1);
+  vector<uint8_t> data(options.stack_size + kProcFileSize + 64);
+  for (size_t i = 0; i + sizeof(uint64_t) <= data.size();
+       i += sizeof(uint64_t)) {
+    uint64_t word = engine();
+    switch (word % 4) {
+      case 0: word = 0; break;
+      case 1: word = (word >> 32) % 4096; break;
+      case 2: word = 0x7f0000000000ULL + ((word >> 32) % 16) * 0x100000ULL +
+                     ((word >> 8) & 0xffff8); break;
+    }
+    memcpy(&data[i], &word, sizeof(word));
+  }
+
+  const string path = options.directory + "/minidump_file_writer_benchmark." +
+      std::to_string(getpid()) + ".dmp";
+  vector<double> times;
+  MinidumpFileWriterStats stats = MinidumpFileWriterStats();
+  for (int run = 0; run < options.repeat_count; ++run) {
+    unlink(path.c_str());
+    const auto start = std::chrono::steady_clock::now();
+    const bool written = WriteDump(options, path.c_str(), data, &stats);
+    const auto end = std::chrono::steady_clock::now();
+    if (!written) {
+      fprintf(stderr, "%s: Failed to write %s\n", argv[0], path.c_str());
+      unlink(path.c_str());
+      return 1;
+    }
+    times.push_back(
+        std::chrono::duration<double, std::micro>(end - start).count());
+  }
+  unlink(path.c_str());
+
+  std::sort(times.begin(), times.end());
+  printf("%10s %10s %12s %12s %10s %10s %10s %10s\n",
+         "bytes", "file bytes", "best (us)", "median (us)", "syscalls",
+         "pwrite", "pwritev", "ftruncate");
+  printf("%10llu %10llu %12.1f %12.1f %10llu %10llu %10llu %10llu\n",
+         static_cast<unsigned long long>(stats.bytes),
+         static_cast<unsigned long long>(stats.file_bytes), times.front(),
+         times[times.size() / 2],
+         static_cast<unsigned long long>(stats.syscalls),
+         static_cast<unsigned long long>(stats.write_calls),
+         static_cast<unsigned long long>(stats.writev_calls),
+         static_cast<unsigned long long>(stats.truncate_calls));
+  return 0;
+}
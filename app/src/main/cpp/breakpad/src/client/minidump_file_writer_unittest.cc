@@ -41,9 +41,14 @@
 #endif
 
 #include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
+#include <vector>
+
 #include "minidump_file_writer-inl.h"
+#include "common/minidump_compression.h"
 
 using google_breakpad::MinidumpFileWriter;
 
@@ -170,11 +175,138 @@ static bool CompareFile(const char* path) {
   return true;
 }
 
+// Copies |size| bytes of |pattern| to |position| through |writer|, and to
+// the same offset of |expected|.
+static bool CopyBoth(MinidumpFileWriter* writer, char* expected,
+                     MDRVA position, const char* pattern, size_t size) {
+  memcpy(expected + position, pattern, size);
+  return writer->Copy(position, pattern, size);
+}
+
+// Writes objects small enough to be staged, ones too large for the staging
+// buffer, both right after the staged data and elsewhere, and patches data
+// that has already gone out to the file, then checks the file holds exactly
+// what was copied where.  If |use_fd| the file is given with SetFile() and
+// left to the writer's destructor rather than closed.
+static bool WriteStaged(const char* path, bool use_fd, bool compress) {
+  const size_t kMaxSize = 1024 * 1024;
+  char* pattern = reinterpret_cast<char*>(malloc(kMaxSize));
+  char* expected = reinterpret_cast<char*>(calloc(kMaxSize, 1));
+  char* actual = reinterpret_cast<char*>(malloc(kMaxSize));
+  ASSERT_TRUE(pattern && expected && actual);
+  for (size_t i = 0; i < kMaxSize; ++i)
+    pattern[i] = static_cast<char>(i * 7 + i / 251);
+
+  int fd = -1;
+  MDRVA end;
+  {
+    MinidumpFileWriter writer;
+    writer.set_compress(compress);
+    if (use_fd) {
+      fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+      ASSERT_NE(fd, -1);
+      writer.SetFile(fd);
+    } else {
+      ASSERT_TRUE(writer.Open(path));
+    }
+    ASSERT_EQ(writer.is_compressed(), compress);
+
+    // A header-like object patched last, and a run of small objects.
+    google_breakpad::UntypedMDRVA first(&writer);
+    ASSERT_TRUE(first.Allocate(24));
+    MDRVA small[200];
+    for (int i = 0; i < 200; ++i) {
+      google_breakpad::UntypedMDRVA object(&writer);
+      ASSERT_TRUE(object.Allocate(100 + i * 3));
+      small[i] = object.position();
+      ASSERT_TRUE(CopyBoth(&writer, expected, object.position(), pattern + i,
+                           object.size()));
+    }
+
+    // A large object following on from the staged data, then one whose
+    // start is left unwritten.
+    google_breakpad::UntypedMDRVA large(&writer);
+    ASSERT_TRUE(large.Allocate(200000));
+    ASSERT_TRUE(CopyBoth(&writer, expected, large.position(), pattern + 5,
+                         large.size()));
+    google_breakpad::UntypedMDRVA gap(&writer);
+    ASSERT_TRUE(gap.Allocate(150000));
+    ASSERT_TRUE(CopyBoth(&writer, expected, gap.position() + 16, pattern + 9,
+                         gap.size() - 16));
+
+    // An object straddling the start of the next staged window.
+    google_breakpad::UntypedMDRVA straddle(&writer);
+    ASSERT_TRUE(straddle.Allocate(1000));
+    ASSERT_TRUE(CopyBoth(&writer, expected, straddle.position() + 500,
+                         pattern + 3, 500));
+    for (int i = 0; i < 100; ++i) {
+      google_breakpad::UntypedMDRVA object(&writer);
+      ASSERT_TRUE(object.Allocate(1000));
+      ASSERT_TRUE(CopyBoth(&writer, expected, object.position(), pattern + i,
+                           object.size()));
+    }
+    ASSERT_TRUE(CopyBoth(&writer, expected, straddle.position(), pattern + 1,
+                         straddle.size()));
+
+    // Patches of data already written out.
+    for (int i = 0; i < 200; i += 7)
+      ASSERT_TRUE(CopyBoth(&writer, expected, small[i] + 8, pattern + 11, 40));
+    ASSERT_TRUE(CopyBoth(&writer, expected, first.position(), pattern + 2,
+                         first.size()));
+
+    // Data copied past the end of what was allocated must be refused.
+    ASSERT_TRUE(!writer.Copy(writer.position(), pattern, kMaxSize));
+
+    end = writer.position();
+    if (!use_fd) {
+      ASSERT_TRUE(writer.Close());
+      ASSERT_EQ(writer.stats().truncate_calls, 1U);
+    }
+    ASSERT_TRUE(writer.stats().syscalls < 1000);
+  }
+  if (fd != -1)
+    close(fd);
+
+  fd = open(path, O_RDONLY);
+  ASSERT_NE(fd, -1);
+  ssize_t length = read(fd, actual, kMaxSize);
+  close(fd);
+  if (compress) {
+    std::vector<uint8_t> minidump;
+    ASSERT_TRUE(length > 0);
+    ASSERT_TRUE(google_breakpad::DecompressMinidump(
+        reinterpret_cast<uint8_t*>(actual), length, kMaxSize, &minidump));
+    // The pattern is periodic enough to compress well.
+    ASSERT_TRUE(static_cast<size_t>(length) < minidump.size() / 2);
+    length = static_cast<ssize_t>(minidump.size());
+    memcpy(actual, &minidump[0], minidump.size());
+  }
+  ASSERT_TRUE(length >= static_cast<ssize_t>(end));
+  ASSERT_EQ(memcmp(actual, expected, end), 0);
+  // Close() trims the file to the allocated data; otherwise it is left
+  // padded to a whole number of pages.
+  if (!use_fd)
+    ASSERT_EQ(length, static_cast<ssize_t>(end));
+
+  free(pattern);
+  free(expected);
+  free(actual);
+  return true;
+}
+
 static bool RunTests() {
   const char* path = "/tmp/minidump_file_writer_unittest.dmp";
   ASSERT_TRUE(WriteFile(path));
   ASSERT_TRUE(CompareFile(path));
   unlink(path);
+  ASSERT_TRUE(WriteStaged(path, false, false));
+  unlink(path);
+  ASSERT_TRUE(WriteStaged(path, true, false));
+  unlink(path);
+  ASSERT_TRUE(WriteStaged(path, false, true));
+  unlink(path);
+  ASSERT_TRUE(WriteStaged(path, true, true));
+  unlink(path);
   return true;
 }
 
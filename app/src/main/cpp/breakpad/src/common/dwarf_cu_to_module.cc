@@ -115,6 +115,17 @@ struct DwarfCUToModule::FilePrivate {
   // Keep a list of forward references from DW_AT_abstract_origin and
   // DW_AT_specification attributes so names can be fixed up.
   std::map<uint64_t, Module::Function*> forward_ref_die_to_func;
+
+  // In a speculative context, the functions the unit defined, held back
+  // from the module until the unit is committed, and the forward
+  // references among them.
+  vector<Module::Function*> functions;
+  map<Module::Function*, uint64_t> spec_function_offsets;
+
+  ~FilePrivate() {
+    for (Module::Function* func : functions)
+      delete func;
+  }
 };
 
 DwarfCUToModule::FileContext::FileContext(const string& filename,
@@ -123,7 +134,11 @@ DwarfCUToModule::FileContext::FileContext(const string& filename,
     : filename_(filename),
       module_(module),
       handle_inter_cu_refs_(handle_inter_cu_refs),
-      file_private_(new FilePrivate()) {
+      file_private_(new FilePrivate()),
+      unit_start_(0),
+      unit_end_(UINT64_MAX),
+      speculative_(false),
+      speculation_failed_(false) {
 }
 
 DwarfCUToModule::FileContext::~FileContext() {
@@ -158,6 +173,92 @@ void DwarfCUToModule::FileContext::ClearSpecifications() {
     file_private_->specifications.clear();
 }
 
+void DwarfCUToModule::FileContext::Speculate(uint64_t unit_start,
+                                             uint64_t unit_end) {
+  unit_start_ = unit_start;
+  unit_end_ = unit_end;
+  speculative_ = true;
+  speculation_failed_ = false;
+}
+
+void DwarfCUToModule::FileContext::SetCurrentUnit(uint64_t unit_start,
+                                                  uint64_t unit_end) {
+  unit_start_ = unit_start;
+  unit_end_ = unit_end;
+}
+
+bool DwarfCUToModule::FileContext::HasForeignEntries(uint64_t unit_start,
+                                                     uint64_t unit_end) const {
+  std::set<uint64_t>::const_iterator entry =
+      foreign_entries_.lower_bound(unit_start);
+  return entry != foreign_entries_.end() && *entry < unit_end;
+}
+
+void DwarfCUToModule::FileContext::NoteLookup(uint64_t offset) {
+  if (speculative_ && (offset < unit_start_ || offset >= unit_end_))
+    speculation_failed_ = true;
+}
+
+void DwarfCUToModule::FileContext::NoteEntry(uint64_t offset) {
+  if (offset >= unit_start_ && offset < unit_end_)
+    return;
+  if (speculative_)
+    speculation_failed_ = true;
+  else
+    foreign_entries_.insert(offset);
+}
+
+void DwarfCUToModule::FileContext::Commit(FileContext* speculation) {
+  assert(speculation->speculative_ && !speculation->speculation_failed_);
+  Module* fragment = speculation->module_;
+  FilePrivate* results = speculation->file_private_.get();
+
+  // Names and specifications refer to strings in the fragment's pool.
+  module_->AbsorbStringPool(fragment);
+
+  // Point lines and call sites at our own module's files.
+  vector<Module::File*> fragment_files;
+  fragment->GetFiles(&fragment_files);
+  map<Module::File*, Module::File*> files;
+  for (Module::File* file : fragment_files)
+    files[file] = module_->FindFile(file->name);
+  for (Module::Function* func : results->functions) {
+    for (Module::Line& line : func->lines)
+      line.file = files[line.file];
+    Module::Inline::InlineDFS(func->inlines,
+                              [&files](unique_ptr<Module::Inline>& in) {
+      if (in->call_site_file)
+        in->call_site_file = files[in->call_site_file];
+    });
+  }
+
+  // A successful speculation only recorded entries for its own DIEs, and
+  // no serially processed unit recorded any for them, so none of these
+  // collide with entries we already have.
+  for (auto& entry : fragment->inline_origin_maps)
+    module_->inline_origin_maps[entry.first].Absorb(&entry.second);
+  if (handle_inter_cu_refs_) {
+    file_private_->specifications.insert(results->specifications.begin(),
+                                         results->specifications.end());
+  }
+  file_private_->origins.insert(results->origins.begin(),
+                                results->origins.end());
+  file_private_->forward_ref_die_to_func.insert(
+      results->forward_ref_die_to_func.begin(),
+      results->forward_ref_die_to_func.end());
+
+  // Add the unit's functions, just as DwarfCUToModule::Finish would have.
+  for (Module::Function* func : results->functions)
+    if (!module_->AddFunction(func)) {
+      auto iter = results->spec_function_offsets.find(func);
+      if (iter != results->spec_function_offsets.end())
+        file_private_->forward_ref_die_to_func.erase(iter->second);
+      delete func;
+    }
+  results->functions.clear();
+  results->forward_ref_die_to_func.clear();
+}
+
 bool DwarfCUToModule::FileContext::IsUnhandledInterCUReference(
     uint64_t offset, uint64_t compilation_unit_start) const {
   if (handle_inter_cu_refs_)
@@ -410,6 +511,7 @@ void DwarfCUToModule::GenericDIEHandler::ProcessAttributeReference(
       // here, but it's better to leave the real work to our
       // EndAttribute member function, at which point we know we have
       // seen all the DIE's attributes.
+      file_context->NoteLookup(data);
       SpecificationByOffset* specifications =
           &file_context->file_private_->specifications;
       SpecificationByOffset::iterator spec = specifications->find(data);
@@ -424,6 +526,7 @@ void DwarfCUToModule::GenericDIEHandler::ProcessAttributeReference(
       break;
     }
     case DW_AT_abstract_origin: {
+      cu_context_->file_context->NoteLookup(data);
       const AbstractOriginByOffset& origins =
           cu_context_->file_context->file_private_->origins;
       AbstractOriginByOffset::const_iterator origin = origins.find(data);
@@ -729,6 +832,7 @@ void DwarfCUToModule::InlineHandler::Finish() {
   // Every DW_TAG_inlined_subroutine should have a DW_AT_abstract_origin.
   assert(specification_offset_ != 0);
 
+  cu_context_->file_context->NoteEntry(specification_offset_);
   Module::InlineOriginMap& inline_origin_map =
       cu_context_->file_context->module_
           ->inline_origin_maps[cu_context_->file_context->filename_];
@@ -971,6 +1075,7 @@ void DwarfCUToModule::FuncHandler::Finish() {
       // description is just empty debug data and should just be discarded.
       cu_context_->functions.push_back(func.release());
       if (forward_ref_die_offset_ != 0) {
+        cu_context_->file_context->NoteEntry(forward_ref_die_offset_);
         cu_context_->file_context->file_private_
             ->forward_ref_die_to_func[forward_ref_die_offset_] =
             cu_context_->functions.back();
@@ -992,6 +1097,7 @@ void DwarfCUToModule::FuncHandler::Finish() {
     StringView name = name_.empty() ? name_omitted : name_;
     uint64_t offset =
         specification_offset_ != 0 ? specification_offset_ : offset_;
+    cu_context_->file_context->NoteEntry(offset);
     Module::InlineOriginMap& inline_origin_map =
         cu_context_->file_context->module_
             ->inline_origin_maps[cu_context_->file_context->filename_];
@@ -1029,7 +1135,7 @@ DIEHandler* DwarfCUToModule::NamedScopeHandler::FindChildHandler(
 void DwarfCUToModule::WarningReporter::CUHeading() {
   if (printed_cu_header_)
     return;
-  fprintf(stderr, "%s: in compilation unit '%s' (offset 0x%" PRIx64 "):\n",
+  fprintf(output_, "%s: in compilation unit '%s' (offset 0x%" PRIx64 "):\n",
           filename_.c_str(), cu_name_.c_str(), cu_offset_);
   printed_cu_header_ = true;
 }
@@ -1037,7 +1143,7 @@ void DwarfCUToModule::WarningReporter::CUHeading() {
 void DwarfCUToModule::WarningReporter::UnknownSpecification(uint64_t offset,
                                                             uint64_t target) {
   CUHeading();
-  fprintf(stderr, "%s: the DIE at offset 0x%" PRIx64 " has a "
+  fprintf(output_, "%s: the DIE at offset 0x%" PRIx64 " has a "
           "DW_AT_specification attribute referring to the DIE at offset 0x%"
           PRIx64 ", which was not marked as a declaration\n",
           filename_.c_str(), offset, target);
@@ -1046,7 +1152,7 @@ void DwarfCUToModule::WarningReporter::UnknownSpecification(uint64_t offset,
 void DwarfCUToModule::WarningReporter::UnknownAbstractOrigin(uint64_t offset,
                                                              uint64_t target) {
   CUHeading();
-  fprintf(stderr, "%s: the DIE at offset 0x%" PRIx64 " has a "
+  fprintf(output_, "%s: the DIE at offset 0x%" PRIx64 " has a "
           "DW_AT_abstract_origin attribute referring to the DIE at offset 0x%"
           PRIx64 ", which was not marked as an inline\n",
           filename_.c_str(), offset, target);
@@ -1054,13 +1160,13 @@ void DwarfCUToModule::WarningReporter::UnknownAbstractOrigin(uint64_t offset,
 
 void DwarfCUToModule::WarningReporter::MissingSection(const string& name) {
   CUHeading();
-  fprintf(stderr, "%s: warning: couldn't find DWARF '%s' section\n",
+  fprintf(output_, "%s: warning: couldn't find DWARF '%s' section\n",
           filename_.c_str(), name.c_str());
 }
 
 void DwarfCUToModule::WarningReporter::BadLineInfoOffset(uint64_t offset) {
   CUHeading();
-  fprintf(stderr, "%s: warning: line number data offset beyond end"
+  fprintf(output_, "%s: warning: line number data offset beyond end"
           " of '.debug_line' section\n",
           filename_.c_str());
 }
@@ -1069,7 +1175,7 @@ void DwarfCUToModule::WarningReporter::UncoveredHeading() {
   if (printed_unpaired_header_)
     return;
   CUHeading();
-  fprintf(stderr, "%s: warning: skipping unpaired lines/functions:\n",
+  fprintf(output_, "%s: warning: skipping unpaired lines/functions:\n",
           filename_.c_str());
   printed_unpaired_header_ = true;
 }
@@ -1079,7 +1185,7 @@ void DwarfCUToModule::WarningReporter::UncoveredFunction(
   if (!uncovered_warnings_enabled_)
     return;
   UncoveredHeading();
-  fprintf(stderr, "    function%s: %s\n",
+  fprintf(output_, "    function%s: %s\n",
           IsEmptyRange(function.ranges) ? " (zero-length)" : "",
           function.name.str().c_str());
 }
@@ -1088,43 +1194,45 @@ void DwarfCUToModule::WarningReporter::UncoveredLine(const Module::Line& line) {
   if (!uncovered_warnings_enabled_)
     return;
   UncoveredHeading();
-  fprintf(stderr, "    line%s: %s:%d at 0x%" PRIx64 "\n",
+  fprintf(output_, "    line%s: %s:%d at 0x%" PRIx64 "\n",
           (line.size == 0 ? " (zero-length)" : ""),
           line.file->name.c_str(), line.number, line.address);
 }
 
 void DwarfCUToModule::WarningReporter::UnnamedFunction(uint64_t offset) {
   CUHeading();
-  fprintf(stderr, "%s: warning: function at offset 0x%" PRIx64 " has no name\n",
+  fprintf(output_,
+          "%s: warning: function at offset 0x%" PRIx64 " has no name\n",
           filename_.c_str(), offset);
 }
 
 void DwarfCUToModule::WarningReporter::DemangleError(const string& input) {
   CUHeading();
-  fprintf(stderr, "%s: warning: failed to demangle %s\n",
+  fprintf(output_, "%s: warning: failed to demangle %s\n",
           filename_.c_str(), input.c_str());
 }
 
 void DwarfCUToModule::WarningReporter::UnhandledInterCUReference(
     uint64_t offset, uint64_t target) {
   CUHeading();
-  fprintf(stderr, "%s: warning: the DIE at offset 0x%" PRIx64 " has a "
-                  "DW_FORM_ref_addr attribute with an inter-CU reference to "
-                  "0x%" PRIx64 ", but inter-CU reference handling is turned "
-                  " off.\n", filename_.c_str(), offset, target);
+  fprintf(output_, "%s: warning: the DIE at offset 0x%" PRIx64 " has a "
+                   "DW_FORM_ref_addr attribute with an inter-CU reference to "
+                   "0x%" PRIx64 ", but inter-CU reference handling is turned "
+                   " off.\n", filename_.c_str(), offset, target);
 }
 
 void DwarfCUToModule::WarningReporter::MalformedRangeList(uint64_t offset) {
   CUHeading();
-  fprintf(stderr, "%s: warning: the range list at offset 0x%" PRIx64 " falls "
-                  " out of the .debug_ranges section.\n",
-                  filename_.c_str(), offset);
+  fprintf(output_, "%s: warning: the range list at offset 0x%" PRIx64 " falls "
+                   " out of the .debug_ranges section.\n",
+                   filename_.c_str(), offset);
 }
 
 void DwarfCUToModule::WarningReporter::MissingRanges() {
   CUHeading();
-  fprintf(stderr, "%s: warning: A DW_AT_ranges attribute was encountered but "
-                  "the .debug_ranges section is missing.\n", filename_.c_str());
+  fprintf(output_, "%s: warning: A DW_AT_ranges attribute was encountered but "
+                   "the .debug_ranges section is missing.\n",
+                   filename_.c_str());
 }
 
 DwarfCUToModule::DwarfCUToModule(FileContext* file_context,
@@ -1605,21 +1713,32 @@ void DwarfCUToModule::Finish() {
   AssignFilesToInlines();
 
   // Add our functions, which now have source lines assigned to them,
-  // to module_, and remove duplicate functions.
-  for (Module::Function* func : *functions)
-    if (!cu_context_->file_context->module_->AddFunction(func)) {
-      auto iter = cu_context_->spec_function_offsets.find(func);
-      if (iter != cu_context_->spec_function_offsets.end())
-        cu_context_->file_context->file_private_->forward_ref_die_to_func.erase(
-            iter->second);
-      delete func;
-    }
+  // to module_, and remove duplicate functions. A speculative context
+  // holds on to them until it is committed.
+  FileContext* file_context = cu_context_->file_context;
+  if (file_context->speculative_) {
+    FilePrivate* file_private = file_context->file_private_.get();
+    file_private->functions.insert(file_private->functions.end(),
+                                   functions->begin(), functions->end());
+    file_private->spec_function_offsets.insert(
+        cu_context_->spec_function_offsets.begin(),
+        cu_context_->spec_function_offsets.end());
+  } else {
+    for (Module::Function* func : *functions)
+      if (!file_context->module_->AddFunction(func)) {
+        auto iter = cu_context_->spec_function_offsets.find(func);
+        if (iter != cu_context_->spec_function_offsets.end())
+          file_context->file_private_->forward_ref_die_to_func.erase(
+              iter->second);
+        delete func;
+      }
+  }
 
   // Ownership of the function objects has shifted from cu_context to
   // the Module.
   functions->clear();
 
-  cu_context_->file_context->ClearSpecifications();
+  file_context->ClearSpecifications();
 }
 
 bool DwarfCUToModule::StartCompilationUnit(uint64_t offset,
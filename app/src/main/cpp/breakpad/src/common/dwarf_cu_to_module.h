@@ -39,7 +39,9 @@
 #define COMMON_LINUX_DWARF_CU_TO_MODULE_H__
 
 #include <stdint.h>
+#include <stdio.h>
 
+#include <set>
 #include <string>
 #include <vector>
 
@@ -92,12 +94,43 @@ class DwarfCUToModule: public RootDIEHandler {
 
     const SectionMap& section_map() const;
 
+    // Support for processing compilation units concurrently.
+    //
+    // A speculative context gathers the results of processing the single
+    // compilation unit occupying [UNIT_START, UNIT_END) in .debug_info
+    // into its own module, so that it can run alongside other units.
+    // If the unit refers to any DIE outside its own bounds, the result
+    // would depend on units processed before it, and the speculation
+    // fails; the unit must then be processed again, serially.
+    void Speculate(uint64_t unit_start, uint64_t unit_end);
+    bool speculation_failed() const { return speculation_failed_; }
+
+    // Tell a non-speculative context that the unit occupying
+    // [UNIT_START, UNIT_END) is about to be processed serially, so that
+    // it can note any entries that unit records for DIEs outside itself.
+    void SetCurrentUnit(uint64_t unit_start, uint64_t unit_end);
+
+    // Return true if a unit processed serially so far recorded an entry
+    // for a DIE within [UNIT_START, UNIT_END). A speculative result for
+    // such a unit can't be committed.
+    bool HasForeignEntries(uint64_t unit_start, uint64_t unit_end) const;
+
+    // Merge the results held by SPECULATION, whose speculation succeeded,
+    // into this context and its module, exactly as if the unit had been
+    // processed serially with this context.
+    void Commit(FileContext* speculation);
+
    private:
     friend class DwarfCUToModule;
 
     // Clears all the Specifications if HANDLE_INTER_CU_REFS_ is false.
     void ClearSpecifications();
 
+    // Note that the current unit is looking up, or recording an entry for,
+    // the DIE at OFFSET.
+    void NoteLookup(uint64_t offset);
+    void NoteEntry(uint64_t offset);
+
     // Given an OFFSET and a CU that starts at COMPILATION_UNIT_START, returns
     // true if this is an inter-compilation unit reference that is not being
     // handled.
@@ -120,6 +153,19 @@ class DwarfCUToModule: public RootDIEHandler {
     // Inter-compilation unit data used internally by the handlers.
     scoped_ptr<FilePrivate> file_private_;
     std::vector<uint8_t *> uncompressed_sections_;
+
+    // The bounds of the unit being processed, when processing units
+    // concurrently; otherwise, the whole section.
+    uint64_t unit_start_;
+    uint64_t unit_end_;
+
+    // True if this context only holds the results of a single unit.
+    bool speculative_;
+    bool speculation_failed_;
+
+    // The offsets of DIEs outside their own unit for which serially
+    // processed units have recorded entries.
+    std::set<uint64_t> foreign_entries_;
   };
 
   // An abstract base class for handlers that handle DWARF range lists for
@@ -176,9 +222,12 @@ class DwarfCUToModule: public RootDIEHandler {
     WarningReporter(const string& filename, uint64_t cu_offset)
         : filename_(filename), cu_offset_(cu_offset), printed_cu_header_(false),
           printed_unpaired_header_(false),
-          uncovered_warnings_enabled_(false) { }
+          uncovered_warnings_enabled_(false), output_(stderr) { }
     virtual ~WarningReporter() { }
 
+    // Write warnings to OUTPUT instead of stderr.
+    void set_output(FILE* output) { output_ = output; }
+
     // Set the name of the compilation unit we're processing to NAME.
     virtual void SetCUName(const string& name) { cu_name_ = name; }
 
@@ -246,6 +295,7 @@ class DwarfCUToModule: public RootDIEHandler {
     bool printed_cu_header_;
     bool printed_unpaired_header_;
     bool uncovered_warnings_enabled_;
+    FILE* output_;
 
    private:
     // Print a per-CU heading, once.
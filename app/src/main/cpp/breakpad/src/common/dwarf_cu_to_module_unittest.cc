@@ -1640,6 +1640,100 @@ TEST_F(Specifications, UnhandledInterCU) {
   }
 }
 
+TEST_F(Specifications, SpeculativeCommit) {
+  Module m("module-name", "module-os", "module-arch", "module-id");
+  DwarfCUToModule::FileContext fc("dwarf-filename", &m, true);
+  Module fragment("module-name", "module-os", "module-arch", "module-id");
+  DwarfCUToModule::FileContext speculation("dwarf-filename", &fragment, true);
+  speculation.Speculate(0x6ccfea031a9e0000ULL, 0x6ccfea031a9f0000ULL);
+  EXPECT_CALL(reporter_, UncoveredFunction(_)).WillOnce(Return());
+  MockLineToModuleHandler lr;
+  EXPECT_CALL(lr, ReadProgram(_,_,_,_,_,_,_,_,_)).Times(0);
+
+  // Kludge: satisfy reporter_'s expectation.
+  reporter_.SetCUName("compilation-unit-name");
+
+  // A unit whose references all stay within it.
+  {
+    DwarfCUToModule root_handler(&speculation, &lr, nullptr, &reporter_);
+    ASSERT_TRUE(root_handler.StartCompilationUnit(0, 1, 2, 3, 3));
+    ASSERT_TRUE(root_handler.StartRootDIE(1,
+                                          google_breakpad::DW_TAG_compile_unit));
+    ASSERT_TRUE(root_handler.EndAttributes());
+    DeclarationDIE(&root_handler, 0x6ccfea031a9e1000ULL,
+                   google_breakpad::DW_TAG_subprogram, "declaration-name", "");
+    DefinitionDIE(&root_handler, google_breakpad::DW_TAG_subprogram,
+                  0x6ccfea031a9e1000ULL, "",
+                  0x93cd3dfc1aa10097ULL, 0x0397d47a0b4ca0d4ULL);
+    root_handler.Finish();
+  }
+  EXPECT_FALSE(speculation.speculation_failed());
+
+  // Nothing reaches the module until the unit is committed.
+  vector<Module::Function*> functions;
+  m.GetFunctions(&functions, functions.end());
+  EXPECT_EQ(0U, functions.size());
+
+  fc.Commit(&speculation);
+  m.GetFunctions(&functions, functions.end());
+  ASSERT_EQ(1U, functions.size());
+  EXPECT_STREQ("declaration-name", functions[0]->name.str().c_str());
+  EXPECT_EQ(0x93cd3dfc1aa10097ULL, functions[0]->address);
+}
+
+TEST_F(Specifications, SpeculativeInterCU) {
+  Module m("module-name", "module-os", "module-arch", "module-id");
+  DwarfCUToModule::FileContext fc("dwarf-filename", &m, true);
+  Module fragment("module-name", "module-os", "module-arch", "module-id");
+  DwarfCUToModule::FileContext speculation("dwarf-filename", &fragment, true);
+  speculation.Speculate(0x6ccfea031a9e6000ULL, 0x6ccfea031a9e7000ULL);
+  EXPECT_CALL(reporter_, UncoveredFunction(_)).WillRepeatedly(Return());
+  MockLineToModuleHandler lr;
+  EXPECT_CALL(lr, ReadProgram(_,_,_,_,_,_,_,_,_)).Times(0);
+
+  // Kludge: satisfy reporter_'s expectation.
+  reporter_.SetCUName("compilation-unit-name");
+
+  // First CU, processed serially. Declares a function, and defines one
+  // whose specification lies in a later unit.
+  fc.SetCurrentUnit(0x6ccfea031a9e0000ULL, 0x6ccfea031a9e7000ULL);
+  {
+    DwarfCUToModule root_handler(&fc, &lr, nullptr, &reporter_);
+    ASSERT_TRUE(root_handler.StartCompilationUnit(0, 1, 2, 3, 3));
+    ASSERT_TRUE(root_handler.StartRootDIE(1,
+                                          google_breakpad::DW_TAG_compile_unit));
+    ASSERT_TRUE(root_handler.EndAttributes());
+    DeclarationDIE(&root_handler, 0x6ccfea031a9e1000ULL,
+                   google_breakpad::DW_TAG_subprogram, "declaration-name", "");
+    DefinitionDIE(&root_handler, google_breakpad::DW_TAG_subprogram,
+                  0x6ccfea031a9f1000ULL, "",
+                  0x2618f00a1a711e53ULL, 0x4fd94b76d7c2caf5ULL);
+    root_handler.Finish();
+  }
+  EXPECT_TRUE(fc.HasForeignEntries(0x6ccfea031a9f0000ULL,
+                                   0x6ccfea031a9f2000ULL));
+  EXPECT_FALSE(fc.HasForeignEntries(0x6ccfea031a9f2000ULL,
+                                    0x6ccfea031a9f3000ULL));
+
+  // Second CU, processed speculatively. Defines the function declared in
+  // the first, so its outcome depends on that unit. The speculative
+  // context can't see the declaration.
+  EXPECT_CALL(reporter_, UnknownSpecification(_, 0x6ccfea031a9e1000ULL))
+      .WillOnce(Return());
+  {
+    DwarfCUToModule root_handler(&speculation, &lr, nullptr, &reporter_);
+    ASSERT_TRUE(root_handler.StartCompilationUnit(0, 1, 2, 3, 3));
+    ASSERT_TRUE(root_handler.StartRootDIE(1,
+                                          google_breakpad::DW_TAG_compile_unit));
+    ASSERT_TRUE(root_handler.EndAttributes());
+    DefinitionDIE(&root_handler, google_breakpad::DW_TAG_subprogram,
+                  0x6ccfea031a9e1000ULL, "",
+                  0x93cd3dfc1aa10097ULL, 0x0397d47a0b4ca0d4ULL);
+    root_handler.Finish();
+  }
+  EXPECT_TRUE(speculation.speculation_failed());
+}
+
 TEST_F(Specifications, BadOffset) {
   PushLine(0xa0277efd7ce83771ULL, 0x149554a184c730c1ULL, "line-file", 56636272);
 
@@ -55,8 +55,15 @@
 #include <zstd.h>
 #endif
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <iterator>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -373,6 +380,127 @@ std::pair<uint8_t *, uint64_t> UncompressSectionContents(
   return std::make_pair(nullptr, 0);
 }
 
+// The sections the DWARF readers consult when loading .debug_info.
+const char* const kDwarfSectionNames[] = {
+  ".debug_abbrev",
+  ".debug_addr",
+  ".debug_info",
+  ".debug_line",
+  ".debug_line_str",
+  ".debug_ranges",
+  ".debug_rnglists",
+  ".debug_str",
+  ".debug_str_offsets",
+};
+
+bool IsDwarfSectionName(const string& name) {
+  for (const char* dwarf_name : kDwarfSectionNames) {
+    if (name == dwarf_name)
+      return true;
+  }
+  return false;
+}
+
+// The uncompressed contents of an ELF file's SHF_COMPRESSED sections.
+// A section is decompressed the first time a pass over the file needs
+// it, and kept for any later passes. Sections a pass is about to need
+// can be decompressed ahead of time, concurrently.
+template<typename ElfClass>
+class UncompressedSections {
+ public:
+  typedef typename ElfClass::Ehdr Ehdr;
+  typedef typename ElfClass::Shdr Shdr;
+
+  UncompressedSections(const Ehdr* elf_header, int thread_count)
+      : elf_header_(elf_header),
+        sections_(GetOffset<ElfClass, Shdr>(elf_header,
+                                            elf_header->e_shoff)),
+        thread_count_(thread_count),
+        entries_(elf_header->e_shnum) { }
+
+  ~UncompressedSections() {
+    for (Entry& entry : entries_)
+      delete[] entry.contents;
+  }
+
+  // Decompress those sections named in NAMES which are compressed and
+  // haven't been decompressed yet, using up to the given number of
+  // threads.
+  void Prefetch(const vector<string>& names) {
+    const Shdr* section_names = sections_ + elf_header_->e_shstrndx;
+    const char* names_start =
+        GetOffset<ElfClass, char>(elf_header_, section_names->sh_offset);
+    vector<size_t> pending;
+    for (size_t i = 0; i < entries_.size(); ++i) {
+      if (!IsCompressedHeader<ElfClass>(&sections_[i]) || entries_[i].done)
+        continue;
+      string name = names_start + sections_[i].sh_name;
+      if (std::find(names.begin(), names.end(), name) != names.end())
+        pending.push_back(i);
+    }
+
+    std::atomic<size_t> next(0);
+    auto worker = [this, &pending, &next]() {
+      for (size_t i = next++; i < pending.size(); i = next++)
+        Uncompress(pending[i]);
+    };
+    size_t thread_count =
+        std::min(pending.size(), static_cast<size_t>(thread_count_));
+    vector<std::thread> threads;
+    for (size_t i = 1; i < thread_count; ++i)
+      threads.push_back(std::thread(worker));
+    worker();
+    for (std::thread& thread : threads)
+      thread.join();
+  }
+
+  // Return the uncompressed contents of the compressed SECTION, or
+  // (nullptr, 0) if it can't be decompressed.
+  std::pair<const uint8_t*, uint64_t> Get(const Shdr* section) {
+    size_t index = section - sections_;
+    assert(index < entries_.size());
+    if (!entries_[index].done)
+      Uncompress(index);
+    return std::make_pair(entries_[index].contents, entries_[index].size);
+  }
+
+ private:
+  struct Entry {
+    Entry() : contents(nullptr), size(0), done(false) { }
+    uint8_t* contents;
+    uint64_t size;
+    bool done;
+  };
+
+  void Uncompress(size_t index) {
+    const Shdr* section = &sections_[index];
+    const uint8_t* contents =
+        GetOffset<ElfClass, uint8_t>(elf_header_, section->sh_offset);
+    uint64_t size = section->sh_size;
+    Entry* entry = &entries_[index];
+    entry->done = true;
+
+    typename ElfClass::Chdr chdr;
+    uint32_t compression_header_size =
+      GetCompressionHeader<ElfClass>(chdr, contents, size);
+    if (compression_header_size == 0 || chdr.ch_size == 0)
+      return;
+
+    std::pair<uint8_t *, uint64_t> uncompressed =
+      UncompressSectionContents(chdr.ch_type,
+                                contents + compression_header_size,
+                                size - compression_header_size,
+                                chdr.ch_size);
+    entry->contents = uncompressed.first;
+    entry->size = uncompressed.first ? uncompressed.second : 0;
+  }
+
+  const Ehdr* elf_header_;
+  const Shdr* sections_;
+  const int thread_count_;
+  vector<Entry> entries_;
+};
+
 void StartProcessSplitDwarf(google_breakpad::CompilationUnit* reader,
                             Module* module,
                             google_breakpad::Endianness endianness,
@@ -426,12 +554,153 @@ void StartProcessSplitDwarf(google_breakpad::CompilationUnit* reader,
   }
 }
 
+// Process the compilation unit at OFFSET in FILE_CONTEXT's .debug_info
+// section into MODULE, along with any split DWARF it refers to. Return
+// the size of the unit.
+uint64_t LoadCompilationUnit(const string& dwarf_filename,
+                             DwarfCUToModule::FileContext* file_context,
+                             google_breakpad::ByteReader* byte_reader,
+                             DumperRangesHandler* ranges_handler,
+                             DumperLineToModule* line_to_module,
+                             google_breakpad::Endianness endianness,
+                             bool handle_inter_cu_refs,
+                             bool handle_inline,
+                             Module* module,
+                             uint64_t offset) {
+  // Make a handler for the root DIE that populates MODULE with the
+  // data that was found.
+  DwarfCUToModule::WarningReporter reporter(dwarf_filename, offset);
+  DwarfCUToModule root_handler(file_context, line_to_module,
+                               ranges_handler, &reporter, handle_inline);
+  // Make a Dwarf2Handler that drives the DIEHandler.
+  google_breakpad::DIEDispatcher die_dispatcher(&root_handler);
+  // Make a DWARF parser for the compilation unit at OFFSET.
+  google_breakpad::CompilationUnit reader(dwarf_filename,
+                                       file_context->section_map(),
+                                       offset,
+                                       byte_reader,
+                                       &die_dispatcher);
+  // Process the entire compilation unit; get the offset of the next.
+  uint64_t size = reader.Start();
+  // Start to process split dwarf file.
+  if (reader.ShouldProcessSplitDwarf()) {
+    StartProcessSplitDwarf(&reader, module, endianness, handle_inter_cu_refs,
+                           handle_inline);
+  }
+  return size;
+}
+
+// Find the bounds of each compilation unit in the .debug_info section
+// DEBUG_INFO, of size LENGTH, from the units' initial length fields alone.
+// Return false if the units don't fit the section.
+bool ListCompilationUnits(const uint8_t* debug_info, uint64_t length,
+                          google_breakpad::Endianness endianness,
+                          vector<std::pair<uint64_t, uint64_t>>* units) {
+  google_breakpad::ByteReader reader(endianness);
+  for (uint64_t offset = 0; offset < length;) {
+    uint64_t left = length - offset;
+    if (left < 4)
+      return false;
+    uint64_t size = reader.ReadFourBytes(debug_info + offset);
+    if (size == 0xffffffff) {
+      // The 64-bit DWARF format.
+      if (left < 12)
+        return false;
+      size = reader.ReadEightBytes(debug_info + offset + 4);
+      if (size > left - 12)
+        return false;
+      size += 12;
+    } else {
+      if (size > left - 4)
+        return false;
+      size += 4;
+    }
+    units->push_back(std::make_pair(offset, offset + size));
+    offset += size;
+  }
+  return true;
+}
+
+// A compilation unit processed on a worker thread, waiting to be
+// committed to the module.
+struct SpeculativeUnit {
+  SpeculativeUnit(uint64_t start, uint64_t end)
+      : start(start), end(end), warnings(NULL), warnings_size(0),
+        succeeded(false), done(false) { }
+
+  // The unit's bounds within .debug_info.
+  uint64_t start, end;
+
+  // The unit's results, and the module holding them.
+  std::unique_ptr<Module> module;
+  std::unique_ptr<DwarfCUToModule::FileContext> file_context;
+
+  // Warnings reported while processing the unit, to be printed only if
+  // the results are committed.
+  char* warnings;
+  size_t warnings_size;
+
+  // True if the results can be committed, provided no unit processed
+  // serially before this one recorded entries inside it.
+  bool succeeded;
+
+  // True once the worker is finished with the unit.
+  bool done;
+};
+
+// Process UNIT speculatively, into a module of its own.
+void LoadSpeculativeUnit(const string& dwarf_filename,
+                         const google_breakpad::SectionMap& sections,
+                         google_breakpad::Endianness endianness,
+                         bool handle_inter_cu_refs,
+                         bool handle_inline,
+                         const Module& module,
+                         SpeculativeUnit* unit) {
+  unit->module.reset(new Module(module.name(), module.os(),
+                                module.architecture(), module.identifier()));
+  unit->file_context.reset(new DwarfCUToModule::FileContext(
+      dwarf_filename, unit->module.get(), handle_inter_cu_refs));
+  for (const auto& section : sections) {
+    unit->file_context->AddSectionToSectionMap(
+        section.first, section.second.first, section.second.second);
+  }
+  unit->file_context->Speculate(unit->start, unit->end);
+
+  google_breakpad::ByteReader byte_reader(endianness);
+  DumperRangesHandler ranges_handler(&byte_reader);
+  DumperLineToModule line_to_module(&byte_reader);
+  FILE* warnings = open_memstream(&unit->warnings, &unit->warnings_size);
+  DwarfCUToModule::WarningReporter reporter(dwarf_filename, unit->start);
+  if (warnings)
+    reporter.set_output(warnings);
+  bool split_dwarf;
+  {
+    DwarfCUToModule root_handler(unit->file_context.get(), &line_to_module,
+                                 &ranges_handler, &reporter, handle_inline);
+    google_breakpad::DIEDispatcher die_dispatcher(&root_handler);
+    google_breakpad::CompilationUnit reader(dwarf_filename,
+                                         unit->file_context->section_map(),
+                                         unit->start,
+                                         &byte_reader,
+                                         &die_dispatcher);
+    reader.Start();
+    // Split DWARF units add to the module directly; leave them to be
+    // processed serially.
+    split_dwarf = reader.ShouldProcessSplitDwarf();
+  }
+  if (warnings)
+    fclose(warnings);
+  unit->succeeded = !split_dwarf && !unit->file_context->speculation_failed();
+}
+
 template<typename ElfClass>
 bool LoadDwarf(const string& dwarf_filename,
                const typename ElfClass::Ehdr* elf_header,
                const bool big_endian,
                bool handle_inter_cu_refs,
                bool handle_inline,
+               int thread_count,
+               UncompressedSections<ElfClass>* uncompressed_sections,
                Module* module) {
   typedef typename ElfClass::Shdr Shdr;
 
@@ -463,23 +732,15 @@ bool LoadDwarf(const string& dwarf_filename,
       continue;
     }
 
-    typename ElfClass::Chdr chdr;
-
-    uint32_t compression_header_size =
-      GetCompressionHeader<ElfClass>(chdr, contents, size);
-
-    if (compression_header_size == 0 || chdr.ch_size == 0) {
+    // Only decompress the sections we're going to read.
+    if (!IsDwarfSectionName(name))
       continue;
-    }
-
-    contents += compression_header_size;
-    size -= compression_header_size;
-
-    std::pair<uint8_t *, uint64_t> uncompressed =
-      UncompressSectionContents(chdr.ch_type, contents, size, chdr.ch_size);
 
+    std::pair<const uint8_t*, uint64_t> uncompressed =
+        uncompressed_sections->Get(section);
     if (uncompressed.first != nullptr && uncompressed.second != 0) {
-      file_context.AddManagedSectionToSectionMap(name, uncompressed.first, uncompressed.second);
+      file_context.AddSectionToSectionMap(name, uncompressed.first,
+                                          uncompressed.second);
     }
   }
 
@@ -497,28 +758,93 @@ bool LoadDwarf(const string& dwarf_filename,
   // .debug_info section.
   assert(debug_info_section.first);
   uint64_t debug_info_length = debug_info_section.second;
-  for (uint64_t offset = 0; offset < debug_info_length;) {
-    // Make a handler for the root DIE that populates MODULE with the
-    // data that was found.
-    DwarfCUToModule::WarningReporter reporter(dwarf_filename, offset);
-    DwarfCUToModule root_handler(&file_context, &line_to_module,
-                                 &ranges_handler, &reporter, handle_inline);
-    // Make a Dwarf2Handler that drives the DIEHandler.
-    google_breakpad::DIEDispatcher die_dispatcher(&root_handler);
-    // Make a DWARF parser for the compilation unit at OFFSET.
-    google_breakpad::CompilationUnit reader(dwarf_filename,
-                                         file_context.section_map(),
-                                         offset,
-                                         &byte_reader,
-                                         &die_dispatcher);
-    // Process the entire compilation unit; get the offset of the next.
-    offset += reader.Start();
-    // Start to process split dwarf file.
-    if (reader.ShouldProcessSplitDwarf()) {
-      StartProcessSplitDwarf(&reader, module, endianness, handle_inter_cu_refs,
-                             handle_inline);
+
+  vector<std::pair<uint64_t, uint64_t>> unit_bounds;
+  if (thread_count <= 1 ||
+      !ListCompilationUnits(debug_info_section.first, debug_info_length,
+                            endianness, &unit_bounds) ||
+      unit_bounds.size() < 2) {
+    for (uint64_t offset = 0; offset < debug_info_length;) {
+      offset += LoadCompilationUnit(dwarf_filename, &file_context,
+                                    &byte_reader, &ranges_handler,
+                                    &line_to_module, endianness,
+                                    handle_inter_cu_refs, handle_inline,
+                                    module, offset);
     }
+    return true;
   }
+
+  // Process units speculatively on worker threads, each into a module of
+  // its own, and commit the results in order, so that the module ends up
+  // exactly as if the units had been processed serially. Units whose
+  // results depend on other units are processed again here, serially.
+  vector<SpeculativeUnit> units;
+  units.reserve(unit_bounds.size());
+  for (const auto& bounds : unit_bounds)
+    units.push_back(SpeculativeUnit(bounds.first, bounds.second));
+
+  // Don't let the workers get too far ahead of the commits, so that only
+  // a bounded number of units' results are held at once.
+  const size_t window = static_cast<size_t>(thread_count) * 4;
+  std::mutex mutex;
+  std::condition_variable changed;
+  size_t next_unit = 0;
+  size_t committed = 0;
+  auto worker = [&]() {
+    for (;;) {
+      size_t index;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&]() {
+          return next_unit == units.size() || next_unit < committed + window;
+        });
+        if (next_unit == units.size())
+          return;
+        index = next_unit++;
+      }
+      LoadSpeculativeUnit(dwarf_filename, file_context.section_map(),
+                          endianness, handle_inter_cu_refs, handle_inline,
+                          *module, &units[index]);
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        units[index].done = true;
+      }
+      changed.notify_all();
+    }
+  };
+  vector<std::thread> workers;
+  for (int i = 0; i < thread_count; ++i)
+    workers.push_back(std::thread(worker));
+
+  for (SpeculativeUnit& unit : units) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      changed.wait(lock, [&unit]() { return unit.done; });
+    }
+    if (unit.succeeded &&
+        !file_context.HasForeignEntries(unit.start, unit.end)) {
+      file_context.Commit(unit.file_context.get());
+      if (unit.warnings_size)
+        fwrite(unit.warnings, 1, unit.warnings_size, stderr);
+    } else {
+      file_context.SetCurrentUnit(unit.start, unit.end);
+      LoadCompilationUnit(dwarf_filename, &file_context, &byte_reader,
+                          &ranges_handler, &line_to_module, endianness,
+                          handle_inter_cu_refs, handle_inline, module,
+                          unit.start);
+    }
+    free(unit.warnings);
+    unit.warnings = NULL;
+    unit.file_context.reset();
+    unit.module.reset();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      ++committed;
+    }
+    changed.notify_all();
+  }
+  for (std::thread& thread : workers)
+    thread.join();
   return true;
 }
 
@@ -563,6 +889,7 @@ bool LoadDwarfCFI(const string& dwarf_filename,
                   const typename ElfClass::Shdr* got_section,
                   const typename ElfClass::Shdr* text_section,
                   const bool big_endian,
+                  UncompressedSections<ElfClass>* uncompressed_sections,
                   Module* module) {
   // Find the appropriate set of register names for this file's
   // architecture.
@@ -622,11 +949,8 @@ bool LoadDwarfCFI(const string& dwarf_filename,
     return false;
   }
 
-  cfi += compression_header_size;
-  cfi_size -= compression_header_size;
-
-  std::pair<uint8_t *, uint64_t> uncompressed =
-    UncompressSectionContents(chdr.ch_type, cfi, cfi_size, chdr.ch_size);
+  std::pair<const uint8_t*, uint64_t> uncompressed =
+      uncompressed_sections->Get(section);
 
   if (uncompressed.first == nullptr || uncompressed.second == 0) {
     fprintf(stderr, "%s: decompression failed\n", dwarf_filename.c_str());
@@ -892,6 +1216,8 @@ bool LoadSymbols(const string& obj_file,
   const char* names_end = names + section_names->sh_size;
   bool found_debug_info_section = false;
   bool found_usable_info = false;
+  UncompressedSections<ElfClass> uncompressed_sections(elf_header,
+                                                       options.thread_count);
 
   if ((options.symbol_data & SYMBOLS_AND_FILES) ||
       (options.symbol_data & INLINES)) {
@@ -995,9 +1321,18 @@ bool LoadSymbols(const string& obj_file,
       found_debug_info_section = true;
       found_usable_info = true;
       info->LoadedSection(".debug_info");
+      // Decompress the sections this pass and the CFI pass will need
+      // side by side.
+      vector<string> needed(std::begin(kDwarfSectionNames),
+                            std::end(kDwarfSectionNames));
+      if (options.symbol_data & CFI)
+        needed.push_back(".debug_frame");
+      uncompressed_sections.Prefetch(needed);
       if (!LoadDwarf<ElfClass>(obj_file, elf_header, big_endian,
                                options.handle_inter_cu_refs,
-                               options.symbol_data & INLINES, module)) {
+                               options.symbol_data & INLINES,
+                               options.thread_count, &uncompressed_sections,
+                               module)) {
         fprintf(stderr, "%s: \".debug_info\" section found, but failed to load "
                 "DWARF debugging information\n", obj_file.c_str());
       }
@@ -1029,7 +1364,7 @@ bool LoadSymbols(const string& obj_file,
       bool result =
           LoadDwarfCFI<ElfClass>(obj_file, elf_header, ".debug_frame",
                                  dwarf_cfi_section, false, 0, 0, big_endian,
-                                 module);
+                                 &uncompressed_sections, module);
       found_usable_info = found_usable_info || result;
     }
 
@@ -1055,7 +1390,8 @@ bool LoadSymbols(const string& obj_file,
       bool result =
           LoadDwarfCFI<ElfClass>(obj_file, elf_header, ".eh_frame",
                                  eh_frame_section, true,
-                                 got_section, text_section, big_endian, module);
+                                 got_section, text_section, big_endian,
+                                 &uncompressed_sections, module);
       found_usable_info = found_usable_info || result;
     }
   }
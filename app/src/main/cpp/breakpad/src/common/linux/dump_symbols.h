@@ -51,11 +51,15 @@ struct DumpOptions {
               bool enable_multiple_field)
       : symbol_data(symbol_data),
         handle_inter_cu_refs(handle_inter_cu_refs),
-        enable_multiple_field(enable_multiple_field) {}
+        enable_multiple_field(enable_multiple_field),
+        thread_count(1) {}
 
   SymbolData symbol_data;
   bool handle_inter_cu_refs;
   bool enable_multiple_field;
+  // The number of threads to use for processing DWARF compilation units.
+  // The symbol file produced doesn't depend on this.
+  int thread_count;
 };
 
 // Find all the debugging information in OBJ_FILE, an ELF executable
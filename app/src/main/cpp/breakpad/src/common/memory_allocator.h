@@ -31,6 +31,7 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <sys/mman.h>
 
@@ -51,8 +52,153 @@
 
 namespace google_breakpad {
 
-// This is very simple allocator which fetches pages from the kernel directly.
-// Thus, it can be used even when the heap may be corrupted.
+// A PageArena is memory reserved and faulted in ahead of time, from which
+// PageAllocators take their pages while it is current (see set_current())
+// rather than mapping new ones. It is meant for code that must not depend on
+// mapping memory, like writing a minidump for a process that ran out of it.
+//
+// The arena is mapped shared, so that a process cloned to write a dump takes
+// pages from the same memory instead of copy-on-write copies of it, and the
+// process it was cloned from sees how much was used. Pages are handed out in
+// order, and a PageAllocator's pages are only reused once it is destroyed if
+// they were the last ones handed out. When the arena is exhausted,
+// PageAllocators map pages as usual.
+class PageArena {
+ public:
+  // Reserves |size| bytes, rounded up to whole pages. valid() tells whether
+  // the memory could be reserved.
+  explicit PageArena(size_t size)
+      : page_size_(getpagesize()),
+        size_((size + page_size_ - 1) / page_size_ * page_size_),
+        header_(NULL),
+        data_(NULL) {
+    // The first page holds the Header, which has to be shared too.
+    void* a = sys_mmap(NULL, page_size_ + size_, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (a == MAP_FAILED)
+      return;
+#if defined(MEMORY_SANITIZER)
+    __msan_unpoison(a, page_size_ + size_);
+#endif
+    // Fault in every page now, so that none has to be found later.
+    volatile uint8_t* const pages = static_cast<volatile uint8_t*>(a);
+    for (size_t offset = 0; offset < page_size_ + size_; offset += page_size_)
+      pages[offset] = 0;
+    header_ = static_cast<Header*>(a);
+    data_ = static_cast<uint8_t*>(a) + page_size_;
+  }
+
+  ~PageArena() {
+    if (current_arena() == this)
+      set_current(NULL);
+    if (header_)
+      sys_munmap(header_, page_size_ + size_);
+  }
+
+  bool valid() const { return header_ != NULL; }
+
+  // The number of bytes reserved.
+  size_t size() const { return size_; }
+
+  // The bytes in use now.
+  size_t in_use() const {
+    return header_ ? __atomic_load_n(&header_->top, __ATOMIC_RELAXED) : 0;
+  }
+
+  // Frees everything handed out since in_use() returned |in_use|, as when a
+  // process that allocated from the arena has exited.
+  void Rewind(size_t in_use) {
+    if (header_)
+      __atomic_store_n(&header_->top, in_use, __ATOMIC_RELEASE);
+  }
+
+  // The most bytes that have been in use at once.
+  size_t high_water() const {
+    return header_ ? __atomic_load_n(&header_->high_water, __ATOMIC_RELAXED)
+                   : 0;
+  }
+
+  // The bytes PageAllocators asked for while the arena was exhausted, and
+  // mapped instead.
+  size_t overflow_bytes() const {
+    return header_ ? __atomic_load_n(&header_->overflow_bytes,
+                                     __ATOMIC_RELAXED)
+                   : 0;
+  }
+
+  // Returns |bytes|, a multiple of the page size, of zeroed memory, or NULL
+  // if the arena doesn't have that much left.
+  void* Alloc(size_t bytes) {
+    if (!header_)
+      return NULL;
+    size_t top = __atomic_load_n(&header_->top, __ATOMIC_RELAXED);
+    do {
+      if (bytes > size_ - top) {
+        __atomic_fetch_add(&header_->overflow_bytes, bytes, __ATOMIC_RELAXED);
+        return NULL;
+      }
+    } while (!__atomic_compare_exchange_n(&header_->top, &top, top + bytes,
+                                          true, __ATOMIC_ACQ_REL,
+                                          __ATOMIC_RELAXED));
+
+    const size_t end = top + bytes;
+    size_t high_water = __atomic_load_n(&header_->high_water,
+                                        __ATOMIC_RELAXED);
+    const size_t used_end = high_water;
+    while (high_water < end &&
+           !__atomic_compare_exchange_n(&header_->high_water, &high_water, end,
+                                        true, __ATOMIC_RELAXED,
+                                        __ATOMIC_RELAXED)) {
+    }
+    // Memory below the high-water mark may have been used before; clear it
+    // as freshly mapped memory would be.
+    if (top < used_end)
+      memset(data_ + top, 0, (used_end < end ? used_end : end) - top);
+    return data_ + top;
+  }
+
+  // Gives back the |bytes| at |p| returned by Alloc(). They can be reused
+  // only if they are the last bytes handed out.
+  void Release(void* p, size_t bytes) {
+    size_t end = static_cast<uint8_t*>(p) - data_ + bytes;
+    __atomic_compare_exchange_n(&header_->top, &end, end - bytes, false,
+                                __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+  }
+
+  // Returns true if |p| points into the arena.
+  bool Owns(const void* p) const {
+    return p >= data_ && p < data_ + size_;
+  }
+
+  // Returns the arena PageAllocators take pages from, if any.
+  static PageArena* current() { return current_arena(); }
+
+  // Makes |arena| the one PageAllocators take pages from; NULL to stop
+  // using one. It stays current in processes cloned while it is.
+  static void set_current(PageArena* arena) { current_arena() = arena; }
+
+ private:
+  // Kept at the start of the shared mapping.
+  struct Header {
+    size_t top;             // Offset of the first free byte.
+    size_t high_water;      // The most bytes in use at once.
+    size_t overflow_bytes;  // Bytes asked for beyond size_.
+  };
+
+  static PageArena*& current_arena() {
+    static PageArena* arena = NULL;
+    return arena;
+  }
+
+  const size_t page_size_;
+  const size_t size_;
+  Header* header_;
+  uint8_t* data_;
+};
+
+// This is very simple allocator which fetches pages from the kernel directly,
+// or from the current PageArena if there is one. Thus, it can be used even
+// when the heap may be corrupted.
 //
 // There is no free operation. The pages are only freed when the object is
 // destroyed.
@@ -63,7 +209,8 @@ class PageAllocator {
         last_(NULL),
         current_page_(NULL),
         page_offset_(0),
-        pages_allocated_(0) {
+        pages_allocated_(0),
+        arena_(NULL) {
   }
 
   ~PageAllocator() {
@@ -115,10 +262,19 @@ class PageAllocator {
 
  private:
   uint8_t* GetNPages(size_t num_pages) {
-    void* a = sys_mmap(NULL, page_size_ * num_pages, PROT_READ | PROT_WRITE,
-                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-    if (a == MAP_FAILED)
-      return NULL;
+    // Pages are taken from one arena at most, so that FreeAll() knows which
+    // to give them back to.
+    PageArena* arena = PageArena::current();
+    if (arena_ && arena != arena_)
+      arena = NULL;
+    void* a = arena ? arena->Alloc(page_size_ * num_pages) : NULL;
+    if (!a) {
+      arena = NULL;
+      a = sys_mmap(NULL, page_size_ * num_pages, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (a == MAP_FAILED)
+        return NULL;
+    }
 
 #if defined(MEMORY_SANITIZER)
     // We need to indicate to MSan that memory allocated through sys_mmap is
@@ -130,6 +286,8 @@ class PageAllocator {
     header->next = last_;
     header->num_pages = num_pages;
     last_ = header;
+    if (arena)
+      arena_ = arena;
 
     pages_allocated_ += num_pages;
 
@@ -141,7 +299,10 @@ class PageAllocator {
 
     for (PageHeader* cur = last_; cur; cur = next) {
       next = cur->next;
-      sys_munmap(cur, cur->num_pages * page_size_);
+      if (arena_ && arena_->Owns(cur))
+        arena_->Release(cur, cur->num_pages * page_size_);
+      else
+        sys_munmap(cur, cur->num_pages * page_size_);
     }
   }
 
@@ -155,6 +316,8 @@ class PageAllocator {
   uint8_t* current_page_;
   size_t page_offset_;
   unsigned long pages_allocated_;
+  // The arena pages were taken from, if any.
+  PageArena* arena_;
 };
 
 // Wrapper to use with STL containers
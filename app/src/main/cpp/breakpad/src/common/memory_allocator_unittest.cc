@@ -30,6 +30,9 @@
 #include <config.h>  // Must come first
 #endif
 
+#include <sys/wait.h>
+#include <unistd.h>
+
 #include "breakpad_googletest_includes.h"
 #include "common/memory_allocator.h"
 
@@ -69,6 +72,86 @@ TEST(PageAllocatorTest, LargeObject) {
   }
 }
 
+namespace {
+typedef testing::Test PageArenaTest;
+}
+
+TEST(PageArenaTest, AllocatesFromArena) {
+  const size_t page_size = getpagesize();
+  PageArena arena(10 * page_size - 1);
+  ASSERT_TRUE(arena.valid());
+  EXPECT_EQ(10 * page_size, arena.size());
+  EXPECT_EQ(0U, arena.high_water());
+
+  PageArena::set_current(&arena);
+  {
+    PageAllocator allocator;
+    uint8_t* p = reinterpret_cast<uint8_t*>(allocator.Alloc(page_size));
+    ASSERT_FALSE(p == NULL);
+    EXPECT_TRUE(allocator.OwnsPointer(p));
+    EXPECT_EQ(2 * page_size, arena.high_water());
+    memset(p, 0xff, page_size);
+
+    // Pages released last are reused, and cleared first.
+    {
+      PageAllocator inner;
+      wasteful_vector<int> v(&inner, 100);
+      for (int i = 0; i < 3000; ++i)
+        v.push_back(i);
+    }
+    const size_t high_water = arena.high_water();
+    EXPECT_GT(high_water, 2 * page_size);
+    {
+      PageAllocator inner;
+      uint8_t* q = reinterpret_cast<uint8_t*>(inner.Alloc(3 * page_size));
+      ASSERT_FALSE(q == NULL);
+      for (size_t i = 0; i < 3 * page_size; ++i)
+        ASSERT_EQ(0, q[i]);
+    }
+    EXPECT_EQ(high_water, arena.high_water());
+    EXPECT_EQ(0U, arena.overflow_bytes());
+
+    // Once the arena is exhausted, pages are mapped instead.
+    uint8_t* large = reinterpret_cast<uint8_t*>(
+        allocator.Alloc(10 * page_size));
+    ASSERT_FALSE(large == NULL);
+    memset(large, 0, 10 * page_size);
+    EXPECT_EQ(11 * page_size, arena.overflow_bytes());
+  }
+  PageArena::set_current(NULL);
+
+  // Released pages are used again by the next allocator.
+  PageAllocator allocator;
+  PageArena::set_current(&arena);
+  EXPECT_FALSE(allocator.Alloc(1) == NULL);
+  PageArena::set_current(NULL);
+}
+
+TEST(PageArenaTest, SharedWithForkedProcess) {
+  const size_t page_size = getpagesize();
+  PageArena arena(16 * page_size);
+  ASSERT_TRUE(arena.valid());
+
+  PageArena::set_current(&arena);
+  const pid_t child = fork();
+  if (child == 0) {
+    PageAllocator allocator;
+    _exit(allocator.Alloc(5 * page_size) ? 0 : 1);
+  }
+  PageArena::set_current(NULL);
+  ASSERT_NE(-1, child);
+  int status;
+  ASSERT_EQ(child, waitpid(child, &status, 0));
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(0, WEXITSTATUS(status));
+  EXPECT_EQ(6 * page_size, arena.high_water());
+
+  // The child's pages are still taken until they are freed.
+  EXPECT_EQ(6 * page_size, arena.in_use());
+  arena.Rewind(0);
+  EXPECT_EQ(0U, arena.in_use());
+}
+
 namespace {
 typedef testing::Test WastefulVectorTest;
 }
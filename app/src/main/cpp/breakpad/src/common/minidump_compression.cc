@@ -0,0 +1,321 @@
+// Copyright 2024 Google LLC
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google LLC nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// minidump_compression.cc: See minidump_compression.h for documentation.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>  // Must come first
+#endif
+
+#include "common/minidump_compression.h"
+
+#include <string.h>
+
+namespace google_breakpad {
+
+namespace {
+
+// The LZ4 block format requires the last match to start at least this many
+// bytes before the end of the block...
+const size_t kMatchStartLimit = 12;
+// ...and the last this many bytes to be literals.
+const size_t kLastLiterals = 5;
+
+const size_t kMinMatch = 4;
+const size_t kMaxOffset = 65535;
+const int kHashBits = 12;
+
+// After this many positions without a match, CompressBlock() starts
+// skipping ahead, further the longer it goes without one, so data that
+// doesn't compress costs little time.
+const int kSkipTrigger = 6;
+
+inline uint32_t Read32(const uint8_t* p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+inline size_t Hash(uint32_t sequence) {
+  return (sequence * 2654435761U) >> (32 - kHashBits);
+}
+
+// Appends the length |length| - 15 in the LZ4 continuation encoding.
+inline uint8_t* WriteLengthExtension(uint8_t* out, size_t length) {
+  for (; length >= 255; length -= 255)
+    *out++ = 255;
+  *out++ = static_cast<uint8_t>(length);
+  return out;
+}
+
+// Appends a sequence of the literals [literals, literals + literal_count)
+// followed, unless |match_length| is zero, by a match |offset| bytes back.
+uint8_t* WriteSequence(uint8_t* out, const uint8_t* literals,
+                       size_t literal_count, size_t offset,
+                       size_t match_length) {
+  uint8_t* token = out++;
+  if (literal_count >= 15) {
+    *token = 15 << 4;
+    out = WriteLengthExtension(out, literal_count - 15);
+  } else {
+    *token = static_cast<uint8_t>(literal_count << 4);
+  }
+  memcpy(out, literals, literal_count);
+  out += literal_count;
+  if (!match_length)
+    return out;
+
+  *out++ = static_cast<uint8_t>(offset);
+  *out++ = static_cast<uint8_t>(offset >> 8);
+  const size_t length = match_length - kMinMatch;
+  if (length >= 15) {
+    *token |= 15;
+    out = WriteLengthExtension(out, length - 15);
+  } else {
+    *token |= static_cast<uint8_t>(length);
+  }
+  return out;
+}
+
+// Reads an LZ4 length continuation from [*in, end) onto |length|.
+inline bool ReadLengthExtension(const uint8_t** in, const uint8_t* end,
+                                size_t* length) {
+  uint8_t byte;
+  do {
+    if (*in == end)
+      return false;
+    byte = *(*in)++;
+    *length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+inline uint32_t Swap32(uint32_t value) {
+  return (value >> 24) | ((value >> 8) & 0xff00) |
+         ((value << 8) & 0xff0000) | (value << 24);
+}
+
+// Reads the record at *|in| into |record|, byte-swapping it if |swap|, and
+// points |payload| at its payload.  Returns false, leaving *|in| alone, if
+// the record or its payload runs past |end|.
+bool ReadRecord(const uint8_t** in, const uint8_t* end, bool swap,
+                CompressedMinidumpRecord* record, const uint8_t** payload) {
+  if (static_cast<size_t>(end - *in) < sizeof(*record))
+    return false;
+  memcpy(record, *in, sizeof(*record));
+  if (swap) {
+    record->rva = Swap32(record->rva);
+    record->data_size = Swap32(record->data_size);
+    record->payload_size = Swap32(record->payload_size);
+    record->encoding = Swap32(record->encoding);
+  }
+  const uint8_t* record_payload = *in + sizeof(*record);
+  if (record->payload_size > static_cast<size_t>(end - record_payload))
+    return false;
+  *payload = record_payload;
+  *in = record_payload + record->payload_size;
+  return true;
+}
+
+}  // namespace
+
+size_t CompressBlock(const uint8_t* src, size_t size, uint8_t* dest,
+                     uint16_t* table) {
+  const uint8_t* const end = src + size;
+  const uint8_t* anchor = src;
+  uint8_t* out = dest;
+
+  if (size > kMatchStartLimit) {
+    memset(table, 0, kCompressBlockTableSize * sizeof(*table));
+    const uint8_t* const match_start_limit = end - kMatchStartLimit;
+    const uint8_t* const match_end_limit = end - kLastLiterals;
+    const uint8_t* in = src + 1;
+    unsigned misses = 0;
+    while (in <= match_start_limit) {
+      const uint32_t sequence = Read32(in);
+      const size_t hash = Hash(sequence);
+      const uint8_t* candidate = src + table[hash];
+      table[hash] = static_cast<uint16_t>(in - src);
+      if (candidate >= in ||
+          static_cast<size_t>(in - candidate) > kMaxOffset ||
+          Read32(candidate) != sequence) {
+        in += 1 + (misses++ >> kSkipTrigger);
+        continue;
+      }
+      misses = 0;
+
+      const uint8_t* match_end = in + kMinMatch;
+      const uint8_t* reference = candidate + kMinMatch;
+      while (match_end < match_end_limit && *match_end == *reference) {
+        ++match_end;
+        ++reference;
+      }
+      out = WriteSequence(out, anchor, in - anchor, in - candidate,
+                          match_end - in);
+      in = anchor = match_end;
+      if (in <= match_start_limit)
+        table[Hash(Read32(in - 2))] = static_cast<uint16_t>(in - 2 - src);
+    }
+  }
+
+  return WriteSequence(out, anchor, end - anchor, 0, 0) - dest;
+}
+
+bool DecompressBlock(const uint8_t* src, size_t src_size,
+                     uint8_t* dest, size_t dest_size) {
+  const uint8_t* in = src;
+  const uint8_t* const in_end = src + src_size;
+  uint8_t* out = dest;
+  uint8_t* const out_end = dest + dest_size;
+
+  while (in < in_end) {
+    const uint8_t token = *in++;
+    size_t literal_count = token >> 4;
+    if (literal_count == 15 &&
+        !ReadLengthExtension(&in, in_end, &literal_count)) {
+      return false;
+    }
+    if (literal_count > static_cast<size_t>(in_end - in) ||
+        literal_count > static_cast<size_t>(out_end - out)) {
+      return false;
+    }
+    memcpy(out, in, literal_count);
+    in += literal_count;
+    out += literal_count;
+    if (in == in_end)
+      break;
+
+    if (in_end - in < 2)
+      return false;
+    const size_t offset = in[0] | (in[1] << 8);
+    in += 2;
+    if (offset == 0 || offset > static_cast<size_t>(out - dest))
+      return false;
+    size_t match_length = token & 15;
+    if (match_length == 15 &&
+        !ReadLengthExtension(&in, in_end, &match_length)) {
+      return false;
+    }
+    match_length += kMinMatch;
+    if (match_length > static_cast<size_t>(out_end - out))
+      return false;
+    // The match may overlap the bytes it produces, so copy byte by byte.
+    const uint8_t* reference = out - offset;
+    for (size_t i = 0; i < match_length; ++i)
+      out[i] = reference[i];
+    out += match_length;
+  }
+
+  return out == out_end;
+}
+
+bool IsCompressedMinidump(uint32_t signature) {
+  return signature == kCompressedMinidumpSignature ||
+         signature == Swap32(kCompressedMinidumpSignature);
+}
+
+bool DecompressMinidump(const uint8_t* data, size_t size, size_t max_size,
+                        std::vector<uint8_t>* minidump) {
+  CompressedMinidumpHeader header;
+  if (size < sizeof(header))
+    return false;
+  memcpy(&header, data, sizeof(header));
+  if (!IsCompressedMinidump(header.signature))
+    return false;
+  const bool swap = header.signature != kCompressedMinidumpSignature;
+  if (swap)
+    header.version = Swap32(header.version);
+  if (header.version != kCompressedMinidumpVersion)
+    return false;
+
+  // Size the minidump before filling it in, so that it is allocated once.
+  // Only complete records count; anything after the first incomplete one
+  // was cut off.
+  const uint8_t* const records = data + sizeof(header);
+  const uint8_t* const end = data + size;
+  const uint8_t* records_end = records;
+  uint64_t data_end = 0;
+  bool has_final_record = false;
+  CompressedMinidumpRecord record;
+  const uint8_t* payload;
+  for (const uint8_t* in = records;
+       ReadRecord(&in, end, swap, &record, &payload);) {
+    records_end = in;
+    if (record.data_size == 0) {
+      if (record.payload_size != 0)
+        return false;
+      has_final_record = true;
+      break;
+    }
+    if (record.data_size > kCompressedMinidumpMaxBlock)
+      return false;
+    const uint64_t record_end =
+        static_cast<uint64_t>(record.rva) + record.data_size;
+    if (record_end > data_end)
+      data_end = record_end;
+  }
+
+  uint64_t minidump_size = data_end;
+  if (has_final_record) {
+    // The final record must cover everything written before it.
+    if (record.rva < data_end)
+      return false;
+    minidump_size = record.rva;
+  }
+  if (minidump_size == 0 || minidump_size > UINT32_MAX ||
+      minidump_size > max_size) {
+    return false;
+  }
+
+  minidump->assign(minidump_size, 0);
+  for (const uint8_t* in = records; in < records_end;) {
+    ReadRecord(&in, end, swap, &record, &payload);
+    if (record.data_size == 0)
+      break;
+
+    uint8_t* dest = &(*minidump)[record.rva];
+    switch (record.encoding) {
+      case kCompressedMinidumpStored:
+        if (record.payload_size != record.data_size)
+          return false;
+        memcpy(dest, payload, record.data_size);
+        break;
+      case kCompressedMinidumpLZ4:
+        if (!DecompressBlock(payload, record.payload_size, dest,
+                             record.data_size)) {
+          return false;
+        }
+        break;
+      default:
+        return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace google_breakpad
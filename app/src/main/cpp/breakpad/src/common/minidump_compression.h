@@ -0,0 +1,131 @@
+// Copyright 2024 Google LLC
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google LLC nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// minidump_compression.h: The compressed minidump container.
+//
+// A compressed minidump is written as a log of the writes that produced
+// the minidump, so that it can be generated in one pass from a crashing
+// process without holding the minidump in memory or rewriting what has
+// already been written.  It starts with a CompressedMinidumpHeader, which
+// is followed by records, each a CompressedMinidumpRecord and its payload.
+// Applying the records in order to a zero-filled buffer reproduces the
+// minidump; a later record may overwrite part of an earlier one, as when a
+// stream directory entry is filled in after its stream.  The final record
+// carries no data and gives the size of the minidump.  A container cut
+// short, say by a crash while it was being written, still holds every
+// complete record before the cut.
+//
+// Payloads are either stored as is or compressed with a byte-oriented
+// LZ77 coder laid out as an LZ4 block, so they can be decoded by other
+// tools too.  Compressing needs no allocation beyond the caller's buffers,
+// so it can be done from a compromised context.
+//
+// Containers are written in the byte order of the machine that produced
+// them.
+
+#ifndef COMMON_MINIDUMP_COMPRESSION_H_
+#define COMMON_MINIDUMP_COMPRESSION_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+namespace google_breakpad {
+
+// "MDCZ" read as a little-endian integer.  It can't be mistaken for
+// MD_HEADER_SIGNATURE, which also starts every minidump.
+const uint32_t kCompressedMinidumpSignature = 0x5a43444d;
+const uint32_t kCompressedMinidumpVersion = 1;
+
+struct CompressedMinidumpHeader {
+  uint32_t signature;  // kCompressedMinidumpSignature
+  uint32_t version;    // kCompressedMinidumpVersion
+};
+
+enum CompressedMinidumpEncoding {
+  kCompressedMinidumpStored = 0,  // The payload is the data itself.
+  kCompressedMinidumpLZ4 = 1      // The payload is an LZ4 block.
+};
+
+struct CompressedMinidumpRecord {
+  // Offset of the data in the minidump, or for the final record, the size
+  // of the minidump.
+  uint32_t rva;
+  // Size of the data, no more than kCompressedMinidumpMaxBlock.  Zero for
+  // the final record.
+  uint32_t data_size;
+  // Size of the payload following this record.
+  uint32_t payload_size;
+  // A CompressedMinidumpEncoding.
+  uint32_t encoding;
+};
+
+// The largest amount of data a single record may carry.  Matches within a
+// block are at most 65535 bytes back, so every position in a block can be
+// kept in a uint16_t.
+const size_t kCompressedMinidumpMaxBlock = 65536;
+
+// Number of uint16_t entries in the table CompressBlock() needs.
+const size_t kCompressBlockTableSize = 4096;
+
+// Returns the most bytes CompressBlock() may produce for |size| bytes of
+// input.
+inline size_t CompressBlockBound(size_t size) {
+  return size + size / 255 + 16;
+}
+
+// Compresses the |size| bytes at |src|, at most kCompressedMinidumpMaxBlock
+// of them, into |dest|, which must have room for CompressBlockBound(size)
+// bytes.  |table| is scratch space of kCompressBlockTableSize entries.
+// Returns the size of the compressed data.  Safe to call from a compromised
+// context.
+size_t CompressBlock(const uint8_t* src, size_t size, uint8_t* dest,
+                     uint16_t* table);
+
+// Decompresses the |src_size| bytes of an LZ4 block at |src| into the
+// |dest_size| bytes at |dest|.  Returns false unless the block is well
+// formed and decompresses to exactly |dest_size| bytes.
+bool DecompressBlock(const uint8_t* src, size_t src_size,
+                     uint8_t* dest, size_t dest_size);
+
+// Returns true if |signature|, the first four bytes of a file, marks a
+// compressed minidump in either byte order.
+bool IsCompressedMinidump(uint32_t signature);
+
+// Reproduces the minidump held by the |size| bytes of container at |data|
+// into |minidump|.  Returns false if the container is malformed; a
+// container cut short after its header is not.  The minidump's size comes
+// from the container, so a container that would decompress to more than
+// |max_size| bytes is rejected before anything is allocated for it.
+bool DecompressMinidump(const uint8_t* data, size_t size, size_t max_size,
+                        std::vector<uint8_t>* minidump);
+
+}  // namespace google_breakpad
+
+#endif  // COMMON_MINIDUMP_COMPRESSION_H_
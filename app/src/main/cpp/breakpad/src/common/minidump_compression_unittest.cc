@@ -0,0 +1,341 @@
+// Copyright 2024 Google LLC
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google LLC nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// minidump_compression_unittest.cc: Unit tests for the compressed minidump
+// container and its block coder.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>  // Must come first
+#endif
+
+#include <string.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "breakpad_googletest_includes.h"
+#include "common/minidump_compression.h"
+
+namespace {
+
+using google_breakpad::CompressBlock;
+using google_breakpad::CompressBlockBound;
+using google_breakpad::CompressedMinidumpHeader;
+using google_breakpad::CompressedMinidumpRecord;
+using google_breakpad::DecompressBlock;
+using google_breakpad::DecompressMinidump;
+using google_breakpad::IsCompressedMinidump;
+using google_breakpad::kCompressBlockTableSize;
+using google_breakpad::kCompressedMinidumpLZ4;
+using google_breakpad::kCompressedMinidumpMaxBlock;
+using google_breakpad::kCompressedMinidumpSignature;
+using google_breakpad::kCompressedMinidumpStored;
+using google_breakpad::kCompressedMinidumpVersion;
+using std::vector;
+
+// Larger than any minidump the tests decompress.
+const size_t kMaxMinidumpSize = 1 << 20;
+
+// Compresses |data| and checks that it decompresses to the same bytes.
+// Returns the compressed size.
+size_t RoundTrip(const vector<uint8_t>& data) {
+  vector<uint16_t> table(kCompressBlockTableSize);
+  vector<uint8_t> compressed(CompressBlockBound(data.size()));
+  size_t size = CompressBlock(data.data(), data.size(), compressed.data(),
+                              table.data());
+  EXPECT_LE(size, compressed.size());
+  vector<uint8_t> decompressed(data.size());
+  EXPECT_TRUE(DecompressBlock(compressed.data(), size, decompressed.data(),
+                              decompressed.size()));
+  EXPECT_EQ(data, decompressed);
+  return size;
+}
+
+// Stack-like data: words that are mostly zero or pointers into a few
+// mappings.
+vector<uint8_t> StackLikeData(size_t size, uint32_t seed) {
+  std::mt19937 engine(seed);
+  vector<uint8_t> data(size);
+  for (size_t i = 0; i + 8 <= size; i += 8) {
+    uint64_t word = 0;
+    switch (engine() % 4) {
+      case 0:
+        word = 0x7f0000000000ULL + (engine() % 4) * 0x1000000 +
+               (engine() & 0xffff);
+        break;
+      case 1:
+        word = engine() & 0xff;
+        break;
+      case 2:
+        word = (static_cast<uint64_t>(engine()) << 32) | engine();
+        break;
+    }
+    memcpy(&data[i], &word, sizeof(word));
+  }
+  return data;
+}
+
+class Container {
+ public:
+  Container() {
+    CompressedMinidumpHeader header = { kCompressedMinidumpSignature,
+                                        kCompressedMinidumpVersion };
+    Append(&header, sizeof(header));
+  }
+
+  void AddStored(uint32_t rva, const vector<uint8_t>& data) {
+    CompressedMinidumpRecord record = {
+      rva, static_cast<uint32_t>(data.size()),
+      static_cast<uint32_t>(data.size()), kCompressedMinidumpStored
+    };
+    Append(&record, sizeof(record));
+    Append(data.data(), data.size());
+  }
+
+  void AddCompressed(uint32_t rva, const vector<uint8_t>& data) {
+    vector<uint16_t> table(kCompressBlockTableSize);
+    vector<uint8_t> compressed(CompressBlockBound(data.size()));
+    compressed.resize(CompressBlock(data.data(), data.size(),
+                                    compressed.data(), table.data()));
+    CompressedMinidumpRecord record = {
+      rva, static_cast<uint32_t>(data.size()),
+      static_cast<uint32_t>(compressed.size()), kCompressedMinidumpLZ4
+    };
+    Append(&record, sizeof(record));
+    Append(compressed.data(), compressed.size());
+  }
+
+  void AddFinal(uint32_t size) {
+    CompressedMinidumpRecord record = { size, 0, 0, kCompressedMinidumpStored };
+    Append(&record, sizeof(record));
+  }
+
+  vector<uint8_t>& bytes() { return bytes_; }
+
+ private:
+  void Append(const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    bytes_.insert(bytes_.end(), bytes, bytes + size);
+  }
+
+  vector<uint8_t> bytes_;
+};
+
+TEST(CompressBlockTest, Empty) {
+  EXPECT_EQ(1U, RoundTrip(vector<uint8_t>()));
+}
+
+TEST(CompressBlockTest, Short) {
+  for (size_t size = 1; size < 40; ++size) {
+    vector<uint8_t> data(size, 'a');
+    RoundTrip(data);
+  }
+}
+
+TEST(CompressBlockTest, Zeros) {
+  vector<uint8_t> data(kCompressedMinidumpMaxBlock);
+  EXPECT_LT(RoundTrip(data), 300U);
+}
+
+TEST(CompressBlockTest, Random) {
+  std::mt19937 engine(1);
+  vector<uint8_t> data(kCompressedMinidumpMaxBlock);
+  for (uint8_t& byte : data)
+    byte = static_cast<uint8_t>(engine());
+  EXPECT_LE(RoundTrip(data), CompressBlockBound(data.size()));
+}
+
+TEST(CompressBlockTest, StackLike) {
+  for (uint32_t seed = 1; seed < 20; ++seed) {
+    vector<uint8_t> data = StackLikeData(
+        1 + seed * 3331 % kCompressedMinidumpMaxBlock, seed);
+    EXPECT_LT(RoundTrip(data), data.size());
+  }
+}
+
+TEST(CompressBlockTest, RejectsCorruptBlocks) {
+  vector<uint8_t> data = StackLikeData(8192, 7);
+  vector<uint16_t> table(kCompressBlockTableSize);
+  vector<uint8_t> compressed(CompressBlockBound(data.size()));
+  compressed.resize(CompressBlock(data.data(), data.size(), compressed.data(),
+                                  table.data()));
+  vector<uint8_t> out(data.size());
+
+  // Wrong sizes either way.
+  EXPECT_FALSE(DecompressBlock(compressed.data(), compressed.size(),
+                               out.data(), out.size() - 1));
+  out.resize(data.size() + 1);
+  EXPECT_FALSE(DecompressBlock(compressed.data(), compressed.size(),
+                               out.data(), out.size()));
+  out.resize(data.size());
+  EXPECT_FALSE(DecompressBlock(compressed.data(), compressed.size() / 2,
+                               out.data(), out.size()));
+
+  // A match reaching back before the start of the output.
+  const uint8_t bad_offset[] = { 0x10, 'a', 0x05, 0x00, 0x00 };
+  EXPECT_FALSE(DecompressBlock(bad_offset, sizeof(bad_offset), out.data(),
+                               out.size()));
+
+  // Arbitrary damage must never write out of bounds.
+  std::mt19937 engine(3);
+  for (int i = 0; i < 1000; ++i) {
+    vector<uint8_t> damaged = compressed;
+    damaged[engine() % damaged.size()] ^= 1 << (engine() % 8);
+    DecompressBlock(damaged.data(), damaged.size(), out.data(), out.size());
+  }
+}
+
+TEST(DecompressMinidumpTest, AppliesRecordsInOrder) {
+  vector<uint8_t> first = StackLikeData(70000, 1);
+  first.resize(kCompressedMinidumpMaxBlock);
+  vector<uint8_t> patch(40, 0xab);
+
+  Container container;
+  container.AddCompressed(0, first);
+  container.AddStored(100, patch);
+  container.AddCompressed(kCompressedMinidumpMaxBlock + 8, patch);
+  container.AddFinal(kCompressedMinidumpMaxBlock + 4096);
+
+  vector<uint8_t> expected(kCompressedMinidumpMaxBlock + 4096);
+  memcpy(&expected[0], first.data(), first.size());
+  memcpy(&expected[100], patch.data(), patch.size());
+  memcpy(&expected[kCompressedMinidumpMaxBlock + 8], patch.data(),
+         patch.size());
+
+  vector<uint8_t> minidump;
+  ASSERT_TRUE(DecompressMinidump(container.bytes().data(),
+                                 container.bytes().size(), kMaxMinidumpSize, &minidump));
+  EXPECT_EQ(expected, minidump);
+}
+
+TEST(DecompressMinidumpTest, Truncated) {
+  vector<uint8_t> data(1000, 1);
+  Container container;
+  container.AddStored(0, data);
+  container.AddStored(2000, data);
+  container.AddFinal(4000);
+
+  // Cut in the second record: only the first survives.
+  vector<uint8_t> minidump;
+  ASSERT_TRUE(DecompressMinidump(container.bytes().data(),
+                                 sizeof(CompressedMinidumpHeader) +
+                                     sizeof(CompressedMinidumpRecord) + 1500,
+                                 kMaxMinidumpSize, &minidump));
+  EXPECT_EQ(data, minidump);
+
+  // Nothing but the header is not a minidump.
+  EXPECT_FALSE(DecompressMinidump(container.bytes().data(),
+                                  sizeof(CompressedMinidumpHeader),
+                                  kMaxMinidumpSize, &minidump));
+}
+
+TEST(DecompressMinidumpTest, RejectsMalformed) {
+  vector<uint8_t> data(1000, 1);
+  vector<uint8_t> minidump;
+
+  // A final record smaller than the data before it.
+  {
+    Container container;
+    container.AddStored(500, data);
+    container.AddFinal(1000);
+    EXPECT_FALSE(DecompressMinidump(container.bytes().data(),
+                                    container.bytes().size(), kMaxMinidumpSize, &minidump));
+  }
+
+  // A stored payload of the wrong size.
+  {
+    Container container;
+    container.AddStored(0, data);
+    container.bytes()[sizeof(CompressedMinidumpHeader) + 4] = 0xff;
+    EXPECT_FALSE(DecompressMinidump(container.bytes().data(),
+                                    container.bytes().size(), kMaxMinidumpSize, &minidump));
+  }
+
+  // An unknown version.
+  {
+    Container container;
+    container.AddStored(0, data);
+    container.bytes()[4] = 2;
+    EXPECT_FALSE(DecompressMinidump(container.bytes().data(),
+                                    container.bytes().size(), kMaxMinidumpSize, &minidump));
+  }
+}
+
+TEST(DecompressMinidumpTest, RejectsOversized) {
+  // A few bytes of container claiming a 4 GiB minidump must be rejected
+  // before the minidump is allocated.
+  Container container;
+  container.AddFinal(0xfffffff0);
+  vector<uint8_t> minidump;
+  EXPECT_FALSE(DecompressMinidump(container.bytes().data(),
+                                  container.bytes().size(), kMaxMinidumpSize,
+                                  &minidump));
+  EXPECT_TRUE(minidump.empty());
+
+  // Likewise for data placed far into the minidump.
+  vector<uint8_t> data(16, 1);
+  Container far_data;
+  far_data.AddStored(0xfff00000, data);
+  EXPECT_FALSE(DecompressMinidump(far_data.bytes().data(),
+                                  far_data.bytes().size(), kMaxMinidumpSize,
+                                  &minidump));
+  EXPECT_TRUE(minidump.empty());
+
+  // The limit itself is allowed.
+  Container at_limit;
+  at_limit.AddStored(kMaxMinidumpSize - data.size(), data);
+  EXPECT_TRUE(DecompressMinidump(at_limit.bytes().data(),
+                                 at_limit.bytes().size(), kMaxMinidumpSize,
+                                 &minidump));
+  EXPECT_EQ(kMaxMinidumpSize, minidump.size());
+}
+
+TEST(DecompressMinidumpTest, ByteSwapped) {
+  vector<uint8_t> data(16, 7);
+  Container container;
+  container.AddStored(8, data);
+  container.AddFinal(32);
+  // Swap every 32-bit field of the header and records.
+  vector<uint8_t>& bytes = container.bytes();
+  const size_t fields[] = { 0, 4, 8, 12, 16, 20, 40, 44, 48, 52 };
+  for (size_t field : fields)
+    std::reverse(bytes.begin() + field, bytes.begin() + field + 4);
+
+  uint32_t signature;
+  memcpy(&signature, bytes.data(), sizeof(signature));
+  EXPECT_TRUE(IsCompressedMinidump(signature));
+
+  vector<uint8_t> minidump;
+  ASSERT_TRUE(DecompressMinidump(bytes.data(), bytes.size(), kMaxMinidumpSize, &minidump));
+  vector<uint8_t> expected(32);
+  memcpy(&expected[8], data.data(), data.size());
+  EXPECT_EQ(expected, minidump);
+}
+
+}  // namespace
@@ -101,6 +101,14 @@ void Module::InlineOriginMap::SetReference(uint64_t offset,
   references_[offset] = specification_offset;
 }
 
+void Module::InlineOriginMap::Absorb(InlineOriginMap* other) {
+  inline_origins_.insert(other->inline_origins_.begin(),
+                         other->inline_origins_.end());
+  other->inline_origins_.clear();
+  references_.insert(other->references_.begin(), other->references_.end());
+  other->references_.clear();
+}
+
 Module::Module(const string& name,
                const string& os,
                const string& architecture,
@@ -244,6 +252,17 @@ void Module::GetExterns(vector<Extern*>* vec,
   }
 }
 
+void Module::AbsorbStringPool(Module* other) {
+  // merge() relinks the nodes rather than copying them, so the addresses
+  // of the merged strings do not change. Whatever is left over duplicates a
+  // string we already have, and must be kept alive alongside the pool.
+  common_strings_.merge(other->common_strings_);
+  if (!other->common_strings_.empty()) {
+    absorbed_strings_.push_back(unordered_set<string>());
+    absorbed_strings_.back().swap(other->common_strings_);
+  }
+}
+
 Module::File* Module::FindFile(const string& name) {
   // A tricky bit here.  The key of each map entry needs to be a
   // pointer to the entry's File's name string.  This means that we
@@ -40,6 +40,7 @@
 #include <functional>
 #include <iostream>
 #include <limits>
+#include <list>
 #include <map>
 #include <memory>
 #include <set>
@@ -208,6 +209,10 @@ class Module {
     // DW_AT_specification doesn't exist in that DIE.
     void SetReference(uint64_t offset, uint64_t specification_offset);
 
+    // Move all of OTHER's origins and references into this map. The two
+    // maps must not share any offsets.
+    void Absorb(InlineOriginMap* other);
+
     ~InlineOriginMap() {
       for (const auto& iter : inline_origins_) {
         delete iter.second;
@@ -431,6 +436,10 @@ class Module {
     return *(result.first);
   }
 
+  // Take ownership of the strings in OTHER's pool, so that StringViews
+  // pointing into it remain valid for as long as this module lives.
+  void AbsorbStringPool(Module* other);
+
   string name() const { return name_; }
   string os() const { return os_; }
   string architecture() const { return architecture_; }
@@ -497,6 +506,10 @@ class Module {
 
   unordered_set<string> common_strings_;
 
+  // Strings absorbed from other modules' pools that duplicate an entry in
+  // common_strings_, but are still referred to by StringViews.
+  std::list<unordered_set<string>> absorbed_strings_;
+
   // Whether symbols sharing an address should be collapsed into a single entry
   // and marked with an `m` in the output. See
   // https://bugs.chromium.org/p/google-breakpad/issues/detail?id=751 and docs
@@ -1014,13 +1014,41 @@ typedef struct {
   uint32_t requesting_thread_id;
 } MDRawBreakpadInfo;
 
+/* A longer form of MDRawBreakpadInfo, with the same leading fields, written
+ * by producers that have more to record.  Readers tell the two apart by the
+ * size of the stream, so producers that don't set any of the added fields
+ * should keep writing MDRawBreakpadInfo for the benefit of older readers. */
+typedef struct {
+  uint32_t validity;
+  uint32_t dump_thread_id;
+  uint32_t requesting_thread_id;
+
+  /* How long, in microseconds, the threads of the process were kept
+   * suspended while the minidump was produced.  Saturates at UINT32_MAX. */
+  uint32_t pause_duration_us;
+
+  /* The most bytes of the memory reserved ahead of time for producing the
+   * minidump that were in use at once, and the bytes that had to be
+   * allocated elsewhere once it was exhausted.  Both saturate at
+   * UINT32_MAX. */
+  uint32_t crash_arena_high_water;
+  uint32_t crash_arena_overflow_bytes;
+} MDRawBreakpadInfo2;
+
 /* For (MDRawBreakpadInfo).validity: */
 typedef enum {
   /* When set, the dump_thread_id field is valid. */
   MD_BREAKPAD_INFO_VALID_DUMP_THREAD_ID       = 1 << 0,
 
   /* When set, the requesting_thread_id field is valid. */
-  MD_BREAKPAD_INFO_VALID_REQUESTING_THREAD_ID = 1 << 1
+  MD_BREAKPAD_INFO_VALID_REQUESTING_THREAD_ID = 1 << 1,
+
+  /* When set, the pause_duration_us field of MDRawBreakpadInfo2 is valid. */
+  MD_BREAKPAD_INFO_VALID_PAUSE_DURATION       = 1 << 2,
+
+  /* When set, the crash_arena_high_water and crash_arena_overflow_bytes
+   * fields of MDRawBreakpadInfo2 are valid. */
+  MD_BREAKPAD_INFO_VALID_CRASH_ARENA          = 1 << 3
 } MDBreakpadInfoValidity;
 
 typedef struct {
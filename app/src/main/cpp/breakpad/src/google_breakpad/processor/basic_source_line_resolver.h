@@ -53,6 +53,11 @@ class BasicSourceLineResolver : public SourceLineResolverBase {
   BasicSourceLineResolver();
   virtual ~BasicSourceLineResolver() { }
 
+  // Sets the number of threads used to parse each large symbol file.  The
+  // default is 1; 0 means one per hardware thread.  Only affects modules
+  // loaded afterwards.
+  void set_parse_thread_count(int thread_count);
+
   using SourceLineResolverBase::LoadModule;
   using SourceLineResolverBase::LoadModuleUsingMapBuffer;
   using SourceLineResolverBase::LoadModuleUsingMemoryBuffer;
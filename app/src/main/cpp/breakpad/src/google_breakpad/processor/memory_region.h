@@ -37,6 +37,7 @@
 #ifndef GOOGLE_BREAKPAD_PROCESSOR_MEMORY_REGION_H__
 #define GOOGLE_BREAKPAD_PROCESSOR_MEMORY_REGION_H__
 
+#include <stddef.h>
 
 #include "google_breakpad/common/breakpad_types.h"
 
@@ -67,6 +68,12 @@ class MemoryRegion {
   virtual bool GetMemoryAtAddress(uint64_t address, uint32_t* value) const = 0;
   virtual bool GetMemoryAtAddress(uint64_t address, uint64_t* value) const = 0;
 
+  // Returns a pointer to the region's GetSize() bytes of contents, in the
+  // byte order of the running program, or NULL if the region can't
+  // provide them in one piece.  Callers reading many values at once, such
+  // as stack scanning, use this to avoid a call per value.
+  virtual const uint8_t* GetContiguousMemory() const { return NULL; }
+
   // Print a human-readable representation of the object to stdout.
   virtual void Print() const = 0;
 };
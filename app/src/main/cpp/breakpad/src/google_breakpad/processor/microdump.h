@@ -84,6 +84,7 @@ class MicrodumpMemoryRegion : public MemoryRegion {
   // instance of this class in a test fixture class, individual tests
   // can use this to provide the region's contents.
   void Init(uint64_t base_address, const std::vector<uint8_t>& contents);
+  void Init(uint64_t base_address, std::vector<uint8_t>&& contents);
 
   virtual uint64_t GetBase() const;
   virtual uint32_t GetSize() const;
@@ -93,6 +94,10 @@ class MicrodumpMemoryRegion : public MemoryRegion {
   virtual bool GetMemoryAtAddress(uint64_t address, uint32_t* value) const;
   virtual bool GetMemoryAtAddress(uint64_t address, uint64_t* value) const;
 
+  // Microdumps are little-endian, so this returns NULL on big-endian
+  // hosts.
+  virtual const uint8_t* GetContiguousMemory() const;
+
   // Print a human-readable representation of the object to stdout.
   virtual void Print() const;
 
@@ -111,6 +116,13 @@ class MicrodumpMemoryRegion : public MemoryRegion {
 class Microdump {
  public:
   explicit Microdump(const string& contents);
+
+  // Reads the first microdump in the |length| bytes at |data|, which can be
+  // a whole log file mapped into memory and need not be null-terminated.
+  // Lines outside of the microdump are skipped. If |end_offset| is not
+  // NULL, it is set to the offset of the line after the microdump's end
+  // marker (or to |length|), from which a log's next microdump can be read.
+  Microdump(const char* data, size_t length, size_t* end_offset);
   virtual ~Microdump() {}
 
   DumpContext* GetContext() { return context_.get(); }
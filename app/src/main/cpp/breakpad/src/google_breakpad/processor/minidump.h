@@ -214,7 +214,9 @@ class MinidumpMemoryRegion : public MinidumpObject,
 
   // Returns a pointer to the base of the memory region.  Returns the
   // cached value if available, otherwise, reads the minidump file and
-  // caches the memory region.
+  // caches the memory region.  If the minidump file is memory-mapped, the
+  // region is not copied: this points into the mapping, and the region is
+  // not limited to max_bytes().
   const uint8_t* GetMemory() const;
 
   // The address of the base of the memory region.
@@ -232,6 +234,9 @@ class MinidumpMemoryRegion : public MinidumpObject,
   bool GetMemoryAtAddress(uint64_t address, uint32_t* value) const override;
   bool GetMemoryAtAddress(uint64_t address, uint64_t* value) const override;
 
+  // Returns GetMemory(), unless the minidump needs byte-swapping.
+  const uint8_t* GetContiguousMemory() const override;
+
   // Print a human-readable representation of the object to stdout.
   void Print() const override;
   void SetPrintMode(bool hexdump, unsigned int width);
@@ -1004,6 +1009,18 @@ class MinidumpBreakpadInfo : public MinidumpStream {
   bool GetDumpThreadID(uint32_t* thread_id) const;
   bool GetRequestingThreadID(uint32_t* thread_id) const;
 
+  // Sets |pause_duration_us| to how long, in microseconds, the process was
+  // kept suspended while the minidump was produced.  Returns false if the
+  // stream doesn't record it, as only the MDRawBreakpadInfo2 form can.
+  bool GetPauseDuration(uint32_t* pause_duration_us) const;
+
+  // Sets |high_water| and |overflow_bytes| to how much of the memory
+  // reserved for producing the minidump was used at most, and how much had
+  // to be allocated elsewhere.  Returns false if the stream doesn't record
+  // them, as only the MDRawBreakpadInfo2 form can.
+  bool GetCrashArenaUsage(uint32_t* high_water,
+                          uint32_t* overflow_bytes) const;
+
   // Print a human-readable representation of the object to stdout.
   void Print();
 
@@ -1017,6 +1034,16 @@ class MinidumpBreakpadInfo : public MinidumpStream {
   bool Read(uint32_t expected_size_) override;
 
   MDRawBreakpadInfo breakpad_info_;
+
+  // MDRawBreakpadInfo2::pause_duration_us, valid if breakpad_info_.validity
+  // has MD_BREAKPAD_INFO_VALID_PAUSE_DURATION.
+  uint32_t pause_duration_us_;
+
+  // MDRawBreakpadInfo2::crash_arena_high_water and
+  // crash_arena_overflow_bytes, valid if breakpad_info_.validity has
+  // MD_BREAKPAD_INFO_VALID_CRASH_ARENA.
+  uint32_t crash_arena_high_water_;
+  uint32_t crash_arena_overflow_bytes_;
 };
 
 // MinidumpMemoryInfo wraps MDRawMemoryInfo, which provides information
@@ -1265,6 +1292,11 @@ class Minidump {
   }
   static uint32_t max_string_length() { return max_string_length_; }
 
+  static void set_max_decompressed_size(uint32_t max_decompressed_size) {
+    max_decompressed_size_ = max_decompressed_size;
+  }
+  static uint32_t max_decompressed_size() { return max_decompressed_size_; }
+
   virtual const MDRawHeader* header() const {
     return valid_ ? &header_ : nullptr;
   }
@@ -1378,6 +1410,25 @@ class Minidump {
   // Get current hexdump display settings.
   unsigned int HexdumpMode() const { return hexdump_ ? hexdump_width_ : 0; }
 
+  // If use_mmap is true, Read() maps the minidump file into memory instead
+  // of opening it as an ifstream, so that memory regions can be used in
+  // place rather than copied.  If the file cannot be mapped, it is read as
+  // usual.  Has no effect on a minidump constructed from an istream, or
+  // once the file has been opened.
+  void set_use_mmap(bool use_mmap) { use_mmap_ = use_mmap; }
+
+  // Returns true if the minidump file is mapped into memory.  A compressed
+  // minidump (see common/minidump_compression.h) is decompressed into memory
+  // by Read(), and counts as mapped from then on.
+  bool is_mapped() const { return mapped_data_ != nullptr; }
+
+  // Returns a pointer to the count bytes at offset in the mapped minidump
+  // file, or NULL if the file is not mapped or the bytes are not all within
+  // it.  The bytes are as they appear in the file, not byte-swapped, and
+  // remain valid as long as the Minidump object.  Unlike ReadBytes, this
+  // does not use or move the current position.
+  const uint8_t* GetMappedBytes(off_t offset, size_t count) const;
+
  private:
   // MinidumpStreamInfo is used in the MinidumpStreamMap.  It lets
   // the Minidump object locate interesting streams quickly, and
@@ -1401,6 +1452,15 @@ class Minidump {
   // Opens the minidump file, or if already open, seeks to the beginning.
   bool Open();
 
+  // Maps the minidump file into memory.  Returns false if it can't be
+  // mapped.
+  bool Map();
+
+  // Replaces the compressed minidump being read, whose header Read() has
+  // just read, with the minidump it decompresses to, positioned at its
+  // start.  Returns false if the container is malformed.
+  bool Decompress();
+
   // The largest number of top-level streams that will be read from a minidump.
   // Note that streams are only read (and only consume memory) as needed,
   // when directed by the caller.  The default is 128.
@@ -1412,6 +1472,12 @@ class Minidump {
   // by as many as 3 bytes in UTF-8.
   static unsigned int max_string_length_;
 
+  // The largest minidump, in bytes, that a compressed minidump will be
+  // decompressed to.  The decompressed size is read from the container and
+  // allocated up front, so this keeps a small container from claiming an
+  // arbitrarily large minidump.  The default is 1 GiB.
+  static uint32_t max_decompressed_size_;
+
   MDRawHeader               header_;
 
   // The list of streams.
@@ -1428,6 +1494,18 @@ class Minidump {
   // Set based on the path in Open, or directly in the constructor.
   std::istream*             stream_;
 
+  // If set_use_mmap(true) was called and the file could be mapped, the
+  // whole minidump file, which ReadBytes and SeekSet use instead of
+  // stream_.  mapped_position_ is the current position in it.
+  bool                      use_mmap_;
+  const uint8_t*            mapped_data_;
+  size_t                    mapped_size_;
+  off_t                     mapped_position_;
+
+  // The decompressed minidump, if the file was a compressed minidump.
+  // mapped_data_ then points into it rather than at a mapping.
+  vector<uint8_t>           decompressed_;
+
   // swap_ is true if the minidump file should be byte-swapped.  If the
   // minidump was produced by a CPU that is other-endian than the CPU
   // processing the minidump, this will be true.  If the two CPUs are
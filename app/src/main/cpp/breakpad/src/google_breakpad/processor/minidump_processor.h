@@ -138,6 +138,21 @@ class MinidumpProcessor {
     enable_objdump_for_exploitability_ = enabled;
   }
 
+  // Sets the number of threads used to walk the stacks of the threads in a
+  // minidump. The default of 1 walks them one after another on the calling
+  // thread, and 0 uses one thread per available core. Walking stacks in
+  // parallel requires the StackFrameSymbolizer to be safe for concurrent
+  // use, which the default one is when used with a resolver derived from
+  // SourceLineResolverBase. The resulting ProcessState is identical
+  // whatever the number of threads.
+  void set_stackwalk_thread_count(int count) {
+    stackwalk_thread_count_ = count;
+  }
+
+  // Sets whether Process(const string&, ...) maps the minidump file into
+  // memory instead of reading it, see Minidump::set_use_mmap().
+  void set_use_mmap(bool use_mmap) { use_mmap_ = use_mmap; }
+
  private:
   StackFrameSymbolizer* frame_symbolizer_;
   // Indicate whether resolver_helper_ is owned by this instance.
@@ -157,6 +172,13 @@ class MinidumpProcessor {
   // purposes of disassembly. This results in significantly more overhead than
   // the enable_objdump_ flag.
   bool enable_objdump_for_exploitability_;
+
+  // The number of threads used to walk stacks, see
+  // set_stackwalk_thread_count().
+  int stackwalk_thread_count_;
+
+  // Whether minidump files are mapped into memory, see set_use_mmap().
+  bool use_mmap_;
 };
 
 }  // namespace google_breakpad
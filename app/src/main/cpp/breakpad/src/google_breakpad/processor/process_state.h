@@ -50,6 +50,7 @@ using std::vector;
 
 class CallStack;
 class CodeModules;
+class FrameArena;
 
 enum ExploitabilityRating {
   EXPLOITABILITY_HIGH,                 // The crash likely represents
@@ -91,7 +92,7 @@ enum ExploitabilityRating {
 
 class ProcessState {
  public:
-  ProcessState() : modules_(NULL), unloaded_modules_(NULL) { Clear(); }
+  ProcessState();
   ~ProcessState();
 
   // Resets the ProcessState to its default values
@@ -174,6 +175,10 @@ class ProcessState {
   // Stacks for each thread (except possibly the exception handler
   // thread) at the time of the crash.
   vector<CallStack*> threads_;
+
+  // Storage for the frames of threads_.  Clear() resets it once the
+  // CallStacks have been deleted.
+  FrameArena* frame_arena_;
   vector<MemoryRegion*> thread_memory_regions_;
 
   // Names of each thread at the time of the crash, one for each entry in
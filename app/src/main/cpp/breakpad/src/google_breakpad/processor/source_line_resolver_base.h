@@ -44,8 +44,11 @@
 #include <map>
 #include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "google_breakpad/processor/source_line_resolver_interface.h"
+#include "google_breakpad/processor/stack_frame.h"
 
 namespace google_breakpad {
 
@@ -56,6 +59,7 @@ using std::set;
 // ModuleFactory is a simple factory interface for creating a Module instance
 // at run-time.
 class ModuleFactory;
+class MappedSymbolFile;
 
 class SourceLineResolverBase : public SourceLineResolverInterface {
  public:
@@ -68,6 +72,22 @@ class SourceLineResolverBase : public SourceLineResolverInterface {
                              char** symbol_data,
                              size_t* symbol_data_size);
 
+  // A code module and an address relative to its base address.
+  typedef std::pair<const CodeModule*, MemAddr> ModuleOffset;
+
+  // Resolves many addresses at once.  Stores in |frames| one StackFrame
+  // for each (module, offset) pair in |addresses|, in the same order, filled
+  // in as FillSourceLineInfo would fill a frame at module->base_address() +
+  // offset.  Inlined frames are not constructed.
+  //
+  // Each run of pairs for the same module costs a single module lookup, and
+  // modules resolve a run sorted by offset in one pass, reusing the function
+  // and line found for the previous address.  |addresses| should therefore
+  // be grouped by module and sorted by offset within each module; other
+  // orders give the same results, only more slowly.
+  void FillSourceLineInfos(const std::vector<ModuleOffset>& addresses,
+                           std::vector<StackFrame>* frames);
+
  protected:
   // Users are not allowed create SourceLineResolverBase instance directly.
   SourceLineResolverBase(ModuleFactory* module_factory);
@@ -115,6 +135,11 @@ class SourceLineResolverBase : public SourceLineResolverInterface {
   typedef std::map<string, char*, CompareString> MemoryMap;
   MemoryMap* memory_buffers_;
 
+  // All of the symbol files mapped by LoadModule() that are owned locally
+  // by resolver.
+  typedef std::map<string, MappedSymbolFile*, CompareString> MappedFileMap;
+  MappedFileMap* mapped_files_;
+
   // Creates a concrete module at run-time.
   ModuleFactory* module_factory_;
 
@@ -29,6 +29,8 @@
 #ifndef GOOGLE_BREAKPAD_PROCESSOR_STACK_FRAME_H__
 #define GOOGLE_BREAKPAD_PROCESSOR_STACK_FRAME_H__
 
+#include <stddef.h>
+
 #include <string>
 
 #include "common/using_std_string.h"
@@ -69,6 +71,13 @@ struct StackFrame {
         is_multiple(false) {}
   virtual ~StackFrame() {}
 
+  // StackFrames, including those of CPU-specific subclasses, are allocated
+  // from the FrameArena installed on the current thread during a stack walk,
+  // or from the heap when there is none.  Either kind is released by
+  // deleting it.  See processor/frame_arena.h.
+  static void* operator new(size_t size);
+  static void operator delete(void* frame);
+
   // Return a string describing how this stack frame was found
   // by the stackwalker.
   string trust_description() const {
@@ -34,9 +34,13 @@
 #ifndef GOOGLE_BREAKPAD_PROCESSOR_STACK_FRAME_SYMBOLIZER_H__
 #define GOOGLE_BREAKPAD_PROCESSOR_STACK_FRAME_SYMBOLIZER_H__
 
+#include <atomic>
 #include <deque>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <set>
+#include <shared_mutex>
 #include <string>
 #include <vector>
 
@@ -53,6 +57,11 @@ struct StackFrame;
 struct SystemInfo;
 struct WindowsFrameInfo;
 
+// A StackFrameSymbolizer may be shared by several threads walking different
+// stacks at the same time: symbol lookups run concurrently, while fetching
+// symbols from the supplier and loading them into the resolver are
+// serialized. This requires the resolver's lookups to be safe to run
+// alongside each other, which is the case for SourceLineResolverBase.
 class StackFrameSymbolizer {
  public:
   enum SymbolizerResult {
@@ -91,8 +100,27 @@ class StackFrameSymbolizer {
   // Reset internal (locally owned) data as if the helper is re-instantiated.
   // A typical case is to call Reset() after processing an individual report
   // before start to process next one, in order to reset internal information
-  // about missing symbols found so far.
-  virtual void Reset() { no_symbol_modules_.clear(); }
+  // about missing symbols found so far.  Symbol modules stay loaded, subject
+  // to the module cache budget.
+  virtual void Reset();
+
+  // Counters describing how well loaded symbol modules are reused.
+  struct ModuleCacheStats {
+    uint64_t hits;          // Frames symbolized with an already loaded module.
+    uint64_t misses;        // Frames that needed a module to be loaded.
+    uint64_t evictions;     // Modules unloaded to stay within the budget.
+    uint64_t loaded_bytes;  // Symbol data currently loaded.
+  };
+
+  // Limits the symbol data kept loaded in the resolver to |bytes|, counted
+  // as the size of the data returned by the supplier.  Once the budget is
+  // exceeded, the least recently used modules are unloaded.  Modules used
+  // since the last Reset(), that is, by the minidump being processed, are
+  // pinned and never unloaded, so a single large minidump may exceed the
+  // budget until the next one starts.  0, the default, never unloads.
+  void set_module_cache_budget(uint64_t bytes);
+
+  ModuleCacheStats module_cache_stats();
 
   // Returns true if there is valid implementation for stack symbolization.
   virtual bool HasImplementation() { return resolver_ && supplier_; }
@@ -106,6 +134,40 @@ class StackFrameSymbolizer {
   // A list of modules known to have symbols missing. This helps avoid
   // repeated lookups for the missing symbols within one minidump.
   std::set<string> no_symbol_modules_;
+  // Taken shared to look up symbols, and exclusively to load them or to
+  // update |no_symbol_modules_|.
+  std::shared_mutex lock_;
+
+ private:
+  // A module loaded into the resolver from symbol data from the supplier.
+  struct CachedModule {
+    // A copy of the module it was loaded for, to unload it by.
+    std::unique_ptr<CodeModule> module;
+    uint64_t size;
+    // The value of |use_clock_| when the module was last used.
+    std::atomic<uint64_t> last_use;
+    // The value of |dump_generation_| when the module was last used.
+    std::atomic<uint64_t> dump_generation;
+  };
+
+  // Records a use of the loaded module |code_file|.  Requires |lock_|, held
+  // shared or exclusively.
+  void TouchModule(const string& code_file);
+
+  // Unloads least recently used modules that are not pinned until the
+  // budget is met.  Requires |lock_| held exclusively.
+  void EvictModules();
+
+  // Keyed by code file, like the resolver's own modules.
+  std::map<string, std::unique_ptr<CachedModule>> cached_modules_;
+  uint64_t module_cache_budget_;
+  uint64_t loaded_bytes_;
+  // Advanced by Reset(); modules used in the current generation are pinned.
+  uint64_t dump_generation_;
+  std::atomic<uint64_t> use_clock_;
+  std::atomic<uint64_t> hits_;
+  std::atomic<uint64_t> misses_;
+  uint64_t evictions_;
 };
 
 }  // namespace google_breakpad
@@ -44,6 +44,7 @@
 #include <string>
 #include <vector>
 
+#include "common/scoped_ptr.h"
 #include "common/using_std_string.h"
 #include "google_breakpad/common/breakpad_types.h"
 #include "google_breakpad/processor/code_modules.h"
@@ -54,6 +55,8 @@ namespace google_breakpad {
 
 class CallStack;
 class DumpContext;
+class FrameArena;
+class ModuleRangeTable;
 class StackFrameSymbolizer;
 
 using std::set;
@@ -61,7 +64,7 @@ using std::vector;
 
 class Stackwalker {
  public:
-  virtual ~Stackwalker() {}
+  virtual ~Stackwalker();
 
   // Populates the given CallStack by calling GetContextFrame and
   // GetCallerFrame.  The frames are further processed to fill all available
@@ -102,6 +105,11 @@ class Stackwalker {
     max_frames_scanned_ = max_frames_scanned;
   }
 
+  // Allocates the frames that Walk produces from |frame_arena| instead of
+  // the heap, if it is not NULL.  The arena must not be reset until those
+  // frames have been deleted.  See processor/frame_arena.h.
+  void set_frame_arena(FrameArena* frame_arena) { frame_arena_ = frame_arena; }
+
  protected:
   // system_info identifies the operating system, NULL or empty if unknown.
   // memory identifies a MemoryRegion that provides the stack memory
@@ -168,6 +176,17 @@ class Stackwalker {
                             InstructionType* location_found,
                             InstructionType* ip_found,
                             int searchwords) {
+    bool found;
+    uint64_t location, ip;
+    if (ScanStackInPlace(location_start, sizeof(InstructionType), searchwords,
+                         &found, &location, &ip)) {
+      if (found) {
+        *ip_found = static_cast<InstructionType>(ip);
+        *location_found = static_cast<InstructionType>(location);
+      }
+      return found;
+    }
+
     for (InstructionType location = location_start;
          location <= location_start + searchwords * sizeof(InstructionType);
          location += sizeof(InstructionType)) {
@@ -190,6 +209,21 @@ class Stackwalker {
     return false;
   }
 
+  // The same scan as ScanForReturnAddress, for words of word_size bytes,
+  // done directly on the stack region's contiguous memory: candidate
+  // words are first filtered in bulk against the ranges of modules_, and
+  // only the survivors are checked with GetModuleForAddress and
+  // InstructionAddressSeemsValid.  Returns false if the memory region
+  // can't provide contiguous memory, in which case the caller must scan
+  // word by word.  Otherwise, sets *found to indicate whether a return
+  // address was found, and if so, sets *location_found and *ip_found.
+  bool ScanStackInPlace(uint64_t location_start,
+                        size_t word_size,
+                        int searchwords,
+                        bool* found,
+                        uint64_t* location_found,
+                        uint64_t* ip_found);
+
   // Information about the system that produced the minidump.  Subclasses
   // and the SymbolSupplier may find this information useful.
   const SystemInfo* system_info_;
@@ -238,6 +272,12 @@ class Stackwalker {
   virtual StackFrame* GetCallerFrame(const CallStack* stack,
                                      bool stack_scan_allowed) = 0;
 
+  // Where Walk allocates frames, or NULL for the heap.
+  FrameArena* frame_arena_;
+
+  // The ranges of modules_, for ScanStackInPlace.  Built on first use.
+  scoped_ptr<ModuleRangeTable> module_ranges_;
+
   // The maximum number of frames Stackwalker will walk through.
   // This defaults to 1024 to prevent infinite loops.
   static uint32_t max_frames_;
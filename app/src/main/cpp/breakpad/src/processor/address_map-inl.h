@@ -82,6 +82,19 @@ bool AddressMap<AddressType, EntryType>::Retrieve(
   return true;
 }
 
+template<typename AddressType, typename EntryType>
+const EntryType* AddressMap<AddressType, EntryType>::GetEntryForAddress(
+    const AddressType& address, AddressType* entry_address) const {
+  MapConstIterator iterator = map_.upper_bound(address);
+  if (iterator == map_.begin())
+    return NULL;
+  --iterator;
+
+  if (entry_address)
+    *entry_address = iterator->first;
+  return &iterator->second;
+}
+
 template<typename AddressType, typename EntryType>
 void AddressMap<AddressType, EntryType>::Clear() {
   map_.clear();
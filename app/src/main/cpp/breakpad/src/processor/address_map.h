@@ -62,6 +62,12 @@ class AddressMap {
   bool Retrieve(const AddressType& address,
                 EntryType* entry, AddressType* entry_address) const;
 
+  // Returns the entry that Retrieve would, or NULL if there is none.  The
+  // entry is not copied, so this may be called from several threads at once
+  // even when copying EntryType modifies shared state, as linked_ptr does.
+  const EntryType* GetEntryForAddress(const AddressType& address,
+                                      AddressType* entry_address) const;
+
   // Empties the address map, restoring it to the same state as when it was
   // initially created.
   void Clear();
@@ -108,14 +108,15 @@ unsigned int BasicCodeModules::module_count() const {
 
 const CodeModule* BasicCodeModules::GetModuleForAddress(
     uint64_t address) const {
-  linked_ptr<const CodeModule> module;
-  if (!map_.RetrieveRange(address, &module, NULL /* base */, NULL /* delta */,
-                          NULL /* size */)) {
+  // Look the module up without copying its linked_ptr, so that concurrent
+  // stack walks can share this object.
+  const linked_ptr<const CodeModule>* module = map_.GetEntryForAddress(address);
+  if (!module) {
     BPLOG(INFO) << "No module at " << HexString(address);
     return NULL;
   }
 
-  return module.get();
+  return module->get();
 }
 
 const CodeModule* BasicCodeModules::GetMainModule() const {
@@ -124,14 +125,13 @@ const CodeModule* BasicCodeModules::GetMainModule() const {
 
 const CodeModule* BasicCodeModules::GetModuleAtSequence(
     unsigned int sequence) const {
-  linked_ptr<const CodeModule> module;
-  if (!map_.RetrieveRangeAtIndex(sequence, &module, NULL /* base */,
-                                 NULL /* delta */, NULL /* size */)) {
-    BPLOG(ERROR) << "RetrieveRangeAtIndex failed for sequence " << sequence;
+  const linked_ptr<const CodeModule>* module = map_.GetEntryAtIndex(sequence);
+  if (!module) {
+    BPLOG(ERROR) << "GetEntryAtIndex failed for sequence " << sequence;
     return NULL;
   }
 
-  return module.get();
+  return module->get();
 }
 
 const CodeModule* BasicCodeModules::GetModuleAtIndex(
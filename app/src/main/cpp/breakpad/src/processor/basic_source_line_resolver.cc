@@ -41,9 +41,12 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 
+#include <algorithm>
+#include <iterator>
 #include <limits>
 #include <map>
 #include <memory>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -108,9 +111,18 @@ static const char* kWhitespace = " \r\n";
 static const int kMaxErrorsPrinted = 5;
 static const int kMaxErrorsBeforeBailing = 100;
 
+// Symbol data is only split into chunks of at least this many bytes, so that
+// small files aren't parsed on several threads.
+static const size_t kMinParseChunkSize = 1 << 20;
+
 BasicSourceLineResolver::BasicSourceLineResolver() :
     SourceLineResolverBase(new BasicModuleFactory) { }
 
+void BasicSourceLineResolver::set_parse_thread_count(int thread_count) {
+  static_cast<BasicModuleFactory*>(module_factory_)->set_parse_thread_count(
+      thread_count);
+}
+
 // static
 void BasicSourceLineResolver::Module::LogParseError(
    const string& message,
@@ -125,6 +137,61 @@ void BasicSourceLineResolver::Module::LogParseError(
   }
 }
 
+// The records of a chunk are kept in one vector per kind of record, along
+// with the kind of each line in file order, so that StoreChunk() can store
+// them exactly as parsing the lines one at a time would have.
+struct BasicSourceLineResolver::Module::Chunk {
+  enum LineKind {
+    IGNORED_LINE,         // MODULE, INFO and PUBLIC at address 0, and the
+                          // lines and inlines of a FUNC in this chunk.
+    FILE_LINE,
+    INLINE_ORIGIN_LINE,
+    FUNCTION_LINE,
+    PUBLIC_LINE,
+    STACK_WIN_LINE,
+    STACK_CFI_INIT_LINE,
+    STACK_CFI_LINE,
+    LEADING_LINE,         // A line record before any FUNC or PUBLIC in the
+                          // chunk, which belongs to an earlier chunk's FUNC.
+    LEADING_INLINE_LINE,  // Likewise for an INLINE record.
+    ERROR_LINE,
+    INLINE_ERROR_LINE
+  };
+
+  struct WindowsFrameInfoRecord {
+    int type;
+    MemAddr rva;
+    MemAddr code_size;
+    linked_ptr<WindowsFrameInfo> info;
+  };
+
+  struct CFIInitialRulesRecord {
+    MemAddr address;
+    MemAddr size;
+    const char* rules;  // Points into the symbol data.
+  };
+
+  Chunk() : sets_function(false) { }
+
+  vector<unsigned char> kinds;
+  vector<std::pair<long, string>> files;
+  vector<std::pair<long, linked_ptr<InlineOrigin>>> inline_origins;
+  vector<linked_ptr<Function>> functions;
+  vector<linked_ptr<PublicSymbol>> public_symbols;
+  vector<WindowsFrameInfoRecord> windows_frame_info;
+  vector<CFIInitialRulesRecord> cfi_initial_rules;
+  vector<std::pair<MemAddr, string>> cfi_delta_rules;
+  vector<linked_ptr<Line>> leading_lines;   // NULL where ParseLine failed.
+  vector<linked_ptr<Inline>> leading_inlines;  // NULL where ParseInline
+                                               // failed.
+  vector<const char*> errors;
+
+  // Whether the chunk has a FUNC or PUBLIC record, and if so, the function
+  // that lines following the chunk belong to.
+  bool sets_function;
+  linked_ptr<Function> last_function;
+};
+
 bool BasicSourceLineResolver::Module::LoadMapFromMemory(
     char* memory_buffer,
     size_t memory_buffer_size) {
@@ -132,7 +199,6 @@ bool BasicSourceLineResolver::Module::LoadMapFromMemory(
   int line_number = 0;
   int num_errors = 0;
   int inline_num_errors = 0;
-  char* save_ptr;
 
   // If the length is 0, we can still pretend we have a symbol file. This is
   // for scenarios that want to test symbol lookup, but don't necessarily care
@@ -167,36 +233,86 @@ bool BasicSourceLineResolver::Module::LoadMapFromMemory(
        &num_errors);
   }
 
-  char* buffer;
-  buffer = strtok_r(memory_buffer, "\r\n", &save_ptr);
+  // Split the data into chunks at line boundaries.  Terminating each chunk
+  // where its last line ends doesn't change how the data tokenizes.
+  size_t thread_count = parse_thread_count_ > 0 ?
+      parse_thread_count_ : std::thread::hardware_concurrency();
+  size_t chunk_count = std::max<size_t>(
+      1, std::min(thread_count, last_null_terminator / kMinParseChunkSize));
+  vector<char*> chunk_starts(1, memory_buffer);
+  for (size_t i = 1; i < chunk_count; ++i) {
+    char* end = memory_buffer + last_null_terminator;
+    char* split = std::max(
+        memory_buffer + i * (last_null_terminator / chunk_count),
+        chunk_starts.back());
+    while (split < end && *split != '\n' && *split != '\r')
+      ++split;
+    if (split == end)
+      break;
+    *split = '\0';
+    chunk_starts.push_back(split + 1);
+  }
+
+  vector<Chunk> chunks(chunk_starts.size());
+  vector<std::thread> threads;
+  for (size_t i = 1; i < chunks.size(); ++i)
+    threads.emplace_back(ParseChunk, chunk_starts[i], &chunks[i]);
+  ParseChunk(chunk_starts[0], &chunks[0]);
+
+  // Store each chunk as soon as it is parsed, while later ones are still
+  // being parsed.
+  bool bailed = false;
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    if (i > 0)
+      threads[i - 1].join();
+    if (!bailed) {
+      bailed = !StoreChunk(&chunks[i], &cur_func, &line_number, &num_errors,
+                           &inline_num_errors);
+    }
+    chunks[i] = Chunk();
+  }
+  is_corrupt_ = num_errors > 0;
+  return true;
+}
+
+// static
+void BasicSourceLineResolver::Module::ParseChunk(char* data, Chunk* chunk) {
+  // The function that line and INLINE records belong to, once the chunk has
+  // had a FUNC or PUBLIC record.
+  linked_ptr<Function> cur_func;
+  char* save_ptr;
+  char* buffer = strtok_r(data, "\r\n", &save_ptr);
 
   while (buffer != NULL) {
-    ++line_number;
+    // The Parse* functions that store records in |chunk| also record the
+    // kind of the line on success.
+    const char* error = NULL;
+    bool inline_error = false;
 
     if (strncmp(buffer, "FILE ", 5) == 0) {
-      if (!ParseFile(buffer)) {
-        LogParseError("ParseFile on buffer failed", line_number, &num_errors);
+      if (!ParseFile(buffer, chunk)) {
+        error = "ParseFile on buffer failed";
       }
     } else if (strncmp(buffer, "STACK ", 6) == 0) {
-      if (!ParseStackInfo(buffer)) {
-        LogParseError("ParseStackInfo failed", line_number, &num_errors);
+      if (!ParseStackInfo(buffer, chunk)) {
+        error = "ParseStackInfo failed";
       }
     } else if (strncmp(buffer, "FUNC ", 5) == 0) {
+      chunk->sets_function = true;
       cur_func.reset(ParseFunction(buffer));
       if (!cur_func.get()) {
-        LogParseError("ParseFunction failed", line_number, &num_errors);
+        error = "ParseFunction failed";
       } else {
-        // StoreRange will fail if the function has an invalid address or size.
-        // We'll silently ignore this, the function and any corresponding lines
-        // will be destroyed when cur_func is released.
-        functions_.StoreRange(cur_func->address, cur_func->size, cur_func);
+        chunk->functions.push_back(cur_func);
+        chunk->kinds.push_back(Chunk::FUNCTION_LINE);
       }
     } else if (strncmp(buffer, "PUBLIC ", 7) == 0) {
       // Clear cur_func: public symbols don't contain line number information.
+      chunk->sets_function = true;
       cur_func.reset();
 
-      if (!ParsePublicSymbol(buffer)) {
-        LogParseError("ParsePublicSymbol failed", line_number, &num_errors);
+      if (!ParsePublicSymbol(buffer, chunk)) {
+        error = "ParsePublicSymbol failed";
       }
     } else if (strncmp(buffer, "MODULE ", 7) == 0) {
       // Ignore these.  They're not of any use to BasicSourceLineResolver,
@@ -205,41 +321,187 @@ bool BasicSourceLineResolver::Module::LoadMapFromMemory(
       // be accessed by a SymbolSupplier.
       //
       // MODULE <guid> <age> <filename>
+      chunk->kinds.push_back(Chunk::IGNORED_LINE);
     } else if (strncmp(buffer, "INFO ", 5) == 0) {
       // Ignore these as well, they're similarly just for housekeeping.
       //
       // INFO CODE_ID <code id> <filename>
+      chunk->kinds.push_back(Chunk::IGNORED_LINE);
     } else if (strncmp(buffer, "INLINE ", 7) == 0) {
       linked_ptr<Inline> in = ParseInline(buffer);
-      if (!in.get())
-        LogParseError("ParseInline failed", line_number, &inline_num_errors);
-      else
-        cur_func->AppendInline(in);
+      if (!chunk->sets_function) {
+        // The function is in an earlier chunk.
+        chunk->leading_inlines.push_back(in);
+        chunk->kinds.push_back(Chunk::LEADING_INLINE_LINE);
+      } else if (!in.get()) {
+        error = "ParseInline failed";
+        inline_error = true;
+      } else {
+        if (cur_func.get())
+          cur_func->AppendInline(in);
+        chunk->kinds.push_back(Chunk::IGNORED_LINE);
+      }
     } else if (strncmp(buffer, "INLINE_ORIGIN ", 14) == 0) {
-      if (!ParseInlineOrigin(buffer)) {
-        LogParseError("ParseInlineOrigin failed", line_number,
-                      &inline_num_errors);
+      if (!ParseInlineOrigin(buffer, chunk)) {
+        error = "ParseInlineOrigin failed";
+        inline_error = true;
       }
+    } else if (!chunk->sets_function) {
+      // The function is in an earlier chunk, if there is one.
+      chunk->leading_lines.push_back(linked_ptr<Line>(ParseLine(buffer)));
+      chunk->kinds.push_back(Chunk::LEADING_LINE);
     } else {
       if (!cur_func.get()) {
-        LogParseError("Found source line data without a function",
-                       line_number, &num_errors);
+        error = "Found source line data without a function";
       } else {
         Line* line = ParseLine(buffer);
         if (!line) {
-          LogParseError("ParseLine failed", line_number, &num_errors);
+          error = "ParseLine failed";
         } else {
           cur_func->lines.StoreRange(line->address, line->size,
                                      linked_ptr<Line>(line));
+          chunk->kinds.push_back(Chunk::IGNORED_LINE);
         }
       }
     }
-    if (num_errors > kMaxErrorsBeforeBailing) {
-      break;
+    if (error) {
+      chunk->errors.push_back(error);
+      chunk->kinds.push_back(inline_error ? Chunk::INLINE_ERROR_LINE :
+                                            Chunk::ERROR_LINE);
     }
     buffer = strtok_r(NULL, "\r\n", &save_ptr);
   }
-  is_corrupt_ = num_errors > 0;
+  chunk->last_function = cur_func;
+}
+
+bool BasicSourceLineResolver::Module::StoreChunk(
+    Chunk* chunk,
+    linked_ptr<Function>* cur_func,
+    int* line_number,
+    int* num_errors,
+    int* inline_num_errors) {
+  size_t file = 0, inline_origin = 0, function = 0, public_symbol = 0;
+  size_t windows_frame_info = 0, cfi_initial_rules = 0, cfi_delta_rules = 0;
+  size_t leading_line = 0, leading_inline = 0, error = 0;
+
+  for (unsigned char kind : chunk->kinds) {
+    ++*line_number;
+
+    switch (kind) {
+      case Chunk::IGNORED_LINE:
+        break;
+
+      case Chunk::FILE_LINE:
+        files_.insert(std::move(chunk->files[file++]));
+        break;
+
+      case Chunk::INLINE_ORIGIN_LINE:
+        inline_origins_.insert(chunk->inline_origins[inline_origin++]);
+        break;
+
+      case Chunk::FUNCTION_LINE: {
+        // StoreRange will fail if the function has an invalid address or size.
+        // We'll silently ignore this, the function and any corresponding lines
+        // will be destroyed when the chunk is released.
+        const linked_ptr<Function>& func = chunk->functions[function++];
+        functions_.StoreRange(func->address, func->size, func);
+        break;
+      }
+
+      case Chunk::PUBLIC_LINE: {
+        const linked_ptr<PublicSymbol>& symbol =
+            chunk->public_symbols[public_symbol++];
+        if (!public_symbols_.Store(symbol->address, symbol)) {
+          LogParseError("ParsePublicSymbol failed", *line_number, num_errors);
+        }
+        break;
+      }
+
+      case Chunk::STACK_WIN_LINE: {
+        // TODO(mmentovai): I wanted to use StoreRange's return value as this
+        // method's return value, but MSVC infrequently outputs stack info that
+        // violates the containment rules.  This happens with a section of code
+        // in strncpy_s in test_app.cc (testdata/minidump2).  There, problem
+        // looks like this:
+        //   STACK WIN 4 4242 1a a 0 ...  (STACK WIN 4 base size prolog 0 ...)
+        //   STACK WIN 4 4243 2e 9 0 ...
+        // ContainedRangeMap treats these two blocks as conflicting.  In
+        // reality, when the prolog lengths are taken into account, the actual
+        // code of these blocks doesn't conflict.  However, we can't take the
+        // prolog lengths into account directly here because we'd wind up with
+        // a different set of range conflicts when MSVC outputs stack info like
+        // this:
+        //   STACK WIN 4 1040 73 33 0 ...
+        //   STACK WIN 4 105a 59 19 0 ...
+        // because in both of these entries, the beginning of the code after
+        // the prolog is at 0x1073, and the last byte of contained code is at
+        // 0x10b2.  Perhaps we could get away with storing ranges by rva +
+        // prolog_size if ContainedRangeMap were modified to allow replacement
+        // of already-stored values.
+        const Chunk::WindowsFrameInfoRecord& record =
+            chunk->windows_frame_info[windows_frame_info++];
+        windows_frame_info_[record.type].StoreRange(record.rva,
+                                                    record.code_size,
+                                                    record.info);
+        break;
+      }
+
+      case Chunk::STACK_CFI_INIT_LINE: {
+        const Chunk::CFIInitialRulesRecord& record =
+            chunk->cfi_initial_rules[cfi_initial_rules++];
+        cfi_initial_rules_.StoreRange(record.address, record.size,
+                                      record.rules);
+        break;
+      }
+
+      case Chunk::STACK_CFI_LINE: {
+        // Delta records are usually in address order, which makes the end of
+        // the map the right place to insert them.
+        std::pair<MemAddr, string>& record =
+            chunk->cfi_delta_rules[cfi_delta_rules++];
+        cfi_delta_rules_.insert_or_assign(cfi_delta_rules_.end(), record.first,
+                                          std::move(record.second));
+        break;
+      }
+
+      case Chunk::LEADING_LINE: {
+        const linked_ptr<Line>& line = chunk->leading_lines[leading_line++];
+        if (!cur_func->get()) {
+          LogParseError("Found source line data without a function",
+                        *line_number, num_errors);
+        } else if (!line.get()) {
+          LogParseError("ParseLine failed", *line_number, num_errors);
+        } else {
+          (*cur_func)->lines.StoreRange(line->address, line->size, line);
+        }
+        break;
+      }
+
+      case Chunk::LEADING_INLINE_LINE: {
+        const linked_ptr<Inline>& in = chunk->leading_inlines[leading_inline++];
+        if (!in.get()) {
+          LogParseError("ParseInline failed", *line_number, inline_num_errors);
+        } else if (cur_func->get()) {
+          (*cur_func)->AppendInline(in);
+        }
+        break;
+      }
+
+      case Chunk::ERROR_LINE:
+        LogParseError(chunk->errors[error++], *line_number, num_errors);
+        break;
+
+      case Chunk::INLINE_ERROR_LINE:
+        LogParseError(chunk->errors[error++], *line_number, inline_num_errors);
+        break;
+    }
+    if (*num_errors > kMaxErrorsBeforeBailing) {
+      return false;
+    }
+  }
+
+  if (chunk->sets_function)
+    *cur_func = chunk->last_function;
   return true;
 }
 
@@ -301,51 +563,120 @@ void BasicSourceLineResolver::Module::ConstructInlineFrames(
   }
 }
 
+struct BasicSourceLineResolver::Module::LookupHint {
+  LookupHint()
+      : function(NULL), function_base(), function_size(),
+        line(NULL), line_base(), line_size() {}
+
+  // The function the previous address fell in, or NULL if it fell in none.
+  const linked_ptr<Function>* function;
+  MemAddr function_base;
+  MemAddr function_size;
+
+  // The line of |function| the previous address fell in, or NULL if it
+  // fell in none.
+  const linked_ptr<Line>* line;
+  MemAddr line_base;
+  MemAddr line_size;
+};
+
 void BasicSourceLineResolver::Module::LookupAddress(
     StackFrame* frame,
     deque<unique_ptr<StackFrame>>* inlined_frames) const {
+  LookupAddressWithHint(frame, inlined_frames, NULL);
+}
+
+void BasicSourceLineResolver::Module::LookupAddresses(StackFrame* frames,
+                                                      size_t count) const {
+  LookupHint hint;
+  for (size_t i = 0; i < count; ++i)
+    LookupAddressWithHint(&frames[i], NULL, &hint);
+}
+
+void BasicSourceLineResolver::Module::LookupAddressWithHint(
+    StackFrame* frame,
+    deque<unique_ptr<StackFrame>>* inlined_frames,
+    LookupHint* hint) const {
   MemAddr address = frame->instruction - frame->module->base_address();
 
   // First, look for a FUNC record that covers address. Use
-  // RetrieveNearestRange instead of RetrieveRange so that, if there
-  // is no such function, we can use the next function to bound the
+  // GetNearestEntryForAddress instead of GetEntryForAddress so that, if
+  // there is no such function, we can use the next function to bound the
   // extent of the PUBLIC symbol we find, below. This does mean we
   // need to check that address indeed falls within the function we
   // find; do the range comparison in an overflow-friendly way.
-  linked_ptr<Function> func;
-  linked_ptr<PublicSymbol> public_symbol;
+  // The entries are used in place rather than copied, because copying a
+  // linked_ptr modifies its ownership ring, which would race with lookups
+  // on other threads.
+  const linked_ptr<Function>* func;
   MemAddr function_base;
   MemAddr function_size;
-  MemAddr public_address;
-  if (functions_.RetrieveNearestRange(address, &func, &function_base,
-                                      NULL /* delta */, &function_size) &&
+  bool reused_function = false;
+  if (hint && hint->function && address >= hint->function_base &&
+      address - hint->function_base < hint->function_size) {
+    func = hint->function;
+    function_base = hint->function_base;
+    function_size = hint->function_size;
+    reused_function = true;
+  } else {
+    func = functions_.GetNearestEntryForAddress(address, &function_base,
+                                                NULL /* delta */,
+                                                &function_size);
+  }
+
+  if (func &&
       address >= function_base && address - function_base < function_size) {
-    frame->function_name = func->name;
+    frame->function_name = (*func)->name;
     frame->function_base = frame->module->base_address() + function_base;
-    frame->is_multiple = func->is_multiple;
-
-    linked_ptr<Line> line;
-    MemAddr line_base;
-    if (func->lines.RetrieveRange(address, &line, &line_base, NULL /* delta */,
-                                  NULL /* size */)) {
-      FileMap::const_iterator it = files_.find(line->source_file_id);
+    frame->is_multiple = (*func)->is_multiple;
+
+    const linked_ptr<Line>* line;
+    MemAddr line_base = 0;
+    MemAddr line_size = 0;
+    if (reused_function && hint->line && address >= hint->line_base &&
+        address - hint->line_base < hint->line_size) {
+      line = hint->line;
+      line_base = hint->line_base;
+      line_size = hint->line_size;
+    } else {
+      line = (*func)->lines.GetEntryForAddress(address, &line_base,
+                                               NULL /* delta */, &line_size);
+    }
+    if (line) {
+      FileMap::const_iterator it = files_.find((*line)->source_file_id);
       if (it != files_.end()) {
-        frame->source_file_name = files_.find(line->source_file_id)->second;
+        frame->source_file_name = it->second;
       }
-      frame->source_line = line->line;
+      frame->source_line = (*line)->line;
       frame->source_line_base = frame->module->base_address() + line_base;
     }
 
+    if (hint) {
+      hint->function = func;
+      hint->function_base = function_base;
+      hint->function_size = function_size;
+      hint->line = line;
+      hint->line_base = line_base;
+      hint->line_size = line_size;
+    }
+
     // Check if this is inlined function call.
     if (inlined_frames) {
-      ConstructInlineFrames(frame, address, func->inlines, inlined_frames);
+      ConstructInlineFrames(frame, address, (*func)->inlines, inlined_frames);
     }
-  } else if (public_symbols_.Retrieve(address,
-                                      &public_symbol, &public_address) &&
-             (!func.get() || public_address > function_base)) {
-    frame->function_name = public_symbol->name;
+    return;
+  }
+
+  if (hint)
+    hint->function = NULL;
+
+  MemAddr public_address;
+  const linked_ptr<PublicSymbol>* public_symbol =
+      public_symbols_.GetEntryForAddress(address, &public_address);
+  if (public_symbol && (!func || public_address > function_base)) {
+    frame->function_name = (*public_symbol)->name;
     frame->function_base = frame->module->base_address() + public_address;
-    frame->is_multiple = public_symbol->is_multiple;
+    frame->is_multiple = (*public_symbol)->is_multiple;
   }
 }
 
@@ -360,39 +691,42 @@ WindowsFrameInfo* BasicSourceLineResolver::Module::FindWindowsFrameInfo(
   // includes its own program string.
   // WindowsFrameInfo::STACK_INFO_FPO is the older type
   // corresponding to the FPO_DATA struct. See stackwalker_x86.cc.
-  linked_ptr<WindowsFrameInfo> frame_info;
+  // As in LookupAddress, entries are used in place rather than copied.
+  // RetrieveRanges lists the most specific range first.
+  vector<const linked_ptr<WindowsFrameInfo>*> frame_infos;
   if ((windows_frame_info_[WindowsFrameInfo::STACK_INFO_FRAME_DATA]
-       .RetrieveRange(address, &frame_info))
+       .RetrieveRanges(address, frame_infos))
       || (windows_frame_info_[WindowsFrameInfo::STACK_INFO_FPO]
-          .RetrieveRange(address, &frame_info))) {
-    result->CopyFrom(*frame_info.get());
+          .RetrieveRanges(address, frame_infos))) {
+    result->CopyFrom(*frame_infos.front()->get());
     return result.release();
   }
 
   // Even without a relevant STACK line, many functions contain
   // information about how much space their parameters consume on the
-  // stack. Use RetrieveNearestRange instead of RetrieveRange, so that
-  // we can use the function to bound the extent of the PUBLIC symbol,
+  // stack. Use GetNearestEntryForAddress instead of GetEntryForAddress, so
+  // that we can use the function to bound the extent of the PUBLIC symbol,
   // below. However, this does mean we need to check that ADDRESS
   // falls within the retrieved function's range; do the range
   // comparison in an overflow-friendly way.
-  linked_ptr<Function> function;
   MemAddr function_base, function_size;
-  if (functions_.RetrieveNearestRange(address, &function, &function_base,
-                                      NULL /* delta */, &function_size) &&
+  const linked_ptr<Function>* function =
+      functions_.GetNearestEntryForAddress(address, &function_base,
+                                           NULL /* delta */, &function_size);
+  if (function &&
       address >= function_base && address - function_base < function_size) {
-    result->parameter_size = function->parameter_size;
+    result->parameter_size = (*function)->parameter_size;
     result->valid |= WindowsFrameInfo::VALID_PARAMETER_SIZE;
     return result.release();
   }
 
   // PUBLIC symbols might have a parameter size. Use the function we
   // found above to limit the range the public symbol covers.
-  linked_ptr<PublicSymbol> public_symbol;
   MemAddr public_address;
-  if (public_symbols_.Retrieve(address, &public_symbol, &public_address) &&
-      (!function.get() || public_address > function_base)) {
-    result->parameter_size = public_symbol->parameter_size;
+  const linked_ptr<PublicSymbol>* public_symbol =
+      public_symbols_.GetEntryForAddress(address, &public_address);
+  if (public_symbol && (!function || public_address > function_base)) {
+    result->parameter_size = (*public_symbol)->parameter_size;
   }
 
   return NULL;
@@ -401,49 +735,65 @@ WindowsFrameInfo* BasicSourceLineResolver::Module::FindWindowsFrameInfo(
 CFIFrameInfo* BasicSourceLineResolver::Module::FindCFIFrameInfo(
     const StackFrame* frame) const {
   MemAddr address = frame->instruction - frame->module->base_address();
-  MemAddr initial_base, initial_size;
-  string initial_rules;
+  MemAddr initial_base;
 
   // Find the initial rule whose range covers this address. That
   // provides an initial set of register recovery rules. Then, walk
   // forward from the initial rule's starting address to frame's
   // instruction address, applying delta rules.
-  if (!cfi_initial_rules_.RetrieveRange(address, &initial_rules, &initial_base,
-                                        NULL /* delta */, &initial_size)) {
+  const string* initial_rules =
+      cfi_initial_rules_.GetEntryForAddress(address, &initial_base);
+  if (!initial_rules)
     return NULL;
-  }
+
+  // The delta rules that apply are those from the initial rule's starting
+  // address up to and including the frame's address.
+  map<MemAddr, string>::const_iterator first_delta =
+    cfi_delta_rules_.lower_bound(initial_base);
+  map<MemAddr, string>::const_iterator end_delta =
+    cfi_delta_rules_.upper_bound(address);
+
+  // Every address up to the next delta rule has the same rules, so look
+  // for them in the cache before building them.
+  MemAddr rules_address = initial_base;
+  if (end_delta != first_delta)
+    rules_address = std::prev(end_delta)->first;
+  CFIFrameInfo* cached = cfi_frame_info_cache_.Find(rules_address);
+  if (cached)
+    return cached;
 
   // Create a frame info structure, and populate it with the rules from
   // the STACK CFI INIT record.
   scoped_ptr<CFIFrameInfo> rules(new CFIFrameInfo());
-  if (!ParseCFIRuleSet(initial_rules, rules.get()))
+  if (!ParseCFIRuleSet(*initial_rules, rules.get()))
     return NULL;
 
-  // Find the first delta rule that falls within the initial rule's range.
-  map<MemAddr, string>::const_iterator delta =
-    cfi_delta_rules_.lower_bound(initial_base);
-
   // Apply delta rules up to and including the frame's address.
-  while (delta != cfi_delta_rules_.end() && delta->first <= address) {
+  for (map<MemAddr, string>::const_iterator delta = first_delta;
+       delta != end_delta; ++delta) {
     ParseCFIRuleSet(delta->second, rules.get());
-    delta++;
   }
 
+  cfi_frame_info_cache_.Insert(rules_address, *rules);
   return rules.release();
 }
 
-bool BasicSourceLineResolver::Module::ParseFile(char* file_line) {
+// static
+bool BasicSourceLineResolver::Module::ParseFile(char* file_line,
+                                                Chunk* chunk) {
   long index;
   char* filename;
   if (SymbolParseHelper::ParseFile(file_line, &index, &filename)) {
-    files_.insert(make_pair(index, string(filename)));
+    chunk->files.push_back(make_pair(index, string(filename)));
+    chunk->kinds.push_back(Chunk::FILE_LINE);
     return true;
   }
   return false;
 }
 
+// static
 bool BasicSourceLineResolver::Module::ParseInlineOrigin(
-  char* inline_origin_line) {
+  char* inline_origin_line, Chunk* chunk) {
   bool has_file_id;
   long origin_id;
   long source_file_id;
@@ -451,14 +801,17 @@ bool BasicSourceLineResolver::Module::ParseInlineOrigin(
   if (SymbolParseHelper::ParseInlineOrigin(inline_origin_line, &has_file_id,
                                            &origin_id, &source_file_id,
                                            &origin_name)) {
-    inline_origins_.insert(make_pair(
+    chunk->inline_origins.push_back(make_pair(
         origin_id,
-        new InlineOrigin(has_file_id, source_file_id, origin_name)));
+        linked_ptr<InlineOrigin>(
+            new InlineOrigin(has_file_id, source_file_id, origin_name))));
+    chunk->kinds.push_back(Chunk::INLINE_ORIGIN_LINE);
     return true;
   }
   return false;
 }
 
+// static
 linked_ptr<BasicSourceLineResolver::Inline>
 BasicSourceLineResolver::Module::ParseInline(char* inline_line) {
   bool has_call_site_file_id;
@@ -477,6 +830,7 @@ BasicSourceLineResolver::Module::ParseInline(char* inline_line) {
   return linked_ptr<Inline>();
 }
 
+// static
 BasicSourceLineResolver::Function*
 BasicSourceLineResolver::Module::ParseFunction(char* function_line) {
   bool is_multiple;
@@ -491,6 +845,7 @@ BasicSourceLineResolver::Module::ParseFunction(char* function_line) {
   return NULL;
 }
 
+// static
 BasicSourceLineResolver::Line* BasicSourceLineResolver::Module::ParseLine(
     char* line_line) {
   uint64_t address;
@@ -505,7 +860,9 @@ BasicSourceLineResolver::Line* BasicSourceLineResolver::Module::ParseLine(
   return NULL;
 }
 
-bool BasicSourceLineResolver::Module::ParsePublicSymbol(char* public_line) {
+// static
+bool BasicSourceLineResolver::Module::ParsePublicSymbol(char* public_line,
+                                                        Chunk* chunk) {
   bool is_multiple;
   uint64_t address;
   long stack_param_size;
@@ -520,18 +877,23 @@ bool BasicSourceLineResolver::Module::ParsePublicSymbol(char* public_line) {
     // but since the address is obviously invalid, gracefully accept them
     // as input without putting them into the map.
     if (address == 0) {
+      chunk->kinds.push_back(Chunk::IGNORED_LINE);
       return true;
     }
 
-    linked_ptr<PublicSymbol> symbol(new PublicSymbol(name, address,
-                                                     stack_param_size,
-                                                     is_multiple));
-    return public_symbols_.Store(address, symbol);
+    // Whether the address is already taken is only known once the chunk
+    // is stored.
+    chunk->public_symbols.push_back(linked_ptr<PublicSymbol>(
+        new PublicSymbol(name, address, stack_param_size, is_multiple)));
+    chunk->kinds.push_back(Chunk::PUBLIC_LINE);
+    return true;
   }
   return false;
 }
 
-bool BasicSourceLineResolver::Module::ParseStackInfo(char* stack_info_line) {
+// static
+bool BasicSourceLineResolver::Module::ParseStackInfo(char* stack_info_line,
+                                                     Chunk* chunk) {
   // Skip "STACK " prefix.
   stack_info_line += 6;
 
@@ -556,39 +918,24 @@ bool BasicSourceLineResolver::Module::ParseStackInfo(char* stack_info_line) {
     if (stack_frame_info == NULL)
       return false;
 
-    // TODO(mmentovai): I wanted to use StoreRange's return value as this
-    // method's return value, but MSVC infrequently outputs stack info that
-    // violates the containment rules.  This happens with a section of code
-    // in strncpy_s in test_app.cc (testdata/minidump2).  There, problem looks
-    // like this:
-    //   STACK WIN 4 4242 1a a 0 ...  (STACK WIN 4 base size prolog 0 ...)
-    //   STACK WIN 4 4243 2e 9 0 ...
-    // ContainedRangeMap treats these two blocks as conflicting.  In reality,
-    // when the prolog lengths are taken into account, the actual code of
-    // these blocks doesn't conflict.  However, we can't take the prolog lengths
-    // into account directly here because we'd wind up with a different set
-    // of range conflicts when MSVC outputs stack info like this:
-    //   STACK WIN 4 1040 73 33 0 ...
-    //   STACK WIN 4 105a 59 19 0 ...
-    // because in both of these entries, the beginning of the code after the
-    // prolog is at 0x1073, and the last byte of contained code is at 0x10b2.
-    // Perhaps we could get away with storing ranges by rva + prolog_size
-    // if ContainedRangeMap were modified to allow replacement of
-    // already-stored values.
-
-    windows_frame_info_[type].StoreRange(rva, code_size, stack_frame_info);
+    // See StoreChunk() for why conflicting records are silently dropped.
+    Chunk::WindowsFrameInfoRecord record = { type, rva, code_size,
+                                             stack_frame_info };
+    chunk->windows_frame_info.push_back(record);
+    chunk->kinds.push_back(Chunk::STACK_WIN_LINE);
     return true;
   } else if (strcmp(platform, "CFI") == 0) {
     // DWARF CFI stack frame info
-    return ParseCFIFrameInfo(stack_info_line);
+    return ParseCFIFrameInfo(stack_info_line, chunk);
   } else {
     // Something unrecognized.
     return false;
   }
 }
 
+// static
 bool BasicSourceLineResolver::Module::ParseCFIFrameInfo(
-    char* stack_info_line) {
+    char* stack_info_line, Chunk* chunk) {
   char* cursor;
 
   // Is this an INIT record or a delta record?
@@ -609,7 +956,9 @@ bool BasicSourceLineResolver::Module::ParseCFIFrameInfo(
 
     MemAddr address = strtoul(address_field, NULL, 16);
     MemAddr size    = strtoul(size_field,    NULL, 16);
-    cfi_initial_rules_.StoreRange(address, size, initial_rules);
+    Chunk::CFIInitialRulesRecord record = { address, size, initial_rules };
+    chunk->cfi_initial_rules.push_back(record);
+    chunk->kinds.push_back(Chunk::STACK_CFI_INIT_LINE);
     return true;
   }
 
@@ -618,7 +967,8 @@ bool BasicSourceLineResolver::Module::ParseCFIFrameInfo(
   char* delta_rules = strtok_r(NULL, "\r\n", &cursor);
   if (!delta_rules) return false;
   MemAddr address = strtoul(address_field, NULL, 16);
-  cfi_delta_rules_[address] = delta_rules;
+  chunk->cfi_delta_rules.push_back(make_pair(address, string(delta_rules)));
+  chunk->kinds.push_back(Chunk::STACK_CFI_LINE);
   return true;
 }
 
@@ -38,6 +38,8 @@
 
 #include <map>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "common/scoped_ptr.h"
 #include "google_breakpad/processor/basic_source_line_resolver.h"
@@ -86,7 +88,11 @@ BasicSourceLineResolver::Function : public SourceLineResolverBase::Function {
 
 class BasicSourceLineResolver::Module : public SourceLineResolverBase::Module {
  public:
-  explicit Module(const string& name) : name_(name), is_corrupt_(false) { }
+  // |parse_thread_count| is the number of threads LoadMapFromMemory() may
+  // use to parse a large symbol file.  0 means one per hardware thread.
+  explicit Module(const string& name, int parse_thread_count = 1)
+      : name_(name), is_corrupt_(false),
+        parse_thread_count_(parse_thread_count) { }
   virtual ~Module() { }
 
   // Loads a map from the given buffer in char* type.
@@ -94,6 +100,9 @@ class BasicSourceLineResolver::Module : public SourceLineResolverBase::Module {
   // The passed in |memory buffer| is of size |memory_buffer_size|.  If it is
   // not null terminated, LoadMapFromMemory() will null terminate it by
   // modifying the passed in buffer.
+  // Large buffers are split into chunks at line boundaries, which are
+  // parsed in parallel and then stored in file order, so the result is the
+  // same as parsing the whole buffer on one thread.
   virtual bool LoadMapFromMemory(char* memory_buffer,
                                  size_t memory_buffer_size);
 
@@ -107,6 +116,12 @@ class BasicSourceLineResolver::Module : public SourceLineResolverBase::Module {
       StackFrame* frame,
       std::deque<std::unique_ptr<StackFrame>>* inlined_frame) const;
 
+  // Looks up |count| frames without inlined frames.  While the frames are
+  // in increasing address order, each one starts from the function and
+  // line found for the previous frame, so the function and line maps are
+  // only searched again once an address leaves them.
+  virtual void LookupAddresses(StackFrame* frames, size_t count) const;
+
   // Construct inlined frames for |frame| and store them in |inline_frames|.
   // |frame|'s source line and source file name may be updated if an inlined
   // frame is found inside |frame|. As a result, the innermost inlined frame
@@ -138,6 +153,23 @@ class BasicSourceLineResolver::Module : public SourceLineResolverBase::Module {
 
   typedef std::map<int, string> FileMap;
 
+  // The function and line that the previous address of a batch fell in.
+  // Defined in basic_source_line_resolver.cc.
+  struct LookupHint;
+
+  // Does the work of LookupAddress.  If |hint| is not NULL, the function
+  // and line it holds are tried before searching, and it is updated with
+  // those found for |frame|.
+  void LookupAddressWithHint(
+      StackFrame* frame,
+      std::deque<std::unique_ptr<StackFrame>>* inlined_frames,
+      LookupHint* hint) const;
+
+  // The records parsed from a run of lines of a symbol file, waiting to be
+  // stored in the module's tables.  Defined in
+  // basic_source_line_resolver.cc.
+  struct Chunk;
+
   // Logs parse errors.  |*num_errors| is increased every time LogParseError is
   // called.
   static void LogParseError(
@@ -145,31 +177,45 @@ class BasicSourceLineResolver::Module : public SourceLineResolverBase::Module {
       int line_number,
       int* num_errors);
 
-  // Parses a file declaration
-  bool ParseFile(char* file_line);
+  // Parses the lines of the null-terminated |data| into |chunk|, without
+  // touching the module's tables, so that chunks can be parsed on separate
+  // threads.
+  static void ParseChunk(char* data, Chunk* chunk);
 
-  // Parses an inline origin declaration.
-  bool ParseInlineOrigin(char* inline_origin_line);
+  // Stores the records of |chunk| in the module's tables, in the order they
+  // appeared.  |cur_func|, |line_number| and the error counts carry over
+  // from the previous chunk.  Returns false once there are too many errors
+  // to continue.
+  bool StoreChunk(Chunk* chunk,
+                  linked_ptr<Function>* cur_func,
+                  int* line_number,
+                  int* num_errors,
+                  int* inline_num_errors);
+
+  // Parses a file declaration into |chunk|.
+  static bool ParseFile(char* file_line, Chunk* chunk);
+
+  // Parses an inline origin declaration into |chunk|.
+  static bool ParseInlineOrigin(char* inline_origin_line, Chunk* chunk);
 
   // Parses an inline declaration.
-  linked_ptr<Inline> ParseInline(char* inline_line);
+  static linked_ptr<Inline> ParseInline(char* inline_line);
 
   // Parses a function declaration, returning a new Function object.
-  Function* ParseFunction(char* function_line);
+  static Function* ParseFunction(char* function_line);
 
   // Parses a line declaration, returning a new Line object.
-  Line* ParseLine(char* line_line);
+  static Line* ParseLine(char* line_line);
 
-  // Parses a PUBLIC symbol declaration, storing it in public_symbols_.
-  // Returns false if an error occurs.
-  bool ParsePublicSymbol(char* public_line);
+  // Parses a PUBLIC symbol declaration into |chunk|.  Returns false if an
+  // error occurs.
+  static bool ParsePublicSymbol(char* public_line, Chunk* chunk);
 
-  // Parses a STACK WIN or STACK CFI frame info declaration, storing
-  // it in the appropriate table.
-  bool ParseStackInfo(char* stack_info_line);
+  // Parses a STACK WIN or STACK CFI frame info declaration into |chunk|.
+  static bool ParseStackInfo(char* stack_info_line, Chunk* chunk);
 
-  // Parses a STACK CFI record, storing it in cfi_frame_info_.
-  bool ParseCFIFrameInfo(char* stack_info_line);
+  // Parses a STACK CFI record into |chunk|.
+  static bool ParseCFIFrameInfo(char* stack_info_line, Chunk* chunk);
 
   string name_;
   FileMap files_;
@@ -202,6 +248,13 @@ class BasicSourceLineResolver::Module : public SourceLineResolverBase::Module {
   // this map, or the end of the range as given by the cfi_initial_rules_
   // entry (which FindCFIFrameInfo looks up first).
   std::map<MemAddr, string> cfi_delta_rules_;
+
+  // The rule sets FindCFIFrameInfo has built, keyed by the address of the
+  // last STACK CFI record applied, or of the STACK CFI INIT record if
+  // there was none.
+  mutable CFIFrameInfoCache cfi_frame_info_cache_;
+
+  int parse_thread_count_;
 };
 
 }  // namespace google_breakpad
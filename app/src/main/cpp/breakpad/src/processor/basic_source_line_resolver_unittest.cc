@@ -33,7 +33,10 @@
 #include <assert.h>
 #include <stdio.h>
 
+#include <atomic>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "breakpad_googletest_includes.h"
 #include "common/scoped_ptr.h"
@@ -50,6 +53,7 @@
 namespace {
 
 using google_breakpad::BasicSourceLineResolver;
+using google_breakpad::SourceLineResolverBase;
 using google_breakpad::CFIFrameInfo;
 using google_breakpad::CodeModule;
 using google_breakpad::MemoryRegion;
@@ -388,6 +392,92 @@ TEST_F(TestBasicSourceLineResolver, TestLoadAndResolve)
   ASSERT_EQ(frame.function_name, "Public2_2");
 }
 
+// Looks up the same addresses from several threads at once, as a parallel
+// stack walk does.  Run under ThreadSanitizer to catch races in lookups.
+TEST_F(TestBasicSourceLineResolver, TestConcurrentLookups)
+{
+  TestCodeModule module1("module1");
+  ASSERT_TRUE(resolver.LoadModule(&module1, testdata_dir + "/module1.out"));
+
+  std::vector<std::thread> threads;
+  std::atomic<int> failures(0);
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([this, &module1, &failures]() {
+      for (int j = 0; j < 1000; ++j) {
+        StackFrame frame;
+        frame.instruction = 0x1000;
+        frame.module = &module1;
+        resolver.FillSourceLineInfo(&frame, nullptr);
+        if (frame.function_name != "Function1_1")
+          ++failures;
+        scoped_ptr<WindowsFrameInfo> windows_frame_info(
+            resolver.FindWindowsFrameInfo(&frame));
+        if (!windows_frame_info.get())
+          ++failures;
+
+        frame.instruction = 0x2900;
+        resolver.FillSourceLineInfo(&frame, nullptr);
+        if (frame.function_name != "PublicSymbol")
+          ++failures;
+      }
+    });
+  }
+  for (std::thread& thread : threads)
+    thread.join();
+  EXPECT_EQ(0, failures);
+}
+
+// FillSourceLineInfos must resolve every address exactly as
+// FillSourceLineInfo does, whether or not the addresses are sorted.
+TEST_F(TestBasicSourceLineResolver, TestFillSourceLineInfos)
+{
+  TestCodeModule module1("module1");
+  ASSERT_TRUE(resolver.LoadModule(&module1, testdata_dir + "/module1.out"));
+  TestCodeModule module2("module2");
+  ASSERT_TRUE(resolver.LoadModule(&module2, testdata_dir + "/module2.out"));
+  TestCodeModule unloaded("unloaded");
+
+  std::vector<SourceLineResolverBase::ModuleOffset> addresses;
+  const CodeModule* modules[] = { &module1, &module2, &unloaded, NULL };
+  for (const CodeModule* module : modules) {
+    for (uint64_t offset = 0; offset < 0x3800; offset += 0x7)
+      addresses.push_back(std::make_pair(module, offset));
+  }
+  // Visit module1 again, out of order.
+  for (uint64_t offset = 0x3800; offset >= 0x35; offset -= 0x35)
+    addresses.push_back(std::make_pair(&module1, offset));
+
+  std::vector<StackFrame> frames;
+  resolver.FillSourceLineInfos(addresses, &frames);
+  ASSERT_EQ(addresses.size(), frames.size());
+
+  int resolved = 0;
+  for (size_t i = 0; i < addresses.size(); ++i) {
+    StackFrame expected;
+    expected.module = addresses[i].first;
+    expected.instruction = addresses[i].second;
+    resolver.FillSourceLineInfo(&expected, nullptr);
+
+    const StackFrame& frame = frames[i];
+    ASSERT_EQ(expected.module, frame.module);
+    ASSERT_EQ(expected.instruction, frame.instruction);
+    ASSERT_EQ(expected.function_name, frame.function_name);
+    ASSERT_EQ(expected.function_base, frame.function_base);
+    ASSERT_EQ(expected.source_file_name, frame.source_file_name);
+    ASSERT_EQ(expected.source_line, frame.source_line);
+    ASSERT_EQ(expected.source_line_base, frame.source_line_base);
+    ASSERT_EQ(expected.is_multiple, frame.is_multiple);
+    if (!frame.function_name.empty())
+      ++resolved;
+  }
+  // Make sure the addresses covered both functions and public symbols.
+  ASSERT_GT(resolved, 100);
+
+  resolver.FillSourceLineInfos(
+      std::vector<SourceLineResolverBase::ModuleOffset>(), &frames);
+  ASSERT_TRUE(frames.empty());
+}
+
 TEST_F(TestBasicSourceLineResolver, TestInvalidLoads)
 {
   TestCodeModule module3("module3");
@@ -510,6 +600,91 @@ TEST_F(TestBasicSourceLineResolver, TestLoadAndResolveNewInlines) {
   ASSERT_EQ(inlined_frames[0]->trust, StackFrame::FRAME_TRUST_INLINE);
 }
 
+// Symbol data big enough to be split into several chunks, with function
+// bodies and records that conflict with earlier ones crossing the chunk
+// boundaries.
+static string MakeLargeSymbolData() {
+  string data = "MODULE Linux x86 0 large\n";
+  char line[128];
+  for (int file = 0; file < 100; ++file) {
+    snprintf(line, sizeof(line), "FILE %d source_%d.cc\n", file, file);
+    data += line;
+  }
+  const int kFunctionCount = 30000;
+  for (int function = 0; function < kFunctionCount; ++function) {
+    uint64_t address = 0x1000 + function * 0x40;
+    snprintf(line, sizeof(line), "FUNC %llx 40 0 function_%d\n",
+             static_cast<unsigned long long>(address), function);
+    data += line;
+    for (int i = 0; i < 8; ++i) {
+      snprintf(line, sizeof(line), "%llx 8 %d %d\n",
+               static_cast<unsigned long long>(address + i * 8),
+               function + i, function % 100);
+      data += line;
+    }
+  }
+  // Conflicts with function_0, which must win.
+  data += "FUNC 1000 10 0 conflicting_function\n";
+  data += "PUBLIC 1000 0 public_0\n";
+  data += "PUBLIC 1000 0 duplicate_public\n";
+  for (int function = 0; function < kFunctionCount; ++function) {
+    uint64_t address = 0x1000 + function * 0x40;
+    snprintf(line, sizeof(line),
+             "STACK CFI INIT %llx 40 .cfa: $esp 4 + .ra: .cfa 4 - ^\n",
+             static_cast<unsigned long long>(address));
+    data += line;
+    snprintf(line, sizeof(line), "STACK CFI %llx .cfa: $esp %d +\n",
+             static_cast<unsigned long long>(address + 4), function % 64);
+    data += line;
+  }
+  return data;
+}
+
+TEST_F(TestBasicSourceLineResolver, TestParallelParseMatchesSerial) {
+  string symbol_data = MakeLargeSymbolData();
+  ASSERT_GT(symbol_data.size(), 4U << 20);
+
+  TestCodeModule module("large");
+  BasicSourceLineResolver parallel_resolver;
+  parallel_resolver.set_parse_thread_count(4);
+  ASSERT_TRUE(resolver.LoadModuleUsingMapBuffer(&module, symbol_data));
+  ASSERT_TRUE(parallel_resolver.LoadModuleUsingMapBuffer(&module,
+                                                         symbol_data));
+  // The duplicate PUBLIC record is an error either way.
+  EXPECT_TRUE(resolver.IsModuleCorrupt(&module));
+  EXPECT_TRUE(parallel_resolver.IsModuleCorrupt(&module));
+
+  for (uint64_t address = 0x1000; address < 0x1000 + 30000 * 0x40;
+       address += 0x1c) {
+    StackFrame frame;
+    frame.instruction = address;
+    frame.module = &module;
+    resolver.FillSourceLineInfo(&frame, nullptr);
+    StackFrame parallel_frame;
+    parallel_frame.instruction = address;
+    parallel_frame.module = &module;
+    parallel_resolver.FillSourceLineInfo(&parallel_frame, nullptr);
+    ASSERT_EQ(frame.function_name, parallel_frame.function_name);
+    ASSERT_EQ(frame.function_base, parallel_frame.function_base);
+    ASSERT_EQ(frame.source_file_name, parallel_frame.source_file_name);
+    ASSERT_EQ(frame.source_line, parallel_frame.source_line);
+
+    scoped_ptr<CFIFrameInfo> cfi(resolver.FindCFIFrameInfo(&frame));
+    scoped_ptr<CFIFrameInfo> parallel_cfi(
+        parallel_resolver.FindCFIFrameInfo(&parallel_frame));
+    ASSERT_TRUE(cfi.get());
+    ASSERT_TRUE(parallel_cfi.get());
+    ASSERT_EQ(cfi->Serialize(), parallel_cfi->Serialize());
+  }
+
+  StackFrame frame;
+  frame.instruction = 0x1000;
+  frame.module = &module;
+  parallel_resolver.FillSourceLineInfo(&frame, nullptr);
+  EXPECT_EQ("function_0", frame.function_name);
+  EXPECT_EQ("source_0.cc", frame.source_file_name);
+}
+
 // Test parsing of valid FILE lines.  The format is:
 // FILE <id> <filename>
 TEST(SymbolParseHelper, ParseFileValid) {
@@ -35,10 +35,34 @@
 #ifndef PROCESSOR_CFI_FRAME_INFO_INL_H_
 #define PROCESSOR_CFI_FRAME_INFO_INL_H_
 
+#include <assert.h>
 #include <string.h>
 
 namespace google_breakpad {
 
+template <typename RegisterType, class RawContextType>
+SimpleCFIWalker<RegisterType, RawContextType>::SimpleCFIWalker(
+    const RegisterSet* register_map, size_t map_size)
+    : register_map_(register_map), map_size_(map_size) {
+  for (size_t i = 0; i < map_size_; i++)
+    names_.push_back(register_map_[i].name);
+  for (size_t i = 0; i < map_size_; i++) {
+    const char* alternate = register_map_[i].alternate_name;
+    if (!alternate) {
+      alternates_.push_back(ALTERNATE_NONE);
+    } else if (strcmp(alternate, ".ra") == 0) {
+      alternates_.push_back(ALTERNATE_RA);
+    } else if (strcmp(alternate, ".cfa") == 0) {
+      alternates_.push_back(ALTERNATE_CFA);
+    } else {
+      alternates_.push_back(names_.size());
+      names_.push_back(alternate);
+    }
+  }
+  assert(names_.size() <=
+         CFIFrameInfo::RegisterFile<RegisterType>::kMaxRegisters);
+}
+
 template <typename RegisterType, class RawContextType>
 bool SimpleCFIWalker<RegisterType, RawContextType>::FindCallerRegisters(
     const MemoryRegion& memory,
@@ -47,22 +71,22 @@ bool SimpleCFIWalker<RegisterType, RawContextType>::FindCallerRegisters(
     int callee_validity,
     RawContextType* caller_context,
     int* caller_validity) const {
-  typedef CFIFrameInfo::RegisterValueMap<RegisterType> ValueMap;
-  ValueMap callee_registers;
-  ValueMap caller_registers;
-  // Just for brevity.
-  typename ValueMap::const_iterator caller_none = caller_registers.end();
+  typedef CFIFrameInfo::RegisterFile<RegisterType> Registers;
+  Registers callee_registers;
+  Registers caller_registers;
+  RegisterType cfa, ra;
 
   // Populate callee_registers with register values from callee_context.
   for (size_t i = 0; i < map_size_; i++) {
     const RegisterSet& r = register_map_[i];
     if (callee_validity & r.validity_flag)
-      callee_registers[r.name] = callee_context.*r.context_member;
+      callee_registers.Set(i, callee_context.*r.context_member);
   }
 
   // Apply the rules, and see what register values they yield.
-  if (!cfi_frame_info.FindCallerRegs<RegisterType>(callee_registers, memory,
-                                                   &caller_registers))
+  if (!cfi_frame_info.FindCallerRegs<RegisterType>(
+          names_.data(), names_.size(), callee_registers, memory,
+          &caller_registers, &cfa, &ra))
     return false;
 
   // Populate *caller_context with the values the rules placed in
@@ -71,25 +95,27 @@ bool SimpleCFIWalker<RegisterType, RawContextType>::FindCallerRegisters(
   *caller_validity = 0;
   for (size_t i = 0; i < map_size_; i++) {
     const RegisterSet& r = register_map_[i];
-    typename ValueMap::const_iterator caller_entry;
 
     // Did the rules provide a value for this register by its name?
-    caller_entry = caller_registers.find(r.name);
-    if (caller_entry != caller_none) {
-      caller_context->*r.context_member = caller_entry->second;
+    if (caller_registers.Has(i)) {
+      caller_context->*r.context_member = caller_registers.Get(i);
       *caller_validity |= r.validity_flag;
       continue;
     }
 
     // Did the rules provide a value for this register under its
     // alternate name?
-    if (r.alternate_name) {
-      caller_entry = caller_registers.find(r.alternate_name);
-      if (caller_entry != caller_none) {
-        caller_context->*r.context_member = caller_entry->second;
-        *caller_validity |= r.validity_flag;
-        continue;
-      }
+    int alternate = alternates_[i];
+    if (alternate == ALTERNATE_RA || alternate == ALTERNATE_CFA) {
+      caller_context->*r.context_member =
+          alternate == ALTERNATE_RA ? ra : cfa;
+      *caller_validity |= r.validity_flag;
+      continue;
+    }
+    if (alternate >= 0 && caller_registers.Has(alternate)) {
+      caller_context->*r.context_member = caller_registers.Get(alternate);
+      *caller_validity |= r.validity_flag;
+      continue;
     }
 
     // Is this a callee-saves register? The walker assumes that these
@@ -37,11 +37,17 @@
 
 #include "processor/cfi_frame_info.h"
 
+#include <assert.h>
+#include <ctype.h>
+#include <stdint.h>
 #include <string.h>
 
+#include <algorithm>
+#include <mutex>
 #include <sstream>
 
 #include "common/scoped_ptr.h"
+#include "processor/logging.h"
 #include "processor/postfix_evaluator-inl.h"
 
 namespace google_breakpad {
@@ -50,40 +56,339 @@ namespace google_breakpad {
 #define strtok_r strtok_s
 #endif
 
+namespace {
+
+// The deepest stack a compiled expression may use.  STACK CFI expressions
+// rarely need more than three entries.
+const size_t kMaxStackDepth = 32;
+
+// Returns true if |token| is a decimal literal, as PostfixEvaluator would
+// read it, and sets |magnitude| and |negative| accordingly.  Sets
+// |unsupported| if PostfixEvaluator might read |token| as some other
+// literal.
+bool ParseLiteral(const string& token, uint64_t* magnitude, bool* negative,
+                  bool* unsupported) {
+  size_t start = token[0] == '-' ? 1 : 0;
+  *negative = start == 1;
+  *unsupported = false;
+  if (start == token.size() || !isdigit(static_cast<unsigned char>(
+          token[start]))) {
+    // Signs and leading whitespace mean something to istream, so leave
+    // anything that isn't plainly an identifier to PostfixEvaluator.
+    *unsupported = token[0] == '+' || (start == 1 && token.size() > 1);
+    return false;
+  }
+  uint64_t value = 0;
+  for (size_t i = start; i < token.size(); ++i) {
+    if (!isdigit(static_cast<unsigned char>(token[i])) ||
+        value > (UINT64_MAX - (token[i] - '0')) / 10) {
+      *unsupported = true;
+      return false;
+    }
+    value = value * 10 + (token[i] - '0');
+  }
+  *magnitude = value;
+  return true;
+}
+
+// Registers for CFIFrameInfo::EvaluateRule, looked up by name in a
+// RegisterValueMap.
+template<typename V>
+class MapRegisters {
+ public:
+  MapRegisters(const CFIFrameInfo::RegisterValueMap<V>& registers,
+               const std::vector<string>& names)
+      : registers_(registers), names_(names) { }
+
+  bool Get(size_t name, V* value) const {
+    typename CFIFrameInfo::RegisterValueMap<V>::const_iterator it =
+        registers_.find(names_[name]);
+    if (it == registers_.end())
+      return false;
+    *value = it->second;
+    return true;
+  }
+
+  void Fill(CFIFrameInfo::RegisterValueMap<V>* map) const {
+    *map = registers_;
+  }
+
+ private:
+  const CFIFrameInfo::RegisterValueMap<V>& registers_;
+  const std::vector<string>& names_;
+};
+
+// Registers for CFIFrameInfo::EvaluateRule, looked up by number in a
+// RegisterFile.  |numbers| maps indices of the rules' names to register
+// numbers, or to -1 for names that aren't registers.
+template<typename V>
+class FileRegisters {
+ public:
+  FileRegisters(const CFIFrameInfo::RegisterFile<V>& registers,
+                const int* numbers,
+                const char* const* register_names,
+                size_t register_count)
+      : registers_(registers),
+        numbers_(numbers),
+        register_names_(register_names),
+        register_count_(register_count) { }
+
+  bool Get(size_t name, V* value) const {
+    int number = numbers_[name];
+    if (number < 0 || !registers_.Has(number))
+      return false;
+    *value = registers_.Get(number);
+    return true;
+  }
+
+  void Fill(CFIFrameInfo::RegisterValueMap<V>* map) const {
+    map->clear();
+    for (size_t i = 0; i < register_count_; ++i) {
+      if (registers_.Has(i))
+        (*map)[register_names_[i]] = registers_.Get(i);
+    }
+  }
+
+ private:
+  const CFIFrameInfo::RegisterFile<V>& registers_;
+  const int* numbers_;
+  const char* const* register_names_;
+  size_t register_count_;
+};
+
+}  // namespace
+
+CFIFrameInfo::Rules* CFIFrameInfo::MutableRules() {
+  if (!rules_)
+    rules_ = std::make_shared<Rules>();
+  else if (rules_.use_count() > 1)
+    rules_ = std::make_shared<Rules>(*rules_);
+  return rules_.get();
+}
+
+void CFIFrameInfo::SetCFARule(const string& expression) {
+  SetRule(expression, &MutableRules()->cfa_rule);
+}
+
+void CFIFrameInfo::SetRARule(const string& expression) {
+  SetRule(expression, &MutableRules()->ra_rule);
+}
+
+void CFIFrameInfo::SetRegisterRule(const string& register_name,
+                                   const string& expression) {
+  Rules* rules = MutableRules();
+  Rule* rule = &rules->register_rules[register_name];
+  rule->name = InternName(register_name, rules);
+  SetRule(expression, rule);
+}
+
+// static
+size_t CFIFrameInfo::InternName(const string& name, Rules* rules) {
+  std::vector<string>::iterator it =
+      std::find(rules->names.begin(), rules->names.end(), name);
+  if (it != rules->names.end())
+    return it - rules->names.begin();
+  if (name == ".cfa")
+    rules->cfa_name = rules->names.size();
+  rules->names.push_back(name);
+  return rules->names.size() - 1;
+}
+
+void CFIFrameInfo::SetRule(const string& expression, Rule* rule) {
+  Rules* rules = rules_.get();
+  rule->expression = expression;
+  rule->compiled = false;
+  rule->operations.clear();
+
+  size_t depth = 0;
+  size_t position = 0;
+  string token;
+  for (;;) {
+    position = expression.find_first_not_of(" \t\r\n", position);
+    if (position == string::npos)
+      break;
+    size_t token_end = expression.find_first_of(" \t\r\n", position);
+    if (token_end == string::npos)
+      token_end = expression.size();
+    token.assign(expression, position, token_end - position);
+    position = token_end;
+
+    Operation operation;
+    operation.operand = 0;
+    size_t pops = 0;
+    if (token == "+") {
+      operation.code = Operation::ADD;
+      pops = 2;
+    } else if (token == "-") {
+      operation.code = Operation::SUBTRACT;
+      pops = 2;
+    } else if (token == "*") {
+      operation.code = Operation::MULTIPLY;
+      pops = 2;
+    } else if (token == "/") {
+      operation.code = Operation::DIVIDE;
+      pops = 2;
+    } else if (token == "%") {
+      operation.code = Operation::MODULUS;
+      pops = 2;
+    } else if (token == "@") {
+      operation.code = Operation::ALIGN;
+      pops = 2;
+    } else if (token == "^") {
+      operation.code = Operation::DEREFERENCE;
+      pops = 1;
+    } else if (token[0] == '=') {
+      // Assignments are left to PostfixEvaluator.
+      return;
+    } else {
+      uint64_t magnitude;
+      bool negative, unsupported;
+      if (ParseLiteral(token, &magnitude, &negative, &unsupported)) {
+        operation.code = negative ? Operation::PUSH_NEGATED_CONSTANT :
+                                    Operation::PUSH_CONSTANT;
+        operation.operand = magnitude;
+      } else if (unsupported) {
+        return;
+      } else {
+        operation.code = Operation::PUSH_REGISTER;
+        operation.operand = InternName(token, rules);
+      }
+    }
+
+    // Check the stack statically, so that evaluation needn't.
+    if (depth < pops)
+      return;
+    depth = depth - pops + 1;
+    if (depth > kMaxStackDepth)
+      return;
+    rule->operations.push_back(operation);
+  }
+
+  rule->compiled = depth == 1;
+  if (!rule->compiled)
+    rule->operations.clear();
+}
+
+template<typename V, typename Registers>
+bool CFIFrameInfo::EvaluateRule(const Rule& rule,
+                                const Registers& registers,
+                                const V* cfa,
+                                const MemoryRegion& memory,
+                                V* value) const {
+  if (!rule.compiled) {
+    RegisterValueMap<V> working;
+    registers.Fill(&working);
+    if (cfa)
+      working[".cfa"] = *cfa;
+    PostfixEvaluator<V> evaluator(&working, &memory);
+    return evaluator.EvaluateForValue(rule.expression, value);
+  }
+
+  V stack[kMaxStackDepth];
+  size_t depth = 0;
+  for (const Operation& operation : rule.operations) {
+    switch (operation.code) {
+      case Operation::PUSH_CONSTANT:
+      case Operation::PUSH_NEGATED_CONSTANT: {
+        // PostfixEvaluator can't read a literal that doesn't fit in V.
+        V constant = static_cast<V>(operation.operand);
+        if (constant != operation.operand)
+          return false;
+        stack[depth++] = operation.code == Operation::PUSH_CONSTANT ?
+            constant : -constant;
+        break;
+      }
+      case Operation::PUSH_REGISTER: {
+        if (cfa && operation.operand == rules_->cfa_name) {
+          stack[depth++] = *cfa;
+          break;
+        }
+        if (!registers.Get(operation.operand, &stack[depth])) {
+          BPLOG(INFO) << "Identifier " << rules_->names[operation.operand]
+                      << " not in dictionary";
+          return false;
+        }
+        ++depth;
+        break;
+      }
+      case Operation::DEREFERENCE: {
+        V address = stack[depth - 1];
+        if (!memory.GetMemoryAtAddress(address, &stack[depth - 1])) {
+          BPLOG(ERROR) << "Could not dereference memory at address " <<
+                          HexString(address) << ": " << rule.expression;
+          return false;
+        }
+        break;
+      }
+      default: {
+        V operand2 = stack[--depth];
+        V& operand1 = stack[depth - 1];
+        switch (operation.code) {
+          case Operation::ADD:
+            operand1 += operand2;
+            break;
+          case Operation::SUBTRACT:
+            operand1 -= operand2;
+            break;
+          case Operation::MULTIPLY:
+            operand1 *= operand2;
+            break;
+          case Operation::DIVIDE:
+          case Operation::MODULUS:
+            if (operand2 == 0) {
+              BPLOG(ERROR) << "Division by zero: " << rule.expression;
+              return false;
+            }
+            if (operation.code == Operation::DIVIDE)
+              operand1 /= operand2;
+            else
+              operand1 %= operand2;
+            break;
+          case Operation::ALIGN:
+            operand1 &= static_cast<V>(-1) ^ (operand2 - 1);
+            break;
+          default:
+            assert(false);
+            return false;
+        }
+        break;
+      }
+    }
+  }
+
+  *value = stack[0];
+  return true;
+}
+
 template<typename V>
 bool CFIFrameInfo::FindCallerRegs(const RegisterValueMap<V>& registers,
                                   const MemoryRegion& memory,
                                   RegisterValueMap<V>* caller_registers) const {
   // If there are not rules for both .ra and .cfa in effect at this address,
   // don't use this CFI data for stack walking.
-  if (cfa_rule_.empty() || ra_rule_.empty())
+  if (!rules_ || rules_->cfa_rule.expression.empty() ||
+      rules_->ra_rule.expression.empty())
     return false;
 
-  RegisterValueMap<V> working;
-  PostfixEvaluator<V> evaluator(&working, &memory);
-
+  MapRegisters<V> lookup(registers, rules_->names);
   caller_registers->clear();
 
   // First, compute the CFA.
   V cfa;
-  working = registers;
-  if (!evaluator.EvaluateForValue(cfa_rule_, &cfa))
+  if (!EvaluateRule(rules_->cfa_rule, lookup, static_cast<const V*>(NULL),
+                    memory, &cfa))
     return false;
 
   // Then, compute the return address.
   V ra;
-  working = registers;
-  working[".cfa"] = cfa;
-  if (!evaluator.EvaluateForValue(ra_rule_, &ra))
+  if (!EvaluateRule(rules_->ra_rule, lookup, &cfa, memory, &ra))
     return false;
 
-  // Now, compute values for all the registers register_rules_ mentions.
-  for (RuleMap::const_iterator it = register_rules_.begin();
-       it != register_rules_.end(); it++) {
+  // Now, compute values for all the registers register_rules mentions.
+  for (RuleMap::const_iterator it = rules_->register_rules.begin();
+       it != rules_->register_rules.end(); it++) {
     V value;
-    working = registers;
-    working[".cfa"] = cfa;
-    if (!evaluator.EvaluateForValue(it->second, &value))
+    if (!EvaluateRule(it->second, lookup, &cfa, memory, &value))
       continue;
     (*caller_registers)[it->first] = value;
   }
@@ -94,6 +399,75 @@ bool CFIFrameInfo::FindCallerRegs(const RegisterValueMap<V>& registers,
   return true;
 }
 
+template<typename V>
+bool CFIFrameInfo::FindCallerRegs(const char* const* register_names,
+                                  size_t register_count,
+                                  const RegisterFile<V>& registers,
+                                  const MemoryRegion& memory,
+                                  RegisterFile<V>* caller_registers,
+                                  V* cfa,
+                                  V* ra) const {
+  assert(register_count <= RegisterFile<V>::kMaxRegisters);
+  if (!rules_ || rules_->cfa_rule.expression.empty() ||
+      rules_->ra_rule.expression.empty())
+    return false;
+
+  // Number the names the rules use.  Rule sets rarely name more than a
+  // dozen registers; go through a RegisterValueMap for any that name more
+  // than fit here.
+  const size_t kMaxNames = 64;
+  size_t name_count = rules_->names.size();
+  if (name_count > kMaxNames) {
+    RegisterValueMap<V> callee_map, caller_map;
+    FileRegisters<V>(registers, NULL, register_names,
+                     register_count).Fill(&callee_map);
+    if (!FindCallerRegs(callee_map, memory, &caller_map))
+      return false;
+    *caller_registers = RegisterFile<V>();
+    for (size_t i = 0; i < register_count; ++i) {
+      typename RegisterValueMap<V>::const_iterator it =
+          caller_map.find(register_names[i]);
+      if (it != caller_map.end())
+        caller_registers->Set(i, it->second);
+    }
+    *cfa = caller_map[".cfa"];
+    *ra = caller_map[".ra"];
+    return true;
+  }
+  int numbers[kMaxNames];
+  for (size_t i = 0; i < name_count; ++i) {
+    numbers[i] = -1;
+    for (size_t j = 0; j < register_count; ++j) {
+      if (rules_->names[i] == register_names[j]) {
+        numbers[i] = j;
+        break;
+      }
+    }
+  }
+
+  FileRegisters<V> lookup(registers, numbers, register_names, register_count);
+  *caller_registers = RegisterFile<V>();
+
+  if (!EvaluateRule(rules_->cfa_rule, lookup, static_cast<const V*>(NULL),
+                    memory, cfa))
+    return false;
+  if (!EvaluateRule(rules_->ra_rule, lookup, cfa, memory, ra))
+    return false;
+
+  // Recover the registers that register_rules mentions and that have
+  // numbers.
+  for (RuleMap::const_iterator it = rules_->register_rules.begin();
+       it != rules_->register_rules.end(); it++) {
+    int number = numbers[it->second.name];
+    V value;
+    if (number < 0 || !EvaluateRule(it->second, lookup, cfa, memory, &value))
+      continue;
+    caller_registers->Set(number, value);
+  }
+
+  return true;
+}
+
 // Explicit instantiations for 32-bit and 64-bit architectures.
 template bool CFIFrameInfo::FindCallerRegs<uint32_t>(
     const RegisterValueMap<uint32_t>& registers,
@@ -103,29 +477,61 @@ template bool CFIFrameInfo::FindCallerRegs<uint64_t>(
     const RegisterValueMap<uint64_t>& registers,
     const MemoryRegion& memory,
     RegisterValueMap<uint64_t>* caller_registers) const;
+template bool CFIFrameInfo::FindCallerRegs<uint32_t>(
+    const char* const* register_names,
+    size_t register_count,
+    const RegisterFile<uint32_t>& registers,
+    const MemoryRegion& memory,
+    RegisterFile<uint32_t>* caller_registers,
+    uint32_t* cfa,
+    uint32_t* ra) const;
+template bool CFIFrameInfo::FindCallerRegs<uint64_t>(
+    const char* const* register_names,
+    size_t register_count,
+    const RegisterFile<uint64_t>& registers,
+    const MemoryRegion& memory,
+    RegisterFile<uint64_t>* caller_registers,
+    uint64_t* cfa,
+    uint64_t* ra) const;
 
 string CFIFrameInfo::Serialize() const {
   std::ostringstream stream;
+  if (!rules_)
+    return stream.str();
 
-  if (!cfa_rule_.empty()) {
-    stream << ".cfa: " << cfa_rule_;
+  if (!rules_->cfa_rule.expression.empty()) {
+    stream << ".cfa: " << rules_->cfa_rule.expression;
   }
-  if (!ra_rule_.empty()) {
+  if (!rules_->ra_rule.expression.empty()) {
     if (static_cast<std::streamoff>(stream.tellp()) != 0)
       stream << " ";
-    stream << ".ra: " << ra_rule_;
+    stream << ".ra: " << rules_->ra_rule.expression;
   }
-  for (RuleMap::const_iterator iter = register_rules_.begin();
-       iter != register_rules_.end();
+  for (RuleMap::const_iterator iter = rules_->register_rules.begin();
+       iter != rules_->register_rules.end();
        ++iter) {
     if (static_cast<std::streamoff>(stream.tellp()) != 0)
       stream << " ";
-    stream << iter->first << ": " << iter->second;
+    stream << iter->first << ": " << iter->second.expression;
   }
 
   return stream.str();
 }
 
+CFIFrameInfo* CFIFrameInfoCache::Find(uint64_t key) const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  std::unordered_map<uint64_t, CFIFrameInfo>::const_iterator it =
+      entries_.find(key);
+  if (it == entries_.end())
+    return NULL;
+  return new CFIFrameInfo(it->second);
+}
+
+void CFIFrameInfoCache::Insert(uint64_t key, const CFIFrameInfo& frame_info) {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  entries_.emplace(key, frame_info);
+}
+
 bool CFIRuleParser::Parse(const string& rule_set) {
   size_t rule_set_len = rule_set.size();
   scoped_array<char> working_copy(new char[rule_set_len + 1]);
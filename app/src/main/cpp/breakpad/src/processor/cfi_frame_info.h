@@ -37,8 +37,14 @@
 #ifndef PROCESSOR_CFI_FRAME_INFO_H_
 #define PROCESSOR_CFI_FRAME_INFO_H_
 
+#include <stdint.h>
+
 #include <map>
+#include <memory>
+#include <shared_mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "common/using_std_string.h"
 #include "google_breakpad/common/breakpad_types.h"
@@ -68,14 +74,40 @@ class CFIFrameInfo {
   template<typename ValueType> class RegisterValueMap: 
     public map<string, ValueType> { };
 
+  // The values of an architecture's registers, indexed by register number,
+  // with a bit set in valid() for each register whose value is known.
+  // Stack walkers that know their architecture's register set use this
+  // rather than a RegisterValueMap, since it involves no allocation and no
+  // string keys.
+  template<typename ValueType> class RegisterFile {
+   public:
+    // The most registers a RegisterFile can hold.
+    static const size_t kMaxRegisters = 64;
+
+    RegisterFile() : valid_(0) { }
+
+    bool Has(size_t number) const { return (valid_ >> number) & 1; }
+    ValueType Get(size_t number) const { return values_[number]; }
+    void Set(size_t number, ValueType value) {
+      values_[number] = value;
+      valid_ |= static_cast<uint64_t>(1) << number;
+    }
+    uint64_t valid() const { return valid_; }
+
+   private:
+    uint64_t valid_;
+    ValueType values_[kMaxRegisters];
+  };
+
   // Set the expression for computing a call frame address, return
   // address, or register's value. At least the CFA rule and the RA
   // rule must be set before calling FindCallerRegs.
-  void SetCFARule(const string& expression) { cfa_rule_ = expression; }
-  void SetRARule(const string& expression)  { ra_rule_ = expression; }
-  void SetRegisterRule(const string& register_name, const string& expression) {
-    register_rules_[register_name] = expression;
-  }
+  //
+  // Each expression is compiled when it is set, so that FindCallerRegs
+  // doesn't have to parse it again.
+  void SetCFARule(const string& expression);
+  void SetRARule(const string& expression);
+  void SetRegisterRule(const string& register_name, const string& expression);
 
   // Compute the values of the calling frame's registers, according to
   // this rule set. Use ValueType in expression evaluation; this
@@ -99,38 +131,146 @@ class CFIFrameInfo {
                       const MemoryRegion& memory,
                       RegisterValueMap<ValueType>* caller_registers) const;
 
+  // The same, but with registers identified by number: REGISTER_NAMES[i]
+  // is the name that STACK CFI rules use for register number i, for each
+  // of the REGISTER_COUNT registers. CALLER_REGISTERS is populated with
+  // the recoverable registers that have numbers, and *CFA and *RA are set
+  // to the call frame address and return address.
+  template<typename ValueType>
+  bool FindCallerRegs(const char* const* register_names,
+                      size_t register_count,
+                      const RegisterFile<ValueType>& registers,
+                      const MemoryRegion& memory,
+                      RegisterFile<ValueType>* caller_registers,
+                      ValueType* cfa,
+                      ValueType* ra) const;
+
   // Serialize the rules in this object into a string in the format
   // of STACK CFI records.
   string Serialize() const;
 
  private:
+  // In this type, a "postfix expression" is an expression of the sort
+  // interpreted by google_breakpad::PostfixEvaluator.
+
+  // One step of a compiled postfix expression.
+  struct Operation {
+    enum Code {
+      PUSH_CONSTANT,           // Push operand.
+      PUSH_NEGATED_CONSTANT,   // Push -operand.
+      PUSH_REGISTER,           // Push the register named names[operand].
+      ADD,
+      SUBTRACT,
+      MULTIPLY,
+      DIVIDE,
+      MODULUS,
+      ALIGN,
+      DEREFERENCE
+    };
+    Code code;
+    uint64_t operand;
+  };
+
+  // A postfix expression compiled into operations on a fixed-size stack
+  // of values, so that evaluating it involves no tokenizing and no
+  // conversion of values to and from strings.  Expressions using features
+  // that only PostfixEvaluator supports, such as assignment, are not
+  // compiled, and are evaluated from their text instead.
+  struct Rule {
+    Rule() : name(0), compiled(false) { }
+
+    // For a register rule, the index in Rules::names of the register it
+    // recovers.
+    size_t name;
+
+    // The expression's text.
+    string expression;
+
+    // True if operations holds the compiled expression.  Compilation
+    // checks that every operation has its operands, and that the
+    // expression leaves exactly one value.
+    bool compiled;
+    std::vector<Operation> operations;
+  };
 
   // A map from register names onto evaluation rules. 
-  typedef map<string, string> RuleMap;
+  typedef map<string, Rule> RuleMap;
+
+  // The rules themselves.  A copy of a CFIFrameInfo shares them with the
+  // original until either is changed, so copying is cheap.
+  struct Rules {
+    Rules() : cfa_name(SIZE_MAX) { }
+
+    // A postfix expression for computing the current frame's CFA (call
+    // frame address). The CFA is a reference address for the frame that
+    // remains unchanged throughout the frame's lifetime. You should
+    // evaluate this expression with a dictionary initially populated
+    // with the values of the current frame's known registers.
+    Rule cfa_rule;
+
+    // The following expressions should be evaluated with a dictionary
+    // initially populated with the values of the current frame's known
+    // registers, and with ".cfa" set to the result of evaluating the
+    // cfa_rule expression, above.
+
+    // A postfix expression for computing the current frame's return
+    // address. 
+    Rule ra_rule;
+
+    // For a register named REG, rules[REG] is a postfix expression
+    // which leaves the value of REG in the calling frame on the top of
+    // the stack. You should evaluate this expression
+    RuleMap register_rules;
+
+    // The names of the registers that compiled rules refer to or register
+    // rules recover, and the index of ".cfa" among them, if present.
+    std::vector<string> names;
+    size_t cfa_name;
+  };
 
-  // In this type, a "postfix expression" is an expression of the sort
-  // interpreted by google_breakpad::PostfixEvaluator.
+  // Returns rules_, first making a copy of them that this object alone
+  // owns if they are shared.
+  Rules* MutableRules();
+
+  // Returns the index of |name| in the names of |rules|, adding it if
+  // necessary.
+  static size_t InternName(const string& name, Rules* rules);
+
+  // Sets |rule| to |expression|, compiling it if possible.
+  void SetRule(const string& expression, Rule* rule);
+
+  // Evaluates |rule| with the register values in |registers|, which
+  // provides Get(name, &value), to look up a register by its index in
+  // rules_->names, and Fill(&map), to copy all of its registers into a
+  // RegisterValueMap.  If |cfa| is not NULL, it is the value of ".cfa".
+  // Returns false if the expression cannot be evaluated.
+  template<typename ValueType, typename Registers>
+  bool EvaluateRule(const Rule& rule,
+                    const Registers& registers,
+                    const ValueType* cfa,
+                    const MemoryRegion& memory,
+                    ValueType* value) const;
+
+  std::shared_ptr<Rules> rules_;
+};
+
+// A thread-safe cache of CFIFrameInfo objects, for the modules of
+// source line resolvers to keep the rule sets they have already built.
+// Building the rule set in effect at an address means parsing its STACK
+// CFI INIT record and every STACK CFI record up to that address, but all
+// addresses between two consecutive STACK CFI records share a rule set.
+class CFIFrameInfoCache {
+ public:
+  // If a rule set is cached under |key|, returns a new copy of it, owned
+  // by the caller.  Otherwise returns NULL.
+  CFIFrameInfo* Find(uint64_t key) const;
 
-  // A postfix expression for computing the current frame's CFA (call
-  // frame address). The CFA is a reference address for the frame that
-  // remains unchanged throughout the frame's lifetime. You should
-  // evaluate this expression with a dictionary initially populated
-  // with the values of the current frame's known registers.
-  string cfa_rule_;
-
-  // The following expressions should be evaluated with a dictionary
-  // initially populated with the values of the current frame's known
-  // registers, and with ".cfa" set to the result of evaluating the
-  // cfa_rule expression, above.
-
-  // A postfix expression for computing the current frame's return
-  // address. 
-  string ra_rule_;
-
-  // For a register named REG, rules[REG] is a postfix expression
-  // which leaves the value of REG in the calling frame on the top of
-  // the stack. You should evaluate this expression
-  RuleMap register_rules_;
+  // Caches a copy of |frame_info| under |key|.
+  void Insert(uint64_t key, const CFIFrameInfo& frame_info);
+
+ private:
+  mutable std::shared_mutex mutex_;
+  std::unordered_map<uint64_t, CFIFrameInfo> entries_;
 };
 
 // A parser for STACK CFI-style rule sets.
@@ -239,8 +379,7 @@ class SimpleCFIWalker {
   // architecture's register set. REGISTER_MAP is an array of
   // RegisterSet structures; MAP_SIZE is the number of elements in the
   // array.
-  SimpleCFIWalker(const RegisterSet* register_map, size_t map_size)
-      : register_map_(register_map), map_size_(map_size) { }
+  SimpleCFIWalker(const RegisterSet* register_map, size_t map_size);
 
   // Compute the calling frame's raw context given the callee's raw
   // context.
@@ -263,8 +402,25 @@ class SimpleCFIWalker {
                            int* caller_validity) const;
 
  private:
+  // Where FindCallerRegisters finds a register's value under its
+  // alternate name.
+  enum {
+    ALTERNATE_NONE = -1,
+    ALTERNATE_RA = -2,
+    ALTERNATE_CFA = -3
+  };
+
   const RegisterSet* register_map_;
   size_t map_size_;
+
+  // The names of the registers in REGISTER_MAP_, in order, followed by
+  // any alternate names other than ".ra" and ".cfa", numbering the
+  // slots of the RegisterFiles that FindCallerRegisters uses.
+  std::vector<const char*> names_;
+
+  // For each register, the slot holding its value under its alternate
+  // name, or one of the ALTERNATE_ values above.
+  std::vector<int> alternates_;
 };
 
 }  // namespace google_breakpad
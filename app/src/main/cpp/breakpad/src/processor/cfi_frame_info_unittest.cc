@@ -29,7 +29,8 @@
 // Original author: Jim Blandy <jimb@mozilla.com> <jimb@red-bean.com>
 
 // cfi_frame_info_unittest.cc: Unit tests for CFIFrameInfo,
-// CFIRuleParser, CFIFrameInfoParseHandler, and SimpleCFIWalker.
+// CFIRuleParser, CFIFrameInfoParseHandler, SimpleCFIWalker, and
+// CFIFrameInfoCache.
 
 #ifdef HAVE_CONFIG_H
 #include <config.h>  // Must come first
@@ -37,15 +38,20 @@
 
 #include <string.h>
 
+#include <memory>
+
 #include "breakpad_googletest_includes.h"
 #include "common/using_std_string.h"
 #include "processor/cfi_frame_info.h"
+#include "processor/postfix_evaluator-inl.h"
 #include "google_breakpad/processor/memory_region.h"
 
 using google_breakpad::CFIFrameInfo;
+using google_breakpad::CFIFrameInfoCache;
 using google_breakpad::CFIFrameInfoParseHandler;
 using google_breakpad::CFIRuleParser;
 using google_breakpad::MemoryRegion;
+using google_breakpad::PostfixEvaluator;
 using google_breakpad::SimpleCFIWalker;
 using testing::_;
 using testing::A;
@@ -294,6 +300,206 @@ TEST_F(Scope, SeparateTempsRA) {
                                              &caller_registers));
 }
 
+// Memory in which the word at each address holds twice the address.
+class DoublingMemoryRegion: public MemoryRegion {
+ public:
+  uint64_t GetBase() const { return 0; }
+  uint32_t GetSize() const { return 0xffffffff; }
+  bool GetMemoryAtAddress(uint64_t address, uint8_t* value) const {
+    return Get(address, value);
+  }
+  bool GetMemoryAtAddress(uint64_t address, uint16_t* value) const {
+    return Get(address, value);
+  }
+  bool GetMemoryAtAddress(uint64_t address, uint32_t* value) const {
+    return Get(address, value);
+  }
+  bool GetMemoryAtAddress(uint64_t address, uint64_t* value) const {
+    return Get(address, value);
+  }
+  void Print() const { }
+
+ private:
+  // Addresses from 0x10000000 up are unreadable.
+  template<typename T> bool Get(uint64_t address, T* value) const {
+    if (address >= 0x10000000)
+      return false;
+    *value = static_cast<T>(address * 2);
+    return true;
+  }
+};
+
+// Evaluates EXPRESSION as a register rule, and checks that the result
+// agrees with PostfixEvaluator's.
+template<typename ValueType>
+void CheckAgainstPostfixEvaluator(const string& expression) {
+  SCOPED_TRACE(expression);
+  DoublingMemoryRegion memory;
+  CFIFrameInfo::RegisterValueMap<ValueType> registers, caller_registers;
+  registers["$sp"] = 0x1000;
+  registers["$fp"] = 0x1234;
+  registers[".cfa"] = 0x5678;  // Overridden by the CFA rule's value.
+
+  CFIFrameInfo cfi;
+  cfi.SetCFARule("$sp 16 +");
+  cfi.SetRARule(".cfa 8 - ^");
+  cfi.SetRegisterRule("$reg", expression);
+  ASSERT_TRUE(cfi.FindCallerRegs<ValueType>(registers, memory,
+                                             &caller_registers));
+  ASSERT_EQ(0x1010U, caller_registers[".cfa"]);
+  ASSERT_EQ(0x2010U, caller_registers[".ra"]);
+
+  typename PostfixEvaluator<ValueType>::DictionaryType dictionary;
+  dictionary.insert(registers.begin(), registers.end());
+  dictionary[".cfa"] = 0x1010;
+  PostfixEvaluator<ValueType> evaluator(&dictionary, &memory);
+  ValueType expected;
+  bool expected_ok = evaluator.EvaluateForValue(expression, &expected);
+  ASSERT_EQ(expected_ok, caller_registers.count("$reg") == 1);
+  if (expected_ok) {
+    EXPECT_EQ(expected, caller_registers["$reg"]);
+  }
+}
+
+// Compiled rules must give the same results as PostfixEvaluator,
+// including for the rules that are left to it.
+TEST(Compiled, MatchesPostfixEvaluator) {
+  const char* const expressions[] = {
+    "$sp 16 +",
+    ".cfa -8 + ^",
+    "$fp 16 @",
+    "$fp 4 - ^ 2 *",
+    "1000 7 /",
+    "1000 7 %",
+    "-8",
+    "-8 $sp +",
+    "010",
+    "18446744073709551615 1 +",
+    "4294967296 $sp +",
+    "$sp\t8\n+",
+    "$missing",
+    "$sp +",
+    "1 2",
+    "",
+    "0x10000000 ^",
+    "268435456 ^",
+    "12abc",
+    "-$sp",
+    "+5",
+    "$T0 $sp = $T0 4 +",
+    "$T0 $sp =$T1 $T0 4 + = $T1",
+  };
+  for (const char* expression : expressions) {
+    CheckAgainstPostfixEvaluator<uint32_t>(expression);
+    CheckAgainstPostfixEvaluator<uint64_t>(expression);
+  }
+}
+
+// Compiled rules fail cleanly on division by zero.
+TEST(Compiled, DivisionByZero) {
+  DoublingMemoryRegion memory;
+  CFIFrameInfo::RegisterValueMap<uint64_t> registers, caller_registers;
+  CFIFrameInfo cfi;
+  cfi.SetCFARule("8 0 /");
+  cfi.SetRARule("0");
+  EXPECT_FALSE(cfi.FindCallerRegs<uint64_t>(registers, memory,
+                                             &caller_registers));
+  cfi.SetCFARule("8 0 %");
+  EXPECT_FALSE(cfi.FindCallerRegs<uint64_t>(registers, memory,
+                                             &caller_registers));
+}
+
+// Copies share their rules until one of them changes.
+TEST(Compiled, CopiesAreIndependent) {
+  CFIFrameInfo original;
+  original.SetCFARule("$sp 8 +");
+  original.SetRARule(".cfa 8 - ^");
+  CFIFrameInfo copy(original);
+  copy.SetRegisterRule("$fp", ".cfa 16 - ^");
+  original.SetRARule(".cfa 4 - ^");
+  EXPECT_EQ(".cfa: $sp 8 + .ra: .cfa 4 - ^", original.Serialize());
+  EXPECT_EQ(".cfa: $sp 8 + .ra: .cfa 8 - ^ $fp: .cfa 16 - ^",
+            copy.Serialize());
+  EXPECT_EQ("", CFIFrameInfo().Serialize());
+}
+
+// The register file interface recovers the same registers as the
+// dictionary interface, and leaves out names that aren't registers.
+TEST(RegisterFile, MatchesRegisterValueMap) {
+  static const char* const names[] = { "$pc", "$sp", "$fp", "$bx", "$si" };
+  DoublingMemoryRegion memory;
+  CFIFrameInfo cfi;
+  cfi.SetCFARule("$fp 16 +");
+  cfi.SetRARule(".cfa 8 - ^");
+  cfi.SetRegisterRule("$fp", ".cfa 16 - ^");
+  cfi.SetRegisterRule("$bx", "$si $fp +");
+  cfi.SetRegisterRule("$si", "$unknown");
+  cfi.SetRegisterRule("$tmp", "$bx");
+
+  CFIFrameInfo::RegisterValueMap<uint64_t> registers, caller_map;
+  registers["$pc"] = 0x4000;
+  registers["$sp"] = 0x1000;
+  registers["$fp"] = 0x1100;
+  registers["$si"] = 0x22;
+  ASSERT_TRUE(cfi.FindCallerRegs<uint64_t>(registers, memory, &caller_map));
+
+  CFIFrameInfo::RegisterFile<uint64_t> callee_file, caller_file;
+  callee_file.Set(0, 0x4000);
+  callee_file.Set(1, 0x1000);
+  callee_file.Set(2, 0x1100);
+  callee_file.Set(4, 0x22);
+  uint64_t cfa, ra;
+  ASSERT_TRUE(cfi.FindCallerRegs<uint64_t>(names, 5, callee_file, memory,
+                                            &caller_file, &cfa, &ra));
+  EXPECT_EQ(caller_map[".cfa"], cfa);
+  EXPECT_EQ(caller_map[".ra"], ra);
+  EXPECT_EQ(0xcU, caller_file.valid());
+  EXPECT_EQ(caller_map["$fp"], caller_file.Get(2));
+  EXPECT_EQ(caller_map["$bx"], caller_file.Get(3));
+  EXPECT_EQ(0U, caller_map.count("$si"));
+}
+
+// Rules the register file interface can't evaluate fail as the
+// dictionary interface's do.
+TEST(RegisterFile, MissingRegister) {
+  static const char* const names[] = { "$pc", "$sp" };
+  DoublingMemoryRegion memory;
+  CFIFrameInfo cfi;
+  cfi.SetCFARule("$sp 16 +");
+  cfi.SetRARule(".cfa 8 - ^");
+  CFIFrameInfo::RegisterFile<uint32_t> callee_file, caller_file;
+  uint32_t cfa, ra;
+  EXPECT_FALSE(cfi.FindCallerRegs<uint32_t>(names, 2, callee_file, memory,
+                                             &caller_file, &cfa, &ra));
+  callee_file.Set(1, 0x1000);
+  ASSERT_TRUE(cfi.FindCallerRegs<uint32_t>(names, 2, callee_file, memory,
+                                            &caller_file, &cfa, &ra));
+  EXPECT_EQ(0x1010U, cfa);
+  EXPECT_EQ(0x2010U, ra);
+  EXPECT_EQ(0U, caller_file.valid());
+}
+
+TEST(Cache, FindAndInsert) {
+  CFIFrameInfoCache cache;
+  EXPECT_EQ(NULL, cache.Find(0x1000));
+
+  CFIFrameInfo cfi;
+  cfi.SetCFARule("$sp 8 +");
+  cfi.SetRARule(".cfa 8 - ^");
+  cache.Insert(0x1000, cfi);
+  cfi.SetRARule("0");
+
+  std::unique_ptr<CFIFrameInfo> found(cache.Find(0x1000));
+  ASSERT_TRUE(found.get());
+  EXPECT_EQ(".cfa: $sp 8 + .ra: .cfa 8 - ^", found->Serialize());
+  EXPECT_EQ(NULL, cache.Find(0x1001));
+
+  // Changing a found rule set doesn't change the cached one.
+  found->SetRARule("1");
+  found.reset(cache.Find(0x1000));
+  EXPECT_EQ(".cfa: $sp 8 + .ra: .cfa 8 - ^", found->Serialize());
+}
+
 class MockCFIRuleParserHandler: public CFIRuleParser::Handler {
  public:
   MOCK_METHOD1(CFARule, void(const string&));
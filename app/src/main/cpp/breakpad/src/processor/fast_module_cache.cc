@@ -0,0 +1,306 @@
+// Copyright 2024 Google LLC
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google LLC nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// fast_module_cache.cc: Implement google_breakpad::FastModuleCache and
+// google_breakpad::FastModuleCacheSymbolSupplier.
+// See fast_module_cache.h for details.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>  // Must come first
+#endif
+
+#include "processor/fast_module_cache.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <utility>
+
+#include "common/md5.h"
+#include "google_breakpad/processor/code_module.h"
+#include "processor/logging.h"
+#include "processor/mapped_symbol_file.h"
+#include "processor/module_serializer.h"
+#include "processor/pathname_stripper.h"
+
+namespace google_breakpad {
+
+namespace {
+
+const char kEntryMagic[8] = { 'B', 'P', 'F', 'A', 'S', 'T', 'M', 'D' };
+
+// Written in the byte order of the machine that wrote the entry, which must
+// match the reader's, since the serialized module is in native byte order.
+const uint32_t kByteOrderMark = 0x01020304;
+
+struct EntryHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint64_t data_size;
+  unsigned char checksum[16];  // MD5 of the serialized module.
+};
+
+void Checksum(const char* data, size_t size, unsigned char checksum[16]) {
+  MD5Context context;
+  MD5Init(&context);
+  MD5Update(&context, reinterpret_cast<const unsigned char*>(data), size);
+  MD5Final(checksum, &context);
+}
+
+// Creates |path| and any missing parent directories.
+bool MakeDirectories(const string& path) {
+  for (size_t slash = path.find('/', 1); ; slash = path.find('/', slash + 1)) {
+    string directory = path.substr(0, slash);
+    if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+      string error_string;
+      int error_code = ErrnoString(&error_string);
+      BPLOG(ERROR) << "Could not create " << directory <<
+          ", error " << error_code << ": " << error_string;
+      return false;
+    }
+    if (slash == string::npos)
+      return true;
+  }
+}
+
+}  // namespace
+
+FastModuleCache::FastModuleCache(const string& directory)
+    : directory_(directory), verify_checksums_(true) {
+  memset(&stats_, 0, sizeof(stats_));
+}
+
+string FastModuleCache::EntryPath(const CodeModule* module) const {
+  if (!module)
+    return string();
+  string debug_file_name = PathnameStripper::File(module->debug_file());
+  string identifier = module->debug_identifier();
+  if (debug_file_name.empty() || identifier.empty())
+    return string();
+  return directory_ + "/" + debug_file_name + "/" + identifier + "/" +
+      debug_file_name + ".fast";
+}
+
+bool FastModuleCache::Load(const CodeModule* module, MappedSymbolFile* entry,
+                           char** data, size_t* size) {
+  string path = EntryPath(module);
+  struct stat buf;
+  if (path.empty() || stat(path.c_str(), &buf) != 0) {
+    ++stats_.misses;
+    return false;
+  }
+  if (!entry->Map(path)) {
+    ++stats_.invalid;
+    return false;
+  }
+
+  // The mapping is followed by a null terminator that isn't part of the
+  // entry.
+  const size_t entry_size = entry->size() - 1;
+  EntryHeader header;
+  if (entry_size < sizeof(header)) {
+    BPLOG(ERROR) << "Fast module cache entry " << path << " is truncated";
+    ++stats_.invalid;
+    entry->Unmap();
+    return false;
+  }
+  memcpy(&header, entry->data(), sizeof(header));
+  if (memcmp(header.magic, kEntryMagic, sizeof(kEntryMagic)) != 0 ||
+      header.version != kVersion ||
+      header.byte_order != kByteOrderMark ||
+      header.data_size != entry_size - sizeof(header)) {
+    BPLOG(ERROR) << "Fast module cache entry " << path
+                 << " has an unsupported header";
+    ++stats_.invalid;
+    entry->Unmap();
+    return false;
+  }
+
+  char* entry_data = entry->data() + sizeof(header);
+  if (verify_checksums_) {
+    unsigned char checksum[16];
+    Checksum(entry_data, header.data_size, checksum);
+    if (memcmp(checksum, header.checksum, sizeof(checksum)) != 0) {
+      BPLOG(ERROR) << "Fast module cache entry " << path << " is corrupt";
+      ++stats_.invalid;
+      entry->Unmap();
+      return false;
+    }
+  }
+
+  ++stats_.hits;
+  *data = entry_data;
+  *size = header.data_size;
+  return true;
+}
+
+bool FastModuleCache::Store(const CodeModule* module, const char* data,
+                            size_t size) {
+  string path = EntryPath(module);
+  if (path.empty() || !MakeDirectories(path.substr(0, path.rfind('/')))) {
+    ++stats_.store_failures;
+    return false;
+  }
+
+  EntryHeader header;
+  memcpy(header.magic, kEntryMagic, sizeof(kEntryMagic));
+  header.version = kVersion;
+  header.byte_order = kByteOrderMark;
+  header.data_size = size;
+  Checksum(data, size, header.checksum);
+
+  // Write to a temporary file and rename it over the entry, so that
+  // concurrent readers never see a partial entry.
+  string temp_path = path + ".XXXXXX";
+  int fd = mkstemp(&temp_path[0]);
+  FILE* f = fd == -1 ? NULL : fdopen(fd, "wb");
+  if (!f) {
+    string error_string;
+    int error_code = ErrnoString(&error_string);
+    BPLOG(ERROR) << "Could not create " << temp_path <<
+        ", error " << error_code << ": " << error_string;
+    if (fd != -1) {
+      close(fd);
+      unlink(temp_path.c_str());
+    }
+    ++stats_.store_failures;
+    return false;
+  }
+
+  bool written = fwrite(&header, sizeof(header), 1, f) == 1 &&
+                 fwrite(data, 1, size, f) == size;
+  written = fclose(f) == 0 && written;
+  if (!written || rename(temp_path.c_str(), path.c_str()) != 0) {
+    string error_string;
+    int error_code = ErrnoString(&error_string);
+    BPLOG(ERROR) << "Could not write " << path <<
+        ", error " << error_code << ": " << error_string;
+    unlink(temp_path.c_str());
+    ++stats_.store_failures;
+    return false;
+  }
+
+  ++stats_.stores;
+  return true;
+}
+
+FastModuleCacheSymbolSupplier::FastModuleCacheSymbolSupplier(
+    SymbolSupplier* supplier, FastModuleCache* cache)
+    : supplier_(supplier), cache_(cache) {
+}
+
+FastModuleCacheSymbolSupplier::~FastModuleCacheSymbolSupplier() {
+  std::map<string, MappedSymbolFile*>::iterator mapped_iter =
+      mapped_entries_.begin();
+  for (; mapped_iter != mapped_entries_.end(); ++mapped_iter)
+    delete mapped_iter->second;
+  std::map<string, char*>::iterator buffer_iter = serialized_buffers_.begin();
+  for (; buffer_iter != serialized_buffers_.end(); ++buffer_iter)
+    delete [] buffer_iter->second;
+}
+
+SymbolSupplier::SymbolResult FastModuleCacheSymbolSupplier::GetSymbolFile(
+    const CodeModule* module, const SystemInfo* system_info,
+    string* symbol_file) {
+  return supplier_->GetSymbolFile(module, system_info, symbol_file);
+}
+
+SymbolSupplier::SymbolResult FastModuleCacheSymbolSupplier::GetSymbolFile(
+    const CodeModule* module, const SystemInfo* system_info,
+    string* symbol_file, string* symbol_data) {
+  return supplier_->GetSymbolFile(module, system_info, symbol_file,
+                                  symbol_data);
+}
+
+SymbolSupplier::SymbolResult
+FastModuleCacheSymbolSupplier::GetCStringSymbolData(
+    const CodeModule* module, const SystemInfo* system_info,
+    string* symbol_file, char** symbol_data, size_t* symbol_data_size) {
+  if (!module)
+    return NOT_FOUND;
+
+  MappedSymbolFile* entry = new MappedSymbolFile();
+  if (cache_->Load(module, entry, symbol_data, symbol_data_size)) {
+    *symbol_file = cache_->EntryPath(module);
+    FreeSymbolData(module);
+    mapped_entries_.insert(std::make_pair(module->code_file(), entry));
+    return FOUND;
+  }
+  delete entry;
+
+  char* text_data = NULL;
+  size_t text_data_size = 0;
+  SymbolResult result = supplier_->GetCStringSymbolData(
+      module, system_info, symbol_file, &text_data, &text_data_size);
+  if (result != FOUND)
+    return result;
+
+  ModuleSerializer serializer;
+  size_t serialized_size = 0;
+  char* serialized = serializer.SerializeSymbolFileData(
+      text_data, text_data_size, &serialized_size);
+  supplier_->FreeSymbolData(module);
+  if (!serialized) {
+    BPLOG(ERROR) << "Could not serialize symbols from " << *symbol_file;
+    return NOT_FOUND;
+  }
+
+  cache_->Store(module, serialized, serialized_size);
+  FreeSymbolData(module);
+  serialized_buffers_.insert(std::make_pair(module->code_file(), serialized));
+  *symbol_data = serialized;
+  *symbol_data_size = serialized_size;
+  return FOUND;
+}
+
+void FastModuleCacheSymbolSupplier::FreeSymbolData(const CodeModule* module) {
+  if (!module)
+    return;
+
+  std::map<string, MappedSymbolFile*>::iterator mapped_iter =
+      mapped_entries_.find(module->code_file());
+  if (mapped_iter != mapped_entries_.end()) {
+    delete mapped_iter->second;
+    mapped_entries_.erase(mapped_iter);
+  }
+
+  std::map<string, char*>::iterator buffer_iter =
+      serialized_buffers_.find(module->code_file());
+  if (buffer_iter != serialized_buffers_.end()) {
+    delete [] buffer_iter->second;
+    serialized_buffers_.erase(buffer_iter);
+  }
+}
+
+}  // namespace google_breakpad
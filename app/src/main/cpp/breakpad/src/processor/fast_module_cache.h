@@ -0,0 +1,152 @@
+// Copyright 2024 Google LLC
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google LLC nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// fast_module_cache.h: An on-disk cache of symbol files serialized into the
+// FastSourceLineResolver format, so that a process which starts up again
+// does not need to parse the same text symbol files again.
+//
+// FastModuleCache stores one entry per module, at
+//   <directory>/<debug_file>/<debug_identifier>/<debug_file>.fast
+// mirroring the layout SimpleSymbolSupplier uses for .sym files.  Each entry
+// is a small header followed by the output of ModuleSerializer.  The header
+// records the format version, the byte order of the machine that wrote it,
+// the size of the serialized data and its MD5 checksum; entries that don't
+// match are ignored and rewritten.
+//
+// FastModuleCacheSymbolSupplier puts the cache in front of another
+// SymbolSupplier.  It must be used with a FastSourceLineResolver: cached
+// entries are memory mapped and handed to the resolver, which uses them in
+// place, and on a miss the text symbol file is fetched from the wrapped
+// supplier, serialized, and written to the cache.
+
+#ifndef PROCESSOR_FAST_MODULE_CACHE_H__
+#define PROCESSOR_FAST_MODULE_CACHE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <string>
+
+#include "common/using_std_string.h"
+#include "google_breakpad/processor/symbol_supplier.h"
+
+namespace google_breakpad {
+
+class CodeModule;
+class MappedSymbolFile;
+
+class FastModuleCache {
+ public:
+  // Bumped whenever the FastSourceLineResolver serialization format or the
+  // entry header changes, which invalidates every existing entry.
+  static const uint32_t kVersion = 1;
+
+  struct Stats {
+    uint64_t hits;            // Entries found and validated.
+    uint64_t misses;          // Modules with no entry.
+    uint64_t invalid;         // Entries rejected by validation.
+    uint64_t stores;          // Entries written.
+    uint64_t store_failures;  // Entries that could not be written.
+  };
+
+  // Creates a cache rooted at |directory|, which is created on demand.
+  explicit FastModuleCache(const string& directory);
+
+  // Returns the path of the entry for |module|, or an empty string if
+  // |module| lacks the debug file or identifier that key the cache.
+  string EntryPath(const CodeModule* module) const;
+
+  // Maps the entry for |module| into |entry| and validates it.  On success,
+  // sets |data| and |size| to the serialized module within |entry|, ready
+  // for FastSourceLineResolver::LoadModuleUsingMemoryBuffer(), and returns
+  // true.
+  bool Load(const CodeModule* module, MappedSymbolFile* entry,
+            char** data, size_t* size);
+
+  // Writes |size| bytes of serialized module |data| as the entry for
+  // |module|, replacing any existing entry atomically.
+  bool Store(const CodeModule* module, const char* data, size_t size);
+
+  // Controls whether Load() verifies the checksum of each entry, which
+  // reads the whole entry.  Defaults to true.
+  void set_verify_checksums(bool verify) { verify_checksums_ = verify; }
+
+  const Stats& stats() const { return stats_; }
+
+ private:
+  string directory_;
+  bool verify_checksums_;
+  Stats stats_;
+};
+
+class FastModuleCacheSymbolSupplier : public SymbolSupplier {
+ public:
+  // |supplier| provides text symbol files on cache misses, and |cache|
+  // stores them once serialized.  Neither is owned.
+  FastModuleCacheSymbolSupplier(SymbolSupplier* supplier,
+                                FastModuleCache* cache);
+  virtual ~FastModuleCacheSymbolSupplier();
+
+  // These return the text symbol file from the wrapped supplier.
+  virtual SymbolResult GetSymbolFile(const CodeModule* module,
+                                     const SystemInfo* system_info,
+                                     string* symbol_file);
+  virtual SymbolResult GetSymbolFile(const CodeModule* module,
+                                     const SystemInfo* system_info,
+                                     string* symbol_file,
+                                     string* symbol_data);
+
+  // Returns the serialized module for FastSourceLineResolver, from the
+  // cache if possible.  On a cache hit, |symbol_file| is the cache entry.
+  virtual SymbolResult GetCStringSymbolData(const CodeModule* module,
+                                            const SystemInfo* system_info,
+                                            string* symbol_file,
+                                            char** symbol_data,
+                                            size_t* symbol_data_size);
+
+  virtual void FreeSymbolData(const CodeModule* module);
+
+ private:
+  SymbolSupplier* supplier_;
+  FastModuleCache* cache_;
+
+  // Cache entries mapped for modules, keyed by code file.
+  std::map<string, MappedSymbolFile*> mapped_entries_;
+
+  // Modules serialized on a cache miss, keyed by code file.
+  std::map<string, char*> serialized_buffers_;
+
+  // Disallow copy constructor and assignment operator.
+  FastModuleCacheSymbolSupplier(const FastModuleCacheSymbolSupplier&);
+  void operator=(const FastModuleCacheSymbolSupplier&);
+};
+
+}  // namespace google_breakpad
+
+#endif  // PROCESSOR_FAST_MODULE_CACHE_H__
@@ -0,0 +1,172 @@
+// Copyright 2024 Google LLC
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google LLC nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// fast_module_cache_unittest.cc: Unit tests for FastModuleCache and
+// FastModuleCacheSymbolSupplier.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>  // Must come first
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+
+#include "breakpad_googletest_includes.h"
+#include "common/tests/auto_tempdir.h"
+#include "common/using_std_string.h"
+#include "google_breakpad/processor/fast_source_line_resolver.h"
+#include "google_breakpad/processor/stack_frame.h"
+#include "processor/basic_code_module.h"
+#include "processor/fast_module_cache.h"
+#include "processor/simple_symbol_supplier.h"
+
+namespace {
+
+using google_breakpad::AutoTempDir;
+using google_breakpad::BasicCodeModule;
+using google_breakpad::FastModuleCache;
+using google_breakpad::FastModuleCacheSymbolSupplier;
+using google_breakpad::FastSourceLineResolver;
+using google_breakpad::SimpleSymbolSupplier;
+using google_breakpad::StackFrame;
+using google_breakpad::SymbolSupplier;
+
+string GetTestDataPath() {
+  char* srcdir = getenv("srcdir");
+  return string(srcdir ? srcdir : ".") + "/src/processor/testdata/";
+}
+
+class FastModuleCacheTest : public ::testing::Test {
+ public:
+  FastModuleCacheTest()
+      : module_(0x400000, 0x10000, "c:\\test_app.exe", "",
+                "c:\\test_app.pdb", "5A9832E5287241C1838ED98914E9B7FF1",
+                ""),
+        text_supplier_(GetTestDataPath() + "symbols"),
+        cache_(temp_dir_.path() + "/cache") {}
+
+  // Loads |module_| into a new FastSourceLineResolver through a
+  // FastModuleCacheSymbolSupplier, and checks that it symbolizes.
+  void LoadAndCheck() {
+    FastModuleCacheSymbolSupplier supplier(&text_supplier_, &cache_);
+    FastSourceLineResolver resolver;
+    string symbol_file;
+    char* symbol_data = NULL;
+    size_t symbol_data_size = 0;
+    ASSERT_EQ(SymbolSupplier::FOUND,
+              supplier.GetCStringSymbolData(&module_, NULL, &symbol_file,
+                                            &symbol_data, &symbol_data_size));
+    ASSERT_TRUE(resolver.LoadModuleUsingMemoryBuffer(&module_, symbol_data,
+                                                     symbol_data_size));
+    EXPECT_FALSE(resolver.IsModuleCorrupt(&module_));
+
+    StackFrame frame;
+    frame.module = &module_;
+    frame.instruction = 0x401024;
+    resolver.FillSourceLineInfo(&frame, NULL);
+    EXPECT_EQ("wmemcpy_s", frame.function_name);
+  }
+
+  AutoTempDir temp_dir_;
+  BasicCodeModule module_;
+  SimpleSymbolSupplier text_supplier_;
+  FastModuleCache cache_;
+};
+
+TEST_F(FastModuleCacheTest, EntryPath) {
+  EXPECT_EQ(temp_dir_.path() + "/cache/test_app.pdb/"
+            "5A9832E5287241C1838ED98914E9B7FF1/test_app.pdb.fast",
+            cache_.EntryPath(&module_));
+
+  BasicCodeModule no_identifier(0, 0, "a.so", "", "a.so", "", "");
+  EXPECT_EQ("", cache_.EntryPath(&no_identifier));
+}
+
+TEST_F(FastModuleCacheTest, MissStoresThenHits) {
+  LoadAndCheck();
+  EXPECT_EQ(1U, cache_.stats().misses);
+  EXPECT_EQ(1U, cache_.stats().stores);
+  EXPECT_EQ(0U, cache_.stats().hits);
+
+  LoadAndCheck();
+  EXPECT_EQ(1U, cache_.stats().misses);
+  EXPECT_EQ(1U, cache_.stats().stores);
+  EXPECT_EQ(1U, cache_.stats().hits);
+}
+
+TEST_F(FastModuleCacheTest, CorruptEntryIsReplaced) {
+  LoadAndCheck();
+
+  // Flip a byte near the end of the serialized module.
+  string path = cache_.EntryPath(&module_);
+  FILE* f = fopen(path.c_str(), "r+b");
+  ASSERT_TRUE(f != NULL);
+  ASSERT_EQ(0, fseek(f, -2, SEEK_END));
+  int c = fgetc(f);
+  ASSERT_EQ(0, fseek(f, -2, SEEK_END));
+  fputc(c ^ 0xff, f);
+  fclose(f);
+
+  LoadAndCheck();
+  EXPECT_EQ(1U, cache_.stats().invalid);
+  EXPECT_EQ(2U, cache_.stats().stores);
+
+  LoadAndCheck();
+  EXPECT_EQ(1U, cache_.stats().hits);
+}
+
+TEST_F(FastModuleCacheTest, TruncatedEntryIsReplaced) {
+  LoadAndCheck();
+
+  string path = cache_.EntryPath(&module_);
+  FILE* f = fopen(path.c_str(), "wb");
+  ASSERT_TRUE(f != NULL);
+  fputs("BPFAST", f);
+  fclose(f);
+
+  LoadAndCheck();
+  EXPECT_EQ(1U, cache_.stats().invalid);
+  EXPECT_EQ(2U, cache_.stats().stores);
+}
+
+TEST_F(FastModuleCacheTest, MissingSymbols) {
+  BasicCodeModule module(0, 0x1000, "nosyms.so", "", "nosyms.so",
+                         "000000000000000000000000000000000", "");
+  FastModuleCacheSymbolSupplier supplier(&text_supplier_, &cache_);
+  string symbol_file;
+  char* symbol_data = NULL;
+  size_t symbol_data_size = 0;
+  EXPECT_EQ(SymbolSupplier::NOT_FOUND,
+            supplier.GetCStringSymbolData(&module, NULL, &symbol_file,
+                                          &symbol_data, &symbol_data_size));
+  EXPECT_EQ(0U, cache_.stats().stores);
+}
+
+}  // namespace
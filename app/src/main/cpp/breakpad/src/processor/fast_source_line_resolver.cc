@@ -343,22 +343,38 @@ CFIFrameInfo* FastSourceLineResolver::Module::FindCFIFrameInfo(
     return NULL;
   }
 
+  // The delta rules that apply are those from the initial rule's starting
+  // address up to and including the frame's address.
+  StaticMap<MemAddr, char>::iterator first_delta =
+    cfi_delta_rules_.lower_bound(initial_base);
+  StaticMap<MemAddr, char>::iterator end_delta =
+    cfi_delta_rules_.upper_bound(address);
+
+  // Every address up to the next delta rule has the same rules, so look
+  // for them in the cache before building them.
+  MemAddr rules_address = initial_base;
+  if (end_delta != first_delta) {
+    StaticMap<MemAddr, char>::iterator last_delta = end_delta;
+    --last_delta;
+    rules_address = last_delta.GetKey();
+  }
+  CFIFrameInfo* cached = cfi_frame_info_cache_.Find(rules_address);
+  if (cached)
+    return cached;
+
   // Create a frame info structure, and populate it with the rules from
   // the STACK CFI INIT record.
   scoped_ptr<CFIFrameInfo> rules(new CFIFrameInfo());
   if (!ParseCFIRuleSet(initial_rules, rules.get()))
     return NULL;
 
-  // Find the first delta rule that falls within the initial rule's range.
-  StaticMap<MemAddr, char>::iterator delta =
-    cfi_delta_rules_.lower_bound(initial_base);
-
   // Apply delta rules up to and including the frame's address.
-  while (delta != cfi_delta_rules_.end() && delta.GetKey() <= address) {
+  for (StaticMap<MemAddr, char>::iterator delta = first_delta;
+       delta != end_delta; ++delta) {
     ParseCFIRuleSet(delta.GetValuePtr(), rules.get());
-    delta++;
   }
 
+  cfi_frame_info_cache_.Insert(rules_address, *rules);
   return rules.release();
 }
 
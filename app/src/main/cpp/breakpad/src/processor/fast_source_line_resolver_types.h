@@ -239,6 +239,11 @@ class FastSourceLineResolver::Module: public SourceLineResolverBase::Module {
   // entry (which FindCFIFrameInfo looks up first).
   StaticMap<MemAddr, char> cfi_delta_rules_;
 
+  // The rule sets FindCFIFrameInfo has built, keyed by the address of the
+  // last STACK CFI record applied, or of the STACK CFI INIT record if
+  // there was none.
+  mutable CFIFrameInfoCache cfi_frame_info_cache_;
+
   // INLINE_ORIGIN records: used as a function name string pool for INLINE
   // records.
   StaticMap<int, char> inline_origins_;
@@ -0,0 +1,162 @@
+// Copyright 2024 Google LLC
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google LLC nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// frame_arena.cc: Bump-pointer storage for the StackFrames of a
+// ProcessState.
+//
+// See frame_arena.h for documentation.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>  // Must come first
+#endif
+
+#include "processor/frame_arena.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+
+#include "google_breakpad/processor/stack_frame.h"
+
+namespace google_breakpad {
+
+namespace {
+
+// Every allocation is rounded up to, and aligned on, this boundary.
+const size_t kAlignment = alignof(std::max_align_t);
+
+// Blocks start small, for dumps with a handful of short stacks, and double
+// in size up to kMaxBlockSize.
+const size_t kMinBlockSize = 64 * 1024;
+const size_t kMaxBlockSize = 4 * 1024 * 1024;
+
+// StackFrame::operator new stores the arena that a frame came from, or
+// NULL for the heap, in a header just before the frame.
+const size_t kFrameHeaderSize = kAlignment;
+
+thread_local FrameArena* current_arena = NULL;
+
+size_t RoundUp(size_t size) {
+  return (size + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+}  // namespace
+
+FrameArena::FrameArena() : next_(NULL), end_(NULL), allocated_bytes_(0) {}
+
+FrameArena::~FrameArena() {
+  for (const Block& block : blocks_)
+    ::operator delete(block.data);
+}
+
+void* FrameArena::Allocate(size_t size) {
+  size = RoundUp(std::max<size_t>(size, 1));
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (static_cast<size_t>(end_ - next_) < size)
+    AddBlock(size);
+  void* result = next_;
+  next_ += size;
+  allocated_bytes_ += size;
+  return result;
+}
+
+void FrameArena::AddBlock(size_t size) {
+  size_t block_size = blocks_.empty() ?
+      kMinBlockSize : std::min(blocks_.back().size * 2, kMaxBlockSize);
+  block_size = std::max(block_size, size);
+  Block block;
+  // ::operator new returns storage aligned for any type of its size.
+  block.data = static_cast<char*>(::operator new(block_size));
+  block.size = block_size;
+  blocks_.push_back(block);
+  next_ = block.data;
+  end_ = block.data + block.size;
+}
+
+void FrameArena::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (blocks_.empty())
+    return;
+  std::vector<Block>::iterator largest = std::max_element(
+      blocks_.begin(), blocks_.end(),
+      [](const Block& a, const Block& b) { return a.size < b.size; });
+  Block kept = *largest;
+  for (std::vector<Block>::iterator it = blocks_.begin();
+       it != blocks_.end(); ++it) {
+    if (it != largest)
+      ::operator delete(it->data);
+  }
+  blocks_.assign(1, kept);
+  next_ = kept.data;
+  end_ = kept.data + kept.size;
+  allocated_bytes_ = 0;
+}
+
+size_t FrameArena::block_count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return blocks_.size();
+}
+
+size_t FrameArena::allocated_bytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return allocated_bytes_;
+}
+
+// static
+FrameArena* FrameArena::current() {
+  return current_arena;
+}
+
+FrameArena::Scope::Scope(FrameArena* arena) : previous_(current_arena) {
+  current_arena = arena;
+}
+
+FrameArena::Scope::~Scope() {
+  current_arena = previous_;
+}
+
+// static
+void* StackFrame::operator new(size_t size) {
+  FrameArena* arena = current_arena;
+  size_t total = kFrameHeaderSize + size;
+  void* header = arena ? arena->Allocate(total) : ::operator new(total);
+  *static_cast<FrameArena**>(header) = arena;
+  return static_cast<char*>(header) + kFrameHeaderSize;
+}
+
+// static
+void StackFrame::operator delete(void* frame) {
+  if (!frame)
+    return;
+  void* header = static_cast<char*>(frame) - kFrameHeaderSize;
+  // Frames in an arena are reclaimed when it is reset.
+  if (!*static_cast<FrameArena**>(header))
+    ::operator delete(header);
+}
+
+}  // namespace google_breakpad
@@ -0,0 +1,119 @@
+// Copyright 2024 Google LLC
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google LLC nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// frame_arena.h: Bump-pointer storage for the StackFrames of a
+// ProcessState.
+//
+// Stack walking creates one StackFrame (or CPU-specific subclass) per frame,
+// plus one per inlined call, and a large minidump holds tens of thousands
+// of them.  Rather than allocating each one separately, MinidumpProcessor
+// and MicrodumpProcessor give the Stackwalker the FrameArena owned by the
+// ProcessState being filled in.  While Stackwalker::Walk runs, the arena is
+// installed on the walking thread, and StackFrame::operator new carves
+// frames out of its blocks.
+//
+// Deleting an arena frame runs its destructor but does not return its
+// memory, which is only reclaimed, all at once, by Reset().  Frames must
+// therefore be deleted before the arena that holds them is reset: the
+// ProcessState owning the arena guarantees this by deleting its CallStacks
+// first.  Frames allocated while no arena is installed come from the heap
+// as usual, and either kind may be deleted through the same pointer type.
+
+#ifndef PROCESSOR_FRAME_ARENA_H__
+#define PROCESSOR_FRAME_ARENA_H__
+
+#include <stddef.h>
+
+#include <mutex>
+#include <vector>
+
+namespace google_breakpad {
+
+class FrameArena {
+ public:
+  FrameArena();
+  ~FrameArena();
+
+  // Returns |size| bytes of storage, aligned for any type.  The storage
+  // lives until Reset() or the arena's destruction.  Allocate may be
+  // called from several threads at once.
+  void* Allocate(size_t size);
+
+  // Releases everything allocated from the arena.  The largest block is
+  // kept, so that refilling the arena with as many frames as before
+  // allocates nothing.
+  void Reset();
+
+  // The number of blocks currently held, and the bytes handed out of them
+  // since the last Reset().
+  size_t block_count() const;
+  size_t allocated_bytes() const;
+
+  // Returns the arena installed on the calling thread by a Scope, or NULL.
+  static FrameArena* current();
+
+  // Installs an arena on the calling thread for the lifetime of the Scope.
+  // A NULL arena uninstalls any arena for that lifetime.  Scopes nest.
+  class Scope {
+   public:
+    explicit Scope(FrameArena* arena);
+    ~Scope();
+
+   private:
+    FrameArena* previous_;
+
+    Scope(const Scope&) = delete;
+    void operator=(const Scope&) = delete;
+  };
+
+ private:
+  struct Block {
+    char* data;
+    size_t size;
+  };
+
+  // Appends a block with room for at least |size| bytes.  Must be called
+  // with mutex_ held.
+  void AddBlock(size_t size);
+
+  mutable std::mutex mutex_;
+  std::vector<Block> blocks_;
+
+  // The unused part of the last block.
+  char* next_;
+  char* end_;
+
+  size_t allocated_bytes_;
+
+  FrameArena(const FrameArena&) = delete;
+  void operator=(const FrameArena&) = delete;
+};
+
+}  // namespace google_breakpad
+
+#endif  // PROCESSOR_FRAME_ARENA_H__
@@ -0,0 +1,143 @@
+// Copyright 2024 Google LLC
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google LLC nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// frame_arena_unittest.cc: Unit tests for FrameArena.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>  // Must come first
+#endif
+
+#include <stdint.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "breakpad_googletest_includes.h"
+#include "google_breakpad/processor/stack_frame.h"
+#include "processor/frame_arena.h"
+
+namespace {
+
+using google_breakpad::FrameArena;
+using google_breakpad::StackFrame;
+
+// Stands in for the CPU-specific subclasses, which add register contexts.
+struct LargeStackFrame : public StackFrame {
+  uint64_t registers[33];
+};
+
+// Returns true if |p| is aligned for any type.
+bool IsAligned(const void* p) {
+  return reinterpret_cast<uintptr_t>(p) % alignof(std::max_align_t) == 0;
+}
+
+TEST(FrameArenaTest, Allocate) {
+  FrameArena arena;
+  EXPECT_EQ(0U, arena.block_count());
+  char* first = static_cast<char*>(arena.Allocate(1));
+  char* second = static_cast<char*>(arena.Allocate(24));
+  EXPECT_TRUE(IsAligned(first));
+  EXPECT_TRUE(IsAligned(second));
+  EXPECT_LE(first + 1, second);
+  EXPECT_EQ(1U, arena.block_count());
+
+  // Allocations bigger than a block get a block of their own.
+  const size_t kLarge = 16 * 1024 * 1024;
+  char* large = static_cast<char*>(arena.Allocate(kLarge));
+  large[0] = large[kLarge - 1] = 1;
+  EXPECT_EQ(2U, arena.block_count());
+}
+
+TEST(FrameArenaTest, ResetKeepsLargestBlock) {
+  FrameArena arena;
+  for (int i = 0; i < 100000; ++i)
+    arena.Allocate(128);
+  size_t blocks = arena.block_count();
+  EXPECT_LT(1U, blocks);
+  EXPECT_EQ(100000U * 128, arena.allocated_bytes());
+
+  arena.Reset();
+  EXPECT_EQ(1U, arena.block_count());
+  EXPECT_EQ(0U, arena.allocated_bytes());
+
+  // The kept block is reused rather than replaced.
+  arena.Allocate(128);
+  EXPECT_EQ(1U, arena.block_count());
+}
+
+TEST(FrameArenaTest, FramesUseInstalledArena) {
+  FrameArena arena;
+  EXPECT_EQ(NULL, FrameArena::current());
+  {
+    FrameArena::Scope scope(&arena);
+    EXPECT_EQ(&arena, FrameArena::current());
+    std::unique_ptr<StackFrame> frame(new LargeStackFrame());
+    std::unique_ptr<StackFrame> copy(new StackFrame(*frame));
+    EXPECT_TRUE(IsAligned(frame.get()));
+    EXPECT_LE(sizeof(LargeStackFrame) + sizeof(StackFrame),
+              arena.allocated_bytes());
+
+    // A NULL scope uninstalls the arena.
+    size_t allocated = arena.allocated_bytes();
+    {
+      FrameArena::Scope heap_scope(NULL);
+      EXPECT_EQ(NULL, FrameArena::current());
+      std::unique_ptr<StackFrame> heap_frame(new LargeStackFrame());
+    }
+    EXPECT_EQ(allocated, arena.allocated_bytes());
+    EXPECT_EQ(&arena, FrameArena::current());
+  }
+  EXPECT_EQ(NULL, FrameArena::current());
+
+  // Frames made outside any scope come from the heap, and can outlive
+  // arenas.
+  size_t allocated = arena.allocated_bytes();
+  std::unique_ptr<StackFrame> frame(new LargeStackFrame());
+  frame->function_name = "heap frame";
+  EXPECT_EQ(allocated, arena.allocated_bytes());
+}
+
+TEST(FrameArenaTest, ScopesArePerThread) {
+  FrameArena arena;
+  FrameArena::Scope scope(&arena);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.push_back(std::thread([&arena]() {
+      EXPECT_EQ(NULL, FrameArena::current());
+      FrameArena::Scope thread_scope(&arena);
+      for (int j = 0; j < 1000; ++j)
+        delete new LargeStackFrame();
+    }));
+  }
+  for (std::thread& thread : threads)
+    thread.join();
+  EXPECT_LE(4000 * sizeof(LargeStackFrame), arena.allocated_bytes());
+}
+
+}  // namespace
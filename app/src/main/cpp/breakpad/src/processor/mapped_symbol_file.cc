@@ -0,0 +1,142 @@
+// Copyright 2024 Google LLC
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google LLC nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// mapped_symbol_file.cc: Implement google_breakpad::MappedSymbolFile.
+// See mapped_symbol_file.h for details.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>  // Must come first
+#endif
+
+#include "processor/mapped_symbol_file.h"
+
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif  // !_WIN32
+
+#include "processor/logging.h"
+
+namespace google_breakpad {
+
+MappedSymbolFile::MappedSymbolFile()
+    : data_(NULL), size_(0), mapping_size_(0) {
+}
+
+MappedSymbolFile::~MappedSymbolFile() {
+  Unmap();
+}
+
+bool MappedSymbolFile::Map(const string& path) {
+  Unmap();
+
+  FILE* f = fopen(path.c_str(), "rb");
+  if (!f) {
+    string error_string;
+    int error_code = ErrnoString(&error_string);
+    BPLOG(ERROR) << "Could not open " << path <<
+        ", error " << error_code << ": " << error_string;
+    return false;
+  }
+
+  struct stat buf;
+  if (fstat(fileno(f), &buf) == -1) {
+    string error_string;
+    int error_code = ErrnoString(&error_string);
+    BPLOG(ERROR) << "Could not stat " << path <<
+        ", error " << error_code << ": " << error_string;
+    fclose(f);
+    return false;
+  }
+  const size_t file_size = static_cast<size_t>(buf.st_size);
+
+#ifndef _WIN32
+  if (S_ISREG(buf.st_mode)) {
+    // Reserve enough zeroed pages for the file and its null terminator,
+    // then map the file over the start of them.  The tail of the file's
+    // last page reads as zeroes, and if the file ends on a page boundary,
+    // the terminator comes from the reserved page after it.
+    const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t mapping_size =
+        (file_size + 1 + page_size - 1) / page_size * page_size;
+    void* base = mmap(NULL, mapping_size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base != MAP_FAILED && file_size > 0 &&
+        mmap(base, file_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED,
+             fileno(f), 0) == MAP_FAILED) {
+      munmap(base, mapping_size);
+      base = MAP_FAILED;
+    }
+    if (base != MAP_FAILED) {
+      fclose(f);
+      data_ = static_cast<char*>(base);
+      size_ = file_size + 1;
+      mapping_size_ = mapping_size;
+      return true;
+    }
+    BPLOG(INFO) << "Could not map " << path << ", reading it instead";
+  }
+#endif  // !_WIN32
+
+  // The file can't be mapped, so read it into a heap buffer.
+  char* data = new char[file_size + 1];
+  if (fread(data, 1, file_size, f) != file_size) {
+    string error_string;
+    int error_code = ErrnoString(&error_string);
+    BPLOG(ERROR) << "Could not slurp " << path <<
+        ", error " << error_code << ": " << error_string;
+    delete [] data;
+    fclose(f);
+    return false;
+  }
+  fclose(f);
+  data[file_size] = '\0';
+  data_ = data;
+  size_ = file_size + 1;
+  return true;
+}
+
+void MappedSymbolFile::Unmap() {
+  if (!data_)
+    return;
+#ifndef _WIN32
+  if (mapping_size_)
+    munmap(data_, mapping_size_);
+  else
+#endif  // !_WIN32
+    delete [] data_;
+  data_ = NULL;
+  size_ = 0;
+  mapping_size_ = 0;
+}
+
+}  // namespace google_breakpad
@@ -0,0 +1,87 @@
+// Copyright 2024 Google LLC
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google LLC nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// mapped_symbol_file.h: Maps a symbol file into memory so that it can be
+// handed to SourceLineResolverInterface::LoadModuleUsingMemoryBuffer()
+// without being copied.
+//
+// The file is mapped copy-on-write and followed by at least one zero byte,
+// so the buffer has the same layout as the one SourceLineResolverBase::
+// ReadSymbolFile() fills in: the file contents plus a null terminator.
+// Resolvers that only read the buffer, such as FastSourceLineResolver,
+// use the file's pages straight from the page cache.  Resolvers that
+// tokenize it in place, such as BasicSourceLineResolver, only get private
+// copies of the pages they write to.
+//
+// Where memory mapping is unavailable the file is read into a heap buffer.
+
+#ifndef PROCESSOR_MAPPED_SYMBOL_FILE_H__
+#define PROCESSOR_MAPPED_SYMBOL_FILE_H__
+
+#include <stddef.h>
+
+#include "common/using_std_string.h"
+
+namespace google_breakpad {
+
+class MappedSymbolFile {
+ public:
+  MappedSymbolFile();
+  ~MappedSymbolFile();
+
+  // Maps the file at |path|, replacing any existing mapping.  Returns false
+  // if the file cannot be opened or mapped.
+  bool Map(const string& path);
+
+  // Releases the mapping.  It's a no-op if nothing is mapped.
+  void Unmap();
+
+  // The file contents followed by a null terminator, or NULL if nothing is
+  // mapped.  The buffer is writable, but writes are never carried back to
+  // the file.
+  char* data() const { return data_; }
+
+  // The size of data() in bytes, including the null terminator.
+  size_t size() const { return size_; }
+
+ private:
+  char* data_;
+  size_t size_;
+
+  // The size of the whole mapping, rounded up to a page, or 0 if data_ is
+  // a heap buffer.
+  size_t mapping_size_;
+
+  // Disallow copy constructor and assignment operator.
+  MappedSymbolFile(const MappedSymbolFile&);
+  void operator=(const MappedSymbolFile&);
+};
+
+}  // namespace google_breakpad
+
+#endif  // PROCESSOR_MAPPED_SYMBOL_FILE_H__
@@ -0,0 +1,133 @@
+// Copyright 2024 Google LLC
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google LLC nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// mapped_symbol_file_unittest.cc: Unit tests for MappedSymbolFile.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>  // Must come first
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "breakpad_googletest_includes.h"
+#include "common/tests/auto_tempdir.h"
+#include "common/using_std_string.h"
+#include "google_breakpad/processor/source_line_resolver_base.h"
+#include "processor/mapped_symbol_file.h"
+
+namespace {
+
+using google_breakpad::AutoTempDir;
+using google_breakpad::MappedSymbolFile;
+using google_breakpad::SourceLineResolverBase;
+
+string GetTestDataPath() {
+  char* srcdir = getenv("srcdir");
+  return string(srcdir ? srcdir : ".") + "/src/processor/testdata/";
+}
+
+// Writes |contents| to a file called |name| in |dir| and returns its path.
+string WriteFile(const AutoTempDir& dir, const char* name,
+                 const string& contents) {
+  string path = dir.path() + "/" + name;
+  FILE* f = fopen(path.c_str(), "wb");
+  EXPECT_TRUE(f != NULL);
+  if (f) {
+    EXPECT_EQ(contents.size(), fwrite(contents.data(), 1, contents.size(), f));
+    fclose(f);
+  }
+  return path;
+}
+
+TEST(MappedSymbolFileTest, MatchesReadSymbolFile) {
+  string path = GetTestDataPath() +
+      "symbols/test_app.pdb/5A9832E5287241C1838ED98914E9B7FF1/test_app.sym";
+
+  char* read_data;
+  size_t read_size;
+  ASSERT_TRUE(SourceLineResolverBase::ReadSymbolFile(path, &read_data,
+                                                     &read_size));
+
+  MappedSymbolFile mapped_file;
+  ASSERT_TRUE(mapped_file.Map(path));
+  ASSERT_EQ(read_size, mapped_file.size());
+  EXPECT_EQ(0, memcmp(read_data, mapped_file.data(), read_size));
+  EXPECT_EQ('\0', mapped_file.data()[mapped_file.size() - 1]);
+  delete [] read_data;
+}
+
+TEST(MappedSymbolFileTest, PageSizedFileIsTerminated) {
+  AutoTempDir dir;
+  const size_t page_size = static_cast<size_t>(getpagesize());
+  string path = WriteFile(dir, "page.sym", string(page_size, 'x'));
+
+  MappedSymbolFile mapped_file;
+  ASSERT_TRUE(mapped_file.Map(path));
+  ASSERT_EQ(page_size + 1, mapped_file.size());
+  EXPECT_EQ('x', mapped_file.data()[page_size - 1]);
+  EXPECT_EQ('\0', mapped_file.data()[page_size]);
+}
+
+TEST(MappedSymbolFileTest, EmptyFile) {
+  AutoTempDir dir;
+  string path = WriteFile(dir, "empty.sym", string());
+
+  MappedSymbolFile mapped_file;
+  ASSERT_TRUE(mapped_file.Map(path));
+  ASSERT_EQ(1U, mapped_file.size());
+  EXPECT_EQ('\0', mapped_file.data()[0]);
+}
+
+TEST(MappedSymbolFileTest, WritesDoNotReachFile) {
+  AutoTempDir dir;
+  string path = WriteFile(dir, "module.sym", "MODULE Linux x86 0 foo\n");
+
+  MappedSymbolFile mapped_file;
+  ASSERT_TRUE(mapped_file.Map(path));
+  mapped_file.data()[0] = '\0';
+  mapped_file.Unmap();
+  EXPECT_EQ(NULL, mapped_file.data());
+  EXPECT_EQ(0U, mapped_file.size());
+
+  ASSERT_TRUE(mapped_file.Map(path));
+  EXPECT_STREQ("MODULE Linux x86 0 foo\n", mapped_file.data());
+}
+
+TEST(MappedSymbolFileTest, MissingFile) {
+  AutoTempDir dir;
+  MappedSymbolFile mapped_file;
+  EXPECT_FALSE(mapped_file.Map(dir.path() + "/missing.sym"));
+  EXPECT_EQ(NULL, mapped_file.data());
+}
+
+}  // namespace
@@ -36,12 +36,14 @@
 
 #include "google_breakpad/processor/microdump.h"
 
+#include <ctype.h>
 #include <stdio.h>
 #include <string.h>
 
+#include <iostream>
 #include <memory>
-#include <sstream>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "google_breakpad/common/minidump_cpu_arm.h"
@@ -56,13 +58,13 @@ namespace {
 static const char kGoogleBreakpadKey[] = "google-breakpad";
 static const char kMicrodumpBegin[] = "-----BEGIN BREAKPAD MICRODUMP-----";
 static const char kMicrodumpEnd[] = "-----END BREAKPAD MICRODUMP-----";
-static const char kOsKey[] = ": O ";
-static const char kCpuKey[] = ": C ";
-static const char kCrashReasonKey[] = ": R ";
-static const char kGpuKey[] = ": G ";
-static const char kMmapKey[] = ": M ";
-static const char kStackKey[] = ": S ";
-static const char kStackFirstLineKey[] = ": S 0 ";
+static const char kRecordSeparator[] = ": ";
+static const char kOsKey = 'O';
+static const char kCpuKey = 'C';
+static const char kCrashReasonKey = 'R';
+static const char kGpuKey = 'G';
+static const char kMmapKey = 'M';
+static const char kStackKey = 'S';
 static const char kArmArchitecture[] = "arm";
 static const char kArm64Architecture[] = "arm64";
 static const char kX86Architecture[] = "x86";
@@ -70,33 +72,106 @@ static const char kMipsArchitecture[] = "mips";
 static const char kMips64Architecture[] = "mips64";
 static const char kGpuUnknown[] = "UNKNOWN";
 
+// Returns the value of the hex digit |c|, or -1 if it isn't one.
+inline int HexDigitValue(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  return -1;
+}
+
+// A range of the microdump text. Nothing in a microdump is null-terminated,
+// as it can be read straight out of a (mapped) log file.
+struct TextRange {
+  TextRange() : begin(NULL), end(NULL) {}
+  TextRange(const char* begin, const char* end) : begin(begin), end(end) {}
+
+  size_t size() const { return end - begin; }
+  bool empty() const { return begin == end; }
+  string str() const { return string(begin, end); }
+  bool Equals(const char* str) const {
+    return size() == strlen(str) && memcmp(begin, str, size()) == 0;
+  }
+
+  const char* begin;
+  const char* end;
+};
+
+// Returns the first occurrence of |needle| in |range|, or NULL.
+const char* Find(const TextRange& range, const char* needle) {
+  const size_t needle_size = strlen(needle);
+  for (const char* p = range.begin;
+       static_cast<size_t>(range.end - p) >= needle_size; ++p) {
+    p = static_cast<const char*>(memchr(p, needle[0], range.end - p));
+    if (!p || static_cast<size_t>(range.end - p) < needle_size)
+      return NULL;
+    if (memcmp(p, needle, needle_size) == 0)
+      return p;
+  }
+  return NULL;
+}
+
+// Removes the next whitespace-separated token from the start of |range| and
+// returns it.
+TextRange NextToken(TextRange* range) {
+  const char* p = range->begin;
+  while (p != range->end && isspace(static_cast<unsigned char>(*p)))
+    ++p;
+  const char* token_begin = p;
+  while (p != range->end && !isspace(static_cast<unsigned char>(*p)))
+    ++p;
+  range->begin = p;
+  return TextRange(token_begin, p);
+}
+
+// Parses the hex number at the start of |str|, stopping at the first
+// character that is not a hex digit.
 template<typename T>
-T HexStrToL(const string& str) {
+T HexStrToL(const TextRange& str) {
   uint64_t res = 0;
-  std::istringstream ss(str);
-  ss >> std::hex >> res;
+  for (const char* p = str.begin;
+       p != str.end && HexDigitValue(*p) >= 0; ++p) {
+    res = (res << 4) | HexDigitValue(*p);
+  }
   return static_cast<T>(res);
 }
 
-std::vector<uint8_t> ParseHexBuf(const string& str) {
-  std::vector<uint8_t> buf;
-  for (size_t i = 0; i < str.length(); i += 2) {
-    buf.push_back(HexStrToL<uint8_t>(str.substr(i, 2)));
+// Returns how many bytes DecodeHex() produces for |str|.
+size_t DecodedHexSize(const TextRange& str) {
+  return (str.size() + 1) / 2;
+}
+
+// Decodes each pair of hex digits in |str| into a byte at |out|. A last,
+// unpaired digit is decoded as a byte on its own. Characters that aren't hex
+// digits count as zero.
+void DecodeHex(const TextRange& str, uint8_t* out) {
+  const char* p = str.begin;
+  for (; str.end - p >= 2; p += 2) {
+    const int high = HexDigitValue(p[0]);
+    const int low = HexDigitValue(p[1]);
+    *out++ = ((high < 0 ? 0 : high) << 4) | (low < 0 ? 0 : low);
+  }
+  if (p != str.end) {
+    const int digit = HexDigitValue(*p);
+    *out = digit < 0 ? 0 : digit;
   }
-  return buf;
 }
 
-bool GetLine(std::istringstream* istream, string* str) {
-  if (std::getline(*istream, *str)) {
-    // Trim any trailing newline from the end of the line. Allows us
-    // to seamlessly handle both Windows/DOS and Unix formatted input. The
-    // adb tool generally writes logcat dumps in Windows/DOS format.
-    if (!str->empty() && str->at(str->size() - 1) == '\r') {
-      str->erase(str->size() - 1);
-    }
-    return true;
+// Decodes the hex digits in |str| into a new |ContextType|, or returns NULL
+// if they are the wrong size for one.
+template<typename ContextType>
+ContextType* DecodeContext(const TextRange& str) {
+  if (DecodedHexSize(str) != sizeof(ContextType)) {
+    std::cerr << "Malformed CPU context. Got " << DecodedHexSize(str)
+              << " bytes instead of " << sizeof(ContextType) << std::endl;
+    return NULL;
   }
-  return false;
+  ContextType* context = new ContextType();
+  DecodeHex(str, reinterpret_cast<uint8_t*>(context));
+  return context;
 }
 
 }  // namespace
@@ -167,6 +242,12 @@ void MicrodumpMemoryRegion::Init(uint64_t base_address,
   contents_ = contents;
 }
 
+void MicrodumpMemoryRegion::Init(uint64_t base_address,
+                                 std::vector<uint8_t>&& contents) {
+  base_address_ = base_address;
+  contents_ = std::move(contents);
+}
+
 uint64_t MicrodumpMemoryRegion::GetBase() const { return base_address_; }
 
 uint32_t MicrodumpMemoryRegion::GetSize() const { return contents_.size(); }
@@ -206,6 +287,15 @@ bool MicrodumpMemoryRegion::GetMemoryLittleEndian(uint64_t address,
   return true;
 }
 
+const uint8_t* MicrodumpMemoryRegion::GetContiguousMemory() const {
+#if defined(__BIG_ENDIAN__) || \
+  (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+  return NULL;
+#else
+  return contents_.empty() ? NULL : &contents_[0];
+#endif
+}
+
 void MicrodumpMemoryRegion::Print() const {
   // Not reached, just needed to honor the base class contract.
   assert(false);
@@ -215,82 +305,105 @@ void MicrodumpMemoryRegion::Print() const {
 // Microdump
 //
 Microdump::Microdump(const string& contents)
+  : Microdump(contents.data(), contents.size(), NULL) {
+}
+
+Microdump::Microdump(const char* data, size_t length, size_t* end_offset)
   : context_(new MicrodumpContext()),
     stack_region_(new MicrodumpMemoryRegion()),
     modules_(new MicrodumpModules()),
     system_info_(new SystemInfo()),
     crash_reason_(),
     crash_address_(0u) {
-  assert(!contents.empty());
+  assert(length);
 
   bool in_microdump = false;
-  string line;
   uint64_t stack_start = 0;
   std::vector<uint8_t> stack_content;
   string arch;
 
-  std::istringstream stream(contents);
-  while (GetLine(&stream, &line)) {
-    if (line.find(kGoogleBreakpadKey) == string::npos) {
-      continue;
+  const char* const data_end = data + length;
+  const char* next_line = data;
+  while (next_line != data_end) {
+    TextRange line(next_line, data_end);
+    const char* newline =
+        static_cast<const char*>(memchr(line.begin, '\n', line.size()));
+    if (newline) {
+      line.end = newline;
+      next_line = newline + 1;
+    } else {
+      next_line = data_end;
     }
-    if (line.find(kMicrodumpBegin) != string::npos) {
-      in_microdump = true;
+    // Trim any trailing newline from the end of the line. Allows us
+    // to seamlessly handle both Windows/DOS and Unix formatted input. The
+    // adb tool generally writes logcat dumps in Windows/DOS format.
+    if (!line.empty() && line.end[-1] == '\r')
+      --line.end;
+
+    // Microdump lines are logged with the google-breakpad tag, and their
+    // contents follow the first ": " after it.
+    const char* tag = Find(line, kGoogleBreakpadKey);
+    if (!tag)
       continue;
-    }
+    TextRange record(tag + strlen(kGoogleBreakpadKey), line.end);
+    const char* separator = Find(record, kRecordSeparator);
+    if (!separator)
+      continue;
+    record.begin = separator + strlen(kRecordSeparator);
+
     if (!in_microdump) {
+      if (Find(record, kMicrodumpBegin))
+        in_microdump = true;
       continue;
     }
-    if (line.find(kMicrodumpEnd) != string::npos) {
+    if (Find(record, kMicrodumpEnd))
       break;
-    }
 
-    size_t pos;
-    if ((pos = line.find(kOsKey)) != string::npos) {
-      string os_str(line, pos + strlen(kOsKey));
-      std::istringstream os_tokens(os_str);
-      string os_id;
-      string num_cpus;
-      string os_version;
+    // Each record is a one letter key, a space and the key's values.
+    if (record.size() < 2 || record.begin[1] != ' ')
+      continue;
+    const char key = record.begin[0];
+    record.begin += 2;
+
+    if (key == kOsKey) {
+      TextRange os_id = NextToken(&record);
+      arch = NextToken(&record).str();
+      TextRange num_cpus = NextToken(&record);
       // This reflect the actual HW arch and might not match the arch emulated
       // for the execution (e.g., running a 32-bit binary on a 64-bit cpu).
-      string hw_arch;
-
-      os_tokens >> os_id;
-      os_tokens >> arch;
-      os_tokens >> num_cpus;
-      os_tokens >> hw_arch;
-      GetLine(&os_tokens, &os_version);
-      os_version.erase(0, 1);  // remove leading space.
+      NextToken(&record);  // hw_arch
+      if (!record.empty())
+        ++record.begin;  // remove leading space.
 
       system_info_->cpu = arch;
       system_info_->cpu_count = HexStrToL<uint8_t>(num_cpus);
-      system_info_->os_version = os_version;
+      system_info_->os_version = record.str();
 
-      if (os_id == "L") {
+      if (os_id.Equals("L")) {
         system_info_->os = "Linux";
         system_info_->os_short = "linux";
-      } else if (os_id == "A") {
+      } else if (os_id.Equals("A")) {
         system_info_->os = "Android";
         system_info_->os_short = "android";
         modules_->SetEnableModuleShrink(true);
       }
 
       // OS line also contains release and version for future use.
-    } else if ((pos = line.find(kStackKey)) != string::npos) {
-      if (line.find(kStackFirstLineKey) != string::npos) {
+    } else if (key == kStackKey) {
+      TextRange start_addr_str = NextToken(&record);
+      if (start_addr_str.Equals("0")) {
         // The first line of the stack (S 0 stack header) provides the value of
         // the stack pointer, the start address of the stack being dumped and
-        // the length of the stack. We could use it in future to double check
-        // that we received all the stack as expected.
+        // the length of the stack. Use the length to decode all of the stack
+        // into one buffer, as long as it is plausible for the input.
+        NextToken(&record);  // stack pointer
+        NextToken(&record);  // start address
+        const uint64_t stack_length = HexStrToL<uint64_t>(NextToken(&record));
+        if (stack_length <= static_cast<uint64_t>(data_end - next_line) / 2)
+          stack_content.reserve(stack_length);
         continue;
       }
-      string stack_str(line, pos + strlen(kStackKey));
-      std::istringstream stack_tokens(stack_str);
-      string start_addr_str;
-      string raw_content;
-      stack_tokens >> start_addr_str;
-      stack_tokens >> raw_content;
+      TextRange raw_content = NextToken(&record);
       uint64_t start_addr = HexStrToL<uint64_t>(start_addr_str);
 
       if (stack_start != 0) {
@@ -299,98 +412,73 @@ Microdump::Microdump(const string& contents)
       } else {
         stack_start = start_addr;
       }
-      std::vector<uint8_t> chunk = ParseHexBuf(raw_content);
-      stack_content.insert(stack_content.end(), chunk.begin(), chunk.end());
+      const size_t offset = stack_content.size();
+      stack_content.resize(offset + DecodedHexSize(raw_content));
+      DecodeHex(raw_content, &stack_content[offset]);
 
-    } else if ((pos = line.find(kCpuKey)) != string::npos) {
-      string cpu_state_str(line, pos + strlen(kCpuKey));
-      std::vector<uint8_t> cpu_state_raw = ParseHexBuf(cpu_state_str);
+    } else if (key == kCpuKey) {
       if (strcmp(arch.c_str(), kArmArchitecture) == 0) {
-        if (cpu_state_raw.size() != sizeof(MDRawContextARM)) {
-          std::cerr << "Malformed CPU context. Got " << cpu_state_raw.size()
-                    << " bytes instead of " << sizeof(MDRawContextARM)
-                    << std::endl;
+        MDRawContextARM* arm = DecodeContext<MDRawContextARM>(record);
+        if (!arm)
           continue;
-        }
-        MDRawContextARM* arm = new MDRawContextARM();
-        memcpy(arm, &cpu_state_raw[0], cpu_state_raw.size());
         context_->SetContextARM(arm);
       } else if (strcmp(arch.c_str(), kArm64Architecture) == 0) {
-        if (cpu_state_raw.size() == sizeof(MDRawContextARM64)) {
-          MDRawContextARM64* arm = new MDRawContextARM64();
-          memcpy(arm, &cpu_state_raw[0], cpu_state_raw.size());
-          context_->SetContextARM64(arm);
-        } else if (cpu_state_raw.size() == sizeof(MDRawContextARM64_Old)) {
+        if (DecodedHexSize(record) == sizeof(MDRawContextARM64_Old)) {
           MDRawContextARM64_Old old_arm;
-          memcpy(&old_arm, &cpu_state_raw[0], cpu_state_raw.size());
+          DecodeHex(record, reinterpret_cast<uint8_t*>(&old_arm));
           MDRawContextARM64* new_arm = new MDRawContextARM64();
           ConvertOldARM64Context(old_arm, new_arm);
           context_->SetContextARM64(new_arm);
         } else {
-          std::cerr << "Malformed CPU context. Got " << cpu_state_raw.size()
-                    << " bytes instead of " << sizeof(MDRawContextARM64)
-                    << std::endl;
-          continue;
+          MDRawContextARM64* arm = DecodeContext<MDRawContextARM64>(record);
+          if (!arm)
+            continue;
+          context_->SetContextARM64(arm);
         }
       } else if (strcmp(arch.c_str(), kX86Architecture) == 0) {
-        if (cpu_state_raw.size() != sizeof(MDRawContextX86)) {
-          std::cerr << "Malformed CPU context. Got " << cpu_state_raw.size()
-                    << " bytes instead of " << sizeof(MDRawContextX86)
-                    << std::endl;
+        MDRawContextX86* x86 = DecodeContext<MDRawContextX86>(record);
+        if (!x86)
           continue;
-        }
-        MDRawContextX86* x86 = new MDRawContextX86();
-        memcpy(x86, &cpu_state_raw[0], cpu_state_raw.size());
         context_->SetContextX86(x86);
       } else if (strcmp(arch.c_str(), kMipsArchitecture) == 0) {
-        if (cpu_state_raw.size() != sizeof(MDRawContextMIPS)) {
-          std::cerr << "Malformed CPU context. Got " << cpu_state_raw.size()
-                    << " bytes instead of " << sizeof(MDRawContextMIPS)
-                    << std::endl;
+        MDRawContextMIPS* mips32 = DecodeContext<MDRawContextMIPS>(record);
+        if (!mips32)
           continue;
-        }
-        MDRawContextMIPS* mips32 = new MDRawContextMIPS();
-        memcpy(mips32, &cpu_state_raw[0], cpu_state_raw.size());
         context_->SetContextMIPS(mips32);
       } else if (strcmp(arch.c_str(), kMips64Architecture) == 0) {
-        if (cpu_state_raw.size() != sizeof(MDRawContextMIPS)) {
-          std::cerr << "Malformed CPU context. Got " << cpu_state_raw.size()
-                    << " bytes instead of " << sizeof(MDRawContextMIPS)
-                    << std::endl;
+        MDRawContextMIPS* mips64 = DecodeContext<MDRawContextMIPS>(record);
+        if (!mips64)
           continue;
-        }
-        MDRawContextMIPS* mips64 = new MDRawContextMIPS();
-        memcpy(mips64, &cpu_state_raw[0], cpu_state_raw.size());
         context_->SetContextMIPS64(mips64);
       } else {
         std::cerr << "Unsupported architecture: " << arch << std::endl;
       }
-    } else if ((pos = line.find(kCrashReasonKey)) != string::npos) {
-      string crash_reason_str(line, pos + strlen(kCrashReasonKey));
-      std::istringstream crash_reason_tokens(crash_reason_str);
-      string signal;
-      string address;
-      crash_reason_tokens >> signal;
-      crash_reason_tokens >> crash_reason_;
-      crash_reason_tokens >> address;
-      crash_address_ = HexStrToL<uint64_t>(address);
-    } else if ((pos = line.find(kGpuKey)) != string::npos) {
-      string gpu_str(line, pos + strlen(kGpuKey));
-      if (strcmp(gpu_str.c_str(), kGpuUnknown) != 0) {
-        std::istringstream gpu_tokens(gpu_str);
-        std::getline(gpu_tokens, system_info_->gl_version, '|');
-        std::getline(gpu_tokens, system_info_->gl_vendor, '|');
-        std::getline(gpu_tokens, system_info_->gl_renderer, '|');
+    } else if (key == kCrashReasonKey) {
+      NextToken(&record);  // signal number
+      crash_reason_ = NextToken(&record).str();
+      crash_address_ = HexStrToL<uint64_t>(NextToken(&record));
+    } else if (key == kGpuKey) {
+      if (!record.Equals(kGpuUnknown)) {
+        string* const gpu_fields[] = {
+          &system_info_->gl_version,
+          &system_info_->gl_vendor,
+          &system_info_->gl_renderer
+        };
+        for (size_t i = 0; i < 3 && !record.empty(); ++i) {
+          const char* bar =
+              static_cast<const char*>(memchr(record.begin, '|',
+                                              record.size()));
+          const char* field_end = bar ? bar : record.end;
+          gpu_fields[i]->assign(record.begin, field_end);
+          record.begin = bar ? bar + 1 : record.end;
+        }
       }
-    } else if ((pos = line.find(kMmapKey)) != string::npos) {
-      string mmap_line(line, pos + strlen(kMmapKey));
-      std::istringstream mmap_tokens(mmap_line);
-      string addr, offset, size, identifier, filename;
-      mmap_tokens >> addr;
-      mmap_tokens >> offset;
-      mmap_tokens >> size;
-      mmap_tokens >> identifier;
-      mmap_tokens >> filename;
+    } else if (key == kMmapKey) {
+      TextRange addr = NextToken(&record);
+      NextToken(&record);  // offset
+      TextRange size = NextToken(&record);
+      const string identifier = NextToken(&record).str();
+      const string filename = NextToken(&record).str();
 
       modules_->Add(new BasicCodeModule(
           HexStrToL<uint64_t>(addr),  // base_address
@@ -402,7 +490,9 @@ Microdump::Microdump(const string& contents)
           ""));                       // version
     }
   }
-  stack_region_->Init(stack_start, stack_content);
+  stack_region_->Init(stack_start, std::move(stack_content));
+  if (end_offset)
+    *end_offset = next_line - data;
 }
 
 }  // namespace google_breakpad
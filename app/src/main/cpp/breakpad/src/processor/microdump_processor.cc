@@ -75,6 +75,7 @@ ProcessResult MicrodumpProcessor::Process(Microdump *microdump,
 
   scoped_ptr<CallStack> stack(new CallStack());
   if (stackwalker.get()) {
+    stackwalker->set_frame_arena(process_state->frame_arena_);
     if (!stackwalker->Walk(stack.get(),
                            &process_state->modules_without_symbols_,
                            &process_state->modules_with_corrupt_symbols_)) {
@@ -238,6 +238,26 @@ TEST_F(MicrodumpProcessorTest, TestProcessMultiple) {
   ASSERT_EQ(5U, state.threads()->at(0)->frames()->size());
 }
 
+TEST_F(MicrodumpProcessorTest, TestReadMultipleFromLog) {
+  string log;
+  ReadFile(files_path_ + "microdump-multiple.dmp", &log);
+
+  size_t end_offset;
+  Microdump first(log.data(), log.size(), &end_offset);
+  EXPECT_EQ(6, first.GetSystemInfo()->cpu_count);
+  EXPECT_EQ(156U, first.GetModules()->module_count());
+  EXPECT_EQ(8192U, first.GetMemory()->GetSize());
+  ASSERT_LT(end_offset, log.size());
+
+  // The log's second microdump was cut off after its OS line.
+  const size_t offset = end_offset;
+  Microdump second(log.data() + offset, log.size() - offset, &end_offset);
+  EXPECT_EQ(log.size() - offset, end_offset);
+  EXPECT_EQ(6, second.GetSystemInfo()->cpu_count);
+  EXPECT_EQ(0U, second.GetModules()->module_count());
+  EXPECT_EQ(0U, second.GetMemory()->GetSize());
+}
+
 TEST_F(MicrodumpProcessorTest, TestProcessMips) {
   ProcessState state;
   AnalyzeDump("microdump-mips32.dmp", false /* omit_symbols */,
@@ -33,18 +33,33 @@
 #include <config.h>  // Must come first
 #endif
 
+#include <dirent.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "common/path_helper.h"
 #include "common/scoped_ptr.h"
 #include "common/using_std_string.h"
 #include "google_breakpad/processor/basic_source_line_resolver.h"
+#include "google_breakpad/processor/code_module.h"
+#include "google_breakpad/processor/code_modules.h"
 #include "google_breakpad/processor/microdump.h"
 #include "google_breakpad/processor/microdump_processor.h"
 #include "google_breakpad/processor/process_state.h"
@@ -59,12 +74,16 @@ namespace {
 struct Options {
   bool machine_readable;
   bool output_stack_contents;
+  bool batch;
+  int batch_threads;
 
   string microdump_file;
   std::vector<string> symbol_paths;
 };
 
 using google_breakpad::BasicSourceLineResolver;
+using google_breakpad::CodeModule;
+using google_breakpad::CodeModules;
 using google_breakpad::Microdump;
 using google_breakpad::MicrodumpProcessor;
 using google_breakpad::ProcessResult;
@@ -125,6 +144,281 @@ int PrintMicrodumpProcess(const Options& options) {
   return 1;
 }
 
+static const char kMicrodumpBegin[] = "-----BEGIN BREAKPAD MICRODUMP-----";
+
+// Reads all of |path|, or of stdin if |path| is "-", into |contents|.
+bool ReadBatchInput(const string& path, string* contents) {
+  std::ifstream file_stream;
+  std::istream* stream = &std::cin;
+  if (path != "-") {
+    file_stream.open(path, std::ios_base::binary);
+    if (!file_stream) {
+      BPLOG(ERROR) << "Could not open " << path;
+      return false;
+    }
+    stream = &file_stream;
+  }
+  contents->assign(std::istreambuf_iterator<char>(*stream),
+                   std::istreambuf_iterator<char>());
+  return !stream->bad();
+}
+
+// Lists the files to read for a batch: |path| itself, or the regular files
+// in it, in name order, if it is a directory.
+std::vector<string> ListBatchInputs(const string& path) {
+  std::vector<string> inputs;
+  struct stat st;
+  if (path == "-" || stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+    inputs.push_back(path);
+    return inputs;
+  }
+  DIR* dir = opendir(path.c_str());
+  if (!dir) {
+    BPLOG(ERROR) << "Could not open directory " << path;
+    return inputs;
+  }
+  while (struct dirent* entry = readdir(dir)) {
+    if (entry->d_name[0] == '.')
+      continue;
+    string file = path + "/" + entry->d_name;
+    if (stat(file.c_str(), &st) == 0 && S_ISREG(st.st_mode))
+      inputs.push_back(file);
+  }
+  closedir(dir);
+  std::sort(inputs.begin(), inputs.end());
+  return inputs;
+}
+
+// One microdump of a batch, from when it is read until its result is
+// printed.
+struct BatchJob {
+  string source;  // The file the microdump was read from.
+  int index;      // The microdump's position within |source|.
+  scoped_ptr<Microdump> microdump;
+  ProcessState process_state;
+  ProcessResult result;
+  bool done;
+};
+
+// Processes a stream of microdumps, such as a log holding many of them or
+// a directory of logs, in a single invocation. The calling thread parses
+// microdumps and queues them, and a pool of workers walks their stacks.
+// Each worker keeps one symbol supplier and resolver for the whole batch,
+// so a module's symbols are only loaded once per worker rather than once
+// per microdump; they aren't shared between workers because
+// BasicSourceLineResolver isn't thread-safe. The resolver only knows
+// modules by code file, so symbols loaded for one build of a module are
+// dropped before a microdump from another build of it is processed.
+//
+// Results are printed in input order, each in the machine-readable format
+// preceded by a line of the form
+//   Microdump|<source>|<index>|<ProcessResult>
+class MicrodumpBatch {
+ public:
+  explicit MicrodumpBatch(const Options& options)
+      : options_(options),
+        max_in_flight_(4 * options.batch_threads),
+        input_done_(false),
+        printing_(false),
+        processed_(0),
+        failed_(0) {}
+
+  // Processes every microdump in |options.microdump_file|, reporting the
+  // throughput to stderr. Returns 0 if all of them were processed
+  // successfully.
+  int Run() {
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int i = 0; i < options_.batch_threads; ++i)
+      workers.emplace_back(&MicrodumpBatch::Worker, this);
+
+    bool read_all = true;
+    std::vector<string> inputs = ListBatchInputs(options_.microdump_file);
+    for (const string& input : inputs) {
+      string contents;
+      if (!ReadBatchInput(input, &contents)) {
+        read_all = false;
+        continue;
+      }
+      AddMicrodumps(input, contents.data(), contents.size());
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      input_done_ = true;
+    }
+    work_cv_.notify_all();
+    for (std::thread& worker : workers)
+      worker.join();
+
+    double seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    fprintf(stderr,
+            "Processed %d microdumps (%d failed) from %zu files in %.3f s: "
+            "%.1f dumps/sec\n",
+            processed_, failed_, inputs.size(), seconds,
+            seconds > 0 ? processed_ / seconds : 0.0);
+    return read_all && failed_ == 0 ? 0 : 1;
+  }
+
+ private:
+  // Parses the microdumps in the |length| bytes at |data| and queues them,
+  // waiting whenever too many are already in flight.
+  void AddMicrodumps(const string& source, const char* data, size_t length) {
+    const char* end = data + length;
+    for (int index = 0; ; ++index) {
+      // Stop at trailing log lines that hold no more microdumps.
+      if (std::search(data, end, kMicrodumpBegin,
+                      kMicrodumpBegin + sizeof(kMicrodumpBegin) - 1) == end) {
+        return;
+      }
+      size_t microdump_length;
+      std::unique_ptr<BatchJob> job(new BatchJob);
+      job->source = source;
+      job->index = index;
+      job->microdump.reset(new Microdump(data, end - data, &microdump_length));
+      job->result = google_breakpad::PROCESS_OK;
+      job->done = false;
+      data += microdump_length;
+
+      std::unique_lock<std::mutex> lock(mutex_);
+      space_cv_.wait(lock, [this] {
+        return in_flight_.size() < max_in_flight_;
+      });
+      queue_.push_back(job.get());
+      in_flight_.push_back(std::move(job));
+      work_cv_.notify_one();
+    }
+  }
+
+  void Worker() {
+    scoped_ptr<SimpleSymbolSupplier> symbol_supplier;
+    if (!options_.symbol_paths.empty()) {
+      symbol_supplier.reset(new SimpleSymbolSupplier(options_.symbol_paths));
+    }
+    BasicSourceLineResolver resolver;
+    StackFrameSymbolizer frame_symbolizer(symbol_supplier.get(), &resolver);
+    MicrodumpProcessor microdump_processor(&frame_symbolizer);
+    // The debug identifier of the build whose symbols |resolver| holds,
+    // keyed by code file.
+    std::map<string, string> loaded_builds;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+      work_cv_.wait(lock, [this] { return !queue_.empty() || input_done_; });
+      if (queue_.empty())
+        return;
+      BatchJob* job = queue_.front();
+      queue_.pop_front();
+      lock.unlock();
+      const CodeModules* modules = job->microdump->GetModules();
+      UnloadOtherBuilds(modules, &resolver, &loaded_builds);
+      // Also forget the modules that had no symbols, as this build of them
+      // may have some.
+      frame_symbolizer.Reset();
+      job->result = microdump_processor.Process(job->microdump.get(),
+                                                &job->process_state);
+      RecordLoadedBuilds(modules, &resolver, &loaded_builds);
+      lock.lock();
+      job->done = true;
+      PrintFinishedJobs(&lock);
+    }
+  }
+
+  // Unloads the symbols in |resolver| for each of |modules| that were
+  // loaded for a different build of it.
+  static void UnloadOtherBuilds(const CodeModules* modules,
+                                BasicSourceLineResolver* resolver,
+                                std::map<string, string>* loaded_builds) {
+    if (!modules)
+      return;
+    for (unsigned int i = 0; i < modules->module_count(); ++i) {
+      const CodeModule* module = modules->GetModuleAtIndex(i);
+      std::map<string, string>::iterator loaded =
+          loaded_builds->find(module->code_file());
+      if (loaded == loaded_builds->end() ||
+          loaded->second == module->debug_identifier()) {
+        continue;
+      }
+      resolver->UnloadModule(module);
+      loaded_builds->erase(loaded);
+    }
+  }
+
+  // Records which build of each of |modules| |resolver| now holds symbols
+  // for.
+  static void RecordLoadedBuilds(const CodeModules* modules,
+                                 BasicSourceLineResolver* resolver,
+                                 std::map<string, string>* loaded_builds) {
+    if (!modules)
+      return;
+    for (unsigned int i = 0; i < modules->module_count(); ++i) {
+      const CodeModule* module = modules->GetModuleAtIndex(i);
+      if (resolver->HasModule(module))
+        (*loaded_builds)[module->code_file()] = module->debug_identifier();
+    }
+  }
+
+  // Prints and releases the jobs at the front of |in_flight_| that are
+  // done. Must be called with |lock| held on |mutex_|, which is released
+  // while printing so that other workers aren't held up by the output.
+  // Only one worker prints at a time, to keep results in input order;
+  // jobs that finish meanwhile are left for it.
+  void PrintFinishedJobs(std::unique_lock<std::mutex>* lock) {
+    if (printing_)
+      return;
+    printing_ = true;
+    for (;;) {
+      std::vector<std::unique_ptr<BatchJob>> finished;
+      while (!in_flight_.empty() && in_flight_.front()->done) {
+        finished.push_back(std::move(in_flight_.front()));
+        in_flight_.pop_front();
+      }
+      if (finished.empty())
+        break;
+      space_cv_.notify_one();
+      lock->unlock();
+
+      int failed = 0;
+      for (const std::unique_ptr<BatchJob>& job : finished) {
+        printf("Microdump|%s|%d|%d\n",
+               job->source.c_str(), job->index, job->result);
+        if (job->result == google_breakpad::PROCESS_OK)
+          PrintProcessStateMachineReadable(job->process_state);
+        else
+          ++failed;
+      }
+      fflush(stdout);
+      int printed = finished.size();
+      finished.clear();
+
+      lock->lock();
+      processed_ += printed;
+      failed_ += failed;
+    }
+    printing_ = false;
+  }
+
+  const Options& options_;
+  const size_t max_in_flight_;
+
+  std::mutex mutex_;
+  // Signaled when a job is queued or the input is exhausted.
+  std::condition_variable work_cv_;
+  // Signaled when jobs leave |in_flight_|.
+  std::condition_variable space_cv_;
+  // Parsed microdumps waiting for a worker.
+  std::deque<BatchJob*> queue_;
+  // Every job not yet handed to the printing worker, in input order.
+  std::deque<std::unique_ptr<BatchJob>> in_flight_;
+  bool input_done_;
+  // Whether a worker is printing finished jobs.
+  bool printing_;
+  int processed_;
+  int failed_;
+};
+
 }  // namespace
 
 static void Usage(int argc, const char *argv[], bool error) {
@@ -136,7 +430,13 @@ static void Usage(int argc, const char *argv[], bool error) {
           "Options:\n"
           "\n"
           "  -m         Output in machine-readable format\n"
-          "  -s         Output stack contents\n",
+          "  -s         Output stack contents\n"
+          "  -b         Batch mode: <microdump-file> may be a log holding any\n"
+          "             number of microdumps, a directory of such logs or - for\n"
+          "             stdin. Prints a machine-readable result per microdump\n"
+          "             and the throughput\n"
+          "  -j <n>     Number of threads processing microdumps in batch mode\n"
+          "             (default: the number of CPUs)\n",
           google_breakpad::BaseName(argv[0]).c_str());
 }
 
@@ -145,8 +445,11 @@ static void SetupOptions(int argc, const char *argv[], Options* options) {
 
   options->machine_readable = false;
   options->output_stack_contents = false;
+  options->batch = false;
+  options->batch_threads =
+      std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
 
-  while ((ch = getopt(argc, (char * const*)argv, "hms")) != -1) {
+  while ((ch = getopt(argc, (char * const*)argv, "hmsbj:")) != -1) {
     switch (ch) {
       case 'h':
         Usage(argc, argv, false);
@@ -159,6 +462,17 @@ static void SetupOptions(int argc, const char *argv[], Options* options) {
       case 's':
         options->output_stack_contents = true;
         break;
+      case 'b':
+        options->batch = true;
+        break;
+      case 'j':
+        options->batch_threads = atoi(optarg);
+        if (options->batch_threads < 1) {
+          fprintf(stderr, "%s: Invalid thread count %s\n", argv[0], optarg);
+          Usage(argc, argv, true);
+          exit(1);
+        }
+        break;
 
       case '?':
         Usage(argc, argv, true);
@@ -183,5 +497,7 @@ int main(int argc, const char* argv[]) {
   Options options;
   SetupOptions(argc, argv, &options);
 
+  if (options.batch)
+    return MicrodumpBatch(options).Run();
   return PrintMicrodumpProcess(options);
 }
@@ -54,6 +54,8 @@
 #ifdef _WIN32
 #include <io.h>
 #else  // _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #endif  // _WIN32
 
@@ -65,6 +67,7 @@
 #include "processor/range_map-inl.h"
 
 #include "common/macros.h"
+#include "common/minidump_compression.h"
 #include "common/scoped_ptr.h"
 #include "common/stdio_wrapper.h"
 #include "google_breakpad/processor/dump_context.h"
@@ -1526,6 +1529,17 @@ const uint8_t* MinidumpMemoryRegion::GetMemory() const {
       return NULL;
     }
 
+    // A mapped minidump's memory is used in place.  Byte-swapping, if
+    // needed, happens as values are read by GetMemoryAtAddress.
+    if (minidump_->is_mapped()) {
+      const uint8_t* memory = minidump_->GetMappedBytes(
+          descriptor_->memory.rva, descriptor_->memory.data_size);
+      if (!memory) {
+        BPLOG(ERROR) << "MinidumpMemoryRegion could not read memory region";
+      }
+      return memory;
+    }
+
     if (!minidump_->SeekSet(descriptor_->memory.rva)) {
       BPLOG(ERROR) << "MinidumpMemoryRegion could not seek to memory region";
       return NULL;
@@ -1647,6 +1661,13 @@ bool MinidumpMemoryRegion::GetMemoryAtAddress(uint64_t  address,
 }
 
 
+const uint8_t* MinidumpMemoryRegion::GetContiguousMemory() const {
+  if (!valid_ || minidump_->swap())
+    return NULL;
+  return GetMemory();
+}
+
+
 void MinidumpMemoryRegion::Print() const {
   if (!valid_) {
     BPLOG(ERROR) << "MinidumpMemoryRegion cannot print invalid data";
@@ -4780,16 +4801,21 @@ void MinidumpMiscInfo::Print() {
 
 MinidumpBreakpadInfo::MinidumpBreakpadInfo(Minidump* minidump)
     : MinidumpStream(minidump),
-      breakpad_info_() {
+      breakpad_info_(),
+      pause_duration_us_(0),
+      crash_arena_high_water_(0),
+      crash_arena_overflow_bytes_(0) {
 }
 
 
 bool MinidumpBreakpadInfo::Read(uint32_t expected_size) {
   valid_ = false;
 
-  if (expected_size != sizeof(breakpad_info_)) {
+  if (expected_size != sizeof(MDRawBreakpadInfo) &&
+      expected_size != sizeof(MDRawBreakpadInfo2)) {
     BPLOG(ERROR) << "MinidumpBreakpadInfo size mismatch, " << expected_size <<
-                    " != " << sizeof(breakpad_info_);
+                    " != " << sizeof(MDRawBreakpadInfo) << " or " <<
+                    sizeof(MDRawBreakpadInfo2);
     return false;
   }
 
@@ -4798,10 +4824,33 @@ bool MinidumpBreakpadInfo::Read(uint32_t expected_size) {
     return false;
   }
 
+  pause_duration_us_ = 0;
+  crash_arena_high_water_ = 0;
+  crash_arena_overflow_bytes_ = 0;
+  if (expected_size == sizeof(MDRawBreakpadInfo2) &&
+      (!minidump_->ReadBytes(&pause_duration_us_,
+                             sizeof(pause_duration_us_)) ||
+       !minidump_->ReadBytes(&crash_arena_high_water_,
+                             sizeof(crash_arena_high_water_)) ||
+       !minidump_->ReadBytes(&crash_arena_overflow_bytes_,
+                             sizeof(crash_arena_overflow_bytes_)))) {
+    BPLOG(ERROR) << "MinidumpBreakpadInfo cannot read Breakpad info 2";
+    return false;
+  }
+
   if (minidump_->swap()) {
     Swap(&breakpad_info_.validity);
     Swap(&breakpad_info_.dump_thread_id);
     Swap(&breakpad_info_.requesting_thread_id);
+    Swap(&pause_duration_us_);
+    Swap(&crash_arena_high_water_);
+    Swap(&crash_arena_overflow_bytes_);
+  }
+
+  // The short form has no room for the fields only the long form has.
+  if (expected_size == sizeof(MDRawBreakpadInfo)) {
+    breakpad_info_.validity &= ~(MD_BREAKPAD_INFO_VALID_PAUSE_DURATION |
+                                 MD_BREAKPAD_INFO_VALID_CRASH_ARENA);
   }
 
   valid_ = true;
@@ -4853,6 +4902,56 @@ bool MinidumpBreakpadInfo::GetRequestingThreadID(uint32_t* thread_id)
 }
 
 
+bool MinidumpBreakpadInfo::GetPauseDuration(uint32_t* pause_duration_us)
+    const {
+  BPLOG_IF(ERROR, !pause_duration_us) << "MinidumpBreakpadInfo::"
+                                         "GetPauseDuration requires "
+                                         "|pause_duration_us|";
+  assert(pause_duration_us);
+  *pause_duration_us = 0;
+
+  if (!valid_) {
+    BPLOG(ERROR) << "Invalid MinidumpBreakpadInfo for GetPauseDuration";
+    return false;
+  }
+
+  if (!(breakpad_info_.validity & MD_BREAKPAD_INFO_VALID_PAUSE_DURATION)) {
+    BPLOG(INFO) << "MinidumpBreakpadInfo has no pause duration";
+    return false;
+  }
+
+  *pause_duration_us = pause_duration_us_;
+  return true;
+}
+
+
+bool MinidumpBreakpadInfo::GetCrashArenaUsage(uint32_t* high_water,
+                                              uint32_t* overflow_bytes) const {
+  BPLOG_IF(ERROR, !high_water || !overflow_bytes) << "MinidumpBreakpadInfo::"
+                                                     "GetCrashArenaUsage "
+                                                     "requires |high_water| "
+                                                     "and |overflow_bytes|";
+  assert(high_water);
+  assert(overflow_bytes);
+  *high_water = 0;
+  *overflow_bytes = 0;
+
+  if (!valid_) {
+    BPLOG(ERROR) << "Invalid MinidumpBreakpadInfo for GetCrashArenaUsage";
+    return false;
+  }
+
+  if (!(breakpad_info_.validity & MD_BREAKPAD_INFO_VALID_CRASH_ARENA)) {
+    BPLOG(INFO) << "MinidumpBreakpadInfo has no crash arena usage";
+    return false;
+  }
+
+  *high_water = crash_arena_high_water_;
+  *overflow_bytes = crash_arena_overflow_bytes_;
+  return true;
+}
+
+
 void MinidumpBreakpadInfo::Print() {
   if (!valid_) {
     BPLOG(ERROR) << "MinidumpBreakpadInfo cannot print invalid data";
@@ -4870,6 +4969,16 @@ void MinidumpBreakpadInfo::Print() {
                           MD_BREAKPAD_INFO_VALID_REQUESTING_THREAD_ID,
                       kNumberFormatHexadecimal,
                       breakpad_info_.requesting_thread_id);
+  // Only the long form's fields that are set are shown, so that the short
+  // form prints as it always has.
+  if (breakpad_info_.validity & MD_BREAKPAD_INFO_VALID_PAUSE_DURATION) {
+    printf("  pause_duration_us    = %u\n", pause_duration_us_);
+  }
+  if (breakpad_info_.validity & MD_BREAKPAD_INFO_VALID_CRASH_ARENA) {
+    printf("  crash_arena_high_water     = %u\n", crash_arena_high_water_);
+    printf("  crash_arena_overflow_bytes = %u\n",
+           crash_arena_overflow_bytes_);
+  }
 
   printf("\n");
 }
@@ -5547,6 +5656,7 @@ void MinidumpCrashpadInfo::Print() {
 
 uint32_t Minidump::max_streams_ = 128;
 unsigned int Minidump::max_string_length_ = 1024;
+uint32_t Minidump::max_decompressed_size_ = 1024 * 1024 * 1024;
 
 
 Minidump::Minidump(const string& path, bool hexdump, unsigned int hexdump_width)
@@ -5555,6 +5665,10 @@ Minidump::Minidump(const string& path, bool hexdump, unsigned int hexdump_width)
       stream_map_(new MinidumpStreamMap()),
       path_(path),
       stream_(NULL),
+      use_mmap_(false),
+      mapped_data_(nullptr),
+      mapped_size_(0),
+      mapped_position_(0),
       swap_(false),
       is_big_endian_(false),
       valid_(false),
@@ -5568,6 +5682,10 @@ Minidump::Minidump(istream& stream)
       stream_map_(new MinidumpStreamMap()),
       path_(),
       stream_(&stream),
+      use_mmap_(false),
+      mapped_data_(nullptr),
+      mapped_size_(0),
+      mapped_position_(0),
       swap_(false),
       is_big_endian_(false),
       valid_(false),
@@ -5576,19 +5694,24 @@ Minidump::Minidump(istream& stream)
 }
 
 Minidump::~Minidump() {
-  if (stream_) {
+  if (stream_ || mapped_data_) {
     BPLOG(INFO) << "Minidump closing minidump";
   }
   if (!path_.empty()) {
     delete stream_;
   }
+#ifndef _WIN32
+  if (mapped_data_ && decompressed_.empty()) {
+    munmap(const_cast<uint8_t*>(mapped_data_), mapped_size_);
+  }
+#endif  // !_WIN32
   delete directory_;
   delete stream_map_;
 }
 
 
 bool Minidump::Open() {
-  if (stream_ != NULL) {
+  if (stream_ != NULL || mapped_data_ != NULL) {
     BPLOG(INFO) << "Minidump reopening minidump " << path_;
 
     // The file is already open.  Seek to the beginning, which is the position
@@ -5596,6 +5719,15 @@ bool Minidump::Open() {
     return SeekSet(0);
   }
 
+  if (use_mmap_) {
+    if (Map()) {
+      BPLOG(INFO) << "Minidump mapped minidump " << path_;
+      return true;
+    }
+    BPLOG(INFO) << "Minidump could not map minidump " << path_ <<
+                   ", reading it instead";
+  }
+
   stream_ = new ifstream(path_.c_str(), std::ios::in | std::ios::binary);
   if (!stream_ || !stream_->good()) {
     string error_string;
@@ -5609,6 +5741,75 @@ bool Minidump::Open() {
   return true;
 }
 
+bool Minidump::Map() {
+#ifndef _WIN32
+  int fd = open(path_.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return false;
+  }
+
+  // Empty files can't be mapped; they fail as usual when read instead.
+  struct stat st;
+  void* data = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+
+  mapped_data_ = static_cast<const uint8_t*>(data);
+  mapped_size_ = st.st_size;
+  mapped_position_ = 0;
+  return true;
+#else  // !_WIN32
+  return false;
+#endif  // !_WIN32
+}
+
+bool Minidump::Decompress() {
+  // The container is decompressed as a whole, so it is read into memory if
+  // it isn't already mapped.
+  vector<uint8_t> container;
+  const uint8_t* data = mapped_data_;
+  size_t size = mapped_size_;
+  if (!data) {
+    if (!SeekSet(0)) {
+      return false;
+    }
+    char buffer[65536];
+    do {
+      stream_->read(buffer, sizeof(buffer));
+      container.insert(container.end(), buffer, buffer + stream_->gcount());
+    } while (stream_->good());
+    stream_->clear();
+    if (container.empty()) {
+      return false;
+    }
+    data = &container[0];
+    size = container.size();
+  }
+
+  vector<uint8_t> minidump;
+  if (!DecompressMinidump(data, size, max_decompressed_size_, &minidump)) {
+    BPLOG(ERROR) << "Compressed minidump is malformed or larger than " <<
+                    max_decompressed_size_ << " bytes";
+    return false;
+  }
+
+#ifndef _WIN32
+  if (mapped_data_ && decompressed_.empty()) {
+    munmap(const_cast<uint8_t*>(mapped_data_), mapped_size_);
+  }
+#endif  // !_WIN32
+  decompressed_.swap(minidump);
+  mapped_data_ = &decompressed_[0];
+  mapped_size_ = decompressed_.size();
+  mapped_position_ = 0;
+  return true;
+}
+
 bool Minidump::GetContextCPUFlagsFromSystemInfo(uint32_t* context_cpu_flags) {
   // Initialize output parameters
   *context_cpu_flags = 0;
@@ -5712,6 +5913,20 @@ bool Minidump::Read() {
     return false;
   }
 
+  if (IsCompressedMinidump(header_.signature)) {
+    // From here on, the minidump is read from the decompressed copy.
+    if (!Decompress()) {
+      BPLOG(ERROR) << "Minidump cannot decompress minidump";
+      return false;
+    }
+    BPLOG(INFO) << "Minidump decompressed minidump, " << mapped_size_ <<
+                   " bytes";
+    if (!ReadBytes(&header_, sizeof(MDRawHeader))) {
+      BPLOG(ERROR) << "Minidump cannot read decompressed header";
+      return false;
+    }
+  }
+
   if (header_.signature != MD_HEADER_SIGNATURE) {
     // The file may be byte-swapped.  Under the present architecture, these
     // classes don't know or need to know what CPU (or endianness) the
@@ -6079,6 +6294,17 @@ const MDRawDirectory* Minidump::GetDirectoryEntryAtIndex(unsigned int index)
 bool Minidump::ReadBytes(void* bytes, size_t count) {
   // Can't check valid_ because Read needs to call this method before
   // validity can be determined.
+  if (mapped_data_) {
+    const uint8_t* mapped_bytes = GetMappedBytes(mapped_position_, count);
+    if (!mapped_bytes) {
+      BPLOG(ERROR) << "ReadBytes: read beyond end of minidump, " << count <<
+                      " bytes at " << mapped_position_ << "/" << mapped_size_;
+      return false;
+    }
+    memcpy(bytes, mapped_bytes, count);
+    mapped_position_ += count;
+    return true;
+  }
   if (!stream_) {
     return false;
   }
@@ -6111,6 +6337,16 @@ bool Minidump::ReadBytes(void* bytes, size_t count) {
 bool Minidump::SeekSet(off_t offset) {
   // Can't check valid_ because Read needs to call this method before
   // validity can be determined.
+  if (mapped_data_) {
+    // As with an ifstream, seeking past the end succeeds, and the next read
+    // fails.
+    if (offset < 0) {
+      BPLOG(ERROR) << "SeekSet: invalid offset " << offset;
+      return false;
+    }
+    mapped_position_ = offset;
+    return true;
+  }
   if (!stream_) {
     return false;
   }
@@ -6125,10 +6361,14 @@ bool Minidump::SeekSet(off_t offset) {
 }
 
 off_t Minidump::Tell() {
-  if (!valid_ || !stream_) {
+  if (!valid_ || (!stream_ && !mapped_data_)) {
     return (off_t)-1;
   }
 
+  if (mapped_data_) {
+    return mapped_position_;
+  }
+
   // Check for conversion data loss
   std::streamoff std_streamoff = stream_->tellg();
   off_t rv = static_cast<off_t>(std_streamoff);
@@ -6141,6 +6381,16 @@ off_t Minidump::Tell() {
 }
 
 
+const uint8_t* Minidump::GetMappedBytes(off_t offset, size_t count) const {
+  if (!mapped_data_ || offset < 0 ||
+      static_cast<uint64_t>(offset) > mapped_size_ ||
+      count > mapped_size_ - static_cast<size_t>(offset)) {
+    return NULL;
+  }
+  return mapped_data_ + offset;
+}
+
+
 string* Minidump::ReadString(off_t offset) {
   if (!valid_) {
     BPLOG(ERROR) << "Invalid Minidump for ReadString";
@@ -35,10 +35,14 @@
 #include <assert.h>
 
 #include <algorithm>
+#include <atomic>
 #include <limits>
 #include <map>
+#include <memory>
 #include <string>
+#include <thread>
 #include <utility>
+#include <vector>
 
 #include "common/scoped_ptr.h"
 #include "common/stdio_wrapper.h"
@@ -58,13 +62,89 @@
 
 namespace google_breakpad {
 
+namespace {
+
+// Everything needed to walk the stack of one thread, and the result of
+// walking it.
+struct ThreadWalk {
+  string thread_string;
+  uint32_t thread_id;
+  string thread_name;
+  MinidumpContext* context;
+  MinidumpMemoryRegion* memory;
+  std::unique_ptr<CallStack> stack;
+  bool interrupted;
+  // Only used when walking in parallel; serial walks record these directly
+  // in the ProcessState.
+  vector<const CodeModule*> modules_without_symbols;
+  vector<const CodeModule*> modules_with_corrupt_symbols;
+};
+
+// Walks the stack described by |walk|, allocating its frames from
+// |frame_arena| and recording modules that lack symbols or have corrupt
+// symbols in the given vectors.
+void WalkThreadStack(const ProcessState& process_state,
+                     FrameArena* frame_arena,
+                     StackFrameSymbolizer* frame_symbolizer,
+                     ThreadWalk* walk,
+                     vector<const CodeModule*>* modules_without_symbols,
+                     vector<const CodeModule*>* modules_with_corrupt_symbols) {
+  // Use process_state.modules_ instead of module_list, because the
+  // |modules| argument will be used to populate the |module| fields in
+  // the returned StackFrame objects, which will be placed into the
+  // returned ProcessState object.  module_list's lifetime is only as
+  // long as the Minidump object: it will be deleted when this function
+  // returns.  process_state.modules_ is owned by the ProcessState object
+  // (just like the StackFrame objects), and is much more suitable for this
+  // task.
+  scoped_ptr<Stackwalker> stackwalker(
+      Stackwalker::StackwalkerForCPU(process_state.system_info(),
+                                     walk->context,
+                                     walk->memory,
+                                     process_state.modules(),
+                                     process_state.unloaded_modules(),
+                                     frame_symbolizer));
+
+  walk->stack.reset(new CallStack());
+  walk->interrupted = false;
+  if (stackwalker.get()) {
+    stackwalker->set_frame_arena(frame_arena);
+    if (!stackwalker->Walk(walk->stack.get(),
+                           modules_without_symbols,
+                           modules_with_corrupt_symbols)) {
+      BPLOG(INFO) << "Stackwalker interrupt (missing symbols?) at "
+                  << walk->thread_string;
+      walk->interrupted = true;
+    }
+  } else {
+    // Threads with missing CPU contexts will hit this, but
+    // don't abort processing the rest of the dump just for
+    // one bad thread.
+    BPLOG(ERROR) << "No stackwalker for " << walk->thread_string;
+  }
+  walk->stack->set_tid(walk->thread_id);
+}
+
+// Appends the modules in |from| that are not already in |to| to |to|.
+void MergeModules(const vector<const CodeModule*>& from,
+                  vector<const CodeModule*>* to) {
+  for (const CodeModule* module : from) {
+    if (std::find(to->begin(), to->end(), module) == to->end())
+      to->push_back(module);
+  }
+}
+
+}  // namespace
+
 MinidumpProcessor::MinidumpProcessor(SymbolSupplier* supplier,
                                      SourceLineResolverInterface* resolver)
     : frame_symbolizer_(new StackFrameSymbolizer(supplier, resolver)),
       own_frame_symbolizer_(true),
       enable_exploitability_(false),
       enable_objdump_(false),
-      enable_objdump_for_exploitability_(false) {
+      enable_objdump_for_exploitability_(false),
+      stackwalk_thread_count_(1),
+      use_mmap_(false) {
 }
 
 MinidumpProcessor::MinidumpProcessor(SymbolSupplier* supplier,
@@ -74,7 +154,9 @@ MinidumpProcessor::MinidumpProcessor(SymbolSupplier* supplier,
       own_frame_symbolizer_(true),
       enable_exploitability_(enable_exploitability),
       enable_objdump_(false),
-      enable_objdump_for_exploitability_(false) {
+      enable_objdump_for_exploitability_(false),
+      stackwalk_thread_count_(1),
+      use_mmap_(false) {
 }
 
 MinidumpProcessor::MinidumpProcessor(StackFrameSymbolizer* frame_symbolizer,
@@ -83,7 +165,9 @@ MinidumpProcessor::MinidumpProcessor(StackFrameSymbolizer* frame_symbolizer,
       own_frame_symbolizer_(false),
       enable_exploitability_(enable_exploitability),
       enable_objdump_(false),
-      enable_objdump_for_exploitability_(false) {
+      enable_objdump_for_exploitability_(false),
+      stackwalk_thread_count_(1),
+      use_mmap_(false) {
   assert(frame_symbolizer_);
 }
 
@@ -234,6 +318,10 @@ ProcessResult MinidumpProcessor::Process(
     }
   }
 
+  // Gather what is needed to walk each thread, in minidump order, before
+  // walking any of them.
+  vector<ThreadWalk> walks;
+  walks.reserve(thread_count);
   for (unsigned int thread_index = 0;
        thread_index < thread_count;
        ++thread_index) {
@@ -282,14 +370,14 @@ ProcessResult MinidumpProcessor::Process(
         return PROCESS_ERROR_DUPLICATE_REQUESTING_THREADS;
       }
 
-      // Use processed_state->threads_.size() instead of thread_index.
+      // Use walks.size() instead of thread_index.
       // thread_index points to the thread index in the minidump, which
       // might be greater than the thread index in the threads vector if
       // any of the minidump's threads are skipped and not placed into the
-      // processed threads vector.  The thread vector's current size will
+      // processed threads vector.  The number of walks so far will
       // be the index of the current thread when it's pushed into the
       // vector.
-      process_state->requesting_thread_ = process_state->threads_.size();
+      process_state->requesting_thread_ = walks.size();
 
       found_requesting_thread = true;
 
@@ -320,41 +408,66 @@ ProcessResult MinidumpProcessor::Process(
       BPLOG(ERROR) << "No memory region for " << thread_string;
     }
 
-    // Use process_state->modules_ instead of module_list, because the
-    // |modules| argument will be used to populate the |module| fields in
-    // the returned StackFrame objects, which will be placed into the
-    // returned ProcessState object.  module_list's lifetime is only as
-    // long as the Minidump object: it will be deleted when this function
-    // returns.  process_state->modules_ is owned by the ProcessState object
-    // (just like the StackFrame objects), and is much more suitable for this
-    // task.
-    scoped_ptr<Stackwalker> stackwalker(
-        Stackwalker::StackwalkerForCPU(process_state->system_info(),
-                                       context,
-                                       thread_memory,
-                                       process_state->modules_,
-                                       process_state->unloaded_modules_,
-                                       frame_symbolizer_));
-
-    scoped_ptr<CallStack> stack(new CallStack());
-    if (stackwalker.get()) {
-      if (!stackwalker->Walk(stack.get(),
-                             &process_state->modules_without_symbols_,
-                             &process_state->modules_with_corrupt_symbols_)) {
-        BPLOG(INFO) << "Stackwalker interrupt (missing symbols?) at "
-                    << thread_string;
-        interrupted = true;
+    walks.push_back(ThreadWalk());
+    ThreadWalk& walk = walks.back();
+    walk.thread_string = thread_string;
+    walk.thread_id = thread_id;
+    walk.thread_name = thread_name;
+    walk.context = context;
+    walk.memory = thread_memory;
+    walk.interrupted = false;
+  }
+
+  unsigned int walker_count = stackwalk_thread_count_ > 0 ?
+      stackwalk_thread_count_ : std::thread::hardware_concurrency();
+  walker_count = std::min<size_t>(std::max(walker_count, 1U), walks.size());
+  if (walker_count <= 1) {
+    for (ThreadWalk& walk : walks) {
+      WalkThreadStack(*process_state, process_state->frame_arena_,
+                      frame_symbolizer_, &walk,
+                      &process_state->modules_without_symbols_,
+                      &process_state->modules_with_corrupt_symbols_);
+    }
+  } else {
+    // Stack memory is read lazily from the minidump file, which cannot be
+    // shared between threads, so load it all up front.  For a mapped
+    // minidump this only checks the regions' bounds.
+    for (ThreadWalk& walk : walks) {
+      if (walk.memory)
+        walk.memory->GetMemory();
+    }
+
+    std::atomic<size_t> next_walk(0);
+    auto walk_threads = [&]() {
+      for (size_t i = next_walk++; i < walks.size(); i = next_walk++) {
+        WalkThreadStack(*process_state, process_state->frame_arena_,
+                        frame_symbolizer_, &walks[i],
+                        &walks[i].modules_without_symbols,
+                        &walks[i].modules_with_corrupt_symbols);
       }
-    } else {
-      // Threads with missing CPU contexts will hit this, but
-      // don't abort processing the rest of the dump just for
-      // one bad thread.
-      BPLOG(ERROR) << "No stackwalker for " << thread_string;
+    };
+    vector<std::thread> walkers;
+    for (unsigned int i = 1; i < walker_count; ++i)
+      walkers.push_back(std::thread(walk_threads));
+    walk_threads();
+    for (std::thread& walker : walkers)
+      walker.join();
+
+    // Merge the per-thread results in minidump order, so that the modules
+    // are listed exactly as a serial walk would have listed them.
+    for (const ThreadWalk& walk : walks) {
+      MergeModules(walk.modules_without_symbols,
+                   &process_state->modules_without_symbols_);
+      MergeModules(walk.modules_with_corrupt_symbols,
+                   &process_state->modules_with_corrupt_symbols_);
     }
-    stack->set_tid(thread_id);
-    process_state->threads_.push_back(stack.release());
-    process_state->thread_memory_regions_.push_back(thread_memory);
-    process_state->thread_names_.push_back(thread_name);
+  }
+
+  for (ThreadWalk& walk : walks) {
+    interrupted |= walk.interrupted;
+    process_state->threads_.push_back(walk.stack.release());
+    process_state->thread_memory_regions_.push_back(walk.memory);
+    process_state->thread_names_.push_back(walk.thread_name);
   }
 
   if (interrupted) {
@@ -397,6 +510,7 @@ ProcessResult MinidumpProcessor::Process(
   BPLOG(INFO) << "Processing minidump in file " << minidump_file;
 
   Minidump dump(minidump_file);
+  dump.set_use_mmap(use_mmap_);
   if (!dump.Read()) {
      BPLOG(ERROR) << "Minidump " << dump.path() << " could not be read";
      return PROCESS_ERROR_MINIDUMP_NOT_FOUND;
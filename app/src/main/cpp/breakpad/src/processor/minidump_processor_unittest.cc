@@ -40,6 +40,7 @@
 #include <fstream>
 #include <map>
 #include <utility>
+#include <vector>
 
 #include "breakpad_googletest_includes.h"
 #include "common/scoped_ptr.h"
@@ -54,9 +55,11 @@
 #include "google_breakpad/processor/stack_frame.h"
 #include "google_breakpad/processor/symbol_supplier.h"
 #include "processor/logging.h"
+#include "processor/simple_symbol_supplier.h"
 #include "processor/stackwalker_unittest_utils.h"
 
 using std::map;
+using std::vector;
 
 namespace google_breakpad {
 class MockMinidump : public Minidump {
@@ -142,6 +145,9 @@ class MockMinidumpMemoryRegion : public MinidumpMemoryRegion {
   bool GetMemoryAtAddress(uint64_t address, uint64_t* value) const {
     return region_.GetMemoryAtAddress(address, value);
   }
+  const uint8_t* GetContiguousMemory() const {
+    return region_.GetContiguousMemory();
+  }
 
   MockMemoryRegion region_;
 };
@@ -180,6 +186,8 @@ using google_breakpad::MockMinidumpUnloadedModule;
 using google_breakpad::MockMinidumpUnloadedModuleList;
 using google_breakpad::ProcessState;
 using google_breakpad::scoped_ptr;
+using google_breakpad::SimpleSymbolSupplier;
+using google_breakpad::StackFrame;
 using google_breakpad::SymbolSupplier;
 using google_breakpad::SystemInfo;
 using ::testing::_;
@@ -826,6 +834,74 @@ TEST_F(MinidumpProcessorTest, TestFastFailException) {
   ASSERT_EQ(state.crash_reason(), "FAST_FAIL_FATAL_APP_EXIT");
 }
 
+// Processes |minidump_file| walking stacks on |thread_count| threads.
+static void ProcessWithThreads(const string& minidump_file, int thread_count,
+                               ProcessState* state) {
+  SimpleSymbolSupplier supplier(GetTestDataPath() + "symbols");
+  BasicSourceLineResolver resolver;
+  MinidumpProcessor processor(&supplier, &resolver);
+  processor.set_stackwalk_thread_count(thread_count);
+  ASSERT_EQ(processor.Process(minidump_file, state),
+            google_breakpad::PROCESS_OK);
+}
+
+static void ExpectSameModules(const vector<const CodeModule*>& expected,
+                              const vector<const CodeModule*>& actual) {
+  ASSERT_EQ(expected.size(), actual.size());
+  for (size_t i = 0; i < expected.size(); ++i)
+    EXPECT_EQ(expected[i]->code_file(), actual[i]->code_file());
+}
+
+TEST_F(MinidumpProcessorTest, TestParallelStackwalkMatchesSerial) {
+  const char* const kMinidumps[] = {
+    "minidump2.dmp",
+    "tiny-exe-fastfail.dmp",
+    "linux_inline.dmp",
+  };
+  for (const char* minidump : kMinidumps) {
+    SCOPED_TRACE(minidump);
+    string minidump_file = GetTestDataPath() + minidump;
+
+    ProcessState serial;
+    ProcessWithThreads(minidump_file, 1, &serial);
+    for (int thread_count : {0, 2, 8}) {
+      SCOPED_TRACE(thread_count);
+      ProcessState parallel;
+      ProcessWithThreads(minidump_file, thread_count, &parallel);
+
+      EXPECT_EQ(serial.requesting_thread(), parallel.requesting_thread());
+      ASSERT_EQ(serial.threads()->size(), parallel.threads()->size());
+      for (size_t t = 0; t < serial.threads()->size(); ++t) {
+        const CallStack* expected = serial.threads()->at(t);
+        const CallStack* actual = parallel.threads()->at(t);
+        EXPECT_EQ(expected->tid(), actual->tid());
+        EXPECT_EQ(serial.thread_names()->at(t), parallel.thread_names()->at(t));
+        ASSERT_EQ(expected->frames()->size(), actual->frames()->size());
+        for (size_t f = 0; f < expected->frames()->size(); ++f) {
+          const StackFrame* expected_frame = expected->frames()->at(f);
+          const StackFrame* actual_frame = actual->frames()->at(f);
+          EXPECT_EQ(expected_frame->instruction, actual_frame->instruction);
+          EXPECT_EQ(expected_frame->trust, actual_frame->trust);
+          EXPECT_EQ(expected_frame->function_name,
+                    actual_frame->function_name);
+          EXPECT_EQ(expected_frame->source_file_name,
+                    actual_frame->source_file_name);
+          EXPECT_EQ(expected_frame->source_line, actual_frame->source_line);
+          ASSERT_EQ(!expected_frame->module, !actual_frame->module);
+          if (expected_frame->module) {
+            EXPECT_EQ(expected_frame->module->code_file(),
+                      actual_frame->module->code_file());
+          }
+        }
+      }
+      ExpectSameModules(*serial.modules_without_symbols(),
+                        *parallel.modules_without_symbols());
+      ExpectSameModules(*serial.modules_with_corrupt_symbols(),
+                        *parallel.modules_with_corrupt_symbols());
+    }
+  }
+}
+
 #ifdef __linux__
 TEST_F(MinidumpProcessorTest, TestNonCanonicalAddress) {
   // This tests if we can correctly fixup non-canonical address GPF fault
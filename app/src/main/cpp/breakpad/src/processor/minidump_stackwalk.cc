@@ -36,6 +36,7 @@
 #endif
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
@@ -51,6 +52,7 @@
 #include "google_breakpad/processor/minidump_processor.h"
 #include "google_breakpad/processor/process_state.h"
 #include "processor/logging.h"
+#include "processor/process_state_serializer.h"
 #include "processor/simple_symbol_supplier.h"
 #include "processor/stackwalk_common.h"
 
@@ -59,9 +61,13 @@ namespace {
 
 struct Options {
   bool machine_readable;
+  bool json;
+  bool proto;
   bool output_stack_contents;
   bool output_requesting_thread_only;
   bool brief;
+  int stackwalk_threads;
+  bool use_mmap;
 
   string minidump_file;
   std::vector<string> symbol_paths;
@@ -73,6 +79,7 @@ using google_breakpad::MinidumpMemoryList;
 using google_breakpad::MinidumpThreadList;
 using google_breakpad::MinidumpProcessor;
 using google_breakpad::ProcessState;
+using google_breakpad::ProcessStateSerializer;
 using google_breakpad::SimpleSymbolSupplier;
 using google_breakpad::scoped_ptr;
 
@@ -96,12 +103,14 @@ bool PrintMinidumpProcess(const Options& options) {
 
   BasicSourceLineResolver resolver;
   MinidumpProcessor minidump_processor(symbol_supplier.get(), &resolver);
+  minidump_processor.set_stackwalk_thread_count(options.stackwalk_threads);
 
   // Increase the maximum number of threads and regions.
   MinidumpThreadList::set_max_threads(std::numeric_limits<uint32_t>::max());
   MinidumpMemoryList::set_max_regions(std::numeric_limits<uint32_t>::max());
   // Process the minidump.
   Minidump dump(options.minidump_file);
+  dump.set_use_mmap(options.use_mmap);
   if (!dump.Read()) {
      BPLOG(ERROR) << "Minidump " << dump.path() << " could not be read";
      return false;
@@ -113,7 +122,13 @@ bool PrintMinidumpProcess(const Options& options) {
     return false;
   }
 
-  if (options.machine_readable) {
+  if (options.proto) {
+    string serialized;
+    ProcessStateSerializer::Serialize(process_state, &serialized);
+    fwrite(serialized.data(), 1, serialized.size(), stdout);
+  } else if (options.json) {
+    PrintProcessStateJSON(process_state);
+  } else if (options.machine_readable) {
     PrintProcessStateMachineReadable(process_state);
   } else if (options.brief) {
     PrintRequestingThreadBrief(process_state);
@@ -136,9 +151,15 @@ static void Usage(int argc, const char *argv[], bool error) {
           "Options:\n"
           "\n"
           "  -m         Output in machine-readable format\n"
+          "  -J         Output in JSON format, one object per line (see\n"
+          "             processor/stackwalk_json_schema.json)\n"
+          "  -P         Output a serialized ProcessStateProto (see\n"
+          "             processor/proto/process_state.proto)\n"
           "  -s         Output stack contents\n"
           "  -c         Output thread that causes crash or dump only\n"
-          "  -b         Brief of the thread that causes crash or dump\n",
+          "  -b         Brief of the thread that causes crash or dump\n"
+          "  -j <N>     Walk stacks on N threads (0 = one per core)\n"
+          "  -M         Map the minidump into memory instead of reading it\n",
           google_breakpad::BaseName(argv[0]).c_str());
 }
 
@@ -146,11 +167,15 @@ static void SetupOptions(int argc, const char *argv[], Options* options) {
   int ch;
 
   options->machine_readable = false;
+  options->json = false;
+  options->proto = false;
   options->output_stack_contents = false;
   options->output_requesting_thread_only = false;
   options->brief = false;
+  options->stackwalk_threads = 1;
+  options->use_mmap = false;
 
-  while ((ch = getopt(argc, (char* const*)argv, "bchms")) != -1) {
+  while ((ch = getopt(argc, (char* const*)argv, "bchJj:MmPs")) != -1) {
     switch (ch) {
       case 'h':
         Usage(argc, argv, false);
@@ -163,9 +188,21 @@ static void SetupOptions(int argc, const char *argv[], Options* options) {
       case 'c':
         options->output_requesting_thread_only = true;
         break;
+      case 'J':
+        options->json = true;
+        break;
+      case 'j':
+        options->stackwalk_threads = atoi(optarg);
+        break;
+      case 'M':
+        options->use_mmap = true;
+        break;
       case 'm':
         options->machine_readable = true;
         break;
+      case 'P':
+        options->proto = true;
+        break;
       case 's':
         options->output_stack_contents = true;
         break;
@@ -33,14 +33,20 @@
 #include <config.h>  // Must come first
 #endif
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <string>
 #include <vector>
 
 #include "breakpad_googletest_includes.h"
+#include "common/minidump_compression.h"
+#include "common/scoped_ptr.h"
+#include "common/tests/auto_tempdir.h"
 #include "common/using_std_string.h"
 #include "google_breakpad/common/minidump_format.h"
 #include "google_breakpad/processor/minidump.h"
@@ -49,7 +55,11 @@
 
 namespace {
 
+using google_breakpad::AutoTempDir;
+using google_breakpad::CompressedMinidumpHeader;
+using google_breakpad::CompressedMinidumpRecord;
 using google_breakpad::Minidump;
+using google_breakpad::MinidumpBreakpadInfo;
 using google_breakpad::MinidumpContext;
 using google_breakpad::MinidumpCrashpadInfo;
 using google_breakpad::MinidumpException;
@@ -75,6 +85,7 @@ using google_breakpad::SynthMinidump::Stream;
 using google_breakpad::SynthMinidump::String;
 using google_breakpad::SynthMinidump::SystemInfo;
 using google_breakpad::SynthMinidump::Thread;
+using google_breakpad::scoped_ptr;
 using google_breakpad::test_assembler::kBigEndian;
 using google_breakpad::test_assembler::kLittleEndian;
 using std::ifstream;
@@ -135,6 +146,167 @@ TEST_F(MinidumpTest, TestMinidumpFromStream) {
   //TODO: add more checks here
 }
 
+TEST_F(MinidumpTest, TestMinidumpMapped) {
+  Minidump read_minidump(minidump_file_);
+  ASSERT_TRUE(read_minidump.Read());
+  ASSERT_FALSE(read_minidump.is_mapped());
+
+  Minidump minidump(minidump_file_);
+  minidump.set_use_mmap(true);
+  ASSERT_TRUE(minidump.Read());
+  ASSERT_TRUE(minidump.is_mapped());
+  ASSERT_EQ(read_minidump.GetDirectoryEntryCount(),
+            minidump.GetDirectoryEntryCount());
+
+  MinidumpModuleList* md_module_list = minidump.GetModuleList();
+  ASSERT_TRUE(md_module_list != NULL);
+  const MinidumpModule* md_module = md_module_list->GetModuleAtIndex(0);
+  ASSERT_TRUE(md_module != NULL);
+  ASSERT_EQ("c:\\test_app.exe", md_module->code_file());
+  ASSERT_EQ("5A9832E5287241C1838ED98914E9B7FF1", md_module->debug_identifier());
+
+  // Stack memory must match what is read from the file, and be used in
+  // place.
+  MinidumpThreadList* read_thread_list = read_minidump.GetThreadList();
+  MinidumpThreadList* thread_list = minidump.GetThreadList();
+  ASSERT_TRUE(read_thread_list != NULL);
+  ASSERT_TRUE(thread_list != NULL);
+  ASSERT_EQ(read_thread_list->thread_count(), thread_list->thread_count());
+  ASSERT_GT(thread_list->thread_count(), 0U);
+  for (unsigned int i = 0; i < thread_list->thread_count(); ++i) {
+    MinidumpThread* thread = thread_list->GetThreadAtIndex(i);
+    MinidumpMemoryRegion* read_stack =
+        read_thread_list->GetThreadAtIndex(i)->GetMemory();
+    MinidumpMemoryRegion* stack = thread->GetMemory();
+    ASSERT_TRUE(read_stack != NULL);
+    ASSERT_TRUE(stack != NULL);
+    ASSERT_EQ(read_stack->GetBase(), stack->GetBase());
+    ASSERT_EQ(read_stack->GetSize(), stack->GetSize());
+    ASSERT_EQ(0, memcmp(read_stack->GetMemory(), stack->GetMemory(),
+                        stack->GetSize()));
+    const MDLocationDescriptor& location = thread->thread()->stack.memory;
+    EXPECT_EQ(minidump.GetMappedBytes(location.rva, location.data_size),
+              stack->GetMemory());
+  }
+
+  // Reading past the end of the mapping fails.
+  uint8_t byte;
+  EXPECT_TRUE(minidump.GetMappedBytes(0, 1) != NULL);
+  EXPECT_TRUE(minidump.GetMappedBytes(0, 1 << 30) == NULL);
+  EXPECT_TRUE(minidump.GetMappedBytes(1 << 30, 1) == NULL);
+  EXPECT_TRUE(minidump.SeekSet(1 << 30));
+  EXPECT_FALSE(minidump.ReadBytes(&byte, 1));
+}
+
+// Returns a compressed container holding |minidump|, with its blocks
+// written last to first to check that record order doesn't matter.
+static string CompressMinidump(const string& minidump) {
+  const size_t kBlockSize = 4096;
+  vector<uint16_t> table(google_breakpad::kCompressBlockTableSize);
+  vector<uint8_t> payload(google_breakpad::CompressBlockBound(kBlockSize));
+  CompressedMinidumpHeader header = {
+    google_breakpad::kCompressedMinidumpSignature,
+    google_breakpad::kCompressedMinidumpVersion
+  };
+  string container(reinterpret_cast<const char*>(&header), sizeof(header));
+  for (size_t offset = (minidump.size() - 1) / kBlockSize * kBlockSize;;
+       offset -= kBlockSize) {
+    CompressedMinidumpRecord record;
+    record.rva = static_cast<uint32_t>(offset);
+    record.data_size = static_cast<uint32_t>(
+        std::min(kBlockSize, minidump.size() - offset));
+    record.payload_size = static_cast<uint32_t>(google_breakpad::CompressBlock(
+        reinterpret_cast<const uint8_t*>(minidump.data()) + offset,
+        record.data_size, &payload[0], &table[0]));
+    record.encoding = google_breakpad::kCompressedMinidumpLZ4;
+    container.append(reinterpret_cast<const char*>(&record), sizeof(record));
+    container.append(reinterpret_cast<const char*>(&payload[0]),
+                     record.payload_size);
+    if (offset == 0)
+      break;
+  }
+  CompressedMinidumpRecord final_record = {
+    static_cast<uint32_t>(minidump.size()), 0, 0,
+    google_breakpad::kCompressedMinidumpStored
+  };
+  container.append(reinterpret_cast<const char*>(&final_record),
+                   sizeof(final_record));
+  return container;
+}
+
+TEST_F(MinidumpTest, TestCompressedMinidump) {
+  ifstream file_stream(minidump_file_.c_str(), std::ios::in | std::ios::binary);
+  ASSERT_TRUE(file_stream.good());
+  std::stringstream contents;
+  contents << file_stream.rdbuf();
+  const string container = CompressMinidump(contents.str());
+  ASSERT_LT(container.size(), contents.str().size());
+
+  AutoTempDir dir;
+  const string path = dir.path() + "/compressed.dmp";
+  FILE* file = fopen(path.c_str(), "wb");
+  ASSERT_TRUE(file != NULL);
+  ASSERT_EQ(fwrite(container.data(), 1, container.size(), file),
+            container.size());
+  fclose(file);
+
+  Minidump read_minidump(minidump_file_);
+  ASSERT_TRUE(read_minidump.Read());
+  MinidumpThreadList* read_thread_list = read_minidump.GetThreadList();
+  ASSERT_TRUE(read_thread_list != NULL);
+
+  // Read from a file, mapped and not, and from a stream.
+  for (int i = 0; i < 3; ++i) {
+    istringstream stream(container);
+    scoped_ptr<Minidump> minidump(i < 2 ? new Minidump(path)
+                                        : new Minidump(stream));
+    minidump->set_use_mmap(i == 1);
+    ASSERT_TRUE(minidump->Read());
+    ASSERT_TRUE(minidump->is_mapped());
+    ASSERT_EQ(minidump->header()->signature, uint32_t(MD_HEADER_SIGNATURE));
+    ASSERT_EQ(read_minidump.GetDirectoryEntryCount(),
+              minidump->GetDirectoryEntryCount());
+    EXPECT_EQ(0, memcmp(minidump->GetMappedBytes(0, contents.str().size()),
+                        contents.str().data(), contents.str().size()));
+
+    MinidumpModuleList* md_module_list = minidump->GetModuleList();
+    ASSERT_TRUE(md_module_list != NULL);
+    const MinidumpModule* md_module = md_module_list->GetModuleAtIndex(0);
+    ASSERT_TRUE(md_module != NULL);
+    EXPECT_EQ("c:\\test_app.exe", md_module->code_file());
+
+    MinidumpThreadList* thread_list = minidump->GetThreadList();
+    ASSERT_TRUE(thread_list != NULL);
+    ASSERT_EQ(read_thread_list->thread_count(), thread_list->thread_count());
+    for (unsigned int j = 0; j < thread_list->thread_count(); ++j) {
+      MinidumpMemoryRegion* read_stack =
+          read_thread_list->GetThreadAtIndex(j)->GetMemory();
+      MinidumpMemoryRegion* stack =
+          thread_list->GetThreadAtIndex(j)->GetMemory();
+      ASSERT_TRUE(read_stack != NULL);
+      ASSERT_TRUE(stack != NULL);
+      ASSERT_EQ(read_stack->GetSize(), stack->GetSize());
+      EXPECT_EQ(0, memcmp(read_stack->GetMemory(), stack->GetMemory(),
+                          stack->GetSize()));
+    }
+  }
+
+  // A malformed container is rejected.
+  string corrupt = container;
+  corrupt[sizeof(CompressedMinidumpHeader) + 4] = '\xff';
+  istringstream corrupt_stream(corrupt);
+  Minidump corrupt_minidump(corrupt_stream);
+  EXPECT_FALSE(corrupt_minidump.Read());
+
+  // So is one that decompresses to more than the maximum size.
+  const uint32_t max_decompressed_size = Minidump::max_decompressed_size();
+  Minidump::set_max_decompressed_size(contents.str().size() - 1);
+  istringstream oversized_stream(container);
+  Minidump oversized_minidump(oversized_stream);
+  EXPECT_FALSE(oversized_minidump.Read());
+  Minidump::set_max_decompressed_size(max_decompressed_size);
+}
+
 TEST_F(MinidumpTest, TestMinidumpWithCrashpadAnnotations) {
   string crashpad_minidump_file =
       string(getenv("srcdir") ? getenv("srcdir") : ".") +
@@ -258,6 +430,45 @@ TEST(Dump, OneMemory) {
   ASSERT_TRUE(memcmp("memory contents", region1_bytes, 15) == 0);
 }
 
+// Memory regions of a mapped big-endian minidump are byte-swapped as they
+// are read.
+TEST(Dump, OneMemoryMapped) {
+  Dump dump(0, kBigEndian);
+  Memory memory(dump, 0x309d68010bd21b2cULL);
+  memory.D32(0x01020304).D16(0x0506);
+  dump.Add(&memory);
+  dump.Finish();
+
+  string contents;
+  ASSERT_TRUE(dump.GetContents(&contents));
+  AutoTempDir dir;
+  string path = dir.path() + "/one_memory.dmp";
+  FILE* file = fopen(path.c_str(), "wb");
+  ASSERT_TRUE(file != NULL);
+  ASSERT_EQ(contents.size(), fwrite(contents.data(), 1, contents.size(), file));
+  fclose(file);
+
+  Minidump minidump(path);
+  minidump.set_use_mmap(true);
+  ASSERT_TRUE(minidump.Read());
+  ASSERT_TRUE(minidump.is_mapped());
+
+  MinidumpMemoryList* memory_list = minidump.GetMemoryList();
+  ASSERT_TRUE(memory_list != NULL);
+  ASSERT_EQ(1U, memory_list->region_count());
+
+  MinidumpMemoryRegion* region = memory_list->GetMemoryRegionAtIndex(0);
+  ASSERT_EQ(0x309d68010bd21b2cULL, region->GetBase());
+  ASSERT_EQ(6U, region->GetSize());
+  uint32_t value32;
+  ASSERT_TRUE(region->GetMemoryAtAddress(0x309d68010bd21b2cULL, &value32));
+  EXPECT_EQ(0x01020304U, value32);
+  uint16_t value16;
+  ASSERT_TRUE(region->GetMemoryAtAddress(0x309d68010bd21b30ULL, &value16));
+  EXPECT_EQ(0x0506U, value16);
+  EXPECT_FALSE(region->GetMemoryAtAddress(0x309d68010bd21b30ULL, &value32));
+}
+
 // One thread --- and its requisite entourage.
 TEST(Dump, OneThread) {
   Dump dump(0, kLittleEndian);
@@ -1086,6 +1297,56 @@ TEST(Dump, OneMemoryInfo) {
   ASSERT_EQ(kRegionSize, info2->GetSize());
 }
 
+TEST(Dump, BreakpadInfo) {
+  for (int long_form = 0; long_form <= 1; ++long_form) {
+    Dump dump(0, kBigEndian);
+    Stream stream(dump, MD_BREAKPAD_INFO_STREAM);
+    stream.D32(MD_BREAKPAD_INFO_VALID_REQUESTING_THREAD_ID |
+               MD_BREAKPAD_INFO_VALID_PAUSE_DURATION |
+               MD_BREAKPAD_INFO_VALID_CRASH_ARENA)  // validity
+          .D32(0)                                   // dump_thread_id
+          .D32(0x4d2a7c1f);                         // requesting_thread_id
+    if (long_form) {
+      stream.D32(1500)     // pause_duration_us
+            .D32(0x23000)  // crash_arena_high_water
+            .D32(0x2000);  // crash_arena_overflow_bytes
+    }
+    dump.Add(&stream);
+    dump.Finish();
+
+    string contents;
+    ASSERT_TRUE(dump.GetContents(&contents));
+    istringstream minidump_stream(contents);
+    Minidump minidump(minidump_stream);
+    ASSERT_TRUE(minidump.Read());
+
+    MinidumpBreakpadInfo* breakpad_info = minidump.GetBreakpadInfo();
+    ASSERT_TRUE(breakpad_info != NULL);
+    uint32_t thread_id;
+    EXPECT_FALSE(breakpad_info->GetDumpThreadID(&thread_id));
+    ASSERT_TRUE(breakpad_info->GetRequestingThreadID(&thread_id));
+    EXPECT_EQ(0x4d2a7c1fU, thread_id);
+
+    // Only the long form has room for the pause duration and crash arena
+    // usage, whatever the validity field says.
+    uint32_t pause_duration_us;
+    uint32_t high_water;
+    uint32_t overflow_bytes;
+    if (long_form) {
+      ASSERT_TRUE(breakpad_info->GetPauseDuration(&pause_duration_us));
+      EXPECT_EQ(1500U, pause_duration_us);
+      ASSERT_TRUE(breakpad_info->GetCrashArenaUsage(&high_water,
+                                                    &overflow_bytes));
+      EXPECT_EQ(0x23000U, high_water);
+      EXPECT_EQ(0x2000U, overflow_bytes);
+    } else {
+      EXPECT_FALSE(breakpad_info->GetPauseDuration(&pause_duration_us));
+      EXPECT_FALSE(breakpad_info->GetCrashArenaUsage(&high_water,
+                                                     &overflow_bytes));
+    }
+  }
+}
+
 TEST(Dump, OneExceptionX86) {
   Dump dump(0, kLittleEndian);
 
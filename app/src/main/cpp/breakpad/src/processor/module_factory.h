@@ -50,11 +50,19 @@ class ModuleFactory {
 
 class BasicModuleFactory : public ModuleFactory {
  public:
+  BasicModuleFactory() : parse_thread_count_(1) { }
   virtual ~BasicModuleFactory() { }
   virtual BasicSourceLineResolver::Module* CreateModule(
       const string& name) const {
-    return new BasicSourceLineResolver::Module(name);
+    return new BasicSourceLineResolver::Module(name, parse_thread_count_);
   }
+
+  void set_parse_thread_count(int thread_count) {
+    parse_thread_count_ = thread_count;
+  }
+
+ private:
+  int parse_thread_count_;
 };
 
 class FastModuleFactory : public ModuleFactory {
@@ -0,0 +1,157 @@
+// Copyright 2024 Google LLC
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google LLC nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// module_range_table.cc: A flat table of the address ranges occupied by a
+// CodeModules list.
+//
+// See module_range_table.h for documentation.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>  // Must come first
+#endif
+
+#include "processor/module_range_table.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+#include "google_breakpad/processor/code_module.h"
+#include "google_breakpad/processor/code_modules.h"
+
+namespace google_breakpad {
+
+ModuleRangeTable::ModuleRangeTable(const CodeModules* modules) {
+  std::vector<std::pair<uint64_t, uint64_t> > ranges;
+  unsigned int module_count = modules ? modules->module_count() : 0;
+  for (unsigned int i = 0; i < module_count; ++i) {
+    const CodeModule* module = modules->GetModuleAtIndex(i);
+    if (!module || module->size() == 0)
+      continue;
+    uint64_t start = module->base_address();
+    uint64_t end = start + module->size();
+    if (end < start)
+      end = UINT64_MAX;
+    ranges.push_back(std::make_pair(start, end));
+  }
+  std::sort(ranges.begin(), ranges.end());
+
+  // Merge overlapping and adjacent ranges.
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    if (!ends_.empty() && ranges[i].first <= ends_.back()) {
+      ends_.back() = std::max(ends_.back(), ranges[i].second);
+    } else {
+      starts_.push_back(ranges[i].first);
+      ends_.push_back(ranges[i].second);
+    }
+  }
+
+  // Cover the ranges with at most kMaxCoarseRanges coarse ranges, by
+  // splitting at the widest gaps between them.  Modules tend to be
+  // clustered, and the widest gaps are where the stacks and heap lie.
+  std::vector<size_t> splits;
+  if (starts_.size() > kMaxCoarseRanges) {
+    std::vector<std::pair<uint64_t, size_t> > gaps;
+    for (size_t i = 1; i < starts_.size(); ++i)
+      gaps.push_back(std::make_pair(starts_[i] - ends_[i - 1], i));
+    std::partial_sort(gaps.begin(), gaps.begin() + kMaxCoarseRanges - 1,
+                      gaps.end(),
+                      std::greater<std::pair<uint64_t, size_t> >());
+    for (size_t i = 0; i < kMaxCoarseRanges - 1; ++i)
+      splits.push_back(gaps[i].second);
+  } else {
+    for (size_t i = 1; i < starts_.size(); ++i)
+      splits.push_back(i);
+  }
+  std::sort(splits.begin(), splits.end());
+  splits.push_back(starts_.size());
+
+  memset(coarse_starts_, 0, sizeof(coarse_starts_));
+  memset(coarse_lengths_, 0, sizeof(coarse_lengths_));
+  size_t first = 0;
+  for (size_t i = 0; i < splits.size() && first < starts_.size(); ++i) {
+    coarse_starts_[i] = starts_[first];
+    coarse_lengths_[i] = ends_[splits[i] - 1] - starts_[first];
+    first = splits[i];
+  }
+}
+
+bool ModuleRangeTable::Contains(uint64_t address) const {
+  std::vector<uint64_t>::const_iterator it =
+      std::upper_bound(starts_.begin(), starts_.end(), address);
+  if (it == starts_.begin())
+    return false;
+  return address < ends_[it - starts_.begin() - 1];
+}
+
+template<typename Word>
+size_t ModuleRangeTable::FindCandidate(const uint8_t* words,
+                                       size_t count,
+                                       size_t start) const {
+  // Check blocks of kBlockWords words against all the coarse ranges at
+  // once.  The loops have constant trip counts and no branches, so that
+  // they compile to vector compares; only words that fall within some
+  // coarse range are looked up in the full table.
+  const size_t kBlockWords = 8;
+  for (size_t i = start; i < count; i += kBlockWords) {
+    size_t block_count = std::min(kBlockWords, count - i);
+    Word block[kBlockWords] = { 0 };
+    memcpy(block, words + i * sizeof(Word), block_count * sizeof(Word));
+
+    uint8_t hits[kBlockWords];
+    uint8_t any_hit = 0;
+    for (size_t j = 0; j < kBlockWords; ++j) {
+      // A return address points after the call instruction, which may be
+      // the last in its module.
+      uint64_t address = static_cast<Word>(block[j] - 1);
+      uint8_t hit = 0;
+      for (size_t k = 0; k < kMaxCoarseRanges; ++k)
+        hit |= address - coarse_starts_[k] < coarse_lengths_[k];
+      hits[j] = hit;
+      any_hit |= hit;
+    }
+    if (!any_hit)
+      continue;
+
+    for (size_t j = 0; j < block_count; ++j) {
+      if (hits[j] && Contains(static_cast<Word>(block[j] - 1)))
+        return i + j;
+    }
+  }
+  return count;
+}
+
+// Explicit instantiations for 32-bit and 64-bit stacks.
+template size_t ModuleRangeTable::FindCandidate<uint32_t>(
+    const uint8_t* words, size_t count, size_t start) const;
+template size_t ModuleRangeTable::FindCandidate<uint64_t>(
+    const uint8_t* words, size_t count, size_t start) const;
+
+}  // namespace google_breakpad
@@ -0,0 +1,94 @@
+// Copyright 2024 Google LLC
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google LLC nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// module_range_table.h: A flat table of the address ranges occupied by a
+// CodeModules list, for filtering stack-scan candidates.
+//
+// Stack scanning considers every word on the stack as a possible return
+// address, and most words are not: they are small integers, pointers into
+// the stack or the heap, and so on.  ModuleRangeTable lets the scanner
+// discard those words in bulk, before asking the CodeModules and the
+// symbolizer about the few that remain.  It holds the module ranges,
+// merged and sorted, and a handful of coarse ranges covering them that
+// blocks of words are compared against together, in a loop the compiler
+// can vectorize.
+//
+// The table only narrows the candidates: a word it accepts may still
+// fall in a gap CodeModules doesn't attribute to any module, so callers
+// must still check candidates with CodeModules::GetModuleForAddress.
+
+#ifndef PROCESSOR_MODULE_RANGE_TABLE_H__
+#define PROCESSOR_MODULE_RANGE_TABLE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+namespace google_breakpad {
+
+class CodeModules;
+
+class ModuleRangeTable {
+ public:
+  // Builds a table of the ranges of the modules in |modules|, which may
+  // be NULL.
+  explicit ModuleRangeTable(const CodeModules* modules);
+
+  // Returns true if |address| lies within some module.
+  bool Contains(uint64_t address) const;
+
+  // |words| holds |count| stack words of type Word, which must be
+  // uint32_t or uint64_t, in host byte order and not necessarily aligned.
+  // Returns the index of the first word at or after |start| that could be
+  // a return address, that is, whose value minus one lies within some
+  // module.  Returns |count| if there is no such word.
+  template<typename Word>
+  size_t FindCandidate(const uint8_t* words, size_t count, size_t start) const;
+
+  // The number of merged module ranges in the table.
+  size_t range_count() const { return starts_.size(); }
+
+ private:
+  // The most coarse ranges that FindCandidate compares words against.
+  static const size_t kMaxCoarseRanges = 8;
+
+  // The merged module ranges, [starts_[i], ends_[i]), sorted by address.
+  std::vector<uint64_t> starts_;
+  std::vector<uint64_t> ends_;
+
+  // Coarse ranges [coarse_starts_[i], coarse_starts_[i] +
+  // coarse_lengths_[i]) covering all the module ranges.  Unused entries
+  // have a length of zero, so no address lies within them.
+  uint64_t coarse_starts_[kMaxCoarseRanges];
+  uint64_t coarse_lengths_[kMaxCoarseRanges];
+};
+
+}  // namespace google_breakpad
+
+#endif  // PROCESSOR_MODULE_RANGE_TABLE_H__
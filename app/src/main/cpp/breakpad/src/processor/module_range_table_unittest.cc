@@ -0,0 +1,163 @@
+// Copyright 2024 Google LLC
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google LLC nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// module_range_table_unittest.cc: Unit tests for ModuleRangeTable.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>  // Must come first
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "breakpad_googletest_includes.h"
+#include "processor/module_range_table.h"
+#include "processor/stackwalker_unittest_utils.h"
+
+namespace {
+
+using google_breakpad::ModuleRangeTable;
+
+// Returns the index FindCandidate should return, by checking each word
+// against |modules| directly.
+template<typename Word>
+size_t FindCandidateSlowly(const MockCodeModules& modules,
+                           const std::vector<Word>& words,
+                           size_t start) {
+  for (size_t i = start; i < words.size(); ++i) {
+    if (modules.GetModuleForAddress(static_cast<Word>(words[i] - 1)))
+      return i;
+  }
+  return words.size();
+}
+
+TEST(ModuleRangeTableTest, Empty) {
+  ModuleRangeTable table(NULL);
+  EXPECT_EQ(0U, table.range_count());
+  EXPECT_FALSE(table.Contains(0));
+  uint64_t words[3] = { 1, 0x1000, 0 };
+  EXPECT_EQ(3U, table.FindCandidate<uint64_t>(
+      reinterpret_cast<const uint8_t*>(words), 3, 0));
+}
+
+TEST(ModuleRangeTableTest, MergesRanges) {
+  MockCodeModule a(0x1000, 0x1000, "a", "1");
+  MockCodeModule b(0x1800, 0x1000, "b", "1");  // Overlaps a.
+  MockCodeModule c(0x2800, 0x100, "c", "1");   // Adjacent to b.
+  MockCodeModule d(0x8000, 0x100, "d", "1");
+  MockCodeModule empty(0x9000, 0, "empty", "1");
+  MockCodeModules modules;
+  modules.Add(&d);
+  modules.Add(&b);
+  modules.Add(&empty);
+  modules.Add(&a);
+  modules.Add(&c);
+
+  ModuleRangeTable table(&modules);
+  EXPECT_EQ(2U, table.range_count());
+  EXPECT_FALSE(table.Contains(0xfff));
+  EXPECT_TRUE(table.Contains(0x1000));
+  EXPECT_TRUE(table.Contains(0x28ff));
+  EXPECT_FALSE(table.Contains(0x2900));
+  EXPECT_TRUE(table.Contains(0x80ff));
+  EXPECT_FALSE(table.Contains(0x8100));
+  EXPECT_FALSE(table.Contains(0x9000));
+}
+
+// A return address may point just past the end of its module.
+TEST(ModuleRangeTableTest, ChecksAddressBeforeWord) {
+  MockCodeModule a(0x1000, 0x1000, "a", "1");
+  MockCodeModules modules;
+  modules.Add(&a);
+  ModuleRangeTable table(&modules);
+
+  uint32_t words[4] = { 0x1000, 0x2001, 0x2000, 0x1001 };
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(words);
+  EXPECT_EQ(2U, table.FindCandidate<uint32_t>(bytes, 4, 0));
+  EXPECT_EQ(3U, table.FindCandidate<uint32_t>(bytes, 4, 3));
+  EXPECT_EQ(2U, table.FindCandidate<uint32_t>(bytes, 3, 0));
+  EXPECT_EQ(2U, table.FindCandidate<uint32_t>(bytes, 2, 0));
+
+  // Zero minus one wraps around, and is no return address.
+  uint64_t zero = 0;
+  EXPECT_EQ(1U, table.FindCandidate<uint64_t>(
+      reinterpret_cast<const uint8_t*>(&zero), 1, 0));
+}
+
+// With more modules than coarse ranges, FindCandidate agrees with a
+// word-by-word search, for unaligned words too.
+template<typename Word>
+void CheckManyModules() {
+  std::vector<MockCodeModule*> owned;
+  MockCodeModules modules;
+  srand(0);
+  for (int i = 0; i < 100; ++i) {
+    // Clusters of modules, like shared libraries and the executable.
+    uint64_t cluster = (i % 3) * 0x10000000ULL + 0x40000000ULL;
+    owned.push_back(new MockCodeModule(cluster + i * 0x20000ULL,
+                                       0x1000 + rand() % 0x8000, "m", "1"));
+    modules.Add(owned.back());
+  }
+  ModuleRangeTable table(&modules);
+
+  std::vector<Word> words;
+  for (int i = 0; i < 5000; ++i) {
+    switch (rand() % 4) {
+      case 0: words.push_back(rand() % 0x100); break;
+      case 1: words.push_back(0x3f000000 + rand() % 0x100000); break;
+      default:
+        words.push_back(0x40000000 + (rand() % 3) * 0x10000000 +
+                        rand() % 0x1000000);
+    }
+  }
+  std::vector<uint8_t> bytes(words.size() * sizeof(Word) + 1);
+  memcpy(&bytes[1], &words[0], words.size() * sizeof(Word));
+
+  for (size_t i = 0; i <= words.size(); ) {
+    size_t expected = FindCandidateSlowly(modules, words, i);
+    ASSERT_EQ(expected,
+              table.FindCandidate<Word>(&bytes[1], words.size(), i));
+    i = expected + 1;
+  }
+
+  for (size_t i = 0; i < owned.size(); ++i)
+    delete owned[i];
+}
+
+TEST(ModuleRangeTableTest, ManyModules32) {
+  CheckManyModules<uint32_t>();
+}
+
+TEST(ModuleRangeTableTest, ManyModules64) {
+  CheckManyModules<uint64_t>();
+}
+
+}  // namespace
@@ -226,4 +226,15 @@ char* ModuleSerializer::SerializeSymbolFileData(const string& symbol_data,
   return Serialize(*module, size);
 }
 
+char* ModuleSerializer::SerializeSymbolFileData(char* symbol_data,
+                                                size_t symbol_data_size,
+                                                size_t* size) {
+  scoped_ptr<BasicSourceLineResolver::Module> module(
+      new BasicSourceLineResolver::Module("no name"));
+  if (!module->LoadMapFromMemory(symbol_data, symbol_data_size)) {
+    return NULL;
+  }
+  return Serialize(*module, size);
+}
+
 }  // namespace google_breakpad
@@ -81,6 +81,12 @@ class ModuleSerializer {
   char* SerializeSymbolFileData(const string& symbol_data,
                                 size_t* size = nullptr);
 
+  // Same as above, but parses the null-terminated |symbol_data| in place,
+  // as BasicSourceLineResolver::LoadModuleUsingMemoryBuffer() does, instead
+  // of copying it first.  The contents of |symbol_data| are clobbered.
+  char* SerializeSymbolFileData(char* symbol_data, size_t symbol_data_size,
+                                size_t* size = nullptr);
+
   // Serializes one loaded module with given moduleid in the basic source line
   // resolver, and loads the serialized data into the fast source line resolver.
   // Return false if the basic source line doesn't have a module with the given
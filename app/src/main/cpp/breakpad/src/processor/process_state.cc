@@ -39,11 +39,20 @@
 #include "google_breakpad/processor/process_state.h"
 #include "google_breakpad/processor/call_stack.h"
 #include "google_breakpad/processor/code_modules.h"
+#include "processor/frame_arena.h"
 
 namespace google_breakpad {
 
+ProcessState::ProcessState()
+    : frame_arena_(new FrameArena()),
+      modules_(NULL),
+      unloaded_modules_(NULL) {
+  Clear();
+}
+
 ProcessState::~ProcessState() {
   Clear();
+  delete frame_arena_;
 }
 
 void ProcessState::Clear() {
@@ -60,6 +69,8 @@ void ProcessState::Clear() {
     delete *iterator;
   }
   threads_.clear();
+  // Every frame in the arena belonged to one of the deleted CallStacks.
+  frame_arena_->Reset();
   system_info_.Clear();
   thread_names_.clear();
   // modules_without_symbols_ and modules_with_corrupt_symbols_ DO NOT own
@@ -0,0 +1,336 @@
+// Copyright 2024 Google LLC
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google LLC nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// process_state_serializer.cc: Encodes a ProcessState as a
+// ProcessStateProto message.
+//
+// See process_state_serializer.h for documentation.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>  // Must come first
+#endif
+
+#include "processor/process_state_serializer.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "google_breakpad/processor/call_stack.h"
+#include "google_breakpad/processor/code_module.h"
+#include "google_breakpad/processor/code_modules.h"
+#include "google_breakpad/processor/process_state.h"
+#include "google_breakpad/processor/stack_frame.h"
+#include "google_breakpad/processor/system_info.h"
+
+namespace google_breakpad {
+
+namespace {
+
+using std::vector;
+
+// Field numbers from processor/proto/process_state.proto.
+enum ProcessStateProtoField {
+  kProcessStateTimeDateStamp = 1,
+  kProcessStateCrash = 2,
+  kProcessStateAssertion = 3,
+  kProcessStateRequestingThread = 4,
+  kProcessStateThreads = 5,
+  kProcessStateModules = 6,
+  kProcessStateOS = 7,
+  kProcessStateOSShort = 8,
+  kProcessStateOSVersion = 9,
+  kProcessStateCPU = 10,
+  kProcessStateCPUInfo = 11,
+  kProcessStateCPUCount = 12,
+  kProcessStateProcessCreateTime = 13,
+};
+
+enum CrashField {
+  kCrashReason = 1,
+  kCrashAddress = 2,
+};
+
+enum ThreadField {
+  kThreadFrames = 1,
+};
+
+enum StackFrameField {
+  kStackFrameInstruction = 1,
+  kStackFrameModule = 2,
+  kStackFrameFunctionName = 3,
+  kStackFrameFunctionBase = 4,
+  kStackFrameSourceFileName = 5,
+  kStackFrameSourceLine = 6,
+  kStackFrameSourceLineBase = 7,
+};
+
+enum CodeModuleField {
+  kCodeModuleBaseAddress = 1,
+  kCodeModuleSize = 2,
+  kCodeModuleCodeFile = 3,
+  kCodeModuleCodeIdentifier = 4,
+  kCodeModuleDebugFile = 5,
+  kCodeModuleDebugIdentifier = 6,
+  kCodeModuleVersion = 7,
+};
+
+// Appends protocol buffer fields to a string.
+class ProtoWriter {
+ public:
+  explicit ProtoWriter(string* output) : output_(output) {}
+
+  // Writes an int32 or int64 field.  Negative values take ten bytes, as
+  // they are sign-extended to 64 bits.
+  void WriteInt(int field, int64_t value) {
+    WriteTag(field, kWireTypeVarint);
+    WriteVarint(static_cast<uint64_t>(value));
+  }
+
+  void WriteString(int field, const string& value) {
+    WriteBytes(field, value.data(), value.size());
+  }
+
+  // Writes a field holding |size| bytes from |data|, such as an already
+  // encoded message.
+  void WriteBytes(int field, const char* data, size_t size) {
+    WriteTag(field, kWireTypeLengthDelimited);
+    WriteVarint(size);
+    output_->append(data, size);
+  }
+
+  // Starts an embedded message, whose fields are written next.  The
+  // message's length isn't known yet, so a one-byte placeholder is written
+  // for it.  Returns the offset that must be passed to EndMessage.
+  size_t BeginMessage(int field) {
+    WriteTag(field, kWireTypeLengthDelimited);
+    output_->push_back('\0');
+    return output_->size();
+  }
+
+  // Ends the embedded message started at |start|, filling in its length.
+  // A length that needs more than one byte moves the message up to make
+  // room, which is cheap next to encoding it.
+  void EndMessage(size_t start) {
+    size_t length = output_->size() - start;
+    char varint[kMaxVarintSize];
+    size_t varint_size = EncodeVarint(length, varint);
+    if (varint_size > 1)
+      output_->insert(start, varint_size - 1, '\0');
+    memcpy(&(*output_)[start - 1], varint, varint_size);
+  }
+
+ private:
+  enum WireType {
+    kWireTypeVarint = 0,
+    kWireTypeLengthDelimited = 2,
+  };
+
+  static const size_t kMaxVarintSize = 10;
+
+  // Stores |value| as a base-128 varint at |buffer| and returns its size.
+  static size_t EncodeVarint(uint64_t value, char* buffer) {
+    size_t size = 0;
+    while (value >= 0x80) {
+      buffer[size++] = static_cast<char>(value | 0x80);
+      value >>= 7;
+    }
+    buffer[size++] = static_cast<char>(value);
+    return size;
+  }
+
+  void WriteVarint(uint64_t value) {
+    char varint[kMaxVarintSize];
+    output_->append(varint, EncodeVarint(value, varint));
+  }
+
+  void WriteTag(int field, WireType wire_type) {
+    WriteVarint(static_cast<uint64_t>(field) << 3 | wire_type);
+  }
+
+  string* output_;
+};
+
+// Writes the fields of a CodeModule message for |module|.
+void WriteCodeModule(const CodeModule* module, ProtoWriter* writer) {
+  writer->WriteInt(kCodeModuleBaseAddress, module->base_address());
+  writer->WriteInt(kCodeModuleSize, module->size());
+  // CodeModule's accessors return copies, so each is only called once.
+  string value = module->code_file();
+  if (!value.empty())
+    writer->WriteString(kCodeModuleCodeFile, value);
+  value = module->code_identifier();
+  if (!value.empty())
+    writer->WriteString(kCodeModuleCodeIdentifier, value);
+  value = module->debug_file();
+  if (!value.empty())
+    writer->WriteString(kCodeModuleDebugFile, value);
+  value = module->debug_identifier();
+  if (!value.empty())
+    writer->WriteString(kCodeModuleDebugIdentifier, value);
+  value = module->version();
+  if (!value.empty())
+    writer->WriteString(kCodeModuleVersion, value);
+}
+
+// The encoded CodeModule messages of a ProcessState's modules, by base
+// address, so that frames can copy them instead of encoding their module
+// again.
+class EncodedModules {
+ public:
+  explicit EncodedModules(const CodeModules* modules) {
+    if (!modules)
+      return;
+    unsigned int module_count = modules->module_count();
+    encoded_.resize(module_count);
+    index_.reserve(module_count);
+    for (unsigned int i = 0; i < module_count; ++i) {
+      const CodeModule* module = modules->GetModuleAtSequence(i);
+      ProtoWriter writer(&encoded_[i]);
+      WriteCodeModule(module, &writer);
+      index_.push_back(std::make_pair(module->base_address(), i));
+    }
+    std::sort(index_.begin(), index_.end());
+  }
+
+  const string& encoded(unsigned int index) const { return encoded_[index]; }
+  unsigned int count() const { return encoded_.size(); }
+
+  // Returns the encoded CodeModule message for |module|, or NULL if it
+  // isn't one of the ProcessState's modules.
+  const string* Find(const CodeModule* module) const {
+    vector<std::pair<uint64_t, unsigned int>>::const_iterator entry =
+        std::lower_bound(index_.begin(), index_.end(),
+                         std::make_pair(module->base_address(), 0U));
+    if (entry == index_.end() || entry->first != module->base_address())
+      return NULL;
+    return &encoded_[entry->second];
+  }
+
+ private:
+  vector<string> encoded_;
+  vector<std::pair<uint64_t, unsigned int>> index_;
+};
+
+// Writes a StackFrame message for |frame| as field |field|.
+void WriteStackFrame(int field, const StackFrame* frame,
+                     const EncodedModules& modules, ProtoWriter* writer) {
+  size_t start = writer->BeginMessage(field);
+  writer->WriteInt(kStackFrameInstruction, frame->instruction);
+  if (frame->module) {
+    const string* encoded = modules.Find(frame->module);
+    if (encoded) {
+      writer->WriteBytes(kStackFrameModule, encoded->data(), encoded->size());
+    } else {
+      // Modules outside the list, such as unloaded ones, are rare enough
+      // to encode each time.
+      size_t module_start = writer->BeginMessage(kStackFrameModule);
+      WriteCodeModule(frame->module, writer);
+      writer->EndMessage(module_start);
+    }
+  }
+  if (!frame->function_name.empty()) {
+    writer->WriteString(kStackFrameFunctionName, frame->function_name);
+    writer->WriteInt(kStackFrameFunctionBase, frame->function_base);
+  }
+  if (!frame->source_file_name.empty()) {
+    writer->WriteString(kStackFrameSourceFileName, frame->source_file_name);
+    writer->WriteInt(kStackFrameSourceLine, frame->source_line);
+    writer->WriteInt(kStackFrameSourceLineBase, frame->source_line_base);
+  }
+  writer->EndMessage(start);
+}
+
+}  // namespace
+
+// static
+void ProcessStateSerializer::Serialize(const ProcessState& process_state,
+                                       string* output) {
+  ProtoWriter writer(output);
+
+  if (process_state.time_date_stamp() != 0) {
+    writer.WriteInt(kProcessStateTimeDateStamp,
+                    process_state.time_date_stamp());
+  }
+
+  if (process_state.crashed()) {
+    size_t start = writer.BeginMessage(kProcessStateCrash);
+    writer.WriteString(kCrashReason, process_state.crash_reason());
+    writer.WriteInt(kCrashAddress, process_state.crash_address());
+    writer.EndMessage(start);
+  }
+
+  const string assertion = process_state.assertion();
+  if (!assertion.empty())
+    writer.WriteString(kProcessStateAssertion, assertion);
+
+  if (process_state.requesting_thread() != -1) {
+    writer.WriteInt(kProcessStateRequestingThread,
+                    process_state.requesting_thread());
+  }
+
+  EncodedModules modules(process_state.modules());
+  const vector<CallStack*>* threads = process_state.threads();
+  for (vector<CallStack*>::const_iterator thread = threads->begin();
+       thread != threads->end(); ++thread) {
+    size_t start = writer.BeginMessage(kProcessStateThreads);
+    const vector<StackFrame*>* frames = (*thread)->frames();
+    for (vector<StackFrame*>::const_iterator frame = frames->begin();
+         frame != frames->end(); ++frame) {
+      WriteStackFrame(kThreadFrames, *frame, modules, &writer);
+    }
+    writer.EndMessage(start);
+  }
+
+  for (unsigned int i = 0; i < modules.count(); ++i) {
+    const string& encoded = modules.encoded(i);
+    writer.WriteBytes(kProcessStateModules, encoded.data(), encoded.size());
+  }
+
+  const SystemInfo* system_info = process_state.system_info();
+  if (!system_info->os.empty())
+    writer.WriteString(kProcessStateOS, system_info->os);
+  if (!system_info->os_short.empty())
+    writer.WriteString(kProcessStateOSShort, system_info->os_short);
+  if (!system_info->os_version.empty())
+    writer.WriteString(kProcessStateOSVersion, system_info->os_version);
+  if (!system_info->cpu.empty())
+    writer.WriteString(kProcessStateCPU, system_info->cpu);
+  if (!system_info->cpu_info.empty())
+    writer.WriteString(kProcessStateCPUInfo, system_info->cpu_info);
+  writer.WriteInt(kProcessStateCPUCount, system_info->cpu_count);
+
+  if (process_state.process_create_time() != 0) {
+    writer.WriteInt(kProcessStateProcessCreateTime,
+                    process_state.process_create_time());
+  }
+}
+
+}  // namespace google_breakpad
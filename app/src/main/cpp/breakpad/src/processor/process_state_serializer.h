@@ -0,0 +1,58 @@
+// Copyright 2024 Google LLC
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google LLC nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// process_state_serializer.h: Encodes a ProcessState in the protocol buffer
+// wire format of ProcessStateProto, defined in
+// processor/proto/process_state.proto.
+//
+// The encoder is hand-written so that the processor doesn't depend on the
+// protobuf library; anything that can parse process_state.proto can read
+// its output.
+
+#ifndef PROCESSOR_PROCESS_STATE_SERIALIZER_H__
+#define PROCESSOR_PROCESS_STATE_SERIALIZER_H__
+
+#include <string>
+
+#include "common/using_std_string.h"
+
+namespace google_breakpad {
+
+class ProcessState;
+
+class ProcessStateSerializer {
+ public:
+  // Appends |process_state|, encoded as a ProcessStateProto message, to
+  // |output|.  Each stack frame carries a copy of its CodeModule message,
+  // as the schema requires, but every module is only encoded once.
+  static void Serialize(const ProcessState& process_state, string* output);
+};
+
+}  // namespace google_breakpad
+
+#endif  // PROCESSOR_PROCESS_STATE_SERIALIZER_H__
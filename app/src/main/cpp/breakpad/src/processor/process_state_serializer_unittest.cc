@@ -0,0 +1,231 @@
+// Copyright 2024 Google LLC
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google LLC nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// process_state_serializer_unittest.cc: Unit tests for
+// ProcessStateSerializer.  The tests decode its output with a minimal
+// protocol buffer wire format parser and compare it to the ProcessState.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>  // Must come first
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+#include "breakpad_googletest_includes.h"
+#include "common/using_std_string.h"
+#include "google_breakpad/processor/basic_source_line_resolver.h"
+#include "google_breakpad/processor/call_stack.h"
+#include "google_breakpad/processor/code_module.h"
+#include "google_breakpad/processor/code_modules.h"
+#include "google_breakpad/processor/minidump_processor.h"
+#include "google_breakpad/processor/process_state.h"
+#include "google_breakpad/processor/stack_frame.h"
+#include "google_breakpad/processor/system_info.h"
+#include "processor/process_state_serializer.h"
+#include "processor/simple_symbol_supplier.h"
+
+namespace {
+
+using google_breakpad::BasicSourceLineResolver;
+using google_breakpad::CodeModule;
+using google_breakpad::MinidumpProcessor;
+using google_breakpad::ProcessState;
+using google_breakpad::ProcessStateSerializer;
+using google_breakpad::SimpleSymbolSupplier;
+using google_breakpad::StackFrame;
+using std::vector;
+
+// A field decoded from a message.  Varint fields set |value|, and
+// length-delimited ones (strings and embedded messages) set |bytes|.
+struct Field {
+  int number;
+  int wire_type;
+  uint64_t value;
+  string bytes;
+};
+
+bool ReadVarint(const string& data, size_t* offset, uint64_t* value) {
+  *value = 0;
+  for (int shift = 0; shift < 64 && *offset < data.size(); shift += 7) {
+    uint8_t byte = data[(*offset)++];
+    *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      return true;
+  }
+  return false;
+}
+
+// Decodes the fields of the message in |data|, which may only use the
+// varint and length-delimited wire types.
+bool DecodeMessage(const string& data, vector<Field>* fields) {
+  fields->clear();
+  size_t offset = 0;
+  while (offset < data.size()) {
+    uint64_t tag;
+    if (!ReadVarint(data, &offset, &tag))
+      return false;
+    Field field;
+    field.number = tag >> 3;
+    field.wire_type = tag & 7;
+    field.value = 0;
+    if (field.wire_type == 0) {
+      if (!ReadVarint(data, &offset, &field.value))
+        return false;
+    } else if (field.wire_type == 2) {
+      uint64_t length;
+      if (!ReadVarint(data, &offset, &length) ||
+          length > data.size() - offset) {
+        return false;
+      }
+      field.bytes = data.substr(offset, length);
+      offset += length;
+    } else {
+      return false;
+    }
+    fields->push_back(field);
+  }
+  return true;
+}
+
+// Returns the fields numbered |number| in |fields|.
+vector<Field> FieldsNumbered(const vector<Field>& fields, int number) {
+  vector<Field> result;
+  for (const Field& field : fields) {
+    if (field.number == number)
+      result.push_back(field);
+  }
+  return result;
+}
+
+// Returns the single field numbered |number| in |fields|, failing the test
+// if there isn't exactly one.
+Field FieldNumbered(const vector<Field>& fields, int number) {
+  vector<Field> matches = FieldsNumbered(fields, number);
+  EXPECT_EQ(1U, matches.size()) << "field " << number;
+  return matches.empty() ? Field() : matches[0];
+}
+
+string TestDataDir() {
+  return string(getenv("srcdir") ? getenv("srcdir") : ".") +
+      "/src/processor/testdata";
+}
+
+void ExpectCodeModule(const CodeModule* module, const string& encoded) {
+  vector<Field> fields;
+  ASSERT_TRUE(DecodeMessage(encoded, &fields));
+  EXPECT_EQ(module->base_address(), FieldNumbered(fields, 1).value);
+  EXPECT_EQ(module->size(), FieldNumbered(fields, 2).value);
+  EXPECT_EQ(module->code_file(), FieldNumbered(fields, 3).bytes);
+  EXPECT_EQ(module->code_identifier(), FieldNumbered(fields, 4).bytes);
+  EXPECT_EQ(module->debug_file(), FieldNumbered(fields, 5).bytes);
+  EXPECT_EQ(module->debug_identifier(), FieldNumbered(fields, 6).bytes);
+}
+
+TEST(ProcessStateSerializerTest, EmptyProcessState) {
+  ProcessState state;
+  string serialized = "prefix";
+  ProcessStateSerializer::Serialize(state, &serialized);
+  // Only cpu_count (field 12) is always written; the output is appended.
+  EXPECT_EQ(string("prefix\x60\x00", 8), serialized);
+}
+
+TEST(ProcessStateSerializerTest, Minidump) {
+  SimpleSymbolSupplier supplier(TestDataDir() + "/symbols");
+  BasicSourceLineResolver resolver;
+  MinidumpProcessor processor(&supplier, &resolver);
+  ProcessState state;
+  ASSERT_EQ(google_breakpad::PROCESS_OK,
+            processor.Process(TestDataDir() + "/minidump2.dmp", &state));
+
+  string serialized;
+  ProcessStateSerializer::Serialize(state, &serialized);
+  vector<Field> fields;
+  ASSERT_TRUE(DecodeMessage(serialized, &fields));
+
+  EXPECT_EQ(state.time_date_stamp(), FieldNumbered(fields, 1).value);
+  vector<Field> crash;
+  ASSERT_TRUE(DecodeMessage(FieldNumbered(fields, 2).bytes, &crash));
+  EXPECT_EQ("EXCEPTION_ACCESS_VIOLATION_WRITE", FieldNumbered(crash, 1).bytes);
+  EXPECT_EQ(state.crash_address(), FieldNumbered(crash, 2).value);
+  EXPECT_TRUE(FieldsNumbered(fields, 3).empty());
+  EXPECT_EQ(0U, FieldNumbered(fields, 4).value);
+
+  vector<Field> threads = FieldsNumbered(fields, 5);
+  ASSERT_EQ(state.threads()->size(), threads.size());
+  for (size_t i = 0; i < threads.size(); ++i) {
+    vector<Field> thread;
+    ASSERT_TRUE(DecodeMessage(threads[i].bytes, &thread));
+    vector<Field> frames = FieldsNumbered(thread, 1);
+    const vector<StackFrame*>* expected_frames =
+        state.threads()->at(i)->frames();
+    ASSERT_EQ(expected_frames->size(), frames.size());
+    for (size_t j = 0; j < frames.size(); ++j) {
+      const StackFrame* expected = expected_frames->at(j);
+      vector<Field> frame;
+      ASSERT_TRUE(DecodeMessage(frames[j].bytes, &frame));
+      EXPECT_EQ(expected->instruction, FieldNumbered(frame, 1).value);
+      ASSERT_TRUE(expected->module);
+      ExpectCodeModule(expected->module, FieldNumbered(frame, 2).bytes);
+      // Symbol information is only written when the frame has it.
+      if (expected->function_name.empty()) {
+        EXPECT_TRUE(FieldsNumbered(frame, 3).empty());
+      } else {
+        EXPECT_EQ(expected->function_name, FieldNumbered(frame, 3).bytes);
+        EXPECT_EQ(expected->function_base, FieldNumbered(frame, 4).value);
+      }
+      if (expected->source_file_name.empty()) {
+        EXPECT_TRUE(FieldsNumbered(frame, 5).empty());
+      } else {
+        EXPECT_EQ(expected->source_file_name, FieldNumbered(frame, 5).bytes);
+        EXPECT_EQ(static_cast<uint64_t>(expected->source_line),
+                  FieldNumbered(frame, 6).value);
+        EXPECT_EQ(expected->source_line_base, FieldNumbered(frame, 7).value);
+      }
+    }
+  }
+
+  vector<Field> modules = FieldsNumbered(fields, 6);
+  ASSERT_EQ(state.modules()->module_count(), modules.size());
+  for (size_t i = 0; i < modules.size(); ++i) {
+    ExpectCodeModule(state.modules()->GetModuleAtSequence(i),
+                     modules[i].bytes);
+  }
+
+  EXPECT_EQ("Windows NT", FieldNumbered(fields, 7).bytes);
+  EXPECT_EQ("windows", FieldNumbered(fields, 8).bytes);
+  EXPECT_EQ("5.1.2600 Service Pack 2", FieldNumbered(fields, 9).bytes);
+  EXPECT_EQ("x86", FieldNumbered(fields, 10).bytes);
+  EXPECT_EQ(state.system_info()->cpu_info, FieldNumbered(fields, 11).bytes);
+  EXPECT_EQ(1U, FieldNumbered(fields, 12).value);
+}
+
+}  // namespace
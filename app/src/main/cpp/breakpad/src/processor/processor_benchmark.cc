@@ -0,0 +1,867 @@
+// Copyright 2024 Google LLC
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google LLC nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// processor_benchmark.cc: A suite of microbenchmarks for the hot paths of
+// the minidump processor, from range map lookups to processing a whole
+// minidump.
+//
+// All inputs are synthetic and generated from a fixed seed, so runs on
+// different machines measure the same work: text symbol files with a
+// configurable number of functions, and minidumps built with
+// SynthMinidump whose threads have stacks running through those
+// functions, either linked by frame pointers or left for the stack
+// walker to scan.
+//
+// Each benchmark is run several times.  For each one, the fastest and the
+// median time per operation are reported, along with the number of heap
+// allocations per operation and the bytes they requested, counted by
+// replacing the global operator new.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>  // Must come first
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "common/path_helper.h"
+#include "common/scoped_ptr.h"
+#include "common/using_std_string.h"
+#include "google_breakpad/common/minidump_format.h"
+#include "google_breakpad/processor/basic_source_line_resolver.h"
+#include "google_breakpad/processor/call_stack.h"
+#include "google_breakpad/processor/code_module.h"
+#include "google_breakpad/processor/memory_region.h"
+#include "google_breakpad/processor/minidump.h"
+#include "google_breakpad/processor/minidump_processor.h"
+#include "google_breakpad/processor/process_state.h"
+#include "google_breakpad/processor/stack_frame.h"
+#include "google_breakpad/processor/symbol_supplier.h"
+#include "processor/basic_code_module.h"
+#include "processor/cfi_frame_info.h"
+#include "processor/logging.h"
+#include "processor/map_serializers-inl.h"
+#include "processor/postfix_evaluator-inl.h"
+#include "processor/process_state_serializer.h"
+#include "processor/range_map-inl.h"
+#include "processor/static_map-inl.h"
+#include "processor/static_range_map-inl.h"
+#include "processor/synth_minidump.h"
+
+namespace {
+
+// Heap allocations made through operator new since the program started.
+std::atomic<uint64_t> allocation_count(0);
+std::atomic<uint64_t> allocation_bytes(0);
+
+}  // namespace
+
+void* operator new(size_t size) {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+  void* p = malloc(size ? size : 1);
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+void operator delete[](void* p) noexcept {
+  free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+  free(p);
+}
+
+namespace {
+
+using google_breakpad::BasicCodeModule;
+using google_breakpad::BasicSourceLineResolver;
+using google_breakpad::CFIFrameInfo;
+using google_breakpad::CFIFrameInfoParseHandler;
+using google_breakpad::CFIRuleParser;
+using google_breakpad::CodeModule;
+using google_breakpad::MemoryRegion;
+using google_breakpad::Minidump;
+using google_breakpad::MinidumpProcessor;
+using google_breakpad::PostfixEvaluator;
+using google_breakpad::ProcessState;
+using google_breakpad::ProcessStateSerializer;
+using google_breakpad::RangeMap;
+using google_breakpad::RangeMapSerializer;
+using google_breakpad::StackFrame;
+using google_breakpad::StaticMap;
+using google_breakpad::StaticRangeMap;
+using google_breakpad::StdMapSerializer;
+using google_breakpad::SymbolSupplier;
+using google_breakpad::SystemInfo;
+using google_breakpad::scoped_array;
+using std::vector;
+
+namespace SynthMinidump = google_breakpad::SynthMinidump;
+
+struct Options {
+  int repeat_count;
+  int function_count;
+  int thread_count;
+  int frame_count;
+  vector<string> benchmarks;
+};
+
+// The module that synthetic symbol files and minidumps describe.
+const uint64_t kModuleBase = 0x10000000;
+
+// The lowest stack address of the first thread in synthetic minidumps.
+const uint64_t kStackBase = 0x80000000;
+
+// Random numbers that are the same on every platform.  The engines of
+// <random> are fully specified, but its distributions are not.
+class Random {
+ public:
+  explicit Random(uint32_t seed) : engine_(seed) { }
+
+  // Returns a number in [0, bound).
+  uint64_t Next(uint64_t bound) {
+    uint64_t value = engine_();
+    value = (value << 32) | engine_();
+    return value % bound;
+  }
+
+ private:
+  std::mt19937 engine_;
+};
+
+// The layout of the functions in the synthetic module, relative to its
+// base address.
+struct Function {
+  uint64_t address;
+  uint64_t size;
+};
+
+// Lays out |count| functions of random sizes, some of them with gaps
+// between them.
+vector<Function> MakeFunctions(int count) {
+  Random random(1);
+  vector<Function> functions;
+  uint64_t address = 0x1000;
+  for (int i = 0; i < count; ++i) {
+    Function function;
+    function.address = address;
+    function.size = 0x20 + random.Next(0x400);
+    functions.push_back(function);
+    address += function.size;
+    if (random.Next(4) == 0)
+      address += 0x10;
+  }
+  return functions;
+}
+
+// Returns the total size of the module holding |functions|.
+uint64_t ModuleSize(const vector<Function>& functions) {
+  return functions.back().address + functions.back().size + 0x1000;
+}
+
+// Returns |count| random addresses in |functions|, relative to the module
+// base.  A few fall in the gaps between functions.
+vector<uint64_t> MakeAddresses(const vector<Function>& functions, int count) {
+  Random random(2);
+  vector<uint64_t> addresses;
+  for (int i = 0; i < count; ++i) {
+    const Function& function = functions[random.Next(functions.size())];
+    addresses.push_back(function.address + random.Next(function.size + 0x10));
+  }
+  return addresses;
+}
+
+// Returns a text symbol file for |functions|, with line records, PUBLIC
+// records, and STACK CFI records.
+string MakeSymbolFile(const vector<Function>& functions) {
+  Random random(3);
+  std::ostringstream out;
+  out << std::hex;
+  out << "MODULE windows x86 5A9832E5287241C1838ED98914E9B7FF1 bench.pdb\n";
+  const int kFileCount = 64;
+  for (int i = 0; i < kFileCount; ++i)
+    out << "FILE " << std::dec << i << std::hex << " src/bench/file" << i
+        << ".cc\n";
+  for (size_t i = 0; i < functions.size(); ++i) {
+    const Function& function = functions[i];
+    out << "FUNC " << function.address << " " << function.size
+        << " 0 bench::Function" << std::dec << i << std::hex << "()\n";
+    int file = random.Next(kFileCount);
+    for (uint64_t line = function.address;
+         line < function.address + function.size; ) {
+      uint64_t size = std::min<uint64_t>(4 + random.Next(28),
+                                         function.address + function.size -
+                                         line);
+      out << line << " " << size << " " << std::dec
+          << 1 + random.Next(5000) << " " << file << std::hex << "\n";
+      line += size;
+    }
+    if (i % 16 == 0)
+      out << "PUBLIC " << function.address << " 0 bench_public_" << std::dec
+          << i << std::hex << "\n";
+  }
+  for (const Function& function : functions) {
+    out << "STACK CFI INIT " << function.address << " " << function.size
+        << " .cfa: $esp 4 + .ra: .cfa 4 - ^\n";
+    out << "STACK CFI " << function.address + 1
+        << " .cfa: $esp 8 + $ebp: .cfa 8 - ^\n";
+    out << "STACK CFI " << function.address + 3
+        << " .cfa: $ebp 8 + .ra: .cfa 4 - ^ $ebp: .cfa 8 - ^\n";
+  }
+  return out.str();
+}
+
+// Returns a minidump of an x86 Windows process running the module of
+// |functions|, with |options.thread_count| threads, each of whose stack
+// holds |options.frame_count| frames.  If |frame_pointers| is true, the
+// frames are a chain linked by saved frame pointers.  Otherwise, as in
+// code built without frame pointers, each frame holds a return address
+// among words that are not return addresses, and the stack walker has to
+// scan for them.
+string MakeMinidump(const Options& options,
+                    const vector<Function>& functions,
+                    bool frame_pointers) {
+  Random random(4);
+  SynthMinidump::Dump dump(0);
+
+  SynthMinidump::String csd_version(
+      dump, SynthMinidump::SystemInfo::windows_x86_csd_version);
+  SynthMinidump::SystemInfo system_info(
+      dump, SynthMinidump::SystemInfo::windows_x86, csd_version);
+  dump.Add(&system_info);
+  dump.Add(&csd_version);
+
+  SynthMinidump::String module_name(dump, "c:\\bench\\bench.exe");
+  SynthMinidump::Module module(dump, kModuleBase, ModuleSize(functions),
+                               module_name);
+  dump.Add(&module);
+  dump.Add(&module_name);
+
+  // Returns an address in the middle of a random function.
+  auto instruction = [&]() {
+    const Function& function = functions[random.Next(functions.size())];
+    return static_cast<uint32_t>(kModuleBase + function.address +
+                                 function.size / 2);
+  };
+
+  // The sections must outlive dump.Finish().
+  vector<std::unique_ptr<SynthMinidump::Memory>> stacks;
+  vector<std::unique_ptr<SynthMinidump::Context>> contexts;
+  vector<std::unique_ptr<SynthMinidump::Thread>> threads;
+  for (int i = 0; i < options.thread_count; ++i) {
+    const uint64_t stack_base = kStackBase + i * 0x10000;
+    SynthMinidump::Memory* stack =
+        new SynthMinidump::Memory(dump, stack_base);
+    stacks.emplace_back(stack);
+    for (int frame = 0; frame < options.frame_count; ++frame) {
+      if (frame_pointers) {
+        // Each frame holds the caller's frame pointer and the return
+        // address.  The outermost frame's saved frame pointer of 0 ends
+        // the walk.
+        bool last = frame == options.frame_count - 1;
+        stack->D32(last ? 0 : stack_base + (frame + 1) * 8);
+      } else {
+        // Each frame holds some locals and saved registers: small
+        // integers, pointers into the stack, and pointers into the heap.
+        uint64_t local_count = 4 + random.Next(24);
+        for (uint64_t local = 0; local < local_count; ++local) {
+          switch (random.Next(3)) {
+            case 0: stack->D32(random.Next(0x1000)); break;
+            case 1: stack->D32(stack_base + random.Next(0x10000)); break;
+            case 2: stack->D32(0x02000000 + random.Next(0x01000000)); break;
+          }
+        }
+      }
+      stack->D32(instruction());
+    }
+    stack->D32(0).D32(0);
+
+    MDRawContextX86 raw_context;
+    memset(&raw_context, 0, sizeof(raw_context));
+    raw_context.context_flags = MD_CONTEXT_X86_FULL;
+    raw_context.eip = instruction();
+    raw_context.esp = stack_base;
+    raw_context.ebp = frame_pointers ? stack_base : 0;
+    SynthMinidump::Context* context =
+        new SynthMinidump::Context(dump, raw_context);
+    contexts.emplace_back(context);
+
+    SynthMinidump::Thread* thread =
+        new SynthMinidump::Thread(dump, 0x1000 + i, *stack, *context);
+    threads.emplace_back(thread);
+
+    dump.Add(stack);
+    dump.Add(context);
+    dump.Add(thread);
+  }
+  dump.Finish();
+
+  string contents;
+  dump.GetContents(&contents);
+  return contents;
+}
+
+// Supplies the same symbol data for every module.
+class BenchmarkSymbolSupplier : public SymbolSupplier {
+ public:
+  explicit BenchmarkSymbolSupplier(const string& symbol_data)
+      : symbol_data_(symbol_data) { }
+
+  SymbolResult GetSymbolFile(const CodeModule* module,
+                             const SystemInfo* system_info,
+                             string* symbol_file) override {
+    *symbol_file = "bench.sym";
+    return FOUND;
+  }
+
+  SymbolResult GetSymbolFile(const CodeModule* module,
+                             const SystemInfo* system_info,
+                             string* symbol_file,
+                             string* symbol_data) override {
+    *symbol_file = "bench.sym";
+    *symbol_data = symbol_data_;
+    return FOUND;
+  }
+
+  SymbolResult GetCStringSymbolData(const CodeModule* module,
+                                    const SystemInfo* system_info,
+                                    string* symbol_file,
+                                    char** symbol_data,
+                                    size_t* symbol_data_size) override {
+    *symbol_file = "bench.sym";
+    *symbol_data_size = symbol_data_.size() + 1;
+    *symbol_data = new char[*symbol_data_size];
+    memcpy(*symbol_data, symbol_data_.c_str(), *symbol_data_size);
+    buffers_[module->code_file()].reset(*symbol_data);
+    return FOUND;
+  }
+
+  void FreeSymbolData(const CodeModule* module) override {
+    buffers_.erase(module->code_file());
+  }
+
+ private:
+  string symbol_data_;
+  std::map<string, scoped_array<char>> buffers_;
+};
+
+// Memory whose contents at each address are the address plus one, so that
+// every dereference succeeds.
+class FakeMemoryRegion : public MemoryRegion {
+ public:
+  uint64_t GetBase() const override { return 0; }
+  uint32_t GetSize() const override { return 0xffffffff; }
+  bool GetMemoryAtAddress(uint64_t address, uint8_t* value) const override {
+    *value = address + 1;
+    return true;
+  }
+  bool GetMemoryAtAddress(uint64_t address, uint16_t* value) const override {
+    *value = address + 1;
+    return true;
+  }
+  bool GetMemoryAtAddress(uint64_t address, uint32_t* value) const override {
+    *value = address + 1;
+    return true;
+  }
+  bool GetMemoryAtAddress(uint64_t address, uint64_t* value) const override {
+    *value = address + 1;
+    return true;
+  }
+  void Print() const override { }
+};
+
+// Results are added to this so that the compiler can't drop the work that
+// produced them.
+volatile uint64_t sink;
+
+// Runs |body|, which performs |operations| operations, options.repeat_count
+// times, and prints the results as a row for |name|.  |setup|, if set, runs
+// before each run of |body| and isn't measured.
+void Measure(const Options& options, const char* name, uint64_t operations,
+             const std::function<void()>& setup,
+             const std::function<void()>& body) {
+  vector<double> times;
+  uint64_t allocations = 0, bytes = 0;
+  for (int i = 0; i < options.repeat_count; ++i) {
+    if (setup)
+      setup();
+    uint64_t start_count = allocation_count.load();
+    uint64_t start_bytes = allocation_bytes.load();
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    body();
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    // Every run does the same work, so the last run's counts stand for all.
+    allocations = allocation_count.load() - start_count;
+    bytes = allocation_bytes.load() - start_bytes;
+    times.push_back(elapsed.count());
+  }
+
+  std::sort(times.begin(), times.end());
+  double best = times.front() / operations * 1e9;
+  double median = times[times.size() / 2] / operations * 1e9;
+  printf("%-20s %10llu %12.1f %12.1f %12.3f %10.2f %12.1f\n",
+         name, static_cast<unsigned long long>(operations), best, median,
+         1e3 / best, static_cast<double>(allocations) / operations,
+         static_cast<double>(bytes) / operations);
+  fflush(stdout);
+}
+
+void Measure(const Options& options, const char* name, uint64_t operations,
+             const std::function<void()>& body) {
+  Measure(options, name, operations, std::function<void()>(), body);
+}
+
+// Looks up random addresses in a RangeMap of the module's functions.
+void BenchmarkRangeMap(const Options& options) {
+  vector<Function> functions = MakeFunctions(options.function_count);
+  RangeMap<uint64_t, int> range_map;
+  for (size_t i = 0; i < functions.size(); ++i)
+    range_map.StoreRange(functions[i].address, functions[i].size, i);
+  vector<uint64_t> addresses = MakeAddresses(functions, 1 << 20);
+
+  Measure(options, "range_map", addresses.size(), [&]() {
+    uint64_t sum = 0;
+    for (uint64_t address : addresses) {
+      int entry;
+      if (range_map.RetrieveRange(address, &entry, NULL, NULL, NULL))
+        sum += entry;
+    }
+    sink += sum;
+  });
+}
+
+// Looks up random addresses in a serialized StaticRangeMap of the module's
+// functions, as FastSourceLineResolver does.
+void BenchmarkStaticRangeMap(const Options& options) {
+  vector<Function> functions = MakeFunctions(options.function_count);
+  RangeMap<uint64_t, int> range_map;
+  for (size_t i = 0; i < functions.size(); ++i)
+    range_map.StoreRange(functions[i].address, functions[i].size, i);
+  RangeMapSerializer<uint64_t, int> serializer;
+  scoped_array<char> data(serializer.Serialize(range_map, NULL));
+  StaticRangeMap<uint64_t, int> static_range_map(data.get());
+  vector<uint64_t> addresses = MakeAddresses(functions, 1 << 20);
+
+  Measure(options, "static_range_map", addresses.size(), [&]() {
+    uint64_t sum = 0;
+    for (uint64_t address : addresses) {
+      const int* entry;
+      if (static_range_map.RetrieveRange(address, entry, NULL, NULL))
+        sum += *entry;
+    }
+    sink += sum;
+  });
+}
+
+// Finds random keys in a serialized StaticMap of the module's function
+// addresses.
+void BenchmarkStaticMap(const Options& options) {
+  vector<Function> functions = MakeFunctions(options.function_count);
+  std::map<uint64_t, int> std_map;
+  for (size_t i = 0; i < functions.size(); ++i)
+    std_map[functions[i].address] = i;
+  StdMapSerializer<uint64_t, int> serializer;
+  scoped_array<char> data(serializer.Serialize(std_map, NULL));
+  StaticMap<uint64_t, int> static_map(data.get());
+  Random random(5);
+  vector<uint64_t> keys;
+  for (int i = 0; i < 1 << 20; ++i)
+    keys.push_back(functions[random.Next(functions.size())].address);
+
+  Measure(options, "static_map", keys.size(), [&]() {
+    uint64_t sum = 0;
+    for (uint64_t key : keys) {
+      StaticMap<uint64_t, int>::iterator it = static_map.find(key);
+      if (it != static_map.end())
+        sum += *it.GetValuePtr();
+    }
+    sink += sum;
+  });
+}
+
+// Evaluates an x86 frame data program, as found in STACK WIN records.
+void BenchmarkPostfixEvaluator(const Options& options) {
+  const string program =
+      "$T0 $ebp = $eip $T0 4 + ^ = $ebp $T0 ^ = $esp $T0 8 + =";
+  FakeMemoryRegion memory;
+  PostfixEvaluator<uint32_t>::DictionaryType dictionary;
+  dictionary["$ebp"] = 0x1000;
+  dictionary["$esp"] = 0x0ff0;
+  dictionary["$eip"] = 0x2000;
+  PostfixEvaluator<uint32_t> evaluator(&dictionary, &memory);
+  const int kEvaluations = 1 << 16;
+
+  Measure(options, "postfix_evaluator", kEvaluations, [&]() {
+    for (int i = 0; i < kEvaluations; ++i) {
+      PostfixEvaluator<uint32_t>::DictionaryValidityType assigned;
+      evaluator.Evaluate(program, &assigned);
+    }
+    sink += dictionary["$eip"];
+  });
+}
+
+// The rules of a typical x86-64 function body, as in STACK CFI records.
+const char kCFIRules[] =
+    ".cfa: $rsp 16 + .ra: .cfa -8 + ^ $rbp: .cfa -16 + ^ "
+    "$rbx: .cfa -24 + ^";
+
+// Parses STACK CFI rules into a CFIFrameInfo, as each stack walk step does.
+void BenchmarkCFIParse(const Options& options) {
+  const string rules = kCFIRules;
+  const int kParses = 1 << 16;
+
+  Measure(options, "cfi_parse", kParses, [&]() {
+    for (int i = 0; i < kParses; ++i) {
+      CFIFrameInfo frame_info;
+      CFIFrameInfoParseHandler handler(&frame_info);
+      CFIRuleParser parser(&handler);
+      sink += parser.Parse(rules);
+    }
+  });
+}
+
+// Recovers the caller's registers from parsed STACK CFI rules.
+void BenchmarkCFIEvaluate(const Options& options) {
+  CFIFrameInfo frame_info;
+  CFIFrameInfoParseHandler handler(&frame_info);
+  CFIRuleParser parser(&handler);
+  parser.Parse(kCFIRules);
+  FakeMemoryRegion memory;
+  CFIFrameInfo::RegisterValueMap<uint64_t> registers;
+  registers["$rsp"] = 0x7fff0000;
+  registers["$rip"] = 0x401000;
+  registers["$rbp"] = 0x7fff0100;
+  registers["$rbx"] = 1;
+  const int kEvaluations = 1 << 16;
+
+  Measure(options, "cfi_evaluate", kEvaluations, [&]() {
+    for (int i = 0; i < kEvaluations; ++i) {
+      CFIFrameInfo::RegisterValueMap<uint64_t> caller_registers;
+      frame_info.FindCallerRegs(registers, memory, &caller_registers);
+      sink += caller_registers[".ra"];
+    }
+  });
+}
+
+// Loads a synthetic text symbol file into BasicSourceLineResolver.
+void BenchmarkSymbolLoad(const Options& options) {
+  vector<Function> functions = MakeFunctions(options.function_count);
+  string symbol_data = MakeSymbolFile(functions);
+  BasicCodeModule module(kModuleBase, ModuleSize(functions), "bench.exe",
+                         "", "", "", "");
+  std::unique_ptr<BasicSourceLineResolver> resolver;
+  vector<char> buffer;
+
+  Measure(options, "symbol_load", 1,
+      [&]() {
+        resolver.reset(new BasicSourceLineResolver);
+        buffer.assign(symbol_data.begin(), symbol_data.end());
+        buffer.push_back('\0');
+      },
+      [&]() {
+        sink += resolver->LoadModuleUsingMemoryBuffer(&module, buffer.data(),
+                                                      buffer.size());
+      });
+}
+
+// Looks up random addresses with BasicSourceLineResolver.
+void BenchmarkSymbolLookup(const Options& options) {
+  vector<Function> functions = MakeFunctions(options.function_count);
+  string symbol_data = MakeSymbolFile(functions);
+  BasicCodeModule module(kModuleBase, ModuleSize(functions), "bench.exe",
+                         "", "", "", "");
+  BasicSourceLineResolver resolver;
+  resolver.LoadModuleUsingMapBuffer(&module, symbol_data);
+  vector<uint64_t> addresses = MakeAddresses(functions, 1 << 18);
+
+  Measure(options, "symbol_lookup", addresses.size(), [&]() {
+    uint64_t sum = 0;
+    for (uint64_t address : addresses) {
+      StackFrame frame;
+      frame.instruction = kModuleBase + address;
+      frame.module = &module;
+      resolver.FillSourceLineInfo(&frame, nullptr);
+      sum += frame.source_line;
+    }
+    sink += sum;
+  });
+}
+
+// Processes a synthetic minidump with MinidumpProcessor, walking and
+// symbolizing every thread, and prints the results as a row for |name|.
+// Symbols stay loaded between runs, as they do in a long-running
+// processing service.
+void MeasureProcess(const Options& options, const char* name,
+                    bool frame_pointers) {
+  vector<Function> functions = MakeFunctions(options.function_count);
+  BenchmarkSymbolSupplier supplier(MakeSymbolFile(functions));
+  BasicSourceLineResolver resolver;
+  MinidumpProcessor processor(&supplier, &resolver);
+  string contents = MakeMinidump(options, functions, frame_pointers);
+  std::unique_ptr<std::istringstream> stream;
+  std::unique_ptr<Minidump> minidump;
+  std::unique_ptr<ProcessState> state;
+
+  // Load the symbols before measuring.
+  {
+    std::istringstream warm_stream(contents);
+    Minidump warm_minidump(warm_stream);
+    ProcessState warm_state;
+    if (!warm_minidump.Read() ||
+        processor.Process(&warm_minidump, &warm_state) !=
+        google_breakpad::PROCESS_OK) {
+      fprintf(stderr, "Could not process the synthetic minidump\n");
+      exit(1);
+    }
+  }
+
+  Measure(options, name, 1,
+      [&]() {
+        state.reset(new ProcessState);
+        minidump.reset();
+        stream.reset(new std::istringstream(contents));
+        minidump.reset(new Minidump(*stream));
+        minidump->Read();
+      },
+      [&]() {
+        sink += processor.Process(minidump.get(), state.get());
+      });
+
+  size_t frame_count = 0;
+  for (const google_breakpad::CallStack* stack : *state->threads())
+    frame_count += stack->frames()->size();
+  printf("%-20s %zu threads, %zu frames\n", "", state->threads()->size(),
+         frame_count);
+}
+
+void BenchmarkProcess(const Options& options) {
+  MeasureProcess(options, "process", true);
+}
+
+// As BenchmarkProcess, but the stacks have no frame pointers, and every
+// frame is found by stack scanning.
+void BenchmarkStackScan(const Options& options) {
+  MeasureProcess(options, "stack_scan", false);
+}
+
+// Serializes the ProcessState of a processed synthetic minidump with
+// ProcessStateSerializer.  Times are per frame.
+void BenchmarkSerialize(const Options& options) {
+  vector<Function> functions = MakeFunctions(options.function_count);
+  BenchmarkSymbolSupplier supplier(MakeSymbolFile(functions));
+  BasicSourceLineResolver resolver;
+  MinidumpProcessor processor(&supplier, &resolver);
+  std::istringstream stream(MakeMinidump(options, functions, true));
+  Minidump minidump(stream);
+  ProcessState state;
+  if (!minidump.Read() ||
+      processor.Process(&minidump, &state) != google_breakpad::PROCESS_OK) {
+    fprintf(stderr, "Could not process the synthetic minidump\n");
+    exit(1);
+  }
+
+  size_t frame_count = 0;
+  for (const google_breakpad::CallStack* stack : *state.threads())
+    frame_count += stack->frames()->size();
+  // Reuse the buffer, as a service writing one dump after another would.
+  string serialized;
+  Measure(options, "serialize", frame_count, [&]() {
+    serialized.clear();
+    ProcessStateSerializer::Serialize(state, &serialized);
+    sink += serialized.size();
+  });
+  printf("%-20s %zu threads, %zu frames, %zu bytes\n", "",
+         state.threads()->size(), frame_count, serialized.size());
+}
+
+struct Benchmark {
+  const char* name;
+  void (*function)(const Options& options);
+  const char* description;
+};
+
+const Benchmark kBenchmarks[] = {
+  { "range_map", BenchmarkRangeMap,
+    "RangeMap::RetrieveRange over the module's functions" },
+  { "static_range_map", BenchmarkStaticRangeMap,
+    "StaticRangeMap::RetrieveRange over the module's functions" },
+  { "static_map", BenchmarkStaticMap,
+    "StaticMap::find of function addresses" },
+  { "postfix_evaluator", BenchmarkPostfixEvaluator,
+    "PostfixEvaluator::Evaluate of an x86 frame data program" },
+  { "cfi_parse", BenchmarkCFIParse,
+    "CFIRuleParser::Parse of STACK CFI rules" },
+  { "cfi_evaluate", BenchmarkCFIEvaluate,
+    "CFIFrameInfo::FindCallerRegs" },
+  { "symbol_load", BenchmarkSymbolLoad,
+    "BasicSourceLineResolver loading the symbol file" },
+  { "symbol_lookup", BenchmarkSymbolLookup,
+    "BasicSourceLineResolver::FillSourceLineInfo" },
+  { "process", BenchmarkProcess,
+    "MinidumpProcessor::Process of a whole minidump" },
+  { "stack_scan", BenchmarkStackScan,
+    "MinidumpProcessor::Process of a minidump that needs stack scanning" },
+  { "serialize", BenchmarkSerialize,
+    "ProcessStateSerializer::Serialize of a processed minidump, per frame" },
+};
+
+void Usage(int argc, const char* argv[], bool error) {
+  fprintf(error ? stderr : stdout,
+          "Usage: %s [options] [<benchmark> ...]\n"
+          "\n"
+          "Runs microbenchmarks of the minidump processor on synthetic\n"
+          "inputs, all of them unless some are named.  Times are in\n"
+          "nanoseconds per operation.\n"
+          "\n"
+          "Options:\n"
+          "\n"
+          "  -l          List the benchmarks\n"
+          "  -r <n>      Runs per benchmark (default: 5)\n"
+          "  -f <n>      Functions in the synthetic module (default: 20000)\n"
+          "  -t <n>      Threads in the synthetic minidump (default: 100)\n"
+          "  -d <n>      Frames per thread (default: 32)\n",
+          google_breakpad::BaseName(argv[0]).c_str());
+}
+
+// Parses the argument of option |option| as a count of at least 1.
+int ParseCount(const char* argv0, char option, const char* value) {
+  int count = atoi(value);
+  if (count < 1) {
+    fprintf(stderr, "%s: Invalid count for -%c: %s\n", argv0, option, value);
+    exit(1);
+  }
+  return count;
+}
+
+void SetupOptions(int argc, const char* argv[], Options* options) {
+  int ch;
+
+  options->repeat_count = 5;
+  options->function_count = 20000;
+  options->thread_count = 100;
+  options->frame_count = 32;
+
+  while ((ch = getopt(argc, (char * const*)argv, "d:f:hlr:t:")) != -1) {
+    switch (ch) {
+      case 'h':
+        Usage(argc, argv, false);
+        exit(0);
+        break;
+
+      case 'l':
+        for (const Benchmark& benchmark : kBenchmarks)
+          printf("%-20s %s\n", benchmark.name, benchmark.description);
+        exit(0);
+        break;
+
+      case 'd':
+        options->frame_count = ParseCount(argv[0], ch, optarg);
+        break;
+
+      case 'f':
+        options->function_count = ParseCount(argv[0], ch, optarg);
+        break;
+
+      case 'r':
+        options->repeat_count = ParseCount(argv[0], ch, optarg);
+        break;
+
+      case 't':
+        options->thread_count = ParseCount(argv[0], ch, optarg);
+        break;
+
+      case '?':
+        Usage(argc, argv, true);
+        exit(1);
+        break;
+    }
+  }
+
+  for (int argi = optind; argi < argc; ++argi) {
+    bool known = false;
+    for (const Benchmark& benchmark : kBenchmarks)
+      known |= strcmp(argv[argi], benchmark.name) == 0;
+    if (!known) {
+      fprintf(stderr, "%s: Unknown benchmark %s\n", argv[0], argv[argi]);
+      Usage(argc, argv, true);
+      exit(1);
+    }
+    options->benchmarks.push_back(argv[argi]);
+  }
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+  BPLOG_INIT(&argc, &argv);
+  Options options;
+  SetupOptions(argc, argv, &options);
+
+  printf("%-20s %10s %12s %12s %12s %10s %12s\n",
+         "benchmark", "ops", "best (ns)", "median (ns)", "Mops/s",
+         "allocs/op", "bytes/op");
+  for (const Benchmark& benchmark : kBenchmarks) {
+    if (!options.benchmarks.empty() &&
+        std::find(options.benchmarks.begin(), options.benchmarks.end(),
+                  benchmark.name) == options.benchmarks.end()) {
+      continue;
+    }
+    benchmark.function(options);
+  }
+  return 0;
+}
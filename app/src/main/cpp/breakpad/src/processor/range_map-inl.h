@@ -38,6 +38,8 @@
 
 #include <assert.h>
 
+#include <iterator>
+
 #include "common/safe_math.h"
 #include "processor/range_map.h"
 #include "processor/linked_ptr.h"
@@ -215,6 +217,24 @@ bool RangeMap<AddressType, EntryType>::RetrieveRange(
 }
 
 
+template<typename AddressType, typename EntryType>
+const EntryType* RangeMap<AddressType, EntryType>::GetEntryForAddress(
+    const AddressType& address, AddressType* entry_base,
+    AddressType* entry_delta, AddressType* entry_size) const {
+  MapConstIterator iterator = map_.lower_bound(address);
+  if (iterator == map_.end() || address < iterator->second.base())
+    return NULL;
+
+  if (entry_base)
+    *entry_base = iterator->second.base();
+  if (entry_delta)
+    *entry_delta = iterator->second.delta();
+  if (entry_size)
+    *entry_size = iterator->first - iterator->second.base() + 1;
+  return &iterator->second.entry();
+}
+
+
 template<typename AddressType, typename EntryType>
 bool RangeMap<AddressType, EntryType>::RetrieveNearestRange(
     const AddressType& address, EntryType* entry, AddressType* entry_base,
@@ -248,6 +268,32 @@ bool RangeMap<AddressType, EntryType>::RetrieveNearestRange(
 }
 
 
+template<typename AddressType, typename EntryType>
+const EntryType* RangeMap<AddressType, EntryType>::GetNearestEntryForAddress(
+    const AddressType& address, AddressType* entry_base,
+    AddressType* entry_delta, AddressType* entry_size) const {
+  // If address is within a range, GetEntryForAddress can handle it.
+  const EntryType* entry =
+      GetEntryForAddress(address, entry_base, entry_delta, entry_size);
+  if (entry)
+    return entry;
+
+  // As in RetrieveNearestRange, find the last range below address.
+  MapConstIterator iterator = map_.upper_bound(address);
+  if (iterator == map_.begin())
+    return NULL;
+  --iterator;
+
+  if (entry_base)
+    *entry_base = iterator->second.base();
+  if (entry_delta)
+    *entry_delta = iterator->second.delta();
+  if (entry_size)
+    *entry_size = iterator->first - iterator->second.base() + 1;
+  return &iterator->second.entry();
+}
+
+
 template<typename AddressType, typename EntryType>
 bool RangeMap<AddressType, EntryType>::RetrieveRangeAtIndex(
     int64_t index, EntryType* entry, AddressType* entry_base,
@@ -278,6 +324,20 @@ bool RangeMap<AddressType, EntryType>::RetrieveRangeAtIndex(
 }
 
 
+template<typename AddressType, typename EntryType>
+const EntryType* RangeMap<AddressType, EntryType>::GetEntryAtIndex(
+    int64_t index) const {
+  if (index < 0 || index >= GetCount()) {
+    BPLOG(ERROR) << "Index out of range: " << index << "/" << GetCount();
+    return NULL;
+  }
+
+  MapConstIterator iterator = map_.begin();
+  std::advance(iterator, index);
+  return &iterator->second.entry();
+}
+
+
 template<typename AddressType, typename EntryType>
 int64_t RangeMap<AddressType, EntryType>::GetCount() const {
   return static_cast<int64_t>(map_.size());
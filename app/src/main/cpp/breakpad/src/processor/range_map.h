@@ -90,6 +90,16 @@ class RangeMap {
                      AddressType* entry_base, AddressType* entry_delta,
                      AddressType* entry_size) const;
 
+  // Returns the entry of the range encompassing the supplied address, or
+  // NULL if there is no such range.  Unlike RetrieveRange, this does not
+  // copy the entry, so it may be called from several threads at once even
+  // when copying EntryType modifies shared state, as linked_ptr does.
+  // entry_base, entry_delta, and entry_size are set as by RetrieveRange.
+  const EntryType* GetEntryForAddress(const AddressType& address,
+                                      AddressType* entry_base = NULL,
+                                      AddressType* entry_delta = NULL,
+                                      AddressType* entry_size = NULL) const;
+
   // Locates the range encompassing the supplied address, if one exists.
   // If no range encompasses the supplied address, locates the nearest range
   // to the supplied address that is lower than the address.  Returns false
@@ -101,6 +111,13 @@ class RangeMap {
                             AddressType* entry_base, AddressType* entry_delta,
                             AddressType* entry_size) const;
 
+  // Returns the entry that RetrieveNearestRange would, or NULL if it would
+  // return false.  The entry is not copied; see GetEntryForAddress.
+  const EntryType* GetNearestEntryForAddress(const AddressType& address,
+                                             AddressType* entry_base,
+                                             AddressType* entry_delta,
+                                             AddressType* entry_size) const;
+
   // Treating all ranges as a list ordered by the address spaces that they
   // occupy, locates the range at the index specified by index.  Returns
   // false if index is larger than the number of ranges stored.  entry_base,
@@ -114,6 +131,11 @@ class RangeMap {
                             AddressType* entry_base, AddressType* entry_delta,
                             AddressType* entry_size) const;
 
+  // Returns the entry of the range at |index|, as RetrieveRangeAtIndex
+  // does, or NULL if index is larger than the number of ranges stored.
+  // The entry is not copied; see GetEntryForAddress.
+  const EntryType* GetEntryAtIndex(int64_t index) const;
+
   // Returns the number of ranges stored in the RangeMap.
   int64_t GetCount() const;
 
@@ -139,7 +161,7 @@ class RangeMap {
 
     AddressType base() const { return base_; }
     AddressType delta() const { return delta_; }
-    EntryType entry() const { return entry_; }
+    const EntryType& entry() const { return entry_; }
 
    private:
     // The base address of the range.  The high address does not need to
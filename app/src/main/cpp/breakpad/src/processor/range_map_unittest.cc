@@ -193,6 +193,26 @@ static bool RetrieveTest(TestMap* range_map, const RangeTest* range_test) {
         return false;
       }
 
+      // GetEntryForAddress must find the same entry and bounds as
+      // RetrieveRange.
+      AddressType entry_base = AddressType();
+      AddressType entry_size = AddressType();
+      const linked_ptr<CountedObject>* entry =
+          range_map->GetEntryForAddress(address, &entry_base, NULL,
+                                        &entry_size);
+      if ((entry != NULL) != retrieved ||
+          (entry && (entry->get() != object.get() ||
+                     entry_base != retrieved_base ||
+                     entry_size != retrieved_size))) {
+        fprintf(stderr, "FAILED: "
+                        "GetEntryForAddress id %d, side %d, offset %d, "
+                        "does not match RetrieveRange\n",
+                        range_test->id,
+                        side,
+                        offset);
+        return false;
+      }
+
       // If a range was successfully retrieved, check that the returned
       // bounds match the range as stored.
       if (observed_result == true &&
@@ -234,6 +254,25 @@ static bool RetrieveTest(TestMap* range_map, const RangeTest* range_test) {
         expected_nearest = false;
       }
 
+      // GetNearestEntryForAddress must agree with RetrieveNearestRange.
+      AddressType nearest_entry_base = AddressType();
+      AddressType nearest_entry_size = AddressType();
+      const linked_ptr<CountedObject>* nearest_entry =
+          range_map->GetNearestEntryForAddress(address, &nearest_entry_base,
+                                               NULL, &nearest_entry_size);
+      if ((nearest_entry != NULL) != retrieved_nearest ||
+          (nearest_entry && (nearest_entry->get() != nearest_object.get() ||
+                             nearest_entry_base != nearest_base ||
+                             nearest_entry_size != nearest_size))) {
+        fprintf(stderr, "FAILED: "
+                        "GetNearestEntryForAddress id %d, side %d, offset %d, "
+                        "does not match RetrieveNearestRange\n",
+                        range_test->id,
+                        side,
+                        offset);
+        return false;
+      }
+
       bool observed_nearest = retrieved_nearest &&
                               nearest_object->id() == range_test->id;
 
@@ -370,6 +409,21 @@ static bool RetrieveAtIndexTest2() {
               object_index, expected_base, base);
       return false;
     }
+
+    const linked_ptr<CountedObject>* entry =
+        range_map->GetEntryAtIndex(object_index);
+    if (!entry || entry->get() != object.get()) {
+      fprintf(stderr, "FAILED: RetrieveAtIndexTest2 index %d, "
+              "GetEntryAtIndex does not match RetrieveRangeAtIndex\n",
+              object_index);
+      return false;
+    }
+  }
+
+  if (range_map->GetEntryAtIndex(object_count)) {
+    fprintf(stderr, "FAILED: GetEntryAtIndex index %d (too large), "
+            "expected failure, observed success\n", object_count);
+    return false;
   }
 
   return true;
@@ -39,18 +39,16 @@
 #include "processor/simple_symbol_supplier.h"
 
 #include <assert.h>
-#include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 
 #include <algorithm>
-#include <iostream>
-#include <fstream>
 
 #include "common/using_std_string.h"
 #include "google_breakpad/processor/code_module.h"
 #include "google_breakpad/processor/system_info.h"
 #include "processor/logging.h"
+#include "processor/mapped_symbol_file.h"
 #include "processor/pathname_stripper.h"
 
 namespace google_breakpad {
@@ -60,6 +58,12 @@ static bool file_exists(const string& file_name) {
   return stat(file_name.c_str(), &sb) == 0;
 }
 
+SimpleSymbolSupplier::~SimpleSymbolSupplier() {
+  map<string, MappedSymbolFile*>::iterator it = memory_buffers_.begin();
+  for (; it != memory_buffers_.end(); ++it)
+    delete it->second;
+}
+
 SymbolSupplier::SymbolResult SimpleSymbolSupplier::GetSymbolFile(
     const CodeModule* module, const SystemInfo* system_info,
     string* symbol_file) {
@@ -90,10 +94,9 @@ SymbolSupplier::SymbolResult SimpleSymbolSupplier::GetSymbolFile(
   SymbolSupplier::SymbolResult s = GetSymbolFile(module, system_info,
                                                  symbol_file);
   if (s == FOUND) {
-    std::ifstream in(symbol_file->c_str());
-    std::getline(in, *symbol_data, string::traits_type::to_char_type(
-                     string::traits_type::eof()));
-    in.close();
+    MappedSymbolFile mapped_file;
+    if (mapped_file.Map(*symbol_file))
+      symbol_data->assign(mapped_file.data(), mapped_file.size() - 1);
   }
   return s;
 }
@@ -107,21 +110,20 @@ SymbolSupplier::SymbolResult SimpleSymbolSupplier::GetCStringSymbolData(
   assert(symbol_data);
   assert(symbol_data_size);
 
-  string symbol_data_string;
   SymbolSupplier::SymbolResult s =
-      GetSymbolFile(module, system_info, symbol_file, &symbol_data_string);
+      GetSymbolFile(module, system_info, symbol_file);
 
   if (s == FOUND) {
-    *symbol_data_size = symbol_data_string.size() + 1;
-    *symbol_data = new char[*symbol_data_size];
-    if (*symbol_data == NULL) {
-      BPLOG(ERROR) << "Memory allocation for size " << *symbol_data_size
-                   << " failed";
+    // The mapping is already null-terminated, and resolvers that keep the
+    // buffer use the file's pages directly instead of a heap copy.
+    MappedSymbolFile* mapped_file = new MappedSymbolFile();
+    if (!mapped_file->Map(*symbol_file)) {
+      delete mapped_file;
       return INTERRUPT;
     }
-    memcpy(*symbol_data, symbol_data_string.c_str(), symbol_data_string.size());
-    (*symbol_data)[symbol_data_string.size()] = '\0';
-    memory_buffers_.insert(make_pair(module->code_file(), *symbol_data));
+    *symbol_data = mapped_file->data();
+    *symbol_data_size = mapped_file->size();
+    memory_buffers_.insert(make_pair(module->code_file(), mapped_file));
   }
   return s;
 }
@@ -132,13 +134,14 @@ void SimpleSymbolSupplier::FreeSymbolData(const CodeModule* module) {
     return;
   }
 
-  map<string, char*>::iterator it = memory_buffers_.find(module->code_file());
+  map<string, MappedSymbolFile*>::iterator it =
+      memory_buffers_.find(module->code_file());
   if (it == memory_buffers_.end()) {
     BPLOG(INFO) << "Cannot find symbol data buffer for module "
                 << module->code_file();
     return;
   }
-  delete [] it->second;
+  delete it->second;
   memory_buffers_.erase(it);
 }
 
@@ -88,6 +88,7 @@ using std::map;
 using std::vector;
 
 class CodeModule;
+class MappedSymbolFile;
 
 class SimpleSymbolSupplier : public SymbolSupplier {
  public:
@@ -99,7 +100,7 @@ class SimpleSymbolSupplier : public SymbolSupplier {
   // paths where symbols may be stored.
   explicit SimpleSymbolSupplier(const vector<string>& paths) : paths_(paths) {}
 
-  virtual ~SimpleSymbolSupplier() {}
+  virtual ~SimpleSymbolSupplier();
 
   // Returns the path to the symbol file for the given module.  See the
   // description above.
@@ -112,8 +113,9 @@ class SimpleSymbolSupplier : public SymbolSupplier {
                                      string* symbol_file,
                                      string* symbol_data);
 
-  // Allocates data buffer on heap and writes symbol data into buffer.
-  // Symbol supplier ALWAYS takes ownership of the data buffer.
+  // Maps the symbol file into memory, copy-on-write, and returns the mapping
+  // as the data buffer.  Symbol supplier ALWAYS takes ownership of the data
+  // buffer.
   virtual SymbolResult GetCStringSymbolData(const CodeModule* module,
                                             const SystemInfo* system_info,
                                             string* symbol_file,
@@ -130,7 +132,7 @@ class SimpleSymbolSupplier : public SymbolSupplier {
                                            string* symbol_file);
 
  private:
-  map<string, char*> memory_buffers_;
+  map<string, MappedSymbolFile*> memory_buffers_;
   vector<string> paths_;
 };
 
@@ -43,13 +43,16 @@
 
 #include <map>
 #include <utility>
+#include <vector>
 
 #include "google_breakpad/processor/source_line_resolver_base.h"
 #include "processor/logging.h"
+#include "processor/mapped_symbol_file.h"
 #include "processor/module_factory.h"
 #include "processor/source_line_resolver_base_types.h"
 
 using std::make_pair;
+using std::vector;
 
 namespace google_breakpad {
 
@@ -58,6 +61,7 @@ SourceLineResolverBase::SourceLineResolverBase(
   : modules_(new ModuleMap),
     corrupt_modules_(new ModuleSet),
     memory_buffers_(new MemoryMap),
+    mapped_files_(new MappedFileMap),
     module_factory_(module_factory) {
 }
 
@@ -84,6 +88,14 @@ SourceLineResolverBase::~SourceLineResolverBase() {
   delete memory_buffers_;
   memory_buffers_ = NULL;
 
+  MappedFileMap::iterator mapped_iter = mapped_files_->begin();
+  for (; mapped_iter != mapped_files_->end(); ++mapped_iter) {
+    delete mapped_iter->second;
+  }
+  // Delete the map of mapped symbol files.
+  delete mapped_files_;
+  mapped_files_ = NULL;
+
   delete module_factory_;
   module_factory_ = NULL;
 }
@@ -166,23 +178,26 @@ bool SourceLineResolverBase::LoadModule(const CodeModule* module,
   BPLOG(INFO) << "Loading symbols for module " << module->code_file()
               << " from " << map_file;
 
-  char* memory_buffer;
-  size_t memory_buffer_size;
-  if (!ReadSymbolFile(map_file, &memory_buffer, &memory_buffer_size))
+  // Map the file rather than reading it, so that resolvers which use the
+  // buffer in place don't need a private copy of it.
+  MappedSymbolFile* mapped_file = new MappedSymbolFile();
+  if (!mapped_file->Map(map_file)) {
+    delete mapped_file;
     return false;
+  }
 
-  BPLOG(INFO) << "Read symbol file " << map_file << " succeeded. "
+  BPLOG(INFO) << "Map symbol file " << map_file << " succeeded. "
               << "module = " << module->code_file()
-              << ", memory_buffer_size = " << memory_buffer_size;
+              << ", memory_buffer_size = " << mapped_file->size();
 
-  bool load_result = LoadModuleUsingMemoryBuffer(module, memory_buffer,
-                                                 memory_buffer_size);
+  bool load_result = LoadModuleUsingMemoryBuffer(module, mapped_file->data(),
+                                                 mapped_file->size());
 
   if (load_result && !ShouldDeleteMemoryBufferAfterLoadModule()) {
-    // memory_buffer has to stay alive as long as the module.
-    memory_buffers_->insert(make_pair(module->code_file(), memory_buffer));
+    // The mapping has to stay alive as long as the module.
+    mapped_files_->insert(make_pair(module->code_file(), mapped_file));
   } else {
-    delete [] memory_buffer;
+    delete mapped_file;
   }
 
   return load_result;
@@ -287,6 +302,12 @@ void SourceLineResolverBase::UnloadModule(const CodeModule* code_module) {
       delete [] iter->second;
       memory_buffers_->erase(iter);
     }
+    MappedFileMap::iterator mapped_iter =
+        mapped_files_->find(code_module->code_file());
+    if (mapped_iter != mapped_files_->end()) {
+      delete mapped_iter->second;
+      mapped_files_->erase(mapped_iter);
+    }
   }
 }
 
@@ -313,6 +334,35 @@ void SourceLineResolverBase::FillSourceLineInfo(
   }
 }
 
+void SourceLineResolverBase::FillSourceLineInfos(
+    const vector<ModuleOffset>& addresses, vector<StackFrame>* frames) {
+  frames->clear();
+  frames->resize(addresses.size());
+  for (size_t i = 0; i < addresses.size(); ++i) {
+    StackFrame* frame = &(*frames)[i];
+    frame->module = addresses[i].first;
+    frame->instruction = addresses[i].second;
+    if (frame->module)
+      frame->instruction += frame->module->base_address();
+  }
+
+  // Hand each run of addresses in the same module to that module at once.
+  size_t begin = 0;
+  while (begin < addresses.size()) {
+    const CodeModule* code_module = addresses[begin].first;
+    size_t end = begin + 1;
+    while (end < addresses.size() && addresses[end].first == code_module)
+      ++end;
+
+    if (code_module) {
+      ModuleMap::const_iterator it = modules_->find(code_module->code_file());
+      if (it != modules_->end())
+        it->second->LookupAddresses(&(*frames)[begin], end - begin);
+    }
+    begin = end;
+  }
+}
+
 WindowsFrameInfo* SourceLineResolverBase::FindWindowsFrameInfo(
     const StackFrame* frame) {
   if (frame->module) {
@@ -340,6 +390,12 @@ bool SourceLineResolverBase::CompareString::operator()(
   return strcmp(s1.c_str(), s2.c_str()) < 0;
 }
 
+void SourceLineResolverBase::Module::LookupAddresses(StackFrame* frames,
+                                                     size_t count) const {
+  for (size_t i = 0; i < count; ++i)
+    LookupAddress(&frames[i], NULL);
+}
+
 bool SourceLineResolverBase::Module::ParseCFIRuleSet(
     const string& rule_set, CFIFrameInfo* frame_info) const {
   CFIFrameInfoParseHandler handler(frame_info);
@@ -186,6 +186,11 @@ class SourceLineResolverBase::Module {
       StackFrame* frame,
       std::deque<std::unique_ptr<StackFrame>>* inlined_frames) const = 0;
 
+  // Looks up |count| frames in this module, as LookupAddress would without
+  // inlined frames.  Modules may resolve frames sorted by instruction
+  // address faster than one at a time; this default does not.
+  virtual void LookupAddresses(StackFrame* frames, size_t count) const;
+
   // If Windows stack walking information is available covering ADDRESS,
   // return a WindowsFrameInfo structure describing it. If the information
   // is not available, returns NULL. A NULL return value does not indicate
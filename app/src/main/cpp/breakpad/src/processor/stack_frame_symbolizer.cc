@@ -39,6 +39,8 @@
 
 #include <assert.h>
 
+#include <utility>
+
 #include "common/scoped_ptr.h"
 #include "google_breakpad/processor/code_module.h"
 #include "google_breakpad/processor/code_modules.h"
@@ -46,6 +48,7 @@
 #include "google_breakpad/processor/stack_frame.h"
 #include "google_breakpad/processor/symbol_supplier.h"
 #include "google_breakpad/processor/system_info.h"
+#include "processor/basic_code_module.h"
 #include "processor/linked_ptr.h"
 #include "processor/logging.h"
 
@@ -54,7 +57,75 @@ namespace google_breakpad {
 StackFrameSymbolizer::StackFrameSymbolizer(
     SymbolSupplier* supplier,
     SourceLineResolverInterface* resolver) : supplier_(supplier),
-                                             resolver_(resolver) { }
+                                             resolver_(resolver),
+                                             module_cache_budget_(0),
+                                             loaded_bytes_(0),
+                                             dump_generation_(0),
+                                             use_clock_(0),
+                                             hits_(0),
+                                             misses_(0),
+                                             evictions_(0) { }
+
+void StackFrameSymbolizer::Reset() {
+  std::unique_lock<std::shared_mutex> lock(lock_);
+  no_symbol_modules_.clear();
+  // Unpin the modules used by the previous minidump.
+  ++dump_generation_;
+  EvictModules();
+}
+
+void StackFrameSymbolizer::set_module_cache_budget(uint64_t bytes) {
+  std::unique_lock<std::shared_mutex> lock(lock_);
+  module_cache_budget_ = bytes;
+  EvictModules();
+}
+
+StackFrameSymbolizer::ModuleCacheStats
+StackFrameSymbolizer::module_cache_stats() {
+  std::shared_lock<std::shared_mutex> lock(lock_);
+  ModuleCacheStats stats;
+  stats.hits = hits_;
+  stats.misses = misses_;
+  stats.evictions = evictions_;
+  stats.loaded_bytes = loaded_bytes_;
+  return stats;
+}
+
+void StackFrameSymbolizer::TouchModule(const string& code_file) {
+  auto it = cached_modules_.find(code_file);
+  if (it == cached_modules_.end())
+    return;
+  it->second->last_use.store(++use_clock_, std::memory_order_relaxed);
+  it->second->dump_generation.store(dump_generation_,
+                                    std::memory_order_relaxed);
+}
+
+void StackFrameSymbolizer::EvictModules() {
+  while (module_cache_budget_ && loaded_bytes_ > module_cache_budget_) {
+    auto victim = cached_modules_.end();
+    for (auto it = cached_modules_.begin(); it != cached_modules_.end();
+         ++it) {
+      if (it->second->dump_generation == dump_generation_)
+        continue;
+      if (victim == cached_modules_.end() ||
+          it->second->last_use < victim->second->last_use) {
+        victim = it;
+      }
+    }
+    if (victim == cached_modules_.end())
+      return;  // Everything left is pinned.
+
+    const CodeModule* module = victim->second->module.get();
+    BPLOG(INFO) << "Unloading symbols for " << module->code_file();
+    resolver_->UnloadModule(module);
+    // Resolvers that keep using the supplier's buffer never had it freed.
+    if (!resolver_->ShouldDeleteMemoryBufferAfterLoadModule())
+      supplier_->FreeSymbolData(module);
+    loaded_bytes_ -= victim->second->size;
+    ++evictions_;
+    cached_modules_.erase(victim);
+  }
+}
 
 StackFrameSymbolizer::SymbolizerResult StackFrameSymbolizer::FillSourceLineInfo(
     const CodeModules* modules,
@@ -76,14 +147,37 @@ StackFrameSymbolizer::SymbolizerResult StackFrameSymbolizer::FillSourceLineInfo(
   frame->module = module;
 
   if (!resolver_) return kError;  // no resolver.
-  // If module is known to have missing symbol file, return.
+
+  {
+    std::shared_lock<std::shared_mutex> lock(lock_);
+    // If module is known to have missing symbol file, return.
+    if (no_symbol_modules_.find(module->code_file()) !=
+        no_symbol_modules_.end()) {
+      return kError;
+    }
+
+    // If module is already loaded, go ahead to fill source line info and
+    // return.
+    if (resolver_->HasModule(frame->module)) {
+      ++hits_;
+      TouchModule(module->code_file());
+      resolver_->FillSourceLineInfo(frame, inlined_frames);
+      return resolver_->IsModuleCorrupt(frame->module) ?
+          kWarningCorruptSymbols : kNoError;
+    }
+  }
+
+  // Loading the module modifies the resolver, so it needs exclusive access.
+  // Another thread may have dealt with the module while the lock was
+  // released, so check again.
+  std::unique_lock<std::shared_mutex> lock(lock_);
   if (no_symbol_modules_.find(module->code_file()) !=
       no_symbol_modules_.end()) {
     return kError;
   }
-
-  // If module is already loaded, go ahead to fill source line info and return.
   if (resolver_->HasModule(frame->module)) {
+    ++hits_;
+    TouchModule(module->code_file());
     resolver_->FillSourceLineInfo(frame, inlined_frames);
     return resolver_->IsModuleCorrupt(frame->module) ?
         kWarningCorruptSymbols : kNoError;
@@ -112,6 +206,21 @@ StackFrameSymbolizer::SymbolizerResult StackFrameSymbolizer::FillSourceLineInfo(
       }
 
       if (load_success) {
+        ++misses_;
+        std::unique_ptr<CachedModule> cached(new CachedModule);
+        cached->module.reset(new BasicCodeModule(module));
+        cached->size = symbol_data_size;
+        cached->last_use = ++use_clock_;
+        cached->dump_generation = dump_generation_;
+        std::unique_ptr<CachedModule>& slot =
+            cached_modules_[module->code_file()];
+        // The caller may have unloaded the module behind our back.
+        if (slot)
+          loaded_bytes_ -= slot->size;
+        slot = std::move(cached);
+        loaded_bytes_ += symbol_data_size;
+        EvictModules();
+
         resolver_->FillSourceLineInfo(frame, inlined_frames);
         return resolver_->IsModuleCorrupt(frame->module) ?
             kWarningCorruptSymbols : kNoError;
@@ -138,11 +247,13 @@ StackFrameSymbolizer::SymbolizerResult StackFrameSymbolizer::FillSourceLineInfo(
 
 WindowsFrameInfo* StackFrameSymbolizer::FindWindowsFrameInfo(
     const StackFrame* frame) {
+  std::shared_lock<std::shared_mutex> lock(lock_);
   return resolver_ ? resolver_->FindWindowsFrameInfo(frame) : NULL;
 }
 
 CFIFrameInfo* StackFrameSymbolizer::FindCFIFrameInfo(
     const StackFrame* frame) {
+  std::shared_lock<std::shared_mutex> lock(lock_);
   return resolver_ ? resolver_->FindCFIFrameInfo(frame) : NULL;
 }
 
@@ -0,0 +1,229 @@
+// Copyright 2024 Google LLC
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google LLC nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// stack_frame_symbolizer_unittest.cc: Unit tests for the module cache in
+// StackFrameSymbolizer.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>  // Must come first
+#endif
+
+#include <string.h>
+
+#include <map>
+#include <string>
+
+#include "breakpad_googletest_includes.h"
+#include "common/using_std_string.h"
+#include "google_breakpad/processor/basic_source_line_resolver.h"
+#include "google_breakpad/processor/fast_source_line_resolver.h"
+#include "google_breakpad/processor/stack_frame.h"
+#include "google_breakpad/processor/stack_frame_symbolizer.h"
+#include "processor/module_serializer.h"
+#include "processor/stackwalker_unittest_utils.h"
+
+namespace {
+
+using google_breakpad::BasicSourceLineResolver;
+using google_breakpad::CodeModule;
+using google_breakpad::FastSourceLineResolver;
+using google_breakpad::ModuleSerializer;
+using google_breakpad::SourceLineResolverInterface;
+using google_breakpad::StackFrame;
+using google_breakpad::StackFrameSymbolizer;
+using google_breakpad::SymbolSupplier;
+using google_breakpad::SystemInfo;
+
+// Supplies a one-function symbol file for every module, either as text or
+// serialized for FastSourceLineResolver, and tracks which buffers are live.
+class FakeSymbolSupplier : public SymbolSupplier {
+ public:
+  explicit FakeSymbolSupplier(bool serialize) : serialize_(serialize) {}
+  ~FakeSymbolSupplier() {
+    for (auto& buffer : buffers_)
+      delete [] buffer.second;
+  }
+
+  SymbolResult GetSymbolFile(const CodeModule* module,
+                             const SystemInfo* system_info,
+                             string* symbol_file) {
+    return NOT_FOUND;
+  }
+  SymbolResult GetSymbolFile(const CodeModule* module,
+                             const SystemInfo* system_info,
+                             string* symbol_file,
+                             string* symbol_data) {
+    return NOT_FOUND;
+  }
+  SymbolResult GetCStringSymbolData(const CodeModule* module,
+                                    const SystemInfo* system_info,
+                                    string* symbol_file,
+                                    char** symbol_data,
+                                    size_t* symbol_data_size) {
+    string text = "MODULE Linux x86 0 " + module->code_file() + "\n"
+                  "FUNC 0 100 0 " + module->code_file() + "_function\n";
+    if (serialize_) {
+      ModuleSerializer serializer;
+      *symbol_data = serializer.SerializeSymbolFileData(text,
+                                                        symbol_data_size);
+    } else {
+      *symbol_data_size = text.size() + 1;
+      *symbol_data = new char[*symbol_data_size];
+      memcpy(*symbol_data, text.c_str(), text.size() + 1);
+    }
+    FreeSymbolData(module);
+    buffers_[module->code_file()] = *symbol_data;
+    return FOUND;
+  }
+  void FreeSymbolData(const CodeModule* module) {
+    auto it = buffers_.find(module->code_file());
+    if (it != buffers_.end()) {
+      delete [] it->second;
+      buffers_.erase(it);
+    }
+  }
+
+  bool HasBuffer(const string& code_file) const {
+    return buffers_.count(code_file) != 0;
+  }
+
+ private:
+  bool serialize_;
+  std::map<string, char*> buffers_;
+};
+
+class ModuleCacheTest : public ::testing::Test {
+ public:
+  ModuleCacheTest()
+      : module_a_(0x1000, 0x1000, "a", ""),
+        module_b_(0x2000, 0x1000, "b", ""),
+        module_c_(0x3000, 0x1000, "c", "") {
+    modules_.Add(&module_a_);
+    modules_.Add(&module_b_);
+    modules_.Add(&module_c_);
+  }
+
+  // Symbolizes an address in |module| and checks the function name.
+  void Symbolize(StackFrameSymbolizer* symbolizer, const CodeModule* module) {
+    StackFrame frame;
+    frame.instruction = module->base_address() + 0x10;
+    EXPECT_EQ(StackFrameSymbolizer::kNoError,
+              symbolizer->FillSourceLineInfo(&modules_, NULL, NULL, &frame,
+                                             NULL));
+    EXPECT_EQ(module->code_file() + "_function", frame.function_name);
+  }
+
+  // The size of the symbol data for a single module.
+  uint64_t ModuleSize(StackFrameSymbolizer* symbolizer) {
+    return symbolizer->module_cache_stats().loaded_bytes;
+  }
+
+  MockCodeModule module_a_;
+  MockCodeModule module_b_;
+  MockCodeModule module_c_;
+  MockCodeModules modules_;
+};
+
+TEST_F(ModuleCacheTest, UnlimitedByDefault) {
+  FakeSymbolSupplier supplier(false);
+  BasicSourceLineResolver resolver;
+  StackFrameSymbolizer symbolizer(&supplier, &resolver);
+
+  for (int dump = 0; dump < 3; ++dump) {
+    symbolizer.Reset();
+    Symbolize(&symbolizer, &module_a_);
+    Symbolize(&symbolizer, &module_b_);
+    Symbolize(&symbolizer, &module_c_);
+  }
+
+  StackFrameSymbolizer::ModuleCacheStats stats =
+      symbolizer.module_cache_stats();
+  EXPECT_EQ(3U, stats.misses);
+  EXPECT_EQ(6U, stats.hits);
+  EXPECT_EQ(0U, stats.evictions);
+}
+
+TEST_F(ModuleCacheTest, EvictsLeastRecentlyUsedBetweenDumps) {
+  FakeSymbolSupplier supplier(false);
+  BasicSourceLineResolver resolver;
+  StackFrameSymbolizer symbolizer(&supplier, &resolver);
+
+  symbolizer.Reset();
+  Symbolize(&symbolizer, &module_a_);
+  const uint64_t module_size = ModuleSize(&symbolizer);
+  symbolizer.set_module_cache_budget(2 * module_size);
+  Symbolize(&symbolizer, &module_b_);
+  Symbolize(&symbolizer, &module_c_);
+
+  // All three modules were used by this dump, so none can be unloaded.
+  StackFrameSymbolizer::ModuleCacheStats stats =
+      symbolizer.module_cache_stats();
+  EXPECT_EQ(3 * module_size, stats.loaded_bytes);
+  EXPECT_EQ(0U, stats.evictions);
+
+  // Starting the next dump unpins them, and the oldest is unloaded.
+  symbolizer.Reset();
+  stats = symbolizer.module_cache_stats();
+  EXPECT_EQ(2 * module_size, stats.loaded_bytes);
+  EXPECT_EQ(1U, stats.evictions);
+  EXPECT_FALSE(resolver.HasModule(&module_a_));
+  EXPECT_TRUE(resolver.HasModule(&module_b_));
+  EXPECT_TRUE(resolver.HasModule(&module_c_));
+
+  // Using c makes b the least recently used, so loading a again evicts b.
+  Symbolize(&symbolizer, &module_c_);
+  Symbolize(&symbolizer, &module_a_);
+  stats = symbolizer.module_cache_stats();
+  EXPECT_EQ(2 * module_size, stats.loaded_bytes);
+  EXPECT_EQ(2U, stats.evictions);
+  EXPECT_EQ(4U, stats.misses);
+  EXPECT_EQ(1U, stats.hits);
+  EXPECT_TRUE(resolver.HasModule(&module_a_));
+  EXPECT_FALSE(resolver.HasModule(&module_b_));
+  EXPECT_TRUE(resolver.HasModule(&module_c_));
+}
+
+TEST_F(ModuleCacheTest, FreesRetainedBuffersOnEviction) {
+  FakeSymbolSupplier supplier(true);
+  FastSourceLineResolver resolver;
+  StackFrameSymbolizer symbolizer(&supplier, &resolver);
+
+  symbolizer.Reset();
+  Symbolize(&symbolizer, &module_a_);
+  symbolizer.set_module_cache_budget(ModuleSize(&symbolizer));
+  EXPECT_TRUE(supplier.HasBuffer("a"));
+
+  symbolizer.Reset();
+  Symbolize(&symbolizer, &module_b_);
+  EXPECT_EQ(1U, symbolizer.module_cache_stats().evictions);
+  EXPECT_FALSE(resolver.HasModule(&module_a_));
+  EXPECT_FALSE(supplier.HasBuffer("a"));
+  EXPECT_TRUE(supplier.HasBuffer("b"));
+}
+
+}  // namespace
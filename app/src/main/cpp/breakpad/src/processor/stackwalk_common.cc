@@ -41,7 +41,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <algorithm>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "common/stdio_wrapper.h"
@@ -52,6 +54,7 @@
 #include "google_breakpad/processor/process_state.h"
 #include "google_breakpad/processor/source_line_resolver_interface.h"
 #include "google_breakpad/processor/stack_frame_cpu.h"
+#include "google_breakpad/processor/system_info.h"
 #include "processor/logging.h"
 #include "processor/pathname_stripper.h"
 
@@ -100,20 +103,114 @@ static int PrintRegister64(const char* name, uint64_t value, int start_col) {
   return start_col + strlen(buffer);
 }
 
-// StripSeparator takes a string |original| and returns a copy
-// of the string with all occurences of |kOutputSeparator| removed.
-static string StripSeparator(const string& original) {
-  string result = original;
-  string::size_type position = 0;
-  while ((position = result.find(kOutputSeparator, position)) != string::npos) {
-    result.erase(position, 1);
+// FileNameStart returns the offset of the file name in |path|, the part
+// that PathnameStripper::File would return.
+static string::size_type FileNameStart(const string& path) {
+  string::size_type separator = path.find_last_of("/\\");
+  return separator == string::npos ? 0 : separator + 1;
+}
+
+// OutputBuffer collects the machine-readable or JSON output for a dump so
+// that it can be written to stdout with a single call, instead of through
+// a printf and a temporary string for every field.
+class OutputBuffer {
+ public:
+  OutputBuffer() { buffer_.reserve(4096); }
+
+  void Append(char c) { buffer_.push_back(c); }
+  void Append(const char* str) { buffer_.append(str); }
+
+  // Appends |str| from |start|, leaving out |kOutputSeparator| and
+  // newlines so that it can be used as a pipe-delimited field.
+  void AppendField(const string& str, string::size_type start = 0) {
+    static const char kStripped[] = { kOutputSeparator, '\n', '\0' };
+    string::size_type end;
+    while ((end = str.find_first_of(kStripped, start)) != string::npos) {
+      buffer_.append(str, start, end - start);
+      start = end + 1;
+    }
+    if (start < str.size())
+      buffer_.append(str, start, string::npos);
+  }
+
+  // Appends |str| from |start| as a quoted JSON string.
+  void AppendJSONString(const string& str, string::size_type start = 0) {
+    buffer_.push_back('"');
+    for (string::size_type i = start; i < str.size(); ++i) {
+      unsigned char c = str[i];
+      if (c == '"' || c == '\\') {
+        buffer_.push_back('\\');
+        buffer_.push_back(c);
+      } else if (c < 0x20) {
+        static const char kHexDigits[] = "0123456789abcdef";
+        buffer_.append("\\u00");
+        buffer_.push_back(kHexDigits[c >> 4]);
+        buffer_.push_back(kHexDigits[c & 0xf]);
+      } else {
+        buffer_.push_back(c);
+      }
+    }
+    buffer_.push_back('"');
   }
-  position = 0;
-  while ((position = result.find('\n', position)) != string::npos) {
-    result.erase(position, 1);
+
+  // Appends |name| as a JSON object key, preceded by a comma unless it is
+  // the object's first member.
+  void AppendJSONKey(const char* name, bool first = false) {
+    if (!first)
+      buffer_.push_back(',');
+    buffer_.push_back('"');
+    buffer_.append(name);
+    buffer_.append("\":");
   }
-  return result;
-}
+
+  void AppendInt(int64_t value) {
+    char digits[24];
+    char* end = digits + sizeof(digits);
+    char* start = end;
+    uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : value;
+    do {
+      *--start = '0' + magnitude % 10;
+      magnitude /= 10;
+    } while (magnitude);
+    if (value < 0)
+      *--start = '-';
+    buffer_.append(start, end);
+  }
+
+  // Appends |value| in hexadecimal with a "0x" prefix and at least
+  // |min_digits| digits, like printf's "0x%0*" PRIx64.
+  void AppendHex(uint64_t value, int min_digits = 1) {
+    static const char kHexDigits[] = "0123456789abcdef";
+    char digits[16];
+    int count = 0;
+    do {
+      digits[count++] = kHexDigits[value & 0xf];
+      value >>= 4;
+    } while (value);
+    buffer_.append("0x");
+    for (; min_digits > count; --min_digits)
+      buffer_.push_back('0');
+    while (count)
+      buffer_.push_back(digits[--count]);
+  }
+
+  // Appends |value| as a JSON string holding it in hexadecimal, since
+  // JSON numbers can't represent every 64-bit address.
+  void AppendJSONHex(uint64_t value) {
+    buffer_.push_back('"');
+    AppendHex(value);
+    buffer_.push_back('"');
+  }
+
+  // Writes the collected output to stdout.
+  void Flush() {
+    fwrite(buffer_.data(), 1, buffer_.size(), stdout);
+    buffer_.clear();
+  }
+
+ private:
+  string buffer_;
+};
 
 // PrintStackContents prints the stack contents of the current frame to stdout.
 static void PrintStackContents(const string& indent,
@@ -955,58 +1052,140 @@ static void PrintStack(const CallStack* stack,
 // Module, function, source file, and source line may all be empty
 // depending on availability.  The code offset follows the same rules as
 // PrintStack above.
-static void PrintStackMachineReadable(int thread_num, const CallStack* stack) {
+static void PrintStackMachineReadable(int thread_num, const CallStack* stack,
+                                      OutputBuffer* out) {
   int frame_count = stack->frames()->size();
   for (int frame_index = 0; frame_index < frame_count; ++frame_index) {
     const StackFrame* frame = stack->frames()->at(frame_index);
-    printf("%d%c%d%c", thread_num, kOutputSeparator, frame_index,
-           kOutputSeparator);
+    out->AppendInt(thread_num);
+    out->Append(kOutputSeparator);
+    out->AppendInt(frame_index);
+    out->Append(kOutputSeparator);
 
     uint64_t instruction_address = frame->ReturnAddress();
 
     if (frame->module) {
-      assert(!frame->module->code_file().empty());
-      printf("%s", StripSeparator(PathnameStripper::File(
-                     frame->module->code_file())).c_str());
+      const string& code_file = frame->module->code_file();
+      assert(!code_file.empty());
+      out->AppendField(code_file, FileNameStart(code_file));
+      out->Append(kOutputSeparator);
       if (!frame->function_name.empty()) {
-        printf("%c%s", kOutputSeparator,
-               StripSeparator(frame->function_name).c_str());
+        out->AppendField(frame->function_name);
+        out->Append(kOutputSeparator);
         if (!frame->source_file_name.empty()) {
-          printf("%c%s%c%d%c0x%" PRIx64,
-                 kOutputSeparator,
-                 StripSeparator(frame->source_file_name).c_str(),
-                 kOutputSeparator,
-                 frame->source_line,
-                 kOutputSeparator,
-                 instruction_address - frame->source_line_base);
+          out->AppendField(frame->source_file_name);
+          out->Append(kOutputSeparator);
+          out->AppendInt(frame->source_line);
+          out->Append(kOutputSeparator);
+          out->AppendHex(instruction_address - frame->source_line_base);
         } else {
-          printf("%c%c%c0x%" PRIx64,
-                 kOutputSeparator,  // empty source file
-                 kOutputSeparator,  // empty source line
-                 kOutputSeparator,
-                 instruction_address - frame->function_base);
+          // empty source file and source line
+          out->Append(kOutputSeparator);
+          out->Append(kOutputSeparator);
+          out->AppendHex(instruction_address - frame->function_base);
         }
       } else {
-        printf("%c%c%c%c0x%" PRIx64,
-               kOutputSeparator,  // empty function name
-               kOutputSeparator,  // empty source file
-               kOutputSeparator,  // empty source line
-               kOutputSeparator,
-               instruction_address - frame->module->base_address());
+        // empty function name, source file and source line
+        out->Append(kOutputSeparator);
+        out->Append(kOutputSeparator);
+        out->Append(kOutputSeparator);
+        out->AppendHex(instruction_address - frame->module->base_address());
       }
     } else {
-      // the printf before this prints a trailing separator for module name
-      printf("%c%c%c%c0x%" PRIx64,
-             kOutputSeparator,  // empty function name
-             kOutputSeparator,  // empty source file
-             kOutputSeparator,  // empty source line
-             kOutputSeparator,
-             instruction_address);
+      // empty module name, function name, source file and source line
+      out->Append(kOutputSeparator);
+      out->Append(kOutputSeparator);
+      out->Append(kOutputSeparator);
+      out->Append(kOutputSeparator);
+      out->AppendHex(instruction_address);
     }
-    printf("\n");
+    out->Append('\n');
   }
 }
 
+// FrameTrustName returns the name of |trust| used in JSON output.
+static const char* FrameTrustName(StackFrame::FrameTrust trust) {
+  switch (trust) {
+    case StackFrame::FRAME_TRUST_SCAN:
+      return "scan";
+    case StackFrame::FRAME_TRUST_CFI_SCAN:
+      return "cfi_scan";
+    case StackFrame::FRAME_TRUST_FP:
+      return "frame_pointer";
+    case StackFrame::FRAME_TRUST_CFI:
+      return "cfi";
+    case StackFrame::FRAME_TRUST_PREWALKED:
+      return "prewalked";
+    case StackFrame::FRAME_TRUST_CONTEXT:
+      return "context";
+    case StackFrame::FRAME_TRUST_INLINE:
+      return "inline";
+    case StackFrame::FRAME_TRUST_LEAF:
+      return "leaf";
+    default:
+      return "none";
+  }
+}
+
+// ModuleIndex maps modules' base addresses to their indices in the dump's
+// CodeModules, sorted by address.
+typedef vector<std::pair<uint64_t, unsigned int>> ModuleIndex;
+
+// PrintStackJSON appends the call stack in |stack| to |out| as a JSON
+// array of frames, as described by processor/stackwalk_json_schema.json.
+// Frames refer to their module by its index, looked up in |module_index|.
+static void PrintStackJSON(const CallStack* stack,
+                           const ModuleIndex& module_index,
+                           OutputBuffer* out) {
+  out->Append('[');
+  int frame_count = stack->frames()->size();
+  for (int frame_index = 0; frame_index < frame_count; ++frame_index) {
+    const StackFrame* frame = stack->frames()->at(frame_index);
+    if (frame_index > 0)
+      out->Append(',');
+    out->Append('{');
+    uint64_t instruction_address = frame->ReturnAddress();
+    out->AppendJSONKey("address", /*first=*/true);
+    out->AppendJSONHex(instruction_address);
+
+    const CodeModule* module = frame->module;
+    if (module) {
+      // |frame->module| need not belong to the dump's CodeModules
+      // instance, so look it up by address.
+      ModuleIndex::const_iterator entry = std::lower_bound(
+          module_index.begin(), module_index.end(),
+          std::make_pair(module->base_address(), 0U));
+      if (entry != module_index.end() &&
+          entry->first == module->base_address()) {
+        out->AppendJSONKey("module");
+        out->AppendInt(entry->second);
+      }
+    }
+
+    uint64_t offset_base = 0;
+    if (!frame->function_name.empty()) {
+      out->AppendJSONKey("function");
+      out->AppendJSONString(frame->function_name);
+      offset_base = frame->function_base;
+      if (!frame->source_file_name.empty()) {
+        out->AppendJSONKey("file");
+        out->AppendJSONString(frame->source_file_name);
+        out->AppendJSONKey("line");
+        out->AppendInt(frame->source_line);
+        offset_base = frame->source_line_base;
+      }
+    } else if (module) {
+      offset_base = module->base_address();
+    }
+    out->AppendJSONKey("offset");
+    out->AppendJSONHex(instruction_address - offset_base);
+    out->AppendJSONKey("trust");
+    out->AppendJSONString(FrameTrustName(frame->trust));
+    out->Append('}');
+  }
+  out->Append(']');
+}
+
 // ContainsModule checks whether a given |module| is in the vector
 // |modules_without_symbols|.
 static bool ContainsModule(
@@ -1085,7 +1264,8 @@ static void PrintModules(
 // text format:
 // Module|{Module Filename}|{Version}|{Debug Filename}|{Debug Identifier}|
 // {Base Address}|{Max Address}|{Main}
-static void PrintModulesMachineReadable(const CodeModules* modules) {
+static void PrintModulesMachineReadable(const CodeModules* modules,
+                                        OutputBuffer* out) {
   if (!modules)
     return;
 
@@ -1101,19 +1281,89 @@ static void PrintModulesMachineReadable(const CodeModules* modules) {
        ++module_sequence) {
     const CodeModule* module = modules->GetModuleAtSequence(module_sequence);
     uint64_t base_address = module->base_address();
-    printf("Module%c%s%c%s%c%s%c%s%c0x%08" PRIx64 "%c0x%08" PRIx64 "%c%d\n",
-           kOutputSeparator,
-           StripSeparator(PathnameStripper::File(module->code_file())).c_str(),
-           kOutputSeparator, StripSeparator(module->version()).c_str(),
-           kOutputSeparator,
-           StripSeparator(PathnameStripper::File(module->debug_file())).c_str(),
-           kOutputSeparator,
-           StripSeparator(module->debug_identifier()).c_str(),
-           kOutputSeparator, base_address,
-           kOutputSeparator, base_address + module->size() - 1,
-           kOutputSeparator,
-           main_module != NULL && base_address == main_address ? 1 : 0);
+    const string& code_file = module->code_file();
+    const string& debug_file = module->debug_file();
+    out->Append("Module");
+    out->Append(kOutputSeparator);
+    out->AppendField(code_file, FileNameStart(code_file));
+    out->Append(kOutputSeparator);
+    out->AppendField(module->version());
+    out->Append(kOutputSeparator);
+    out->AppendField(debug_file, FileNameStart(debug_file));
+    out->Append(kOutputSeparator);
+    out->AppendField(module->debug_identifier());
+    out->Append(kOutputSeparator);
+    out->AppendHex(base_address, 8);
+    out->Append(kOutputSeparator);
+    out->AppendHex(base_address + module->size() - 1, 8);
+    out->Append(kOutputSeparator);
+    out->Append(main_module != NULL && base_address == main_address ?
+                '1' : '0');
+    out->Append('\n');
+  }
+}
+
+// PrintModulesJSON appends the loaded |modules| to |out| as a JSON array,
+// as described by processor/stackwalk_json_schema.json, and fills in
+// |module_index| for PrintStackJSON.
+static void PrintModulesJSON(
+    const CodeModules* modules,
+    const vector<const CodeModule*>* modules_without_symbols,
+    const vector<const CodeModule*>* modules_with_corrupt_symbols,
+    ModuleIndex* module_index,
+    OutputBuffer* out) {
+  out->Append('[');
+  if (!modules) {
+    out->Append(']');
+    return;
+  }
+
+  uint64_t main_address = 0;
+  const CodeModule* main_module = modules->GetMainModule();
+  if (main_module) {
+    main_address = main_module->base_address();
+  }
+
+  unsigned int module_count = modules->module_count();
+  module_index->reserve(module_count);
+  for (unsigned int module_sequence = 0;
+       module_sequence < module_count;
+       ++module_sequence) {
+    const CodeModule* module = modules->GetModuleAtSequence(module_sequence);
+    uint64_t base_address = module->base_address();
+    module_index->push_back(std::make_pair(base_address, module_sequence));
+    const string& code_file = module->code_file();
+    const string& debug_file = module->debug_file();
+    if (module_sequence > 0)
+      out->Append(',');
+    out->Append('{');
+    out->AppendJSONKey("filename", /*first=*/true);
+    out->AppendJSONString(code_file, FileNameStart(code_file));
+    out->AppendJSONKey("version");
+    out->AppendJSONString(module->version());
+    out->AppendJSONKey("debug_file");
+    out->AppendJSONString(debug_file, FileNameStart(debug_file));
+    out->AppendJSONKey("debug_id");
+    out->AppendJSONString(module->debug_identifier());
+    out->AppendJSONKey("base_address");
+    out->AppendJSONHex(base_address);
+    out->AppendJSONKey("end_address");
+    out->AppendJSONHex(base_address + module->size());
+    if (main_module != NULL && base_address == main_address) {
+      out->AppendJSONKey("main");
+      out->Append("true");
+    }
+    if (ContainsModule(modules_without_symbols, module)) {
+      out->AppendJSONKey("symbols");
+      out->Append("\"missing\"");
+    } else if (ContainsModule(modules_with_corrupt_symbols, module)) {
+      out->AppendJSONKey("symbols");
+      out->Append("\"corrupt\"");
+    }
+    out->Append('}');
   }
+  out->Append(']');
+  std::sort(module_index->begin(), module_index->end());
 }
 
 }  // namespace
@@ -1213,64 +1463,72 @@ void PrintProcessState(const ProcessState& process_state,
 }
 
 void PrintProcessStateMachineReadable(const ProcessState& process_state) {
+  OutputBuffer out;
+  const SystemInfo* system_info = process_state.system_info();
+
   // Print OS and CPU information.
   // OS|{OS Name}|{OS Version}
   // CPU|{CPU Name}|{CPU Info}|{Number of CPUs}
   // GPU|{GPU version}|{GPU vendor}|{GPU renderer}
-  printf("OS%c%s%c%s\n", kOutputSeparator,
-         StripSeparator(process_state.system_info()->os).c_str(),
-         kOutputSeparator,
-         StripSeparator(process_state.system_info()->os_version).c_str());
-  printf("CPU%c%s%c%s%c%d\n", kOutputSeparator,
-         StripSeparator(process_state.system_info()->cpu).c_str(),
-         kOutputSeparator,
-         // this may be empty
-         StripSeparator(process_state.system_info()->cpu_info).c_str(),
-         kOutputSeparator,
-         process_state.system_info()->cpu_count);
-  printf("GPU%c%s%c%s%c%s\n", kOutputSeparator,
-         StripSeparator(process_state.system_info()->gl_version).c_str(),
-         kOutputSeparator,
-         StripSeparator(process_state.system_info()->gl_vendor).c_str(),
-         kOutputSeparator,
-         StripSeparator(process_state.system_info()->gl_renderer).c_str());
+  out.Append("OS");
+  out.Append(kOutputSeparator);
+  out.AppendField(system_info->os);
+  out.Append(kOutputSeparator);
+  out.AppendField(system_info->os_version);
+  out.Append("\nCPU");
+  out.Append(kOutputSeparator);
+  out.AppendField(system_info->cpu);
+  out.Append(kOutputSeparator);
+  out.AppendField(system_info->cpu_info);  // this may be empty
+  out.Append(kOutputSeparator);
+  out.AppendInt(system_info->cpu_count);
+  out.Append("\nGPU");
+  out.Append(kOutputSeparator);
+  out.AppendField(system_info->gl_version);
+  out.Append(kOutputSeparator);
+  out.AppendField(system_info->gl_vendor);
+  out.Append(kOutputSeparator);
+  out.AppendField(system_info->gl_renderer);
+  out.Append('\n');
 
   int requesting_thread = process_state.requesting_thread();
 
   // Print crash information.
   // Crash|{Crash Reason}|{Crash Address}|{Crashed Thread}
-  printf("Crash%c", kOutputSeparator);
+  out.Append("Crash");
+  out.Append(kOutputSeparator);
   if (process_state.crashed()) {
-    printf("%s%c0x%" PRIx64 "%c",
-           StripSeparator(process_state.crash_reason()).c_str(),
-           kOutputSeparator, process_state.crash_address(), kOutputSeparator);
+    out.AppendField(process_state.crash_reason());
+    out.Append(kOutputSeparator);
+    out.AppendHex(process_state.crash_address());
   } else {
     // print assertion info, if available, in place of crash reason,
     // instead of the unhelpful "No crash"
-    string assertion = process_state.assertion();
+    const string& assertion = process_state.assertion();
     if (!assertion.empty()) {
-      printf("%s%c%c", StripSeparator(assertion).c_str(),
-             kOutputSeparator, kOutputSeparator);
+      out.AppendField(assertion);
     } else {
-      printf("No crash%c%c", kOutputSeparator, kOutputSeparator);
+      out.Append("No crash");
     }
+    out.Append(kOutputSeparator);
   }
+  out.Append(kOutputSeparator);
 
   if (requesting_thread != -1) {
-    printf("%d\n", requesting_thread);
-  } else {
-    printf("\n");
+    out.AppendInt(requesting_thread);
   }
+  out.Append('\n');
 
-  PrintModulesMachineReadable(process_state.modules());
+  PrintModulesMachineReadable(process_state.modules(), &out);
 
   // blank line to indicate start of threads
-  printf("\n");
+  out.Append('\n');
 
   // If the thread that requested the dump is known, print it first.
   if (requesting_thread != -1) {
     PrintStackMachineReadable(requesting_thread,
-                              process_state.threads()->at(requesting_thread));
+                              process_state.threads()->at(requesting_thread),
+                              &out);
   }
 
   // Print all of the threads in the dump.
@@ -1279,9 +1537,88 @@ void PrintProcessStateMachineReadable(const ProcessState& process_state) {
     if (thread_index != requesting_thread) {
       // Don't print the crash thread again, it was already printed.
       PrintStackMachineReadable(thread_index,
-                                process_state.threads()->at(thread_index));
+                                process_state.threads()->at(thread_index),
+                                &out);
     }
   }
+
+  out.Flush();
+}
+
+void PrintProcessStateJSON(const ProcessState& process_state) {
+  OutputBuffer out;
+  const SystemInfo* system_info = process_state.system_info();
+
+  out.Append('{');
+  out.AppendJSONKey("os", /*first=*/true);
+  out.Append('{');
+  out.AppendJSONKey("name", /*first=*/true);
+  out.AppendJSONString(system_info->os);
+  out.AppendJSONKey("version");
+  out.AppendJSONString(system_info->os_version);
+  out.Append('}');
+
+  out.AppendJSONKey("cpu");
+  out.Append('{');
+  out.AppendJSONKey("arch", /*first=*/true);
+  out.AppendJSONString(system_info->cpu);
+  out.AppendJSONKey("info");
+  out.AppendJSONString(system_info->cpu_info);
+  out.AppendJSONKey("count");
+  out.AppendInt(system_info->cpu_count);
+  out.Append('}');
+
+  out.AppendJSONKey("gpu");
+  out.Append('{');
+  out.AppendJSONKey("version", /*first=*/true);
+  out.AppendJSONString(system_info->gl_version);
+  out.AppendJSONKey("vendor");
+  out.AppendJSONString(system_info->gl_vendor);
+  out.AppendJSONKey("renderer");
+  out.AppendJSONString(system_info->gl_renderer);
+  out.Append('}');
+
+  if (process_state.crashed()) {
+    out.AppendJSONKey("crash");
+    out.Append('{');
+    out.AppendJSONKey("reason", /*first=*/true);
+    out.AppendJSONString(process_state.crash_reason());
+    out.AppendJSONKey("address");
+    out.AppendJSONHex(process_state.crash_address());
+    out.Append('}');
+  }
+  if (!process_state.assertion().empty()) {
+    out.AppendJSONKey("assertion");
+    out.AppendJSONString(process_state.assertion());
+  }
+  int requesting_thread = process_state.requesting_thread();
+  if (requesting_thread != -1) {
+    out.AppendJSONKey("requesting_thread");
+    out.AppendInt(requesting_thread);
+  }
+
+  ModuleIndex module_index;
+  out.AppendJSONKey("modules");
+  PrintModulesJSON(process_state.modules(),
+                   process_state.modules_without_symbols(),
+                   process_state.modules_with_corrupt_symbols(),
+                   &module_index, &out);
+
+  out.AppendJSONKey("threads");
+  out.Append('[');
+  int thread_count = process_state.threads()->size();
+  for (int thread_index = 0; thread_index < thread_count; ++thread_index) {
+    if (thread_index > 0)
+      out.Append(',');
+    out.Append('{');
+    out.AppendJSONKey("frames", /*first=*/true);
+    PrintStackJSON(process_state.threads()->at(thread_index), module_index,
+                   &out);
+    out.Append('}');
+  }
+  out.Append("]}\n");
+
+  out.Flush();
 }
 
 void PrintRequestingThreadBrief(const ProcessState& process_state) {
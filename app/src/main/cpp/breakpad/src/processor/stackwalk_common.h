@@ -39,6 +39,9 @@ class ProcessState;
 class SourceLineResolverInterface;
 
 void PrintProcessStateMachineReadable(const ProcessState& process_state);
+// Prints |process_state| to stdout as a single line holding a JSON object,
+// laid out as described by processor/stackwalk_json_schema.json.
+void PrintProcessStateJSON(const ProcessState& process_state);
 void PrintProcessState(const ProcessState& process_state,
                        bool output_stack_contents,
                        bool output_requesting_thread_only,
@@ -39,6 +39,9 @@
 #include "google_breakpad/processor/stackwalker.h"
 
 #include <assert.h>
+#include <string.h>
+
+#include <algorithm>
 
 #include "common/scoped_ptr.h"
 #include "google_breakpad/processor/call_stack.h"
@@ -48,8 +51,10 @@
 #include "google_breakpad/processor/stack_frame.h"
 #include "google_breakpad/processor/stack_frame_symbolizer.h"
 #include "google_breakpad/processor/system_info.h"
+#include "processor/frame_arena.h"
 #include "processor/linked_ptr.h"
 #include "processor/logging.h"
+#include "processor/module_range_table.h"
 #include "processor/stackwalker_ppc.h"
 #include "processor/stackwalker_ppc64.h"
 #include "processor/stackwalker_sparc.h"
@@ -83,10 +88,13 @@ Stackwalker::Stackwalker(const SystemInfo* system_info,
       memory_(memory),
       modules_(modules),
       unloaded_modules_(NULL),
-      frame_symbolizer_(frame_symbolizer) {
+      frame_symbolizer_(frame_symbolizer),
+      frame_arena_(NULL) {
   assert(frame_symbolizer_);
 }
 
+Stackwalker::~Stackwalker() {}
+
 void InsertSpecialAttentionModule(
     StackFrameSymbolizer::SymbolizerResult symbolizer_result,
     const CodeModule* module,
@@ -135,15 +143,22 @@ bool Stackwalker::Walk(
   // so far, as the caller may have set a limit.
   uint32_t scanned_frames = 0;
 
+  // Frames, including inlined frames created by the resolver, come from
+  // the arena if there is one.
+  FrameArena::Scope arena_scope(frame_arena_);
+
   // Take ownership of the pointer returned by GetContextFrame.
   scoped_ptr<StackFrame> frame(GetContextFrame());
 
+  // Emptied on every iteration, but kept across them so that its storage is
+  // only allocated once per walk.
+  std::deque<std::unique_ptr<StackFrame>> inlined_frames;
+
   while (frame.get()) {
     // frame already contains a good frame with properly set instruction and
     // frame_pointer fields.  The frame structure comes from either the
     // context frame (above) or a caller frame (below).
 
-    std::deque<std::unique_ptr<StackFrame>> inlined_frames;
     // Resolve the module information, if a module map was provided.
     StackFrameSymbolizer::SymbolizerResult symbolizer_result =
         frame_symbolizer_->FillSourceLineInfo(modules_, unloaded_modules_,
@@ -327,6 +342,64 @@ bool Stackwalker::TerminateWalk(uint64_t caller_ip,
   return false;
 }
 
+bool Stackwalker::ScanStackInPlace(uint64_t location_start,
+                                   size_t word_size,
+                                   int searchwords,
+                                   bool* found,
+                                   uint64_t* location_found,
+                                   uint64_t* ip_found) {
+  assert(word_size == sizeof(uint32_t) || word_size == sizeof(uint64_t));
+  const uint8_t* memory = memory_->GetContiguousMemory();
+  if (!memory || searchwords < 0 ||
+      static_cast<uint64_t>(searchwords) * word_size >
+          UINT64_MAX - location_start)
+    return false;
+
+  *found = false;
+  uint64_t base = memory_->GetBase();
+  uint64_t size = memory_->GetSize();
+  if (!modules_ || location_start < base || location_start - base >= size)
+    return true;
+
+  // Scan searchwords + 1 words, or up to the end of the region.
+  uint64_t offset = location_start - base;
+  size_t count = static_cast<size_t>(
+      std::min<uint64_t>((size - offset) / word_size, searchwords + 1ULL));
+  const uint8_t* words = memory + offset;
+
+  if (!module_ranges_.get())
+    module_ranges_.reset(new ModuleRangeTable(modules_));
+  for (size_t i = 0; i < count; ++i) {
+    uint64_t ip;
+    if (word_size == sizeof(uint32_t)) {
+      i = module_ranges_->FindCandidate<uint32_t>(words, count, i);
+      if (i == count)
+        break;
+      uint32_t ip32;
+      memcpy(&ip32, words + i * word_size, sizeof(ip32));
+      ip = ip32;
+    } else {
+      i = module_ranges_->FindCandidate<uint64_t>(words, count, i);
+      if (i == count)
+        break;
+      memcpy(&ip, words + i * word_size, sizeof(ip));
+    }
+
+    // As in ScanForReturnAddress, check the call instruction rather than
+    // the return address, in case the caller was a no-return function.
+    uint64_t call = word_size == sizeof(uint32_t) ?
+        static_cast<uint32_t>(ip - 1) : ip - 1;
+    if (modules_->GetModuleForAddress(call) &&
+        InstructionAddressSeemsValid(call)) {
+      *found = true;
+      *location_found = location_start + i * word_size;
+      *ip_found = ip;
+      return true;
+    }
+  }
+  return true;
+}
+
 bool Stackwalker::InstructionAddressSeemsValid(uint64_t address) const {
   StackFrame frame;
   frame.instruction = address;
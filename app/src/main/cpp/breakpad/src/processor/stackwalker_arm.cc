@@ -93,28 +93,31 @@ StackFrameARM* StackwalkerARM::GetCallerByCFIFrameInfo(
     NULL
   };
 
-  // Populate a dictionary with the valid register values in last_frame.
-  CFIFrameInfo::RegisterValueMap<uint32_t> callee_registers;
-  for (int i = 0; register_names[i]; i++)
+  static const size_t register_count =
+      sizeof(register_names) / sizeof(register_names[0]) - 1;
+
+  // Populate a register file with the valid register values in last_frame.
+  CFIFrameInfo::RegisterFile<uint32_t> callee_registers;
+  for (size_t i = 0; i < register_count; i++)
     if (last_frame->context_validity & StackFrameARM::RegisterValidFlag(i))
-      callee_registers[register_names[i]] = last_frame->context.iregs[i];
+      callee_registers.Set(i, last_frame->context.iregs[i]);
 
   // Use the STACK CFI data to recover the caller's register values.
-  CFIFrameInfo::RegisterValueMap<uint32_t> caller_registers;
-  if (!cfi_frame_info->FindCallerRegs(callee_registers, *memory_,
-                                      &caller_registers))
+  CFIFrameInfo::RegisterFile<uint32_t> caller_registers;
+  uint32_t cfa, ra;
+  if (!cfi_frame_info->FindCallerRegs(register_names, register_count,
+                                      callee_registers, *memory_,
+                                      &caller_registers, &cfa, &ra))
     return NULL;
 
   // Construct a new stack frame given the values the CFI recovered.
   scoped_ptr<StackFrameARM> frame(new StackFrameARM());
-  for (int i = 0; register_names[i]; i++) {
-    CFIFrameInfo::RegisterValueMap<uint32_t>::iterator entry =
-      caller_registers.find(register_names[i]);
-    if (entry != caller_registers.end()) {
+  for (size_t i = 0; i < register_count; i++) {
+    if (caller_registers.Has(i)) {
       // We recovered the value of this register; fill the context with the
       // value from caller_registers.
       frame->context_validity |= StackFrameARM::RegisterValidFlag(i);
-      frame->context.iregs[i] = entry->second;
+      frame->context.iregs[i] = caller_registers.Get(i);
     } else if (4 <= i && i <= 11 && (last_frame->context_validity &
                                      StackFrameARM::RegisterValidFlag(i))) {
       // If the STACK CFI data doesn't mention some callee-saves register, and
@@ -127,31 +130,23 @@ StackFrameARM* StackwalkerARM::GetCallerByCFIFrameInfo(
   }
   // If the CFI doesn't recover the PC explicitly, then use .ra.
   if (!(frame->context_validity & StackFrameARM::CONTEXT_VALID_PC)) {
-    CFIFrameInfo::RegisterValueMap<uint32_t>::iterator entry =
-      caller_registers.find(".ra");
-    if (entry != caller_registers.end()) {
-      if (fp_register_ == -1) {
-        frame->context_validity |= StackFrameARM::CONTEXT_VALID_PC;
-        frame->context.iregs[MD_CONTEXT_ARM_REG_PC] = entry->second;
-      } else {
-        // The CFI updated the link register and not the program counter.
-        // Handle getting the program counter from the link register.
-        frame->context_validity |= StackFrameARM::CONTEXT_VALID_PC;
-        frame->context_validity |= StackFrameARM::CONTEXT_VALID_LR;
-        frame->context.iregs[MD_CONTEXT_ARM_REG_LR] = entry->second;
-        frame->context.iregs[MD_CONTEXT_ARM_REG_PC] =
-            last_frame->context.iregs[MD_CONTEXT_ARM_REG_LR];
-      }
+    if (fp_register_ == -1) {
+      frame->context_validity |= StackFrameARM::CONTEXT_VALID_PC;
+      frame->context.iregs[MD_CONTEXT_ARM_REG_PC] = ra;
+    } else {
+      // The CFI updated the link register and not the program counter.
+      // Handle getting the program counter from the link register.
+      frame->context_validity |= StackFrameARM::CONTEXT_VALID_PC;
+      frame->context_validity |= StackFrameARM::CONTEXT_VALID_LR;
+      frame->context.iregs[MD_CONTEXT_ARM_REG_LR] = ra;
+      frame->context.iregs[MD_CONTEXT_ARM_REG_PC] =
+          last_frame->context.iregs[MD_CONTEXT_ARM_REG_LR];
     }
   }
   // If the CFI doesn't recover the SP explicitly, then use .cfa.
   if (!(frame->context_validity & StackFrameARM::CONTEXT_VALID_SP)) {
-    CFIFrameInfo::RegisterValueMap<uint32_t>::iterator entry =
-      caller_registers.find(".cfa");
-    if (entry != caller_registers.end()) {
-      frame->context_validity |= StackFrameARM::CONTEXT_VALID_SP;
-      frame->context.iregs[MD_CONTEXT_ARM_REG_SP] = entry->second;
-    }
+    frame->context_validity |= StackFrameARM::CONTEXT_VALID_SP;
+    frame->context.iregs[MD_CONTEXT_ARM_REG_SP] = cfa;
   }
 
   // If we didn't recover the PC and the SP, then the frame isn't very useful.
@@ -76,6 +76,14 @@ class MockMemoryRegion: public google_breakpad::MemoryRegion {
   bool GetMemoryAtAddress(uint64_t address, uint64_t* value) const {
     return GetMemoryLittleEndian(address, value);
   }
+  const uint8_t* GetContiguousMemory() const {
+#if defined(__BIG_ENDIAN__) || \
+  (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    return NULL;
+#else
+    return reinterpret_cast<const uint8_t*>(contents_.data());
+#endif
+  }
   void Print() const {
     assert(false);
   }
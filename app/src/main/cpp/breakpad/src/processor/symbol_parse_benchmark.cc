@@ -0,0 +1,216 @@
+// Copyright 2024 Google LLC
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google LLC nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// symbol_parse_benchmark.cc: Measures how long BasicSourceLineResolver
+// takes to load text symbol files with different numbers of parse threads.
+//
+// For each thread count, every symbol file is loaded from memory several
+// times, and the fastest load is reported, so that the time doesn't include
+// reading the file.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>  // Must come first
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/path_helper.h"
+#include "common/using_std_string.h"
+#include "google_breakpad/processor/basic_source_line_resolver.h"
+#include "processor/basic_code_module.h"
+#include "processor/logging.h"
+
+namespace {
+
+using google_breakpad::BasicCodeModule;
+using google_breakpad::BasicSourceLineResolver;
+using google_breakpad::SourceLineResolverBase;
+using std::vector;
+
+struct Options {
+  vector<int> thread_counts;
+  int repeat_count;
+  vector<string> symbol_files;
+};
+
+// Returns the fastest of |options.repeat_count| loads of |symbol_data|
+// with |thread_count| parse threads, in seconds, or a negative number if
+// the load fails.
+double TimeLoad(const Options& options, const vector<char>& symbol_data,
+                int thread_count) {
+  double best = -1;
+  for (int i = 0; i < options.repeat_count; ++i) {
+    // Loading modifies the data, so each load gets a fresh copy.
+    vector<char> buffer(symbol_data);
+    BasicCodeModule module(0, 0, "module", "", "", "", "");
+    BasicSourceLineResolver resolver;
+    resolver.set_parse_thread_count(thread_count);
+
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    if (!resolver.LoadModuleUsingMemoryBuffer(&module, buffer.data(),
+                                              buffer.size())) {
+      return -1;
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (best < 0 || elapsed.count() < best)
+      best = elapsed.count();
+
+    // Unloading isn't part of the measurement.
+    resolver.UnloadModule(&module);
+  }
+  return best;
+}
+
+int RunBenchmark(const Options& options) {
+  printf("%-40s %12s %8s %10s %8s\n",
+         "symbol file", "size (MiB)", "threads", "load (s)", "speedup");
+  for (const string& symbol_file : options.symbol_files) {
+    char* data;
+    size_t size;
+    if (!SourceLineResolverBase::ReadSymbolFile(symbol_file, &data, &size)) {
+      fprintf(stderr, "Could not read %s\n", symbol_file.c_str());
+      return 1;
+    }
+    vector<char> symbol_data(data, data + size);
+    delete [] data;
+
+    double serial_time = 0;
+    for (int thread_count : options.thread_counts) {
+      double time = TimeLoad(options, symbol_data, thread_count);
+      if (time < 0) {
+        fprintf(stderr, "Could not load %s\n", symbol_file.c_str());
+        return 1;
+      }
+      if (serial_time == 0)
+        serial_time = time;
+      printf("%-40s %12.1f %8d %10.3f %7.2fx\n",
+             google_breakpad::BaseName(symbol_file).c_str(),
+             size / (1024.0 * 1024.0), thread_count, time,
+             serial_time / time);
+    }
+  }
+  return 0;
+}
+
+void Usage(int argc, const char* argv[], bool error) {
+  fprintf(error ? stderr : stdout,
+          "Usage: %s [options] <symbol-file> [<symbol-file> ...]\n"
+          "\n"
+          "Times loading Breakpad text symbol files with different numbers\n"
+          "of parse threads.\n"
+          "\n"
+          "Options:\n"
+          "\n"
+          "  -j <n,...>  Thread counts to measure; the first is the baseline\n"
+          "              for the speedup (default: 1,2,4,... up to the\n"
+          "              number of hardware threads)\n"
+          "  -r <n>      Loads per measurement; the fastest is reported\n"
+          "              (default: 3)\n",
+          google_breakpad::BaseName(argv[0]).c_str());
+}
+
+void SetupOptions(int argc, const char* argv[], Options* options) {
+  int ch;
+
+  options->repeat_count = 3;
+
+  while ((ch = getopt(argc, (char * const*)argv, "hj:r:")) != -1) {
+    switch (ch) {
+      case 'h':
+        Usage(argc, argv, false);
+        exit(0);
+        break;
+
+      case 'j': {
+        options->thread_counts.clear();
+        for (char* count = strtok(optarg, ","); count;
+             count = strtok(NULL, ",")) {
+          int thread_count = atoi(count);
+          if (thread_count < 1) {
+            fprintf(stderr, "%s: Invalid thread count %s\n", argv[0], count);
+            exit(1);
+          }
+          options->thread_counts.push_back(thread_count);
+        }
+        break;
+      }
+
+      case 'r':
+        options->repeat_count = atoi(optarg);
+        if (options->repeat_count < 1) {
+          fprintf(stderr, "%s: Invalid repeat count %s\n", argv[0], optarg);
+          exit(1);
+        }
+        break;
+
+      case '?':
+        Usage(argc, argv, true);
+        exit(1);
+        break;
+    }
+  }
+
+  if (options->thread_counts.empty()) {
+    int max_thread_count = std::thread::hardware_concurrency();
+    for (int thread_count = 1; thread_count < max_thread_count;
+         thread_count *= 2) {
+      options->thread_counts.push_back(thread_count);
+    }
+    options->thread_counts.push_back(std::max(max_thread_count, 1));
+  }
+
+  if ((argc - optind) == 0) {
+    fprintf(stderr, "%s: Missing symbol file\n", argv[0]);
+    Usage(argc, argv, true);
+    exit(1);
+  }
+
+  for (int argi = optind; argi < argc; ++argi)
+    options->symbol_files.push_back(argv[argi]);
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+  BPLOG_INIT(&argc, &argv);
+  Options options;
+  SetupOptions(argc, argv, &options);
+
+  return RunBenchmark(options);
+}
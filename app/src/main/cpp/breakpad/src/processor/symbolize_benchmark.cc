@@ -0,0 +1,255 @@
+// Copyright 2024 Google LLC
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google LLC nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// symbolize_benchmark.cc: Measures how many addresses per second
+// SourceLineResolverBase resolves one frame at a time with
+// FillSourceLineInfo, and in one batch with FillSourceLineInfos.
+//
+// Each symbol file is loaded once.  Random addresses are drawn between its
+// lowest and highest FUNC or PUBLIC address and sorted, as a symbolication
+// pipeline would sort the addresses it collects.  Both paths resolve the
+// same addresses several times, and the fastest run of each is reported.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>  // Must come first
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "common/path_helper.h"
+#include "common/using_std_string.h"
+#include "google_breakpad/processor/basic_source_line_resolver.h"
+#include "google_breakpad/processor/stack_frame.h"
+#include "processor/basic_code_module.h"
+#include "processor/logging.h"
+
+namespace {
+
+using google_breakpad::BasicCodeModule;
+using google_breakpad::BasicSourceLineResolver;
+using google_breakpad::SourceLineResolverBase;
+using google_breakpad::StackFrame;
+using std::vector;
+
+struct Options {
+  int address_count;
+  int repeat_count;
+  vector<string> symbol_files;
+};
+
+// Finds the lowest and highest addresses of the FUNC and PUBLIC records in
+// the null-terminated |symbol_data|.  Returns false if there are none.
+bool FindAddressRange(const char* symbol_data, uint64_t* low,
+                      uint64_t* high) {
+  bool found = false;
+  for (const char* line = symbol_data; *line; ) {
+    const char* address = NULL;
+    if (strncmp(line, "FUNC ", 5) == 0)
+      address = line + 5;
+    else if (strncmp(line, "PUBLIC ", 7) == 0)
+      address = line + 7;
+    if (address) {
+      if (strncmp(address, "m ", 2) == 0)
+        address += 2;
+      uint64_t value = strtoull(address, NULL, 16);
+      if (!found || value < *low)
+        *low = value;
+      if (!found || value > *high)
+        *high = value;
+      found = true;
+    }
+
+    const char* next = strchr(line, '\n');
+    if (!next)
+      break;
+    line = next + 1;
+  }
+  return found;
+}
+
+// Returns the fastest of |options.repeat_count| runs of |resolve|, in
+// seconds.  |resolve| fills in a fresh vector of frames each time.
+template<typename Resolve>
+double TimeResolve(const Options& options, Resolve resolve,
+                   vector<StackFrame>* frames) {
+  double best = -1;
+  for (int i = 0; i < options.repeat_count; ++i) {
+    frames->clear();
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    resolve(frames);
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (best < 0 || elapsed.count() < best)
+      best = elapsed.count();
+  }
+  return best;
+}
+
+int RunBenchmark(const Options& options) {
+  printf("%-40s %10s %14s %14s %8s\n",
+         "symbol file", "addresses", "frame (M/s)", "batch (M/s)", "speedup");
+  for (const string& symbol_file : options.symbol_files) {
+    char* data;
+    size_t size;
+    if (!SourceLineResolverBase::ReadSymbolFile(symbol_file, &data, &size)) {
+      fprintf(stderr, "Could not read %s\n", symbol_file.c_str());
+      return 1;
+    }
+    uint64_t low = 0, high = 0;
+    bool found = FindAddressRange(data, &low, &high);
+
+    BasicCodeModule module(0, 0, "module", "", "", "", "");
+    BasicSourceLineResolver resolver;
+    bool loaded = resolver.LoadModuleUsingMemoryBuffer(&module, data, size);
+    delete [] data;
+    if (!loaded) {
+      fprintf(stderr, "Could not load %s\n", symbol_file.c_str());
+      return 1;
+    }
+    if (!found) {
+      fprintf(stderr, "No FUNC or PUBLIC records in %s\n",
+              symbol_file.c_str());
+      return 1;
+    }
+
+    // A fixed seed keeps runs comparable.
+    std::mt19937_64 random(0);
+    std::uniform_int_distribution<uint64_t> offsets(low, high);
+    vector<SourceLineResolverBase::ModuleOffset> addresses;
+    addresses.reserve(options.address_count);
+    for (int i = 0; i < options.address_count; ++i)
+      addresses.push_back(std::make_pair(&module, offsets(random)));
+    std::sort(addresses.begin(), addresses.end());
+
+    vector<StackFrame> frames;
+    double frame_time = TimeResolve(options,
+        [&](vector<StackFrame>* frames) {
+          frames->resize(addresses.size());
+          for (size_t j = 0; j < addresses.size(); ++j) {
+            StackFrame* frame = &(*frames)[j];
+            frame->module = addresses[j].first;
+            frame->instruction = addresses[j].second;
+            resolver.FillSourceLineInfo(frame, nullptr);
+          }
+        }, &frames);
+    double batch_time = TimeResolve(options,
+        [&](vector<StackFrame>* frames) {
+          resolver.FillSourceLineInfos(addresses, frames);
+        }, &frames);
+
+    printf("%-40s %10d %14.2f %14.2f %7.2fx\n",
+           google_breakpad::BaseName(symbol_file).c_str(),
+           options.address_count,
+           addresses.size() / frame_time / 1e6,
+           addresses.size() / batch_time / 1e6,
+           frame_time / batch_time);
+  }
+  return 0;
+}
+
+void Usage(int argc, const char* argv[], bool error) {
+  fprintf(error ? stderr : stdout,
+          "Usage: %s [options] <symbol-file> [<symbol-file> ...]\n"
+          "\n"
+          "Times resolving random sorted addresses in Breakpad text symbol\n"
+          "files one frame at a time and in one batch.\n"
+          "\n"
+          "Options:\n"
+          "\n"
+          "  -n <n>      Addresses to resolve per symbol file\n"
+          "              (default: 1000000)\n"
+          "  -r <n>      Runs per measurement; the fastest is reported\n"
+          "              (default: 3)\n",
+          google_breakpad::BaseName(argv[0]).c_str());
+}
+
+void SetupOptions(int argc, const char* argv[], Options* options) {
+  int ch;
+
+  options->address_count = 1000000;
+  options->repeat_count = 3;
+
+  while ((ch = getopt(argc, (char * const*)argv, "hn:r:")) != -1) {
+    switch (ch) {
+      case 'h':
+        Usage(argc, argv, false);
+        exit(0);
+        break;
+
+      case 'n':
+        options->address_count = atoi(optarg);
+        if (options->address_count < 1) {
+          fprintf(stderr, "%s: Invalid address count %s\n", argv[0], optarg);
+          exit(1);
+        }
+        break;
+
+      case 'r':
+        options->repeat_count = atoi(optarg);
+        if (options->repeat_count < 1) {
+          fprintf(stderr, "%s: Invalid repeat count %s\n", argv[0], optarg);
+          exit(1);
+        }
+        break;
+
+      case '?':
+        Usage(argc, argv, true);
+        exit(1);
+        break;
+    }
+  }
+
+  if ((argc - optind) == 0) {
+    fprintf(stderr, "%s: Missing symbol file\n", argv[0]);
+    Usage(argc, argv, true);
+    exit(1);
+  }
+
+  for (int argi = optind; argi < argc; ++argi)
+    options->symbol_files.push_back(argv[argi]);
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+  BPLOG_INIT(&argc, &argv);
+  Options options;
+  SetupOptions(argc, argv, &options);
+
+  return RunBenchmark(options);
+}
@@ -1140,6 +1140,9 @@ struct kernel_statx {
 #ifndef __NR_getrandom
 #define __NR_getrandom          355
 #endif
+#ifndef __NR_process_vm_readv
+#define __NR_process_vm_readv   347
+#endif
 /* End of i386 definitions                                                   */
 #elif defined(__ARM_ARCH_3__) || defined(__ARM_EABI__)
 #ifndef __NR_setresuid
@@ -1250,6 +1253,9 @@ struct kernel_statx {
 #ifndef __NR_getrandom
 #define __NR_getrandom          (__NR_SYSCALL_BASE + 384)
 #endif
+#ifndef __NR_process_vm_readv
+#define __NR_process_vm_readv   (__NR_SYSCALL_BASE + 376)
+#endif
 /* End of ARM 3/EABI definitions                                             */
 #elif defined(__aarch64__) || defined(__riscv) || defined(__loongarch_lp64)
 #ifndef __NR_setxattr
@@ -1349,6 +1355,9 @@ struct kernel_statx {
 #ifndef __NR_move_pages
 #define __NR_move_pages         239
 #endif
+#ifndef __NR_process_vm_readv
+#define __NR_process_vm_readv   270
+#endif
 #ifndef __NR_getrandom
 #define __NR_getrandom          278
 #endif
@@ -1448,6 +1457,9 @@ struct kernel_statx {
 #ifndef __NR_getrandom
 #define __NR_getrandom          318
 #endif
+#ifndef __NR_process_vm_readv
+#define __NR_process_vm_readv   310
+#endif
 /* End of x86-64 definitions                                                 */
 #elif defined(__mips__)
 #if _MIPS_SIM == _MIPS_SIM_ABI32
@@ -1552,6 +1564,9 @@ struct kernel_statx {
 #ifndef __NR_getrandom
 #define __NR_getrandom          (__NR_Linux + 353)
 #endif
+#ifndef __NR_process_vm_readv
+#define __NR_process_vm_readv   (__NR_Linux + 345)
+#endif
 /* End of MIPS (old 32bit API) definitions */
 #elif  _MIPS_SIM == _MIPS_SIM_ABI64
 #ifndef __NR_pread64
@@ -1633,6 +1648,9 @@ struct kernel_statx {
 #ifndef __NR_getrandom
 #define __NR_getrandom          (__NR_Linux + 313)
 #endif
+#ifndef __NR_process_vm_readv
+#define __NR_process_vm_readv   (__NR_Linux + 304)
+#endif
 /* End of MIPS (64bit API) definitions */
 #else
 #ifndef __NR_setresuid
@@ -1711,6 +1729,9 @@ struct kernel_statx {
 #ifndef __NR_ioprio_get
 #define __NR_ioprio_get         (__NR_Linux + 278)
 #endif
+#ifndef __NR_process_vm_readv
+#define __NR_process_vm_readv   (__NR_Linux + 309)
+#endif
 /* End of MIPS (new 32bit API) definitions                                   */
 #endif
 /* End of MIPS definitions                                                   */
@@ -1823,6 +1844,9 @@ struct kernel_statx {
 #ifndef __NR_getcpu
 #define __NR_getcpu             302
 #endif
+#ifndef __NR_process_vm_readv
+#define __NR_process_vm_readv   351
+#endif
 /* End of powerpc definitions                                              */
 #elif defined(__s390__)
 #ifndef __NR_quotactl
@@ -1924,6 +1948,9 @@ struct kernel_statx {
 #ifndef __NR_fallocate
 #define __NR_fallocate          314
 #endif
+#ifndef __NR_process_vm_readv
+#define __NR_process_vm_readv   340
+#endif
 /* Some syscalls are named/numbered differently between s390 and s390x. */
 #ifdef __s390x__
 # ifndef __NR_getrlimit
@@ -4311,6 +4338,12 @@ struct kernel_statx {
                        const void *,   b, size_t, c)
   LSS_INLINE _syscall3(ssize_t, writev,           int,        f,
                        const struct kernel_iovec*, v, size_t, c)
+  #if defined(__NR_process_vm_readv)
+    LSS_INLINE _syscall6(ssize_t, process_vm_readv, pid_t, p,
+                         const struct kernel_iovec*, lv, unsigned long, lc,
+                         const struct kernel_iovec*, rv, unsigned long, rc,
+                         unsigned long, f)
+  #endif
   #if defined(__NR_getcpu)
     LSS_INLINE _syscall3(long, getcpu, unsigned *, cpu,
                          unsigned *, node, void *, unused)
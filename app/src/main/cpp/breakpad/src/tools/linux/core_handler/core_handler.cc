@@ -79,8 +79,15 @@ bool WriteMinidumpFromCore(const char* filename,
   MappingList mappings;
   AppMemoryList memory_list;
   LinuxCoreDumper dumper(0, core_path, procfs_override);
-  return google_breakpad::WriteMinidump(filename, mappings, memory_list,
-                                        &dumper);
+  if (!google_breakpad::WriteMinidump(filename, mappings, memory_list,
+                                      &dumper)) {
+    return false;
+  }
+
+  const google_breakpad::RemoteMemoryReadStats& stats = dumper.copy_stats();
+  syslog(LOG_INFO, "Copied %llu bytes of process memory\n",
+         static_cast<unsigned long long>(stats.bytes));
+  return true;
 }
 
 bool HandleCrash(pid_t pid, const char* procfs_dir, const char* md_filename) {
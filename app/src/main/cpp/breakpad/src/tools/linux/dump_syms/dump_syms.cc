@@ -32,6 +32,7 @@
 
 #include <paths.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 
 #include <cstring>
@@ -63,6 +64,8 @@ int usage(const char* self) {
   fprintf(stderr, "  -m          Enable writing the optional 'm' field on FUNC "
                                  "and PUBLIC, denoting multiple symbols for "
                                  "the address.\n");
+  fprintf(stderr, "  -j <threads> Process compilation units on this many "
+                                 "threads\n");
   return 1;
 }
 
@@ -75,6 +78,7 @@ int main(int argc, char** argv) {
   bool handle_inter_cu_refs = true;
   bool log_to_stderr = false;
   bool enable_multiple_field = false;
+  int thread_count = 1;
   std::string obj_name;
   const char* obj_os = "Linux";
   int arg_index = 1;
@@ -106,6 +110,17 @@ int main(int argc, char** argv) {
       ++arg_index;
     } else if (strcmp("-m", argv[arg_index]) == 0) {
       enable_multiple_field = true;
+    } else if (strcmp("-j", argv[arg_index]) == 0) {
+      if (arg_index + 1 >= argc) {
+        fprintf(stderr, "Missing argument to -j\n");
+        return usage(argv[0]);
+      }
+      thread_count = atoi(argv[arg_index + 1]);
+      if (thread_count < 1) {
+        fprintf(stderr, "Invalid argument to -j\n");
+        return usage(argv[0]);
+      }
+      ++arg_index;
     } else {
       printf("2.4 %s\n", argv[arg_index]);
       return usage(argv[0]);
@@ -144,6 +159,7 @@ int main(int argc, char** argv) {
                              (cfi ? CFI : NO_DATA) | SYMBOLS_AND_FILES;
     google_breakpad::DumpOptions options(symbol_data, handle_inter_cu_refs,
                                          enable_multiple_field);
+    options.thread_count = thread_count;
     if (!WriteSymbolFile(binary, obj_name, obj_os, debug_dirs, options,
                          std::cout)) {
       fprintf(saved_stderr, "Failed to write symbol file.\n");
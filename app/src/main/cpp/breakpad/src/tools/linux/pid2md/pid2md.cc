@@ -28,35 +28,71 @@
 
 // pid2md.cc: An utility to generate a minidump from a running process
 
+#ifndef __STDC_FORMAT_MACROS
+#define __STDC_FORMAT_MACROS
+#endif  /* __STDC_FORMAT_MACROS */
+
 #ifdef HAVE_CONFIG_H
 #include <config.h>  // Must come first
 #endif
 
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
+#include "client/linux/minidump_writer/linux_ptrace_dumper.h"
 #include "client/linux/minidump_writer/minidump_writer.h"
 #include "common/path_helper.h"
+#include "google_breakpad/common/minidump_exception_linux.h"
+
+using google_breakpad::AppMemoryList;
+using google_breakpad::LinuxPtraceDumper;
+using google_breakpad::MappingList;
+using google_breakpad::RemoteMemoryReadStats;
 
 int main(int argc, char* argv[]) {
+  bool print_stats = false;
+  if (argc == 4 && strcmp(argv[1], "-s") == 0) {
+    print_stats = true;
+    --argc;
+    ++argv;
+  }
+
   if (argc != 3) {
-    fprintf(stderr, "Usage: %s <process id> <minidump file>\n\n",
+    fprintf(stderr, "Usage: %s [-s] <process id> <minidump file>\n\n",
             google_breakpad::BaseName(argv[0]).c_str());
     fprintf(stderr,
             "A tool to generate a minidump from a running process. The process "
             "resumes its\nactivity once the operation is completed. Permission "
-            "to trace the process is\nrequired.\n");
+            "to trace the process is\nrequired.\n\n");
+    fprintf(stderr,
+            "  -s  Print statistics about the memory copied from the "
+            "process\n");
     return EXIT_FAILURE;
   }
 
   pid_t process_id = atoi(argv[1]);
   const char* minidump_file = argv[2];
 
-  if (!google_breakpad::WriteMinidump(minidump_file, process_id, process_id)) {
+  LinuxPtraceDumper dumper(process_id);
+  dumper.set_crash_signal(MD_EXCEPTION_CODE_LIN_DUMP_REQUESTED);
+  dumper.set_crash_thread(process_id);
+  if (!google_breakpad::WriteMinidump(minidump_file, MappingList(),
+                                      AppMemoryList(), &dumper)) {
     fprintf(stderr, "Unable to generate minidump.\n");
     return EXIT_FAILURE;
   }
 
+  if (print_stats) {
+    const RemoteMemoryReadStats& stats = dumper.copy_stats();
+    printf("bytes copied:          %" PRIu64 "\n", stats.bytes);
+    printf("syscalls:              %" PRIu64 "\n", stats.syscalls);
+    printf("  process_vm_readv:    %" PRIu64 "\n", stats.vm_readv_calls);
+    printf("  /proc/<pid>/mem:     %" PRIu64 "\n", stats.proc_mem_calls);
+    printf("  PTRACE_PEEKDATA:     %" PRIu64 "\n", stats.peek_calls);
+  }
+
   return EXIT_SUCCESS;
 }